@@ -12,8 +12,16 @@
 
 #include "kazmath/kazmath.h"
 #include "dlConfig.h"
+#include "dlAlloc.h"
+#include "dlArena.h"
 #include "dlFramework.h"
 #include "dlSceneobject.h"
+#include "dlQueue.h"
+#include "dlBatch.h"
+#include "dlBVH.h"
+#include "dlOcclusion.h"
+#include "dlJob.h"
+#include "dlHierarchy.h"
 #include "dlLog.h"
 #include "skeletal/dlEvaluator.h"
 #include "shader/dlShader.h"
@@ -1,24 +1,304 @@
+#include "dlConfig.h"
 #include "dlCore.h"
 #include "dlTypes.h"
 #include "dlLog.h"
 #include "dlAlloc.h"
+#include "dlHeap.h"
+#include "dlArena.h"
 
 #include <malloc.h>
+#include <stddef.h>
 #include <string.h>
 
+#if DL_THREADS
+#  include <pthread.h>
+#endif
+
 #define DL_DEBUG_CHANNEL "ALLOC"
 
-#ifdef DEBUG
+#if DL_THREADS && defined(__GNUC__)
+__thread dleAlloc DL_D_ALLOC              = ALLOC_CORE;
+#else
 dleAlloc   DL_D_ALLOC                     = ALLOC_CORE;
+#endif
+
+/* guards slab pools and debug counters */
+#if DL_THREADS
+static pthread_mutex_t DL_SLAB_LOCK = PTHREAD_MUTEX_INITIALIZER;
+#  define dlSlabLock()   pthread_mutex_lock( &DL_SLAB_LOCK )
+#  define dlSlabUnlock() pthread_mutex_unlock( &DL_SLAB_LOCK )
+#else
+#  define dlSlabLock()
+#  define dlSlabUnlock()
+#endif
+
+#ifdef DEBUG
 static size_t     DL_ALLOC [ ALLOC_LAST ] =
-{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 static char*      DL_ALLOCN[ ALLOC_LAST ] =
-{ "Core", "Camera", "Sceneobject", "IBO", "VBO", "Animation", "Bone", "Animator", "Evaluator", "Shader", "Material", "Texture", "Texture Cache", "Atlas", "Total" };
+{ "Core", "Camera", "Sceneobject", "IBO", "VBO", "Animation", "Bone", "Animator", "Evaluator", "Shader", "Material", "Texture", "Texture Cache", "Atlas", "Frame Arena", "Total" };
+
+/* high-water marks, total is tracked as allocations happen */
+static size_t     DL_PEAK  [ ALLOC_LAST ];
+
+/* bytes copies share through copy on write */
+static size_t     DL_SHARED[ ALLOC_LAST ];
 
 #define ALLOC_CRITICAL 100 * 1048576 /* 100 MiB */
 #define ALLOC_HIGH     80  * 1048576 /* 80  MiB */
 #define ALLOC_AVERAGE  40  * 1048576 /* 40  MiB */
+
+/* count bytes to current category and raise its high-water mark.
+ * memory freed under other category than it was allocated in
+ * can take count below zero, that is not a peak */
+static void dlAllocCount( size_t add, size_t sub )
+{
+   dlSlabLock();
+   DL_ALLOC[ DL_D_ALLOC ]  += add; DL_ALLOC[ DL_D_ALLOC ]  -= sub;
+   DL_ALLOC[ ALLOC_TOTAL ] += add; DL_ALLOC[ ALLOC_TOTAL ] -= sub;
+
+   if((ptrdiff_t)DL_ALLOC[ DL_D_ALLOC ] > (ptrdiff_t)DL_PEAK[ DL_D_ALLOC ])
+      DL_PEAK[ DL_D_ALLOC ] = DL_ALLOC[ DL_D_ALLOC ];
+   if((ptrdiff_t)DL_ALLOC[ ALLOC_TOTAL ] > (ptrdiff_t)DL_PEAK[ ALLOC_TOTAL ])
+      DL_PEAK[ ALLOC_TOTAL ] = DL_ALLOC[ ALLOC_TOTAL ];
+   dlSlabUnlock();
+}
+#endif
+
+#if DL_SLAB
+/* block sizes of slab classes, larger allocations go to malloc */
+#define DL_SLAB_CLASSES 12
+#define DL_SLAB_MAX     1024
+static const unsigned short DL_SLAB_SIZE[ DL_SLAB_CLASSES ] =
+{ 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+
+/* header in front of blocks of page */
+typedef struct dlSlabPage_t
+{
+   void         *free;           /* released blocks */
+   unsigned int  used, carved, capacity;
+   unsigned char category, size_class;
+
+   /* pages of pool with free blocks */
+   struct dlSlabPage_t *prev, *next;
+} dlSlabPage;
+
+/* first block is this far into page, keeps blocks 16 byte aligned */
+#define DL_SLAB_HEADER ((sizeof(dlSlabPage) + 15) & ~(size_t)15)
+
+/* pages of category and size class */
+typedef struct dlSlabPool_t
+{
+   dlSlabPage   *partial;
+   unsigned int  pages, blocks;
+} dlSlabPool;
+
+static dlSlabPool    DL_SLAB_POOL[ ALLOC_LAST ][ DL_SLAB_CLASSES ];
+
+/* every page sorted by address, for finding page of block */
+static dlSlabPage  **DL_SLAB_PAGES = NULL;
+static unsigned int  DL_SLAB_NUM = 0, DL_SLAB_USE = 0;
+
+/* size class fitting size */
+static unsigned int dlSlabClass( size_t size )
+{
+   unsigned int i = 0;
+   while(DL_SLAB_SIZE[i] < size) ++i;
+   return( i );
+}
+
+/* index of first page above address */
+static unsigned int dlSlabSearch( const void *ptr )
+{
+   unsigned int lo = 0, hi = DL_SLAB_USE, mid;
+
+   while(lo < hi)
+   {
+      mid = (lo + hi) / 2;
+      if((const unsigned char*)DL_SLAB_PAGES[mid] <= (const unsigned char*)ptr) lo = mid + 1;
+      else hi = mid;
+   }
+
+   return( lo );
+}
+
+/* page block belongs to, NULL for malloc memory */
+static dlSlabPage* dlSlabFind( const void *ptr )
+{
+   dlSlabPage  *page;
+   unsigned int i;
+
+   if(!DL_SLAB_USE || !(i = dlSlabSearch( ptr )))
+      return( NULL );
+
+   page = DL_SLAB_PAGES[i - 1];
+   if((const unsigned char*)ptr >= (unsigned char*)page + DL_SLAB_PAGE)
+      return( NULL );
+
+   return( page );
+}
+
+/* link page to pool's pages with free blocks */
+static void dlSlabLink( dlSlabPool *pool, dlSlabPage *page )
+{
+   page->prev = NULL;
+   page->next = pool->partial;
+   if(pool->partial) pool->partial->prev = page;
+   pool->partial = page;
+}
+
+static void dlSlabUnlink( dlSlabPool *pool, dlSlabPage *page )
+{
+   if(page->prev) page->prev->next = page->next;
+   else           pool->partial    = page->next;
+   if(page->next) page->next->prev = page->prev;
+   page->prev = page->next = NULL;
+}
+
+/* new page for pool, pages are not tracked as allocations */
+static dlSlabPage* dlSlabNewPage( unsigned int category, unsigned int size_class )
+{
+   dlSlabPage  **pages, *page;
+   unsigned int  num, i;
+
+   if(DL_SLAB_USE == DL_SLAB_NUM)
+   {
+      num = dlGrowCapacity( DL_SLAB_NUM, DL_SLAB_USE + 1 );
+      if(!(pages = realloc( DL_SLAB_PAGES, num * sizeof(dlSlabPage*) )))
+         return( NULL );
+
+      DL_SLAB_PAGES = pages;
+      DL_SLAB_NUM   = num;
+   }
+
+   if(!(page = malloc( DL_SLAB_PAGE )))
+      return( NULL );
+
+   memset( page, 0, sizeof(dlSlabPage) );
+   page->category   = category;
+   page->size_class = size_class;
+   page->capacity   = (DL_SLAB_PAGE - DL_SLAB_HEADER) / DL_SLAB_SIZE[ size_class ];
+
+   /* keep address order */
+   i = dlSlabSearch( page );
+   memmove( &DL_SLAB_PAGES[i + 1], &DL_SLAB_PAGES[i], (DL_SLAB_USE - i) * sizeof(dlSlabPage*) );
+   DL_SLAB_PAGES[i] = page;
+   DL_SLAB_USE++;
+
+   DL_SLAB_POOL[ category ][ size_class ].pages++;
+   dlSlabLink( &DL_SLAB_POOL[ category ][ size_class ], page );
+   return( page );
+}
+
+static void dlSlabFreePage( dlSlabPage *page )
+{
+   dlSlabPool  *pool = &DL_SLAB_POOL[ page->category ][ page->size_class ];
+   unsigned int i;
+
+   dlSlabUnlink( pool, page );
+   pool->pages--;
+
+   i = dlSlabSearch( page ) - 1;
+   memmove( &DL_SLAB_PAGES[i], &DL_SLAB_PAGES[i + 1], (DL_SLAB_USE - i - 1) * sizeof(dlSlabPage*) );
+   DL_SLAB_USE--;
+
+   free( page );
+}
+
+/* block from pool of current category */
+static void* dlSlabAlloc( size_t size )
+{
+   dlSlabPool   *pool;
+   dlSlabPage   *page;
+   void         *ptr;
+   unsigned int  size_class = dlSlabClass( size );
+
+   dlSlabLock();
+   pool = &DL_SLAB_POOL[ DL_D_ALLOC ][ size_class ];
+   if(!(page = pool->partial) && !(page = dlSlabNewPage( DL_D_ALLOC, size_class )))
+   { dlSlabUnlock(); return( NULL ); }
+
+   if((ptr = page->free))
+      page->free = *(void**)ptr;
+   else
+      ptr = (unsigned char*)page + DL_SLAB_HEADER + page->carved++ * DL_SLAB_SIZE[ size_class ];
+
+   if(++page->used == page->capacity)
+      dlSlabUnlink( pool, page );
+   pool->blocks++;
+   dlSlabUnlock();
+
+   return( ptr );
+}
+
+/* give block back to its page, page empties are released
+ * unless they are last page of pool with room */
+static void dlSlabRelease( dlSlabPage *page, void *ptr )
+{
+   dlSlabPool *pool = &DL_SLAB_POOL[ page->category ][ page->size_class ];
+
+   *(void**)ptr = page->free;
+   page->free   = ptr;
+   pool->blocks--;
+
+   if(page->used-- == page->capacity)
+      dlSlabLink( pool, page );
+
+   if(!page->used && (page->prev || page->next))
+      dlSlabFreePage( page );
+}
+#endif
+
+/* untracked allocation, small sizes come from slab */
+static void* dlAllocRaw( size_t size )
+{
+#if DL_SLAB
+   if(size && size <= DL_SLAB_MAX)
+      return( dlSlabAlloc( size ) );
+#endif
+   return( malloc( size ) );
+}
+
+/* untracked release of dlAllocRaw memory */
+static void dlFreeRaw( void *ptr )
+{
+#if DL_SLAB
+   dlSlabPage *page;
+
+   dlSlabLock();
+   if((page = dlSlabFind( ptr )))
+   {
+      dlSlabRelease( page, ptr );
+      dlSlabUnlock();
+      return;
+   }
+   dlSlabUnlock();
+#endif
+   free( ptr );
+}
+
+/* copy on write allocation
+ * copy shares data of another object, counted as saved memory */
+void dlShareAlloc( size_t size )
+{
+   CALL("%llu", size);
+#ifdef DEBUG
+   dlSlabLock();
+   DL_SHARED[ DL_D_ALLOC ] += size;
+   dlSlabUnlock();
+#endif
+}
+
+/* copy got data of its own */
+void dlUnshareAlloc( size_t size )
+{
+   CALL("%llu", size);
+#ifdef DEBUG
+   dlSlabLock();
+   DL_SHARED[ DL_D_ALLOC ] -= size;
+   dlSlabUnlock();
 #endif
+}
 
 /* fake allocation
  * use when doing allocations using normal operation, but want to keep statistics */
@@ -26,7 +306,7 @@ void dlFakeAlloc( size_t size )
 {
    CALL("%llu", size);
 #ifdef DEBUG
-   DL_ALLOC[ DL_D_ALLOC ] += size;
+   dlAllocCount( size, 0 );
 #endif
 }
 
@@ -37,7 +317,7 @@ void* dlMalloc( size_t size )
    void *ptr;
    CALL("%llu", size);
 
-   ptr = malloc( size );
+   ptr = dlAllocRaw( size );
    if(!ptr)
    {
       LOGERRP("Failed to allocate %llu bytes", (size_t)size);
@@ -47,7 +327,7 @@ void* dlMalloc( size_t size )
    }
 
 #ifdef DEBUG
-   DL_ALLOC[ DL_D_ALLOC ] += size;
+   dlAllocCount( size, 0 );
 #endif
 
    RET("%p", ptr);
@@ -61,6 +341,14 @@ void* dlCalloc( unsigned int items, size_t size )
    void *ptr;
    CALL("%llu", size);
 
+#if DL_SLAB
+   if(items && size && (size_t)items * size <= DL_SLAB_MAX)
+   {
+      if((ptr = dlSlabAlloc( (size_t)items * size )))
+         memset( ptr, 0, (size_t)items * size );
+   }
+   else
+#endif
    ptr = calloc( items, size );
    if(!ptr)
    {
@@ -71,7 +359,7 @@ void* dlCalloc( unsigned int items, size_t size )
    }
 
 #ifdef DEBUG
-   DL_ALLOC[ DL_D_ALLOC ] += items * size;
+   dlAllocCount( (size_t)items * size, 0 );
 #endif
 
    RET("%p", ptr);
@@ -83,12 +371,21 @@ void* dlCalloc( unsigned int items, size_t size )
 void* dlRealloc( void *ptr, unsigned int old_items, unsigned int items, size_t size )
 {
    void *ptr2;
+#if DL_SLAB
+   dlSlabPage *page;
+   size_t      copy;
+#endif
    CALL("%p, %u, %u, %llu", ptr, old_items, items, size);
 
-   ptr2 = realloc( ptr, (size_t)items * size );
-   if(!ptr2)
+#if DL_SLAB
+   /* slab blocks and small new blocks can't go through realloc */
+   dlSlabLock();
+   page = ptr ? dlSlabFind( ptr ) : NULL;
+   dlSlabUnlock();
+
+   if(page || !ptr)
    {
-      ptr2 = dlMalloc( items * size );
+      ptr2 = dlAllocRaw( (size_t)items * size );
       if(!ptr2)
       {
          LOGERRP("Failed to allocate %llu bytes for copy reallocation",
@@ -98,19 +395,39 @@ void* dlRealloc( void *ptr, unsigned int old_items, unsigned int items, size_t s
          return( ptr );
       }
 
-      memcpy( ptr2, ptr, old_items * size );
-      free( ptr );
+      if(page)
+      {
+         copy = (size_t)(old_items < items ? old_items : items) * size;
+         if(copy > DL_SLAB_SIZE[ page->size_class ]) copy = DL_SLAB_SIZE[ page->size_class ];
+         memcpy( ptr2, ptr, copy );
+         dlFreeRaw( ptr );
+      }
       ptr = ptr2;
    }
    else
+#endif
    {
+      ptr2 = realloc( ptr, (size_t)items * size );
+      if(!ptr2)
+      {
+         ptr2 = malloc( (size_t)items * size );
+         if(!ptr2)
+         {
+            LOGERRP("Failed to allocate %llu bytes for copy reallocation",
+                   (size_t)items * size);
+
+            RET("%p", ptr);
+            return( ptr );
+         }
+
+         memcpy( ptr2, ptr, old_items * size );
+         free( ptr );
+      }
       ptr = ptr2;
    }
 
-
 #ifdef DEBUG
-   DL_ALLOC[ DL_D_ALLOC ] -= old_items * size;
-   DL_ALLOC[ DL_D_ALLOC ] += items * size;
+   dlAllocCount( (size_t)items * size, (size_t)old_items * size );
 #endif
 
    RET("%p", ptr);
@@ -152,25 +469,114 @@ int dlFree( void *ptr, size_t size )
    if(!ptr)
    { RET("%d", RETURN_OK); return( RETURN_OK ); }
 
-   free( ptr ); ptr = NULL;
+   dlFreeRaw( ptr ); ptr = NULL;
+#ifdef DEBUG
+   dlAllocCount( 0, size );
+#endif
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* next capacity for array which needs to hold need items.
+ * grows geometrically, so appending one by one stays linear */
+unsigned int dlGrowCapacity( unsigned int num, unsigned int need )
+{
+   CALL("%u, %u", num, need);
+
+   if(num >= need)
+   { RET("%u", num); return( num ); }
+
+   if(num < 16) num = 16;
+   while(num < need)
+      num += num / 2 + 1;
+
+   RET("%u", num);
+   return( num );
+}
+
+/* statistics of category */
+int dlAllocGetStats( dleAlloc category, dlAllocStats *stats )
+{
+#if DL_SLAB
+   unsigned int c, i, first, last;
+#endif
+   CALL("%d, %p", category, stats);
+
+   if(!stats || category >= ALLOC_LAST)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memset( stats, 0, sizeof(dlAllocStats) );
 #ifdef DEBUG
-   DL_ALLOC[ DL_D_ALLOC ] -= size;
+   dlSlabLock();
+   stats->bytes = DL_ALLOC[ category ];
+   stats->peak  = DL_PEAK[ category ];
+   dlSlabUnlock();
+#endif
+
+#if DL_SLAB
+   first = category == ALLOC_TOTAL ? 0 : category;
+   last  = category == ALLOC_TOTAL ? ALLOC_TOTAL : category + 1;
+
+   dlSlabLock();
+   c = first;
+   for(; c != last; ++c)
+   {
+      i = 0;
+      for(; i != DL_SLAB_CLASSES; ++i)
+      {
+         stats->slab_pages  += DL_SLAB_POOL[c][i].pages;
+         stats->slab_blocks += DL_SLAB_POOL[c][i].blocks;
+         stats->slab_used   += (size_t)DL_SLAB_POOL[c][i].blocks * DL_SLAB_SIZE[i];
+      }
+   }
+   dlSlabUnlock();
+   stats->slab_total = (size_t)stats->slab_pages * DL_SLAB_PAGE;
 #endif
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
 }
 
+/* release empty slab pages */
+void dlAllocTrim( void )
+{
+#if DL_SLAB
+   unsigned int i;
+#endif
+   TRACE();
+
+#if DL_SLAB
+   dlSlabLock();
+   i = 0;
+   for(; i != DL_SLAB_USE;)
+   {
+      if(!DL_SLAB_PAGES[i]->used) dlSlabFreePage( DL_SLAB_PAGES[i] );
+      else ++i;
+   }
+
+   if(!DL_SLAB_USE)
+   {
+      free( DL_SLAB_PAGES );
+      DL_SLAB_PAGES = NULL;
+      DL_SLAB_NUM   = 0;
+   }
+   dlSlabUnlock();
+#endif
+}
+
 /* output memory usage graph */
 void dlMemoryGraph( void )
 {
    TRACE();
 #ifdef DEBUG
    unsigned int i;
+   dlAllocStats slab;
+   dlArenaStats arena;
 
    dlPuts("");
    logWhite(); dlPuts("--- Memory Graph ---");
-   i = 0; DL_ALLOC[ ALLOC_TOTAL ] = 0;
+   i = 0;
    for(; i != ALLOC_LAST; ++i)
    {
       if( i == ALLOC_TOTAL )
@@ -187,13 +593,82 @@ void dlMemoryGraph( void )
          dlPrint("%.2f KiB\n", (float)DL_ALLOC[ i ] / 1024 );
       else
          dlPrint("%lu B\n", DL_ALLOC[ i ] );
+   }
+   logWhite(); dlPuts("--------------------"); logNormal();
+
+   /* high-water marks */
+   i = 0;
+   for(; i != ALLOC_LAST; ++i)
+   {
+      if( !DL_PEAK[ i ] )
+         continue;
 
-      /* increase total */
-      DL_ALLOC[ ALLOC_TOTAL ] += DL_ALLOC[ i ];
+      logGreen(); dlPrint("%13s : ", DL_ALLOCN[ i ]); logWhite();
+      dlPrint("%.2f KiB peak\n", (float)DL_PEAK[ i ] / 1024 );
    }
    logWhite(); dlPuts("--------------------"); logNormal();
+
+   /* slab pages left */
+   dlAllocGetStats( ALLOC_TOTAL, &slab );
+   if( slab.slab_pages )
+   {
+      logGreen(); dlPrint("%13s : ", "Slab"); logWhite();
+      dlPrint("%.2f / %.2f KiB, %u blocks, %u pages\n",
+              (float)slab.slab_used / 1024, (float)slab.slab_total / 1024,
+              slab.slab_blocks, slab.slab_pages );
+      logWhite(); dlPuts("--------------------"); logNormal();
+   }
+
+   /* thread frame arenas */
+   dlThreadArenaGetStats( &arena );
+   if( arena.peak )
+   {
+      logGreen(); dlPrint("%13s : ", "Frame"); logWhite();
+      dlPrint("%.2f KiB peak per frame", (float)arena.peak / 1024 );
+      if( arena.arenas )
+         dlPrint(", %.2f KiB in %u blocks of %u arenas",
+                 (float)arena.size / 1024, arena.blocks, arena.arenas );
+      dlPuts("");
+      logWhite(); dlPuts("--------------------"); logNormal();
+   }
+
+   /* memory saved by copy on write */
+   i = 0; DL_SHARED[ ALLOC_TOTAL ] = 0;
+   for(; i != ALLOC_TOTAL; ++i)
+   {
+      if( !DL_SHARED[ i ] )
+         continue;
+
+      logGreen(); dlPrint("%13s : ", DL_ALLOCN[ i ]); logWhite();
+      dlPrint("%.2f KiB shared\n", (float)DL_SHARED[ i ] / 1024 );
+      DL_SHARED[ ALLOC_TOTAL ] += DL_SHARED[ i ];
+   }
+   if( DL_SHARED[ ALLOC_TOTAL ] )
+   {
+      logGreen(); dlPrint("%13s : ", "Shared"); logWhite();
+      dlPrint("%.2f KiB saved by copy on write\n", (float)DL_SHARED[ ALLOC_TOTAL ] / 1024 );
+      logWhite(); dlPuts("--------------------"); logNormal();
+   }
    dlPuts("");
 
+   /* geometry heap */
+   if(dlHeapEnabled())
+   {
+      dlHeapStats stats;
+      static const char *heapn[ DL_HEAP_LAST ] = { "Vertex heap", "Index heap" };
+
+      i = 0;
+      for(; i != DL_HEAP_LAST; ++i)
+      {
+         dlHeapGetStats( i, &stats );
+         logGreen(); dlPrint("%13s : ", heapn[ i ]); logWhite();
+         dlPrint("%.2f / %.2f KiB, %u ranges, %u pages, %.0f%% fragmented\n",
+                 (float)stats.used / 1024, (float)stats.total / 1024,
+                 stats.ranges, stats.pages, stats.fragmentation * 100.0f );
+      }
+      logNormal(); dlPuts("");
+   }
+
 #else
    logBlue(); dlPuts( "-- Memory graph only available on debug build --" ); logNormal();
 #endif
@@ -2,6 +2,7 @@
 #define DL_MALLOC_H
 
 #include <string.h>
+#include "dlConfig.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,25 +24,50 @@ typedef enum
    ALLOC_TEXTURE,       /* Textures */
    ALLOC_TEXTURE_CACHE, /* Texture cache */
    ALLOC_ATLAS,         /* Atlases */
+   ALLOC_FRAME,         /* Frame arenas */
    ALLOC_TOTAL,         /* Total */
    ALLOC_LAST
 } dleAlloc;
 
-#ifdef DEBUG
-extern dleAlloc DL_D_ALLOC;
-#define dlSetAlloc( X ) DL_D_ALLOC = X;
+/* category of following allocations, slab pools are kept per category.
+ * per thread, so jobs don't change category under GL thread */
+#if DL_THREADS && defined(__GNUC__)
+extern __thread dleAlloc DL_D_ALLOC;
 #else
-#define dlSetAlloc( X ) ;
+extern dleAlloc DL_D_ALLOC;
 #endif
+#define dlSetAlloc( X ) DL_D_ALLOC = X;
+
+/* allocation statistics of category */
+typedef struct dlAllocStats_t
+{
+   size_t       bytes;           /* tracked bytes, debug build only */
+   size_t       peak;            /* high-water mark of bytes, debug build only */
+   size_t       slab_total;      /* bytes in slab pages */
+   size_t       slab_used;       /* bytes of slab blocks handed out */
+   unsigned int slab_pages;
+   unsigned int slab_blocks;     /* live slab allocations */
+} dlAllocStats;
 
 /* internal allocation functions */
 void dlFakeAlloc( size_t ); /* fake allocation */
+void dlShareAlloc( size_t );   /* copy shares size bytes instead of allocating */
+void dlUnshareAlloc( size_t ); /* copy stopped sharing size bytes */
 void* dlMalloc( size_t );
 void* dlCalloc( unsigned int, size_t );
 void* dlRealloc( void*, unsigned int, unsigned int, size_t );
 void* dlCopy( void*, size_t );
 int dlFree( void*, size_t );
 
+/* capacity helper for growing arrays */
+unsigned int dlGrowCapacity( unsigned int, unsigned int );
+
+/* statistics of category, ALLOC_TOTAL sums all */
+int dlAllocGetStats( dleAlloc, dlAllocStats* );
+
+/* release empty slab pages */
+void dlAllocTrim( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,298 @@
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlArena.h"
+#include "dlConfig.h"
+#include "dlLog.h"
+
+#if DL_THREADS
+#  include <pthread.h>
+#endif
+
+#define DL_DEBUG_CHANNEL "ARENA"
+
+/* data of block starts after aligned header */
+#define DL_ARENA_HEADER  ((sizeof(dlArenaBlock) + DL_ARENA_ALIGN - 1) & ~(size_t)(DL_ARENA_ALIGN - 1))
+#define DL_ARENA_DATA(b) ((unsigned char*)(b) + DL_ARENA_HEADER)
+
+/* thread arenas, each thread keeps its own in thread local storage.
+ * generation changes when they are freed, so threads make new ones */
+static dlFrameArena  *DL_THREAD_ARENAS = NULL;
+static unsigned int   DL_THREAD_GENERATION = 1;
+
+/* peak of thread arenas already freed */
+static size_t         DL_THREAD_PEAK = 0;
+
+#if DL_THREADS && defined(__GNUC__)
+static __thread dlFrameArena *DL_THREAD_ARENA = NULL;
+static __thread unsigned int  DL_THREAD_ARENA_GENERATION = 0;
+#else
+static dlFrameArena *DL_THREAD_ARENA = NULL;
+static unsigned int  DL_THREAD_ARENA_GENERATION = 0;
+#endif
+
+#if DL_THREADS
+static pthread_mutex_t DL_THREAD_ARENA_LOCK = PTHREAD_MUTEX_INITIALIZER;
+#  define dlArenaLock()   pthread_mutex_lock( &DL_THREAD_ARENA_LOCK )
+#  define dlArenaUnlock() pthread_mutex_unlock( &DL_THREAD_ARENA_LOCK )
+#else
+#  define dlArenaLock()
+#  define dlArenaUnlock()
+#endif
+
+/* block with room for size bytes */
+static dlArenaBlock* dlArenaNewBlock( dlFrameArena *arena, size_t size )
+{
+   dlArenaBlock *block;
+
+   dlSetAlloc( ALLOC_FRAME );
+   if(!(block = dlMalloc( DL_ARENA_HEADER + size )))
+      return( NULL );
+
+   block->next = NULL;
+   block->size = size;
+   block->used = 0;
+
+   arena->size += size;
+   arena->blocks++;
+   return( block );
+}
+
+static void dlArenaFreeBlocks( dlFrameArena *arena )
+{
+   dlArenaBlock *block, *next;
+
+   dlSetAlloc( ALLOC_FRAME );
+   block = arena->block;
+   for(; block; block = next)
+   {
+      next = block->next;
+      dlFree( block, DL_ARENA_HEADER + block->size );
+   }
+
+   arena->block  = arena->current = NULL;
+   arena->size   = 0;
+   arena->blocks = 0;
+}
+
+/* Allocate arena */
+dlFrameArena* dlNewFrameArena( size_t size )
+{
+   dlFrameArena *arena;
+   CALL("%llu", size);
+
+   dlSetAlloc( ALLOC_FRAME );
+   if(!(arena = dlCalloc( 1, sizeof(dlFrameArena) )))
+   { RET("%p", NULL); return( NULL ); }
+
+   arena->block_size = size ? size : DL_ARENA_SIZE;
+   if(!(arena->block = arena->current = dlArenaNewBlock( arena, arena->block_size )))
+   {
+      dlSetAlloc( ALLOC_FRAME );
+      dlFree( arena, sizeof(dlFrameArena) );
+      RET("%p", NULL);
+      return( NULL );
+   }
+
+   LOGOK("NEW");
+
+   arena->refCounter++;
+
+   RET("%p", arena);
+   return( arena );
+}
+
+/* Reference arena */
+dlFrameArena* dlRefFrameArena( dlFrameArena *src )
+{
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   src->refCounter++;
+
+   RET("%p", src);
+   return( src );
+}
+
+/* Free arena */
+int dlFreeFrameArena( dlFrameArena *arena )
+{
+   CALL("%p", arena);
+
+   if(!arena) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* There is still references to this arena alive */
+   if(--arena->refCounter != 0) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlArenaFreeBlocks( arena );
+
+   LOGFREE("FREE");
+
+   dlSetAlloc( ALLOC_FRAME );
+   dlFree( arena, sizeof(dlFrameArena) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Allocate from arena */
+void* dlFrameArenaAlloc( dlFrameArena *arena, size_t size )
+{
+   dlArenaBlock *block;
+   void         *ptr;
+
+   if(!arena)
+      return( NULL );
+
+   size  = (size + DL_ARENA_ALIGN - 1) & ~(size_t)(DL_ARENA_ALIGN - 1);
+   block = arena->current;
+
+   /* next block of chain, or new one big enough */
+   if(!block || block->size - block->used < size)
+   {
+      if(block && block->next && block->next->size >= size)
+         block = block->next;
+      else if((block = dlArenaNewBlock( arena, size > arena->block_size ? size : arena->block_size )))
+      {
+         if(arena->current)
+         {
+            block->next          = arena->current->next;
+            arena->current->next = block;
+         }
+         else arena->block = block;
+      }
+      else return( NULL );
+
+      block->used    = 0;
+      arena->current = block;
+   }
+
+   ptr          = DL_ARENA_DATA( block ) + block->used;
+   block->used += size;
+   arena->used += size;
+
+   return( ptr );
+}
+
+/* Reset arena */
+void dlFrameArenaReset( dlFrameArena *arena )
+{
+   dlArenaBlock *block;
+   size_t        size;
+   CALL("%p", arena);
+
+   if(!arena)
+      return;
+
+   if(arena->used > arena->peak)
+      arena->peak = arena->used;
+
+   /* overflowed, one block holds whole frame from now on */
+   if(arena->blocks > 1)
+   {
+      size = arena->size;
+      dlArenaFreeBlocks( arena );
+
+      if((block = dlArenaNewBlock( arena, size )))
+         arena->block_size = size;
+      else
+         block = dlArenaNewBlock( arena, arena->block_size );
+
+      arena->block = block;
+   }
+
+   arena->current = arena->block;
+   if(arena->current)
+      arena->current->used = 0;
+   arena->used = 0;
+}
+
+/* Arena of calling thread */
+dlFrameArena* dlThreadArena( void )
+{
+   dlFrameArena *arena;
+
+   if(DL_THREAD_ARENA && DL_THREAD_ARENA_GENERATION == DL_THREAD_GENERATION)
+      return( DL_THREAD_ARENA );
+
+   if(!(arena = dlNewFrameArena( DL_ARENA_SIZE )))
+      return( NULL );
+
+   dlArenaLock();
+   arena->next      = DL_THREAD_ARENAS;
+   DL_THREAD_ARENAS = arena;
+   DL_THREAD_ARENA_GENERATION = DL_THREAD_GENERATION;
+   dlArenaUnlock();
+
+   DL_THREAD_ARENA = arena;
+   return( arena );
+}
+
+/* Allocate from arena of calling thread */
+void* dlFrameAlloc( size_t size )
+{
+   return( dlFrameArenaAlloc( dlThreadArena(), size ) );
+}
+
+/* Reset every thread arena */
+void dlThreadArenaReset( void )
+{
+   dlFrameArena *arena;
+   TRACE();
+
+   dlArenaLock();
+   arena = DL_THREAD_ARENAS;
+   for(; arena; arena = arena->next)
+      dlFrameArenaReset( arena );
+   dlArenaUnlock();
+}
+
+/* Free every thread arena */
+void dlThreadArenaFree( void )
+{
+   dlFrameArena *arena, *next;
+   dlArenaStats  stats;
+   TRACE();
+
+   dlThreadArenaGetStats( &stats );
+
+   dlArenaLock();
+   DL_THREAD_PEAK = stats.peak;
+   arena = DL_THREAD_ARENAS;
+   for(; arena; arena = next)
+   {
+      next = arena->next;
+      dlFreeFrameArena( arena );
+   }
+   DL_THREAD_ARENAS = NULL;
+   DL_THREAD_GENERATION++;
+   dlArenaUnlock();
+}
+
+/* Statistics of thread arenas */
+int dlThreadArenaGetStats( dlArenaStats *stats )
+{
+   dlFrameArena *arena;
+   CALL("%p", stats);
+
+   if(!stats)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memset( stats, 0, sizeof(dlArenaStats) );
+
+   dlArenaLock();
+   arena = DL_THREAD_ARENAS;
+   for(; arena; arena = arena->next)
+   {
+      stats->size   += arena->size;
+      stats->peak   += arena->peak > arena->used ? arena->peak : arena->used;
+      stats->blocks += arena->blocks;
+      stats->arenas++;
+   }
+   if(DL_THREAD_PEAK > stats->peak)
+      stats->peak = DL_THREAD_PEAK;
+   dlArenaUnlock();
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
@@ -0,0 +1,72 @@
+#ifndef DL_ARENA_H
+#define DL_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* allocations from arena are aligned to this */
+#define DL_ARENA_ALIGN 16
+
+/* memory block of arena, data follows header */
+typedef struct dlArenaBlock_t
+{
+   struct dlArenaBlock_t *next;
+   size_t size, used;
+} dlArenaBlock;
+
+/* bump pointer allocator for data that lives one frame,
+ * everything is released at once by reset */
+typedef struct dlFrameArena_t
+{
+   dlArenaBlock *block, *current;
+   size_t        block_size;        /* size of new blocks */
+   size_t        used;              /* bytes handed out since reset */
+   size_t        peak;              /* most bytes handed out in one frame */
+   size_t        size;              /* bytes in blocks */
+   unsigned int  blocks;
+
+   /* arenas of threads */
+   struct dlFrameArena_t *next;
+
+   unsigned int refCounter;
+} dlFrameArena;
+
+/* arena statistics, summed over thread arenas */
+typedef struct dlArenaStats_t
+{
+   size_t       size;
+   size_t       peak;
+   unsigned int blocks;
+   unsigned int arenas;
+} dlArenaStats;
+
+dlFrameArena*  dlNewFrameArena( size_t size );
+dlFrameArena*  dlRefFrameArena( dlFrameArena *src );
+int            dlFreeFrameArena( dlFrameArena *arena );
+
+/* Allocate size bytes, chains new block when current one is full */
+void*          dlFrameArenaAlloc( dlFrameArena *arena, size_t size );
+
+/* Release everything, chained blocks are merged
+ * so next frame of same size fits to one block */
+void           dlFrameArenaReset( dlFrameArena *arena );
+
+/* Arena of calling thread, made on first use.
+ * thread arenas are reset by dlEndFrame, so memory from them
+ * is valid until end of frame and jobs must be done by then */
+dlFrameArena*  dlThreadArena( void );
+void*          dlFrameAlloc( size_t size );
+
+/* Reset/free every thread arena, done by framework */
+void           dlThreadArenaReset( void );
+void           dlThreadArenaFree( void );
+int            dlThreadArenaGetStats( dlArenaStats *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_ARENA_H */
@@ -0,0 +1,336 @@
+#include <stdint.h>
+#include <float.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlBVH.h"
+#include "dlCore.h"
+#include "dlLog.h"
+
+#define DL_DEBUG_CHANNEL "BVH"
+
+/* depth of cull traversal, balanced tree never gets close */
+#define DL_BVH_STACK 256
+
+/* leaf data is index of entry */
+#define DL_BVH_INDEX(data) ((unsigned int)(uintptr_t)(data))
+#define DL_BVH_DATA(index) ((void*)(uintptr_t)(index))
+
+/* Allocate tree */
+dlBVH* dlNewBVH( float margin )
+{
+   dlBVH *bvh;
+   CALL("%f", margin);
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   if(!(bvh = dlCalloc( 1, sizeof(dlBVH) )))
+   { RET("%p", NULL); return( NULL ); }
+
+   /* kazmath allocates tree nodes itself */
+   kmAABBTreeInit( &bvh->tree, margin );
+
+   LOGOK("NEW");
+
+   bvh->refCounter++;
+
+   RET("%p", bvh);
+   return( bvh );
+}
+
+/* Reference tree */
+dlBVH* dlRefBVH( dlBVH *src )
+{
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   src->refCounter++;
+
+   RET("%p", src);
+   return( src );
+}
+
+/* Free tree */
+int dlFreeBVH( dlBVH *bvh )
+{
+   CALL("%p", bvh);
+
+   if(!bvh) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* There is still references to this tree alive */
+   if(--bvh->refCounter != 0) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   kmAABBTreeFree( &bvh->tree );
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   dlFree( bvh->entry, bvh->num_entry * sizeof(dlBVHEntry) );
+
+   LOGFREE("FREE");
+
+   dlFree( bvh, sizeof(dlBVH) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Insert object */
+int dlBVHInsert( dlBVH *bvh, dlObject *object )
+{
+   dlBVHEntry   *entry;
+   unsigned int num;
+   CALL("%p, %p", bvh, object);
+
+   if(!bvh || !object)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(bvh->use_entry == bvh->num_entry)
+   {
+      dlSetAlloc( ALLOC_SCENEOBJECT );
+
+      num = dlGrowCapacity( bvh->num_entry, bvh->use_entry + 1 );
+      if(bvh->entry)
+         entry = dlRealloc( bvh->entry, bvh->num_entry, num, sizeof(dlBVHEntry) );
+      else
+         entry = dlCalloc( num, sizeof(dlBVHEntry) );
+
+      if(!entry)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      bvh->entry     = entry;
+      bvh->num_entry = num;
+   }
+
+   entry = &bvh->entry[ bvh->use_entry ];
+   dlObjectWorldBounds( object, &entry->box );
+
+   entry->proxy = kmAABBTreeInsert( &bvh->tree, &entry->box, DL_BVH_DATA( bvh->use_entry ) );
+   if(entry->proxy == KM_AABB_TREE_NULL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   entry->object = object;
+   bvh->use_entry++;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Remove object */
+int dlBVHRemove( dlBVH *bvh, dlObject *object )
+{
+   unsigned int i;
+   CALL("%p, %p", bvh, object);
+
+   if(!bvh || !object)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   i = 0;
+   for(; i != bvh->use_entry; ++i)
+      if(bvh->entry[i].object == object) break;
+
+   if(i == bvh->use_entry)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   kmAABBTreeRemove( &bvh->tree, bvh->entry[i].proxy );
+
+   /* last entry fills the hole */
+   if(i != --bvh->use_entry)
+   {
+      bvh->entry[i] = bvh->entry[ bvh->use_entry ];
+      bvh->tree.nodes[ bvh->entry[i].proxy ].data = DL_BVH_DATA( i );
+   }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Refit changed objects */
+unsigned int dlBVHUpdate( dlBVH *bvh )
+{
+   dlBVHEntry   *entry;
+   unsigned int i, moved;
+   CALL("%p", bvh);
+
+   if(!bvh)
+   { RET("%u", 0); return( 0 ); }
+
+   /* enlarged leaves absorb small moves */
+   moved = 0;
+   i = 0;
+   for(; i != bvh->use_entry; ++i)
+   {
+      entry = &bvh->entry[i];
+      if(!entry->object->transform_changed && !entry->object->bounds_changed)
+         continue;
+
+      dlObjectWorldBounds( entry->object, &entry->box );
+      moved += kmAABBTreeMove( &bvh->tree, entry->proxy, &entry->box );
+   }
+
+   RET("%u", moved);
+   return( moved );
+}
+
+/* Rebuild tree */
+void dlBVHRebuild( dlBVH *bvh )
+{
+   CALL("%p", bvh);
+
+   if(!bvh)
+      return;
+
+   kmAABBTreeRebuild( &bvh->tree );
+}
+
+/* Objects in frustum */
+unsigned int dlBVHCull( dlBVH *bvh, const dlFrustum *frustum, dlBVHCullPtr *func, void *user )
+{
+   struct { int node; unsigned int planes; } stack[ DL_BVH_STACK ];
+   const kmAABBTreeNode *node;
+   unsigned int top, found, planes;
+   CALL("%p, %p, %p, %p", bvh, frustum, func, user);
+
+   if(!bvh || !frustum || !func || bvh->tree.root == KM_AABB_TREE_NULL)
+   { RET("%u", 0); return( 0 ); }
+
+   found = 0;
+   top   = 0;
+   stack[ top   ].node   = bvh->tree.root;
+   stack[ top++ ].planes = DL_FRUSTUM_ALL;
+   while(top)
+   {
+      --top;
+      node   = &bvh->tree.nodes[ stack[top].node ];
+      planes = stack[top].planes;
+
+      /* subtree inside planes skips them */
+      if(planes && dlFrustumTestAABB( frustum, &node->box, &planes ) == DL_FRUSTUM_OUTSIDE)
+         continue;
+
+      if(node->child1 == KM_AABB_TREE_NULL)
+      {
+         func( bvh->entry[ DL_BVH_INDEX( node->data ) ].object, planes, user );
+         ++found;
+         continue;
+      }
+
+      if(top + 2 > DL_BVH_STACK)
+      { LOGERR("Tree too deep"); break; }
+
+      stack[ top   ].node   = node->child1;
+      stack[ top++ ].planes = planes;
+      stack[ top   ].node   = node->child2;
+      stack[ top++ ].planes = planes;
+   }
+
+   RET("%u", found);
+   return( found );
+}
+
+/* draw object found by cull */
+static void dlBVHDrawObject( dlObject *object, unsigned int planes, void *user )
+{
+   dlDrawCulled( object, planes );
+}
+
+/* Update and draw visible objects */
+void dlBVHDraw( dlBVH *bvh )
+{
+   CALL("%p", bvh);
+
+   if(!bvh)
+      return;
+
+   dlBVHUpdate( bvh );
+   dlBVHCull( bvh, &_dlCore.render.frustum, dlBVHDrawObject, NULL );
+}
+
+/* overlap query state */
+typedef struct
+{
+   dlBVH         *bvh;
+   const kmAABB  *box;
+   dlBVHQueryPtr *func;
+   void          *user;
+   unsigned int   found;
+} dlBVHOverlapQuery;
+
+/* leaf box is enlarged, test object's own */
+static int dlBVHOverlapLeaf( void *data, int proxy, void *user )
+{
+   dlBVHOverlapQuery *query = user;
+   dlBVHEntry *entry = &query->bvh->entry[ DL_BVH_INDEX( data ) ];
+
+   if(!kmAABBIntersectsAABB( &entry->box, query->box ))
+      return( 1 );
+
+   query->found++;
+   return( query->func ? query->func( entry->object, query->user ) : 1 );
+}
+
+/* Objects overlapping box */
+unsigned int dlBVHOverlap( dlBVH *bvh, const kmAABB *box, dlBVHQueryPtr *func, void *user )
+{
+   dlBVHOverlapQuery query;
+   CALL("%p, %p, %p, %p", bvh, box, func, user);
+
+   if(!bvh || !box)
+   { RET("%u", 0); return( 0 ); }
+
+   query.bvh   = bvh;
+   query.box   = box;
+   query.func  = func;
+   query.user  = user;
+   query.found = 0;
+   kmAABBTreeQuery( &bvh->tree, box, dlBVHOverlapLeaf, &query );
+
+   RET("%u", query.found);
+   return( query.found );
+}
+
+/* ray query state */
+typedef struct
+{
+   dlBVH        *bvh;
+   const kmVec3 *origin, *direction;
+   dlObject     *object;
+   float         distance;
+} dlBVHRayQuery;
+
+/* closest hit clips the ray */
+static kmScalar dlBVHRayLeaf( void *data, int proxy, kmScalar t, void *user )
+{
+   dlBVHRayQuery *query = user;
+   dlBVHEntry *entry = &query->bvh->entry[ DL_BVH_INDEX( data ) ];
+
+   if(kmAABBIntersectsRay( &entry->box, query->origin, query->direction, query->distance, &t ) &&
+      (!query->object || t < query->distance))
+   {
+      query->object   = entry->object;
+      query->distance = t;
+   }
+
+   return( query->distance );
+}
+
+/* Nearest object along ray */
+dlObject* dlBVHPick( dlBVH *bvh, const kmVec3 *origin, const kmVec3 *direction, float *distance )
+{
+   dlBVHRayQuery query;
+   CALL("%p, %p, %p, %p", bvh, origin, direction, distance);
+
+   if(!bvh || !origin || !direction)
+   { RET("%p", NULL); return( NULL ); }
+
+   query.bvh       = bvh;
+   query.origin    = origin;
+   query.direction = direction;
+   query.object    = NULL;
+   query.distance  = FLT_MAX;
+   kmAABBTreeRayCast( &bvh->tree, origin, direction, FLT_MAX, dlBVHRayLeaf, &query );
+
+   if(query.object && distance)
+      *distance = query.distance;
+
+   RET("%p", query.object);
+   return( query.object );
+}
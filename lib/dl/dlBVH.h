@@ -0,0 +1,70 @@
+#ifndef DL_BVH_H
+#define DL_BVH_H
+
+#include "kazmath/kazmath.h"
+#include "dlSceneobject.h"
+#include "dlFrustum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* object in tree */
+typedef struct dlBVHEntry_t
+{
+   dlObject *object;
+   kmAABB    box;     /* world bounds when last updated */
+   int       proxy;   /* leaf of tree */
+} dlBVHEntry;
+
+/* dynamic AABB tree of root objects, objects are not referenced
+ * and must be removed before they are freed.
+ * childs are culled with their parent by dlDrawCulled */
+typedef struct dlBVH_t
+{
+   kmAABBTree   tree;
+   dlBVHEntry  *entry;
+   unsigned int num_entry, use_entry;
+
+   unsigned int refCounter;
+} dlBVH;
+
+/* called for objects found, return 0 to stop query */
+typedef int  dlBVHQueryPtr( dlObject*, void* );
+
+/* called for objects in frustum with planes they still intersect */
+typedef void dlBVHCullPtr( dlObject*, unsigned int, void* );
+
+dlBVH*         dlNewBVH( float margin );               /* Leaves are enlarged by margin */
+dlBVH*         dlRefBVH( dlBVH *src );
+int            dlFreeBVH( dlBVH *bvh );
+
+int            dlBVHInsert( dlBVH *bvh, dlObject *object );
+int            dlBVHRemove( dlBVH *bvh, dlObject *object );
+
+/* Refit objects whose transformation or bounds changed,
+ * returns number of leaves moved in tree.
+ * call before objects in tree are drawn by other means, drawing clears the flags */
+unsigned int   dlBVHUpdate( dlBVH *bvh );
+
+/* Build tree again from its objects */
+void           dlBVHRebuild( dlBVH *bvh );
+
+/* Objects in frustum, returns count */
+unsigned int   dlBVHCull( dlBVH *bvh, const dlFrustum *frustum, dlBVHCullPtr *func, void *user );
+
+/* Update and draw objects in frustum of current projection,
+ * render stats only count culled objects that reached their own test */
+void           dlBVHDraw( dlBVH *bvh );
+
+/* Objects whose bounds overlap box, returns count */
+unsigned int   dlBVHOverlap( dlBVH *bvh, const kmAABB *box, dlBVHQueryPtr *func, void *user );
+
+/* Nearest object whose bounds ray hits, distance along direction is stored */
+dlObject*      dlBVHPick( dlBVH *bvh, const kmVec3 *origin, const kmVec3 *direction, float *distance );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_BVH_H */
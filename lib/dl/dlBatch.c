@@ -0,0 +1,576 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlBatch.h"
+#include "dlCore.h"
+#include "dlLog.h"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#elif  GLES1
+#  include <GLES/gl.h>
+#  include <GLES/glext.h>
+#else
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#endif
+
+#define DL_DEBUG_CHANNEL "BATCH"
+
+/* Reference batch */
+dlBatch* dlRefBatch( dlBatch *src )
+{
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   src->refCounter++;
+
+   RET("%p", src);
+   return( src );
+}
+
+/* Copy batch,
+ * copy gets ranges of its own since hiding unshares only its IBO */
+dlBatch* dlCopyBatch( dlBatch *src )
+{
+   dlBatch *batch;
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   if(!(batch = dlCopy( src, sizeof(dlBatch) )))
+   { RET("%p", NULL); return( NULL ); }
+
+   batch->range   = dlCopy( src->range,   src->num_range * sizeof(dlBatchRange) );
+   batch->indices = dlCopy( src->indices, src->i_use * sizeof(unsigned int) );
+   if((src->range && !batch->range) || (src->indices && !batch->indices))
+   {
+      dlFree( batch->range,   src->num_range * sizeof(dlBatchRange) );
+      dlFree( batch->indices, src->i_use * sizeof(unsigned int) );
+      dlFree( batch, sizeof(dlBatch) );
+      RET("%p", NULL); return( NULL );
+   }
+
+   batch->refCounter = 0;
+   batch->refCounter++;
+
+   RET("%p", batch);
+   return( batch );
+}
+
+/* Free batch */
+int dlFreeBatch( dlBatch *batch )
+{
+   CALL("%p", batch);
+
+   if(!batch) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* There is still references to this batch alive */
+   if(--batch->refCounter != 0) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   dlFree( batch->range,   batch->num_range * sizeof(dlBatchRange) );
+   dlFree( batch->indices, batch->i_use * sizeof(unsigned int) );
+   dlFree( batch, sizeof(dlBatch) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* objects draw with same state */
+static int dlBatchSameMaterial( dlMaterial *a, dlMaterial *b )
+{
+   if(a == b)
+      return( 1 );
+   if(!a || !b)
+      return( 0 );
+
+   if(a->flags != b->flags || a->blend1 != b->blend1 || a->blend2 != b->blend2)
+      return( 0 );
+
+   /* copied textures share GL object */
+   if(!a->texture || !b->texture)
+      return( a->texture == b->texture );
+
+   return( a->texture->object == b->texture->object );
+}
+
+/* amount of indices object draws */
+static unsigned int dlBatchSourceCount( dlObject *object )
+{
+   if(!object->ibo)
+      return( object->vbo->v_use );
+
+#if USE_BUFFERS
+   return( object->ibo->i_use[0] );
+#else
+   return( object->ibo->i_use );
+#endif
+}
+
+/* index i of object */
+static unsigned int dlBatchSourceIndex( dlObject *object, unsigned int i )
+{
+   if(!object->ibo)
+      return( i );
+
+#if USE_BUFFERS
+   return( object->ibo->indices[0][i] );
+#else
+   return( object->ibo->indices[i] );
+#endif
+}
+
+/* triangle list indices of object */
+static unsigned int dlBatchSourceIndices( dlObject *object )
+{
+   unsigned int count = dlBatchSourceCount( object );
+
+   if(object->primitive_type == GL_TRIANGLE_STRIP)
+      return( count < 3 ? 0 : (count - 2) * 3 );
+
+   return( count - count % 3 );
+}
+
+/* can object be merged */
+static int dlBatchCanMerge( dlObject *object )
+{
+   if(!object || !object->vbo || !object->vbo->v_use)
+      return( 0 );
+
+   /* skinned vertices change every frame */
+   if(object->animator)
+   {
+      LOGWARN("Animated object can't be batched");
+      return( 0 );
+   }
+
+   if(object->primitive_type != GL_TRIANGLES &&
+      object->primitive_type != GL_TRIANGLE_STRIP)
+   {
+      LOGWARN("Only triangle lists and strips can be batched");
+      return( 0 );
+   }
+
+#if USE_BUFFERS
+   if(object->vbo->v_use > DL_BATCH_MAX_VERTICES ||
+     (object->ibo && object->ibo->index_buffer > 1))
+   {
+      LOGWARN("Object has too many vertices for 16-bit batch");
+      return( 0 );
+   }
+#endif
+
+   return( 1 );
+}
+
+/* append transformed vertices of object to batch VBO */
+static int dlBatchVertices( dlVBO *vbo, dlObject *object )
+{
+   dlVBO    *src = object->vbo;
+   kmMat4   normal_matrix, rows;
+   kmVec3   vertex;
+   unsigned int i, u;
+
+   /* kmVec3Transform takes matrix by rows */
+   kmMat4Transpose( &rows, &object->matrix );
+   i = 0;
+   for(; i != src->v_use; ++i)
+   {
+      kmVec3Transform( &vertex, &src->vertices[i], &rows );
+      if(dlInsertVertex( vbo, vertex.x, vertex.y, vertex.z ) != RETURN_OK)
+         return( RETURN_FAIL );
+   }
+
+   /* normals go through inverse transpose,
+    * missing streams are zero filled */
+   if(vbo->normals)
+   {
+      kmMat4Inverse( &normal_matrix, &object->matrix );
+      kmMat4Transpose( &normal_matrix, &normal_matrix );
+
+      i = 0;
+      for(; i != src->v_use; ++i)
+      {
+         kmVec3Fill( &vertex, 0, 0, 0 );
+         if(i < src->n_use)
+         {
+            kmVec3TransformNormal( &vertex, &src->normals[i], &normal_matrix );
+            kmVec3Normalize( &vertex, &vertex );
+         }
+
+         if(dlInsertNormal( vbo, vertex.x, vertex.y, vertex.z ) != RETURN_OK)
+            return( RETURN_FAIL );
+      }
+   }
+
+   u = 0;
+   for(; u != _dlCore.info.maxTextureUnits; ++u)
+   {
+      if(!vbo->uvw[u].coords)
+         continue;
+
+      i = 0;
+      for(; i != src->v_use; ++i)
+      {
+         if(i < src->uvw[u].c_use)
+         {
+            if(dlInsertCoord( vbo, u, src->uvw[u].coords[i].x,
+                                      src->uvw[u].coords[i].y ) != RETURN_OK)
+               return( RETURN_FAIL );
+         }
+         else if(dlInsertCoord( vbo, u, 0, 0 ) != RETURN_OK)
+            return( RETURN_FAIL );
+      }
+   }
+
+#if VERTEX_COLOR
+   if(vbo->colors)
+   {
+      i = 0;
+      for(; i != src->v_use; ++i)
+      {
+         if(i < src->c_use)
+         {
+            if(dlInsertColor( vbo, src->colors[i].r, src->colors[i].g,
+                                   src->colors[i].b, src->colors[i].a ) != RETURN_OK)
+               return( RETURN_FAIL );
+         }
+         else if(dlInsertColor( vbo, 255, 255, 255, 255 ) != RETURN_OK)
+            return( RETURN_FAIL );
+      }
+   }
+#endif
+
+   return( RETURN_OK );
+}
+
+/* append object's triangles to batch IBO, strips become lists */
+static int dlBatchIndices( dlIBO *ibo, dlObject *object, unsigned int base )
+{
+   unsigned int i, count, tri[3];
+
+   count = dlBatchSourceCount( object );
+   if(object->primitive_type == GL_TRIANGLES)
+      count -= count % 3;
+
+   if(count < 3)
+      return( RETURN_OK );
+
+   if(object->primitive_type == GL_TRIANGLE_STRIP)
+   {
+      i = 0;
+      for(; i != count - 2; ++i)
+      {
+         /* odd triangles of strip have reversed winding */
+         tri[0] = base + dlBatchSourceIndex( object, i + (i & 1) );
+         tri[1] = base + dlBatchSourceIndex( object, i + 1 - (i & 1) );
+         tri[2] = base + dlBatchSourceIndex( object, i + 2 );
+
+         /* strips are stitched with degenerates */
+         if(tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+            continue;
+
+         if(dlInsertIndices( ibo, tri, 3 ) != RETURN_OK)
+            return( RETURN_FAIL );
+      }
+
+      return( RETURN_OK );
+   }
+
+   i = 0;
+   for(; i != count; ++i)
+      if(dlInsertIndex( ibo, base + dlBatchSourceIndex( object, i ) ) != RETURN_OK)
+         return( RETURN_FAIL );
+
+   return( RETURN_OK );
+}
+
+/* create empty streams that first object has */
+static int dlBatchStreams( dlVBO *vbo, dlObject *first,
+      unsigned int vertices, unsigned int indices, dlIBO *ibo )
+{
+   unsigned int u;
+
+   if(dlResetVertexBuffer( vbo, vertices ) != RETURN_OK)
+      return( RETURN_FAIL );
+
+   if(first->vbo->n_use)
+      if(dlResetNormalBuffer( vbo, vertices ) != RETURN_OK)
+         return( RETURN_FAIL );
+
+   u = 0;
+   for(; u != _dlCore.info.maxTextureUnits; ++u)
+      if(first->vbo->uvw[u].c_use)
+         if(dlResetCoordBuffer( vbo, u, vertices ) != RETURN_OK)
+            return( RETURN_FAIL );
+
+#if VERTEX_COLOR
+   if(first->vbo->c_use)
+      if(dlResetColorBuffer( vbo, vertices ) != RETURN_OK)
+         return( RETURN_FAIL );
+#endif
+
+#if !USE_BUFFERS
+   if(dlResetIndexBuffer( ibo, indices ) != RETURN_OK)
+      return( RETURN_FAIL );
+#endif
+
+   return( RETURN_OK );
+}
+
+/* merge members to one object */
+static dlObject* dlBatchBuild( dlObject **objects,
+      const unsigned int *member, unsigned int members )
+{
+   dlObject     *object, *src;
+   dlBatch      *batch;
+   unsigned int i, vertices, indices, first;
+
+   /* count */
+   vertices = 0; indices = 0;
+   i = 0;
+   for(; i != members; ++i)
+   {
+      vertices += objects[ member[i] ]->vbo->v_use;
+      indices  += dlBatchSourceIndices( objects[ member[i] ] );
+   }
+
+   if(!(object = dlNewObject()))
+      return( NULL );
+
+   /* vertices are in world space */
+   object->scale.x = 1; object->scale.y = 1; object->scale.z = 1;
+   object->primitive_type = GL_TRIANGLES;
+   object->material       = dlRefMaterial( objects[ member[0] ]->material );
+
+   object->vbo = dlNewVBO();
+   object->ibo = dlNewIBO();
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   if((batch = dlCalloc( 1, sizeof(dlBatch) )))
+   {
+      object->batch = batch;
+      batch->refCounter++;
+   }
+
+   if(!object->vbo || !object->ibo || !batch)
+      goto fail;
+
+   if(dlBatchStreams( object->vbo, objects[ member[0] ],
+                      vertices, indices, object->ibo ) != RETURN_OK)
+      goto fail;
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   batch->range = dlCalloc( members, sizeof(dlBatchRange) );
+   if(!batch->range)
+      goto fail;
+   batch->num_range = members;
+
+   i = 0;
+   for(; i != members; ++i)
+   {
+      src = objects[ member[i] ];
+      if(src->transform_changed)
+         dlUpdateMatrix( src );
+
+#if USE_BUFFERS
+      first = object->ibo->i_use[0];
+#else
+      first = object->ibo->i_use;
+#endif
+
+      if(dlBatchIndices( object->ibo, src, object->vbo->v_use ) != RETURN_OK)
+         goto fail;
+      if(dlBatchVertices( object->vbo, src ) != RETURN_OK)
+         goto fail;
+
+      batch->range[i].source = member[i];
+      batch->range[i].first  = first;
+#if USE_BUFFERS
+      batch->range[i].count  = object->ibo->i_use[0] - first;
+#else
+      batch->range[i].count  = object->ibo->i_use - first;
+#endif
+   }
+
+   /* original indices */
+#if USE_BUFFERS
+   batch->i_use = object->ibo->i_use[0];
+#else
+   batch->i_use = object->ibo->i_use;
+#endif
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   batch->indices = dlCalloc( batch->i_use, sizeof(unsigned int) );
+   if(batch->i_use && !batch->indices)
+      goto fail;
+
+   i = 0;
+   for(; i != batch->i_use; ++i)
+#if USE_BUFFERS
+      batch->indices[i] = object->ibo->indices[0][i];
+#else
+      batch->indices[i] = object->ibo->indices[i];
+#endif
+
+   dlObjectCalculateAABB( object );
+
+   LOGINFOP("Batched %u objects, %u vertices", members, vertices);
+   return( object );
+
+fail:
+   dlFreeObject( object );
+   return( NULL );
+}
+
+/* merge static objects */
+dlObject* dlBatchStatic( dlObject **objects, unsigned int n )
+{
+   dlObject     *root, *object;
+   unsigned int *member, members, vertices, i, j;
+   uint8_t      *merged;
+   CALL("%p, %u", objects, n);
+
+   if(!objects || !n)
+   { RET("%p", NULL); return( NULL ); }
+
+   /* scratch */
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   member = dlMalloc( n * sizeof(unsigned int) );
+   merged = dlCalloc( n, sizeof(uint8_t) );
+   if(!member || !merged)
+   {
+      dlFree( member, n * sizeof(unsigned int) );
+      dlFree( merged, n * sizeof(uint8_t) );
+      RET("%p", NULL); return( NULL );
+   }
+
+   i = 0;
+   for(; i != n; ++i)
+      if(!dlBatchCanMerge( objects[i] )) merged[i] = 1;
+
+   root = NULL;
+   i = 0;
+   for(; i != n; ++i)
+   {
+      if(merged[i])
+         continue;
+
+      /* gather objects with same material,
+       * ones not fitting go to next batch */
+      members = 0; vertices = 0;
+      j = i;
+      for(; j != n; ++j)
+      {
+         if(merged[j] || !dlBatchSameMaterial( objects[i]->material, objects[j]->material ))
+            continue;
+         if(vertices + objects[j]->vbo->v_use > DL_BATCH_MAX_VERTICES)
+            continue;
+
+         vertices += objects[j]->vbo->v_use;
+         member[ members++ ] = j;
+         merged[j] = 1;
+      }
+
+      if(!(object = dlBatchBuild( objects, member, members )))
+         goto fail;
+
+      if(!root)
+         root = object;
+      else if(dlObjectAddChild( root, object ) != RETURN_OK)
+      {
+         dlFreeObject( object );
+         goto fail;
+      }
+   }
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   dlFree( member, n * sizeof(unsigned int) );
+   dlFree( merged, n * sizeof(uint8_t) );
+
+   RET("%p", root);
+   return( root );
+
+fail:
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   dlFree( member, n * sizeof(unsigned int) );
+   dlFree( merged, n * sizeof(uint8_t) );
+   dlFreeObject( root );
+
+   RET("%p", NULL);
+   return( NULL );
+}
+
+/* hide or show range of batch object */
+static int dlBatchHideRange( dlObject *object, dlBatchRange *range, int hidden )
+{
+   unsigned int i, index;
+
+   if(range->hidden == (hidden != 0))
+      return( RETURN_NOTHING );
+
+   if(dlIBOUnshare( object->ibo ) == RETURN_FAIL)
+      return( RETURN_FAIL );
+
+   i = range->first;
+   for(; i != range->first + range->count; ++i)
+   {
+      /* collapse triangles to their first vertex */
+      index = object->batch->indices[ hidden ? range->first : i ];
+#if USE_BUFFERS
+      object->ibo->indices[0][i] = index;
+#else
+      object->ibo->indices[i] = index;
+#endif
+   }
+
+   range->hidden = hidden != 0;
+   object->ibo->up_to_date = 0;
+
+   return( RETURN_OK );
+}
+
+/* hide or show merged object */
+int dlBatchHide( dlObject *batch, unsigned int source, int hidden )
+{
+   unsigned int i;
+   int ret;
+   CALL("%p, %u, %d", batch, source, hidden);
+
+   if(!batch)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(batch->batch)
+   {
+      i = 0;
+      for(; i != batch->batch->num_range; ++i)
+      {
+         if(batch->batch->range[i].source != source)
+            continue;
+
+         ret = dlBatchHideRange( batch, &batch->batch->range[i], hidden );
+         RET("%d", ret);
+         return( ret );
+      }
+   }
+
+   /* source went to other batch */
+   i = 0;
+   for(; i != batch->num_childs; ++i)
+   {
+      if(!batch->child[i]->batch)
+         continue;
+
+      ret = dlBatchHide( batch->child[i], source, hidden );
+      if(ret != RETURN_FAIL)
+      { RET("%d", ret); return( ret ); }
+   }
+
+   RET("%d", RETURN_FAIL);
+   return( RETURN_FAIL );
+}
@@ -0,0 +1,60 @@
+#ifndef DL_BATCH_H
+#define DL_BATCH_H
+
+#include <stdint.h>
+#include <limits.h>
+
+#include "dlSceneobject.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* vertices in one batch object,
+ * 16-bit index buffers can't address more */
+#if USE_BUFFERS
+#  define DL_BATCH_MAX_VERTICES USHRT_MAX
+#else
+#  define DL_BATCH_MAX_VERTICES UINT_MAX
+#endif
+
+/* indices of one object merged into batch */
+typedef struct dlBatchRange_t
+{
+   unsigned int source;       /* index to objects passed to dlBatchStatic */
+   unsigned int first, count;
+   uint8_t      hidden;
+} dlBatchRange;
+
+/* ranges of batch object,
+ * keeps original indices so hidden ranges can be restored */
+typedef struct dlBatch_t
+{
+   dlBatchRange *range;
+   unsigned int num_range;
+
+   unsigned int *indices;
+   unsigned int i_use;
+
+   unsigned int refCounter;
+} dlBatch;
+
+dlBatch*    dlCopyBatch( dlBatch *src );     /* Copy batch */
+dlBatch*    dlRefBatch( dlBatch *src );      /* Reference batch */
+int         dlFreeBatch( dlBatch *batch );   /* Free batch */
+
+/* Merge static objects to one object per material.
+ * vertices are transformed by each object's matrix,
+ * animated objects and childs are left out.
+ * Further batches are childs of returned object */
+dlObject*   dlBatchStatic( dlObject **objects, unsigned int n );
+
+/* Hide or show merged object, source is its index in dlBatchStatic.
+ * hidden triangles are made degenerate, draw call stays same */
+int         dlBatchHide( dlObject *batch, unsigned int source, int hidden );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_BATCH_H */
@@ -13,6 +13,7 @@
 #	include <GL/glew.h>
 #  include <GL/gl.h>
 #endif
+#include "dlGL.h"
 
 #define DL_DEBUG_CHANNEL "CAMERA"
 
@@ -46,7 +47,7 @@ static void dlCameraCalculateViewMatrix( dlCamera *object )
 
    kmMat4LookAt( &object->view, &object->translation, &object->target, &upvector );
 
-   /* Frustum recalculation here */
+   /* culling planes are extracted from this in dlSetCamera */
 
    kmMat4Multiply( &object->matrix, &object->projection, &object->view );
 }
@@ -9,6 +9,40 @@
                               (GLES 1.0) you might want to control this
                               variable for maximum index buffers */
 
+/* Streaming ring buffer for GL_STREAM_DRAW VBOs,
+ * segment size is bytes per frame and there are
+ * DL_STREAM_FRAMES segments in flight */
+#ifndef DL_STREAM_SIZE
+   #define DL_STREAM_SIZE     4194304
+#endif
+#ifndef DL_STREAM_FRAMES
+   #define DL_STREAM_FRAMES   3
+#endif
+
+/* Geometry heap page size, and maximum pages per heap.
+ * Heap is only used after dlHeapInit */
+#ifndef DL_HEAP_SIZE
+   #define DL_HEAP_SIZE       8388608
+#endif
+#ifndef DL_HEAP_PAGES
+   #define DL_HEAP_PAGES      16
+#endif
+
+/* Small allocations of dlMalloc/dlCalloc come from slab pages
+ * of this size, pooled per allocation category and size class */
+#ifndef DL_SLAB
+   #define DL_SLAB            1
+#endif
+#ifndef DL_SLAB_PAGE
+   #define DL_SLAB_PAGE       65536
+#endif
+
+/* Block size of per thread frame arenas,
+ * arena grows by chaining more blocks when frame needs it */
+#ifndef DL_ARENA_SIZE
+   #define DL_ARENA_SIZE      262144
+#endif
+
 /* Specify type for animation nodes,
  * change this if you have more than USHRT_MAX frames per animation,
  * or more than USHRT_MAX animations */
@@ -21,6 +55,12 @@
    #define USE_KEYFRAME_ANIMATION   0
 #endif
 
+/* Worker threads of dlJobPool ( lib: pthread ),
+ * without them jobs run on calling thread */
+#ifndef DL_THREADS
+   #define DL_THREADS      0
+#endif
+
 /* Vertex color support */
 #ifndef VERTEX_COLOR
    #define VERTEX_COLOR    0
@@ -6,6 +6,8 @@
 
 #include "dlSceneobject.h"
 #include "dlCamera.h"
+#include "dlFrustum.h"
+#include "dlOcclusion.h"
 #include "shader/dlShader.h"
 
 #ifdef __cplusplus
@@ -17,7 +19,8 @@ typedef enum
 {
    DL_RENDER_DEFAULT,
    DL_RENDER_OGL3,
-   DL_RENDER_OGL140
+   DL_RENDER_OGL140,
+   DL_RENDER_RECORD  /* OpenGL 1.4+ path recorded, needs DL_GL_RECORD */
 } dleRenderer;
 
 /* render mode enums, VBO or vertex array */
@@ -27,8 +30,21 @@ typedef enum
    DL_MODE_VERTEX_ARRAY
 } dleRenderMode;
 
+/* renderer counters */
+typedef struct
+{
+   unsigned int   draws;         /* draw calls */
+   unsigned int   stateChanges;  /* GL state toggles */
+   unsigned int   textureBinds;
+   unsigned int   visible;       /* objects passing culling */
+   unsigned int   culled;        /* objects rejected, childs of culled object not counted */
+   unsigned int   occluded;      /* objects hidden by occlusion buffer, childs not counted */
+} dlRenderStats;
+
 /* struct for renderer info */
 typedef void drawPtr( dlObject* );
+typedef void drawInstancedPtr( dlObject*, const kmMat4*, unsigned int );
+typedef void releasePtr( void );
 typedef struct
 {
    dleRenderer    id;
@@ -36,9 +52,24 @@ typedef struct
    drawPtr       *draw;
    const char    *string;
 
+   /* NULL if renderer can't draw instances */
+   drawInstancedPtr *drawInstanced;
+
+   /* deletes GL objects renderer keeps, NULL if none */
+   releasePtr    *release;
+
+   /* counters of current and last finished frame */
+   dlRenderStats  stats, frameStats;
+
    kmMat4         projection;
    dlCamera      *camera;
+
+   /* planes of projection, updated with it */
+   dlFrustum      frustum;
    dlShader      *shader;
+
+   /* objects are tested against this when set */
+   dlOcclusion   *occlusion;
 } dlRenderInfo;
 
 /* version info */
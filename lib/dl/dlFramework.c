@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include "dlCore.h"
 #include "dlTypes.h"
 #include "render/dlRender.h"
@@ -7,6 +8,24 @@
 /* init/deinit texture cache */
 #include "dlTexture.h"
 
+/* per frame stream ring */
+#include "dlStream.h"
+
+/* geometry heap */
+#include "dlHeap.h"
+
+/* slab pages */
+#include "dlAlloc.h"
+
+/* per frame arenas */
+#include "dlArena.h"
+
+/* render queue */
+#include "dlQueue.h"
+
+/* recording GL backend */
+#include "dlRecord.h"
+
 #ifdef GLES2
 #	include <GLES2/gl2.h>
 #elif  GLES1
@@ -16,6 +35,7 @@
 #	include <GL/glew.h>
 #  include <GL/gl.h>
 #endif
+#include "dlGL.h"
 
 #define DL_DEBUG_CHANNEL "GL"
 
@@ -29,6 +49,7 @@ void dlSetProjection( kmMat4 projection )
 
    _dlCore.render.projection = projection;
    _dlCore.render.camera     = NULL; /* we use own projection */
+   dlFrustumFromMatrix( &_dlCore.render.frustum, &projection );
 }
 
 /* Get projection */
@@ -45,8 +66,13 @@ void dlSetCamera( dlCamera *camera )
 
    _dlCore.render.camera = camera;
 
-   if(camera) /* camera can also be set NULL */
-      _dlCore.render.projection = camera->matrix; /* we use camera's projection */
+   if(!camera) /* camera can also be set NULL */
+      return;
+
+   /* we use camera's projection,
+    * dlCameraRender sets it once per frame and culling planes with it */
+   _dlCore.render.projection = camera->matrix;
+   dlFrustumFromMatrix( &_dlCore.render.frustum, &camera->matrix );
 }
 
 /* Get active camera */
@@ -72,6 +98,21 @@ dlShader* dlGetShader( void )
    return( _dlCore.render.shader );
 }
 
+/* Set active occlusion buffer */
+void dlSetOcclusion( dlOcclusion *occlusion )
+{
+   CALL("%p", occlusion);
+   _dlCore.render.occlusion = occlusion;
+}
+
+/* Get active occlusion buffer */
+dlOcclusion* dlGetOcclusion( void )
+{
+   TRACE();
+   RET("%p", _dlCore.render.occlusion);
+   return( _dlCore.render.occlusion );
+}
+
 /* Changes internal resolution.
  * NOTE: Any cameras not in use need to be set manually */
 void dlSetResolution( int x, int y )
@@ -93,6 +134,32 @@ void dlSetResolution( int x, int y )
    dlCameraSetView( camera, 0, 0, x, y );
 }
 
+/* Frame is done */
+void dlEndFrame( void )
+{
+   TRACE();
+
+   dlStreamEndFrame();
+
+   /* frame data of every thread is gone */
+   dlThreadArenaReset();
+
+   /* counters start again for next frame */
+   _dlCore.render.frameStats = _dlCore.render.stats;
+   memset( &_dlCore.render.stats, 0, sizeof(dlRenderStats) );
+}
+
+/* Get renderer counters */
+void dlGetRenderStats( dlRenderStats *stats )
+{
+   CALL("%p", stats);
+
+   if(!stats)
+      return;
+
+   *stats = _dlCore.render.frameStats;
+}
+
 /* Set render mode */
 void dlSetRenderMode( dleRenderMode mode )
 {
@@ -212,6 +279,8 @@ int dlCreateDisplay(int display_width, int display_height, dleRenderer renderer)
 
    /* NULL these */
    _dlCore.render.draw     = NULL;
+   _dlCore.render.drawInstanced = NULL;
+   _dlCore.render.release  = NULL;
    _dlCore.render.string   = NULL;
    _dlCore.render.camera   = NULL;
    _dlCore.render.shader   = NULL;
@@ -219,7 +288,11 @@ int dlCreateDisplay(int display_width, int display_height, dleRenderer renderer)
    /* Open log */
    dlLogOpen();
 
-#if !defined(GLES1) && !defined(GLES2)
+#if DL_GL_RECORD
+   /* GL calls go to recorder, no context needed */
+   if(dlRecordInit() != RETURN_OK)
+      return( RETURN_FAIL );
+#elif !defined(GLES1) && !defined(GLES2)
    /* initialize GLEW if on correct platform */
    glClear( GL_COLOR_BUFFER_BIT );
    if(GLEW_OK != glewInit())
@@ -283,6 +356,12 @@ int dlCreateDisplay(int display_width, int display_height, dleRenderer renderer)
             return(RETURN_FAIL);
       }
 
+      if(renderer == DL_RENDER_RECORD)
+      {
+         if(dlRecord() != RETURN_OK)
+            return(RETURN_FAIL);
+      }
+
       /*
       if(renderer == eNULL)
       */
@@ -330,9 +409,32 @@ int dlFreeDisplay( void )
 {
    TRACE();
 
+   /* GL objects of renderer */
+   if(_dlCore.render.release)
+      _dlCore.render.release();
+   _dlCore.render.release = NULL;
+
    /* Deinit texture cache */
    dlTextureFreeCache();
 
+   /* Free stream ring */
+   dlStreamFree();
+
+   /* Free geometry heap */
+   dlHeapFree();
+
+   /* Free render queue */
+   dlFreeQueue();
+
+   /* Free recorded GL calls */
+   dlRecordFree();
+
+   /* Free frame arenas */
+   dlThreadArenaFree();
+
+   /* Release empty slab pages */
+   dlAllocTrim();
+
    LOGFREE("Destroyed");
 
    /* close log */
@@ -30,9 +30,21 @@ dlCamera* dlGetCamera( void );
 void dlSetShader( dlShader *shader );
 dlShader* dlGetShader( void );
 
+/* Occlusion buffer drawing is tested against,
+ * finished with dlOcclusionEnd. NULL disables */
+void dlSetOcclusion( dlOcclusion *occlusion );
+dlOcclusion* dlGetOcclusion( void );
+
 /* Set internal resolution */
 void dlSetResolution( int x, int y );
 
+/* Call once every frame after drawing,
+ * retires per frame resources */
+void dlEndFrame( void );
+
+/* Renderer counters of last finished frame */
+void dlGetRenderStats( dlRenderStats *stats );
+
 /* Output memory graph */
 void dlMemoryGraph( void );
 
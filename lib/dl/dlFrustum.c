@@ -0,0 +1,108 @@
+#include <math.h>
+
+#include "dlFrustum.h"
+
+/* element of column major matrix */
+#define ROW(m, r, c) ((m)->mat[ (c) * 4 + (r) ])
+
+/* plane from clip space row sum, w row + sign * row */
+static void dlFrustumPlane( kmPlane *plane, const kmMat4 *m, int row, float sign )
+{
+   float length;
+
+   plane->a = ROW(m, 3, 0) + sign * ROW(m, row, 0);
+   plane->b = ROW(m, 3, 1) + sign * ROW(m, row, 1);
+   plane->c = ROW(m, 3, 2) + sign * ROW(m, row, 2);
+   plane->d = ROW(m, 3, 3) + sign * ROW(m, row, 3);
+
+   /* normalized so distances are comparable,
+    * degenerate planes stay zero and never reject */
+   length = sqrtf( plane->a * plane->a + plane->b * plane->b + plane->c * plane->c );
+   if(length == 0.0f)
+   {
+      plane->a = plane->b = plane->c = plane->d = 0;
+      return;
+   }
+
+   plane->a /= length; plane->b /= length;
+   plane->c /= length; plane->d /= length;
+}
+
+/* extract planes, Gribb & Hartmann */
+void dlFrustumFromMatrix( dlFrustum *frustum, const kmMat4 *matrix )
+{
+   dlFrustumPlane( &frustum->plane[ DL_FRUSTUM_LEFT   ], matrix, 0,  1 );
+   dlFrustumPlane( &frustum->plane[ DL_FRUSTUM_RIGHT  ], matrix, 0, -1 );
+   dlFrustumPlane( &frustum->plane[ DL_FRUSTUM_BOTTOM ], matrix, 1,  1 );
+   dlFrustumPlane( &frustum->plane[ DL_FRUSTUM_TOP    ], matrix, 1, -1 );
+   dlFrustumPlane( &frustum->plane[ DL_FRUSTUM_NEAR   ], matrix, 2,  1 );
+   dlFrustumPlane( &frustum->plane[ DL_FRUSTUM_FAR    ], matrix, 2, -1 );
+}
+
+/* test box center and extents against planes */
+dleFrustumTest dlFrustumTestAABB( const dlFrustum *frustum, const kmAABB *box, unsigned int *mask )
+{
+   const kmPlane *plane;
+   kmVec3 center, extent;
+   float distance, radius;
+   unsigned int i;
+
+   center.x = (box->max.x + box->min.x) * 0.5f;
+   center.y = (box->max.y + box->min.y) * 0.5f;
+   center.z = (box->max.z + box->min.z) * 0.5f;
+   extent.x = (box->max.x - box->min.x) * 0.5f;
+   extent.y = (box->max.y - box->min.y) * 0.5f;
+   extent.z = (box->max.z - box->min.z) * 0.5f;
+
+   i = 0;
+   for(; i != DL_FRUSTUM_PLANES; ++i)
+   {
+      if(!(*mask & (1 << i)))
+         continue;
+
+      plane    = &frustum->plane[i];
+      distance = plane->a * center.x + plane->b * center.y + plane->c * center.z + plane->d;
+      radius   = fabsf( plane->a ) * extent.x +
+                 fabsf( plane->b ) * extent.y +
+                 fabsf( plane->c ) * extent.z;
+
+      if(distance + radius < 0)
+         return( DL_FRUSTUM_OUTSIDE );
+
+      if(distance - radius >= 0)
+         *mask &= ~(1 << i);
+   }
+
+   return( *mask ? DL_FRUSTUM_INTERSECT : DL_FRUSTUM_INSIDE );
+}
+
+/* transform center, extents through absolute matrix, Arvo */
+kmAABB* dlAABBTransform( kmAABB *out, const kmAABB *box, const kmMat4 *matrix )
+{
+   kmVec3 center, extent;
+   float c[3], e[3];
+   int r;
+
+   center.x = (box->max.x + box->min.x) * 0.5f;
+   center.y = (box->max.y + box->min.y) * 0.5f;
+   center.z = (box->max.z + box->min.z) * 0.5f;
+   extent.x = (box->max.x - box->min.x) * 0.5f;
+   extent.y = (box->max.y - box->min.y) * 0.5f;
+   extent.z = (box->max.z - box->min.z) * 0.5f;
+
+   r = 0;
+   for(; r != 3; ++r)
+   {
+      c[r] = ROW(matrix, r, 0) * center.x +
+             ROW(matrix, r, 1) * center.y +
+             ROW(matrix, r, 2) * center.z + ROW(matrix, r, 3);
+      e[r] = fabsf( ROW(matrix, r, 0) ) * extent.x +
+             fabsf( ROW(matrix, r, 1) ) * extent.y +
+             fabsf( ROW(matrix, r, 2) ) * extent.z;
+   }
+
+   out->min.x = c[0] - e[0]; out->max.x = c[0] + e[0];
+   out->min.y = c[1] - e[1]; out->max.y = c[1] + e[1];
+   out->min.z = c[2] - e[2]; out->max.z = c[2] + e[2];
+   return( out );
+}
@@ -0,0 +1,56 @@
+#ifndef DL_FRUSTUM_H
+#define DL_FRUSTUM_H
+
+#include "kazmath/kazmath.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* frustum planes */
+enum
+{
+   DL_FRUSTUM_LEFT,
+   DL_FRUSTUM_RIGHT,
+   DL_FRUSTUM_BOTTOM,
+   DL_FRUSTUM_TOP,
+   DL_FRUSTUM_NEAR,
+   DL_FRUSTUM_FAR,
+   DL_FRUSTUM_PLANES
+};
+
+/* mask of every plane */
+#define DL_FRUSTUM_ALL ((1 << DL_FRUSTUM_PLANES) - 1)
+
+/* box classification */
+typedef enum
+{
+   DL_FRUSTUM_OUTSIDE,
+   DL_FRUSTUM_INTERSECT,
+   DL_FRUSTUM_INSIDE
+} dleFrustumTest;
+
+/* planes point inwards,
+ * all zero planes keep everything inside */
+typedef struct dlFrustum_t
+{
+   kmPlane plane[ DL_FRUSTUM_PLANES ];
+} dlFrustum;
+
+/* Extract planes from projection * view matrix,
+ * planes are then in the space matrix transforms from */
+void           dlFrustumFromMatrix( dlFrustum *frustum, const kmMat4 *matrix );
+
+/* Test box against planes in mask,
+ * planes box is fully inside of are cleared from mask
+ * so childs contained by the box can skip them */
+dleFrustumTest dlFrustumTestAABB( const dlFrustum *frustum, const kmAABB *box, unsigned int *mask );
+
+/* Box enclosing transformed box */
+kmAABB*        dlAABBTransform( kmAABB *out, const kmAABB *box, const kmMat4 *matrix );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_FRUSTUM_H */
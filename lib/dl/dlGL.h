@@ -0,0 +1,318 @@
+#ifndef DL_GL_H
+#define DL_GL_H
+
+/* GL dispatch, include after GL headers.
+ *
+ * With DL_GL_RECORD every GL call of the framework goes
+ * through dlGL table, which the recorder fills on dlCreateDisplay.
+ * Record builds need no GL context, see dlRecord.h */
+
+#ifndef DL_GL_RECORD
+#  define DL_GL_RECORD 0
+#endif
+
+#if DL_GL_RECORD
+
+#if defined(GLES1) || defined(GLES2)
+#  error "GL recording is only available for desktop GL"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct dlGLTable_t
+{
+   /* state */
+   void (*Enable)( GLenum cap );
+   void (*Disable)( GLenum cap );
+   void (*EnableClientState)( GLenum array );
+   void (*DisableClientState)( GLenum array );
+   void (*BlendFunc)( GLenum sfactor, GLenum dfactor );
+   void (*DepthFunc)( GLenum func );
+   void (*Clear)( GLbitfield mask );
+   void (*Viewport)( GLint x, GLint y, GLsizei width, GLsizei height );
+   void (*Color4f)( GLfloat r, GLfloat g, GLfloat b, GLfloat a );
+
+   /* fixed function matrices */
+   void (*MatrixMode)( GLenum mode );
+   void (*LoadMatrixf)( const GLfloat *m );
+   void (*LoadIdentity)( void );
+   void (*PushMatrix)( void );
+   void (*PopMatrix)( void );
+   void (*Translatef)( GLfloat x, GLfloat y, GLfloat z );
+   void (*Scalef)( GLfloat x, GLfloat y, GLfloat z );
+
+   /* immediate mode */
+   void (*Begin)( GLenum mode );
+   void (*End)( void );
+   void (*Vertex3f)( GLfloat x, GLfloat y, GLfloat z );
+
+   /* arrays and drawing */
+   void (*VertexPointer)( GLint size, GLenum type, GLsizei stride, const GLvoid *ptr );
+   void (*NormalPointer)( GLenum type, GLsizei stride, const GLvoid *ptr );
+   void (*TexCoordPointer)( GLint size, GLenum type, GLsizei stride, const GLvoid *ptr );
+   void (*ColorPointer)( GLint size, GLenum type, GLsizei stride, const GLvoid *ptr );
+   void (*DrawArrays)( GLenum mode, GLint first, GLsizei count );
+   void (*DrawElements)( GLenum mode, GLsizei count, GLenum type, const GLvoid *indices );
+
+   /* buffers */
+   void (*GenBuffers)( GLsizei n, GLuint *buffers );
+   void (*DeleteBuffers)( GLsizei n, const GLuint *buffers );
+   void (*BindBuffer)( GLenum target, GLuint buffer );
+   void (*BufferData)( GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage );
+   void (*BufferSubData)( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data );
+   GLvoid* (*MapBufferRange)( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+   GLboolean (*UnmapBuffer)( GLenum target );
+
+   /* sync */
+   GLsync (*FenceSync)( GLenum condition, GLbitfield flags );
+   GLenum (*ClientWaitSync)( GLsync sync, GLbitfield flags, GLuint64 timeout );
+   void (*DeleteSync)( GLsync sync );
+
+   /* textures */
+   void (*GenTextures)( GLsizei n, GLuint *textures );
+   void (*DeleteTextures)( GLsizei n, const GLuint *textures );
+   void (*BindTexture)( GLenum target, GLuint texture );
+   void (*TexImage2D)( GLenum target, GLint level, GLint internalformat,
+                       GLsizei width, GLsizei height, GLint border,
+                       GLenum format, GLenum type, const GLvoid *pixels );
+
+   /* queries */
+   void (*GetIntegerv)( GLenum pname, GLint *params );
+   const GLubyte* (*GetString)( GLenum name );
+
+   /* shaders */
+   GLuint (*CreateShader)( GLenum type );
+   void (*ShaderSource)( GLuint shader, GLsizei count, const GLchar **string, const GLint *length );
+   void (*CompileShader)( GLuint shader );
+   void (*DeleteShader)( GLuint shader );
+   GLuint (*CreateProgram)( void );
+   void (*AttachShader)( GLuint program, GLuint shader );
+   void (*BindAttribLocation)( GLuint program, GLuint index, const GLchar *name );
+   GLint (*GetAttribLocation)( GLuint program, const GLchar *name );
+   void (*LinkProgram)( GLuint program );
+   void (*UseProgram)( GLuint program );
+   void (*DeleteProgram)( GLuint program );
+   void (*GetProgramiv)( GLuint program, GLenum pname, GLint *params );
+   void (*GetProgramInfoLog)( GLuint program, GLsizei size, GLsizei *length, GLchar *log );
+   GLint (*GetUniformLocation)( GLuint program, const GLchar *name );
+   void (*GetActiveUniform)( GLuint program, GLuint index, GLsizei size, GLsizei *length,
+                             GLint *count, GLenum *type, GLchar *name );
+   void (*UniformMatrix4fv)( GLint location, GLsizei count, GLboolean transpose, const GLfloat *value );
+
+   /* vertex attributes and instancing */
+   void (*VertexAttribPointer)( GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                GLsizei stride, const GLvoid *ptr );
+   void (*EnableVertexAttribArray)( GLuint index );
+   void (*DisableVertexAttribArray)( GLuint index );
+   void (*VertexAttrib4f)( GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w );
+   void (*VertexAttribDivisorARB)( GLuint index, GLuint divisor );
+   void (*DrawArraysInstancedARB)( GLenum mode, GLint first, GLsizei count, GLsizei primcount );
+   void (*DrawElementsInstancedARB)( GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLsizei primcount );
+
+   /* vertex array objects */
+   void (*GenVertexArrays)( GLsizei n, GLuint *arrays );
+   void (*DeleteVertexArrays)( GLsizei n, const GLuint *arrays );
+   void (*BindVertexArray)( GLuint array );
+
+   /* uniform buffers */
+   GLuint (*GetUniformBlockIndex)( GLuint program, const GLchar *name );
+   void (*UniformBlockBinding)( GLuint program, GLuint index, GLuint binding );
+   void (*BindBufferBase)( GLenum target, GLuint index, GLuint buffer );
+} dlGLTable;
+
+/* active table */
+extern dlGLTable dlGL;
+
+#ifdef __cplusplus
+}
+#endif
+
+/* route calls, GLEW may have these as macros already */
+#undef glEnable
+#undef glDisable
+#undef glEnableClientState
+#undef glDisableClientState
+#undef glBlendFunc
+#undef glDepthFunc
+#undef glClear
+#undef glViewport
+#undef glColor4f
+#undef glMatrixMode
+#undef glLoadMatrixf
+#undef glLoadIdentity
+#undef glPushMatrix
+#undef glPopMatrix
+#undef glTranslatef
+#undef glScalef
+#undef glBegin
+#undef glEnd
+#undef glVertex3f
+#undef glVertexPointer
+#undef glNormalPointer
+#undef glTexCoordPointer
+#undef glColorPointer
+#undef glDrawArrays
+#undef glDrawElements
+#undef glGenBuffers
+#undef glDeleteBuffers
+#undef glBindBuffer
+#undef glBufferData
+#undef glBufferSubData
+#undef glMapBufferRange
+#undef glUnmapBuffer
+#undef glFenceSync
+#undef glClientWaitSync
+#undef glDeleteSync
+#undef glGenTextures
+#undef glDeleteTextures
+#undef glBindTexture
+#undef glTexImage2D
+#undef glGetIntegerv
+#undef glGetString
+#undef glCreateShader
+#undef glShaderSource
+#undef glCompileShader
+#undef glDeleteShader
+#undef glCreateProgram
+#undef glAttachShader
+#undef glBindAttribLocation
+#undef glGetAttribLocation
+#undef glLinkProgram
+#undef glUseProgram
+#undef glDeleteProgram
+#undef glGetProgramiv
+#undef glGetProgramInfoLog
+#undef glGetUniformLocation
+#undef glGetActiveUniform
+#undef glUniformMatrix4fv
+#undef glVertexAttribPointer
+#undef glEnableVertexAttribArray
+#undef glDisableVertexAttribArray
+#undef glVertexAttrib4f
+#undef glVertexAttribDivisorARB
+#undef glDrawArraysInstancedARB
+#undef glDrawElementsInstancedARB
+#undef glGenVertexArrays
+#undef glDeleteVertexArrays
+#undef glBindVertexArray
+#undef glGetUniformBlockIndex
+#undef glUniformBlockBinding
+#undef glBindBufferBase
+
+#define glEnable              dlGL.Enable
+#define glDisable             dlGL.Disable
+#define glEnableClientState   dlGL.EnableClientState
+#define glDisableClientState  dlGL.DisableClientState
+#define glBlendFunc           dlGL.BlendFunc
+#define glDepthFunc           dlGL.DepthFunc
+#define glClear               dlGL.Clear
+#define glViewport            dlGL.Viewport
+#define glColor4f             dlGL.Color4f
+#define glMatrixMode          dlGL.MatrixMode
+#define glLoadMatrixf         dlGL.LoadMatrixf
+#define glLoadIdentity        dlGL.LoadIdentity
+#define glPushMatrix          dlGL.PushMatrix
+#define glPopMatrix           dlGL.PopMatrix
+#define glTranslatef          dlGL.Translatef
+#define glScalef              dlGL.Scalef
+#define glBegin               dlGL.Begin
+#define glEnd                 dlGL.End
+#define glVertex3f            dlGL.Vertex3f
+#define glVertexPointer       dlGL.VertexPointer
+#define glNormalPointer       dlGL.NormalPointer
+#define glTexCoordPointer     dlGL.TexCoordPointer
+#define glColorPointer        dlGL.ColorPointer
+#define glDrawArrays          dlGL.DrawArrays
+#define glDrawElements        dlGL.DrawElements
+#define glGenBuffers          dlGL.GenBuffers
+#define glDeleteBuffers       dlGL.DeleteBuffers
+#define glBindBuffer          dlGL.BindBuffer
+#define glBufferData          dlGL.BufferData
+#define glBufferSubData       dlGL.BufferSubData
+#define glMapBufferRange      dlGL.MapBufferRange
+#define glUnmapBuffer         dlGL.UnmapBuffer
+#define glFenceSync           dlGL.FenceSync
+#define glClientWaitSync      dlGL.ClientWaitSync
+#define glDeleteSync          dlGL.DeleteSync
+#define glGenTextures         dlGL.GenTextures
+#define glDeleteTextures      dlGL.DeleteTextures
+#define glBindTexture         dlGL.BindTexture
+#define glTexImage2D          dlGL.TexImage2D
+#define glGetIntegerv         dlGL.GetIntegerv
+#define glGetString           dlGL.GetString
+#define glCreateShader        dlGL.CreateShader
+#define glShaderSource        dlGL.ShaderSource
+#define glCompileShader       dlGL.CompileShader
+#define glDeleteShader        dlGL.DeleteShader
+#define glCreateProgram       dlGL.CreateProgram
+#define glAttachShader        dlGL.AttachShader
+#define glBindAttribLocation  dlGL.BindAttribLocation
+#define glGetAttribLocation   dlGL.GetAttribLocation
+#define glLinkProgram         dlGL.LinkProgram
+#define glUseProgram          dlGL.UseProgram
+#define glDeleteProgram       dlGL.DeleteProgram
+#define glGetProgramiv        dlGL.GetProgramiv
+#define glGetProgramInfoLog   dlGL.GetProgramInfoLog
+#define glGetUniformLocation  dlGL.GetUniformLocation
+#define glGetActiveUniform    dlGL.GetActiveUniform
+#define glUniformMatrix4fv    dlGL.UniformMatrix4fv
+#define glVertexAttribPointer       dlGL.VertexAttribPointer
+#define glEnableVertexAttribArray   dlGL.EnableVertexAttribArray
+#define glDisableVertexAttribArray  dlGL.DisableVertexAttribArray
+#define glVertexAttrib4f            dlGL.VertexAttrib4f
+#define glVertexAttribDivisorARB    dlGL.VertexAttribDivisorARB
+#define glDrawArraysInstancedARB    dlGL.DrawArraysInstancedARB
+#define glDrawElementsInstancedARB  dlGL.DrawElementsInstancedARB
+#define glGenVertexArrays           dlGL.GenVertexArrays
+#define glDeleteVertexArrays        dlGL.DeleteVertexArrays
+#define glBindVertexArray           dlGL.BindVertexArray
+#define glGetUniformBlockIndex      dlGL.GetUniformBlockIndex
+#define glUniformBlockBinding       dlGL.UniformBlockBinding
+#define glBindBufferBase            dlGL.BindBufferBase
+
+/* recorder supports every extension framework asks for */
+#undef  GL_ARB_vertex_buffer_object
+#undef  GL_ARB_map_buffer_range
+#undef  GL_ARB_sync
+#undef  GL_ARB_half_float_vertex
+#undef  GL_ARB_vertex_type_2_10_10_10_rev
+#undef  GL_ARB_instanced_arrays
+#undef  GL_ARB_draw_instanced
+#undef  GL_ARB_vertex_array_object
+#undef  GL_ARB_uniform_buffer_object
+#define GL_ARB_vertex_buffer_object       1
+#define GL_ARB_map_buffer_range           1
+#define GL_ARB_sync                       1
+#define GL_ARB_half_float_vertex          1
+#define GL_ARB_vertex_type_2_10_10_10_rev 1
+#define GL_ARB_instanced_arrays           1
+#define GL_ARB_draw_instanced             1
+#define GL_ARB_vertex_array_object        1
+#define GL_ARB_uniform_buffer_object      1
+
+/* runtime checks of GLEW, glewInit is skipped when recording */
+#undef  GLEW_VERSION_3_0
+#undef  GLEW_ARB_instanced_arrays
+#undef  GLEW_ARB_draw_instanced
+#undef  GLEW_ARB_vertex_array_object
+#undef  GLEW_ARB_map_buffer_range
+#undef  GLEW_ARB_sync
+#undef  GLEW_ARB_half_float_vertex
+#undef  GLEW_ARB_vertex_type_2_10_10_10_rev
+#undef  GLEW_VERSION_3_3
+#define GLEW_VERSION_3_0                  1
+#define GLEW_ARB_instanced_arrays         1
+#define GLEW_ARB_draw_instanced           1
+#define GLEW_ARB_vertex_array_object      1
+#define GLEW_ARB_map_buffer_range         1
+#define GLEW_ARB_sync                     1
+#define GLEW_ARB_half_float_vertex        1
+#define GLEW_ARB_vertex_type_2_10_10_10_rev 1
+#define GLEW_VERSION_3_3                  1
+
+#endif /* DL_GL_RECORD */
+
+#endif /* DL_GL_H */
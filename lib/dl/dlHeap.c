@@ -0,0 +1,482 @@
+#include <stdint.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlHeap.h"
+#include "dlConfig.h"
+#include "dlCore.h"
+#include "dlLog.h"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#endif
+#ifdef GLES1
+#  include <GLES/gl.h>
+#  include <GLES/glext.h>
+#endif
+#if !defined(GLES1) && !defined(GLES2)
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#endif
+#include "dlGL.h"
+
+#define DL_DEBUG_CHANNEL "HEAP"
+
+/* vertex array objects, bound by renderer for cached pointer setup */
+#if !defined(GLES1) && !defined(GLES2) && GL_ARB_vertex_array_object
+#  define DL_VERTEX_ARRAY_OBJECT 1
+#else
+#  define DL_VERTEX_ARRAY_OBJECT 0
+#endif
+
+/* ranges inside page are aligned to this */
+#define DL_HEAP_ALIGN 16
+
+/* free block, pages keep these sorted by offset */
+typedef struct dlHeapBlock_t
+{
+   size_t offset, size;
+   struct dlHeapBlock_t *next;
+} dlHeapBlock;
+
+/* one GL buffer */
+typedef struct dlHeapPage_t
+{
+   unsigned int object;
+   size_t       size, used;
+   unsigned int ranges;
+   dlHeapBlock  *free;
+} dlHeapPage;
+
+/* heap of one type */
+typedef struct dlHeap_t
+{
+   dlHeapPage   page[DL_HEAP_PAGES];
+   unsigned int num_pages;
+} dlHeap;
+
+static dlHeap _DL_HEAP[DL_HEAP_LAST];
+static size_t _DL_HEAP_PAGE_SIZE = 0;
+
+/* buffer binding cache */
+static unsigned int _DL_BOUND_ARRAY   = 0;
+static unsigned int _DL_BOUND_ELEMENT = 0;
+
+/* element binding is vertex array state,
+ * default one is kept while other vertex arrays are bound */
+static unsigned int _DL_BOUND_VERTEX_ARRAY = 0;
+static unsigned int _DL_DEFAULT_ELEMENT    = 0;
+
+/* buffers deleted so far */
+static unsigned int _DL_DELETED_BUFFERS = 0;
+
+/* GL target of heap */
+static unsigned int dlHeapTarget( dleHeap type )
+{
+   return( type == DL_HEAP_INDEX ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER );
+}
+
+/* new free block */
+static dlHeapBlock* dlHeapNewBlock( size_t offset, size_t size, dlHeapBlock *next )
+{
+   dlHeapBlock *block;
+
+   dlSetAlloc( ALLOC_CORE );
+   block = dlMalloc( sizeof(dlHeapBlock) );
+   if(!block)
+      return( NULL );
+
+   block->offset = offset;
+   block->size   = size;
+   block->next   = next;
+   return( block );
+}
+
+/* add new page to heap */
+static int dlHeapNewPage( dleHeap type, size_t size )
+{
+   dlHeap     *heap = &_DL_HEAP[type];
+   dlHeapPage *page;
+   CALL("%d, %llu", type, size);
+
+   if(heap->num_pages == DL_HEAP_PAGES)
+   {
+      LOGWARN("Out of heap pages");
+      RET("%d", RETURN_FAIL);
+      return( RETURN_FAIL );
+   }
+
+   if(size < _DL_HEAP_PAGE_SIZE)
+      size = _DL_HEAP_PAGE_SIZE;
+
+   page = &heap->page[ heap->num_pages ];
+   page->free = dlHeapNewBlock( 0, size, NULL );
+   if(!page->free)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   glGenBuffers( 1, &page->object );
+   if(!page->object)
+   {
+      dlSetAlloc( ALLOC_CORE );
+      dlFree( page->free, sizeof(dlHeapBlock) );
+      page->free = NULL;
+
+      RET("%d", RETURN_FAIL);
+      return( RETURN_FAIL );
+   }
+
+   dlBindBuffer( dlHeapTarget( type ), page->object );
+   glBufferData( dlHeapTarget( type ), size, NULL, GL_STATIC_DRAW );
+
+   page->size   = size;
+   page->used   = 0;
+   page->ranges = 0;
+   heap->num_pages++;
+
+   LOGINFOP("New page %u, %llu bytes", heap->num_pages - 1, size);
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* first fit from page */
+static int dlHeapPageAlloc( dlHeapPage *page, size_t size, size_t *offset )
+{
+   dlHeapBlock *block, *prev = NULL;
+
+   block = page->free;
+   for(; block; prev = block, block = block->next)
+   {
+      if(block->size < size)
+         continue;
+
+      *offset = block->offset;
+
+      /* take from front of block */
+      block->offset += size;
+      block->size   -= size;
+      if(!block->size)
+      {
+         if(prev) prev->next = block->next;
+         else     page->free = block->next;
+
+         dlSetAlloc( ALLOC_CORE );
+         dlFree( block, sizeof(dlHeapBlock) );
+      }
+
+      page->used += size;
+      page->ranges++;
+      return( RETURN_OK );
+   }
+
+   return( RETURN_FAIL );
+}
+
+/* init heap */
+int dlHeapInit( size_t page_size )
+{
+   CALL("%llu", page_size);
+
+   if(_DL_HEAP_PAGE_SIZE)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+   {
+      LOGWARN("Geometry heap needs VBO render mode");
+      RET("%d", RETURN_FAIL);
+      return( RETURN_FAIL );
+   }
+
+   if(!page_size)
+      page_size = DL_HEAP_SIZE;
+
+   memset( _DL_HEAP, 0, sizeof(_DL_HEAP) );
+   _DL_HEAP_PAGE_SIZE = page_size;
+
+   LOGOK("INIT");
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* free heap, every range should be released before this */
+int dlHeapFree( void )
+{
+   unsigned int t, p;
+   dlHeapBlock *block, *next;
+   TRACE();
+
+   if(!_DL_HEAP_PAGE_SIZE)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_CORE );
+
+   t = 0;
+   for(; t != DL_HEAP_LAST; ++t)
+   {
+      p = 0;
+      for(; p != _DL_HEAP[t].num_pages; ++p)
+      {
+         if(_DL_HEAP[t].page[p].ranges)
+         { LOGWARNP("Page %u still has %u ranges", p, _DL_HEAP[t].page[p].ranges); }
+
+         block = _DL_HEAP[t].page[p].free;
+         for(; block; block = next)
+         {
+            next = block->next;
+            dlFree( block, sizeof(dlHeapBlock) );
+         }
+
+         dlDeleteBuffer( &_DL_HEAP[t].page[p].object );
+      }
+   }
+
+   memset( _DL_HEAP, 0, sizeof(_DL_HEAP) );
+   _DL_HEAP_PAGE_SIZE = 0;
+   dlResetBufferCache();
+
+   LOGFREE("FREE");
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* is heap in use? */
+int dlHeapEnabled( void )
+{
+   return( _DL_HEAP_PAGE_SIZE != 0 );
+}
+
+/* allocate range */
+int dlHeapAlloc( dleHeap type, size_t size, dlHeapRange *range )
+{
+   unsigned int p;
+   size_t offset;
+   dlHeap *heap;
+   CALL("%d, %llu, %p", type, size, range);
+
+   if(!range || type >= DL_HEAP_LAST || !_DL_HEAP_PAGE_SIZE)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memset( range, 0, sizeof(dlHeapRange) );
+   range->type = type;
+
+   if(!size)
+   { RET("%d", RETURN_OK); return( RETURN_OK ); }
+
+   size = (size + DL_HEAP_ALIGN - 1) & ~((size_t)DL_HEAP_ALIGN - 1);
+   heap = &_DL_HEAP[type];
+
+   /* first fit from existing pages, then new page */
+   p = 0;
+   for(; p != heap->num_pages; ++p)
+      if(dlHeapPageAlloc( &heap->page[p], size, &offset ) == RETURN_OK)
+         break;
+
+   if(p == heap->num_pages)
+   {
+      if(dlHeapNewPage( type, size ) != RETURN_OK)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      if(dlHeapPageAlloc( &heap->page[p], size, &offset ) != RETURN_OK)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   }
+
+   range->object = heap->page[p].object;
+   range->offset = offset;
+   range->size   = size;
+   range->page   = p;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* release range, coalesce with neighbour blocks */
+int dlHeapRelease( dlHeapRange *range )
+{
+   dlHeapPage  *page;
+   dlHeapBlock *block, *prev = NULL;
+   CALL("%p", range);
+
+   if(!range)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!range->size || !_DL_HEAP_PAGE_SIZE)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   page = &_DL_HEAP[ range->type ].page[ range->page ];
+
+   /* find position, list is sorted */
+   block = page->free;
+   for(; block && block->offset < range->offset; prev = block, block = block->next);
+
+   /* merge with previous */
+   if(prev && prev->offset + prev->size == range->offset)
+   {
+      prev->size += range->size;
+
+      /* and next */
+      if(block && prev->offset + prev->size == block->offset)
+      {
+         prev->size += block->size;
+         prev->next  = block->next;
+
+         dlSetAlloc( ALLOC_CORE );
+         dlFree( block, sizeof(dlHeapBlock) );
+      }
+   }
+   /* merge with next */
+   else if(block && range->offset + range->size == block->offset)
+   {
+      block->offset  = range->offset;
+      block->size   += range->size;
+   }
+   else
+   {
+      block = dlHeapNewBlock( range->offset, range->size, block );
+      if(!block)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      if(prev) prev->next = block;
+      else     page->free = block;
+   }
+
+   page->used -= range->size;
+   page->ranges--;
+   memset( range, 0, sizeof(dlHeapRange) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* collect statistics */
+int dlHeapGetStats( dleHeap type, dlHeapStats *stats )
+{
+   unsigned int p;
+   size_t free_bytes = 0;
+   dlHeapBlock *block;
+   CALL("%d, %p", type, stats);
+
+   if(!stats || type >= DL_HEAP_LAST)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memset( stats, 0, sizeof(dlHeapStats) );
+
+   p = 0;
+   for(; p != _DL_HEAP[type].num_pages; ++p)
+   {
+      stats->total  += _DL_HEAP[type].page[p].size;
+      stats->used   += _DL_HEAP[type].page[p].used;
+      stats->ranges += _DL_HEAP[type].page[p].ranges;
+
+      block = _DL_HEAP[type].page[p].free;
+      for(; block; block = block->next)
+      {
+         free_bytes += block->size;
+         stats->free_blocks++;
+         if(block->size > stats->largest)
+            stats->largest = block->size;
+      }
+   }
+   stats->pages = _DL_HEAP[type].num_pages;
+
+   if(free_bytes)
+      stats->fragmentation = 1.0f - (float)stats->largest / free_bytes;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* cached glBindBuffer */
+void dlBindBuffer( unsigned int target, unsigned int object )
+{
+   if(target == GL_ARRAY_BUFFER)
+   {
+      if(_DL_BOUND_ARRAY == object) return;
+      _DL_BOUND_ARRAY = object;
+   }
+   else if(target == GL_ELEMENT_ARRAY_BUFFER)
+   {
+      /* don't change element buffer of cached vertex array */
+      if(_DL_BOUND_VERTEX_ARRAY)
+         dlBindVertexArray( 0, 0 );
+
+      if(_DL_BOUND_ELEMENT == object) return;
+      _DL_BOUND_ELEMENT = object;
+   }
+
+   glBindBuffer( target, object );
+}
+
+/* forget cached bindings,
+ * call after binding buffers outside framework */
+void dlResetBufferCache( void )
+{
+#if DL_VERTEX_ARRAY_OBJECT
+   /* unbinding needs driver support, only there if one was bound */
+   if(_DL_BOUND_VERTEX_ARRAY)
+      glBindVertexArray( 0 );
+   _DL_BOUND_VERTEX_ARRAY = 0;
+   _DL_DEFAULT_ELEMENT    = 0;
+#endif
+
+   _DL_BOUND_ARRAY   = 0;
+   _DL_BOUND_ELEMENT = 0;
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+}
+
+/* delete buffer and drop it from binding cache */
+void dlDeleteBuffer( unsigned int *object )
+{
+   if(!*object)
+      return;
+
+   if(_DL_BOUND_ARRAY     == *object) _DL_BOUND_ARRAY     = 0;
+   if(_DL_BOUND_ELEMENT   == *object) _DL_BOUND_ELEMENT   = 0;
+   if(_DL_DEFAULT_ELEMENT == *object) _DL_DEFAULT_ELEMENT = 0;
+
+   glDeleteBuffers( 1, object );
+   *object = 0;
+
+   ++_DL_DELETED_BUFFERS;
+}
+
+/* buffers deleted so far,
+ * vertex arrays built before may point to reused names */
+unsigned int dlDeletedBuffers( void )
+{
+   return( _DL_DELETED_BUFFERS );
+}
+
+/* cached glBindVertexArray,
+ * element is the element buffer bound inside vertex array */
+void dlBindVertexArray( unsigned int object, unsigned int element )
+{
+#if DL_VERTEX_ARRAY_OBJECT
+   if(_DL_BOUND_VERTEX_ARRAY == object) return;
+
+   if(!_DL_BOUND_VERTEX_ARRAY)
+      _DL_DEFAULT_ELEMENT = _DL_BOUND_ELEMENT;
+
+   _DL_BOUND_VERTEX_ARRAY = object;
+   _DL_BOUND_ELEMENT      = object ? element : _DL_DEFAULT_ELEMENT;
+
+   glBindVertexArray( object );
+#endif
+}
+
+/* delete vertex array, deleting bound one binds default */
+void dlDeleteVertexArray( unsigned int *object )
+{
+   if(!*object)
+      return;
+
+#if DL_VERTEX_ARRAY_OBJECT
+   if(_DL_BOUND_VERTEX_ARRAY == *object)
+      dlBindVertexArray( 0, 0 );
+
+   glDeleteVertexArrays( 1, object );
+#endif
+   *object = 0;
+}
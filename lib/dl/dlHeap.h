@@ -0,0 +1,73 @@
+#ifndef DL_HEAP_H
+#define DL_HEAP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* heap types, vertex and index data live in separate buffers */
+typedef enum
+{
+   DL_HEAP_VERTEX,
+   DL_HEAP_INDEX,
+   DL_HEAP_LAST
+} dleHeap;
+
+/* range handed out from heap */
+typedef struct dlHeapRange_t
+{
+   unsigned int object;    /* GL buffer of page */
+   size_t       offset;    /* byte offset inside buffer */
+   size_t       size;      /* 0 when nothing allocated */
+   unsigned int page;
+   dleHeap      type;
+} dlHeapRange;
+
+/* heap statistics */
+typedef struct dlHeapStats_t
+{
+   size_t       total;           /* bytes in all pages */
+   size_t       used;            /* bytes handed out */
+   size_t       largest;         /* largest free block */
+   unsigned int pages;
+   unsigned int ranges;          /* live allocations */
+   unsigned int free_blocks;
+   float        fragmentation;   /* 1 - largest / free */
+} dlHeapStats;
+
+/* Init/deinit geometry heap,
+ * VBOs and IBOs constructed after init suballocate from it */
+int   dlHeapInit( size_t page_size );
+int   dlHeapFree( void );
+int   dlHeapEnabled( void );
+
+/* Allocate/release range */
+int   dlHeapAlloc( dleHeap type, size_t size, dlHeapRange *range );
+int   dlHeapRelease( dlHeapRange *range );
+
+/* Statistics */
+int   dlHeapGetStats( dleHeap type, dlHeapStats *stats );
+
+/* Cached buffer binding,
+ * use this instead of glBindBuffer so renderer can skip rebinds */
+void  dlBindBuffer( unsigned int target, unsigned int object );
+void  dlDeleteBuffer( unsigned int *object );
+void  dlResetBufferCache( void );
+
+/* Cached vertex array binding, element is the element buffer
+ * bound inside it. Binding element buffer through dlBindBuffer
+ * binds default vertex array first, so cached ones stay intact */
+void  dlBindVertexArray( unsigned int object, unsigned int element );
+void  dlDeleteVertexArray( unsigned int *object );
+
+/* Counts deleted buffers, vertex arrays built
+ * before it changed may reference reused names */
+unsigned int dlDeletedBuffers( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_HEAP_H */
@@ -0,0 +1,227 @@
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlHierarchy.h"
+#include "dlLog.h"
+
+#define DL_DEBUG_CHANNEL "HIERARCHY"
+
+/* Allocate hierarchy */
+dlHierarchy* dlNewHierarchy( void )
+{
+   dlHierarchy *hierarchy;
+   TRACE();
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   if(!(hierarchy = dlCalloc( 1, sizeof(dlHierarchy) )))
+   { RET("%p", NULL); return( NULL ); }
+
+   LOGOK("NEW");
+
+   hierarchy->refCounter++;
+
+   RET("%p", hierarchy);
+   return( hierarchy );
+}
+
+/* Reference hierarchy */
+dlHierarchy* dlRefHierarchy( dlHierarchy *src )
+{
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   src->refCounter++;
+
+   RET("%p", src);
+   return( src );
+}
+
+/* Free hierarchy */
+int dlFreeHierarchy( dlHierarchy *hierarchy )
+{
+   CALL("%p", hierarchy);
+
+   if(!hierarchy) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* There is still references to this hierarchy alive */
+   if(--hierarchy->refCounter != 0) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+   dlFree( hierarchy->root, hierarchy->num_root * sizeof(dlObject*) );
+   dlFree( hierarchy->node, hierarchy->num_node * sizeof(dlObject*) );
+
+   LOGFREE("FREE");
+
+   dlFree( hierarchy, sizeof(dlHierarchy) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* make room for need pointers */
+static int dlHierarchyGrow( dlObject ***list, unsigned int *num, unsigned int need )
+{
+   dlObject   **tmp;
+   unsigned int size;
+
+   if(need <= *num)
+      return( RETURN_OK );
+
+   dlSetAlloc( ALLOC_SCENEOBJECT );
+
+   size = dlGrowCapacity( *num, need );
+   if(*list)
+      tmp = dlRealloc( *list, *num, size, sizeof(dlObject*) );
+   else
+      tmp = dlCalloc( size, sizeof(dlObject*) );
+
+   if(!tmp)
+      return( RETURN_FAIL );
+
+   *list = tmp;
+   *num  = size;
+   return( RETURN_OK );
+}
+
+/* count object and childs it owns */
+static unsigned int dlHierarchyCount( dlObject *object )
+{
+   unsigned int i, count = 1;
+
+   i = 0;
+   for(; i != object->num_childs; ++i)
+      if(object->child[i]->parent == object)
+         count += dlHierarchyCount( object->child[i] );
+
+   return( count );
+}
+
+/* append object and then its childs, shared childs stay with their first parent */
+static void dlHierarchyFlatten( dlHierarchy *hierarchy, dlObject *object )
+{
+   unsigned int i;
+
+   hierarchy->node[ hierarchy->use_node++ ] = object;
+
+   i = 0;
+   for(; i != object->num_childs; ++i)
+      if(object->child[i]->parent == object)
+         dlHierarchyFlatten( hierarchy, object->child[i] );
+}
+
+/* append nodes of root */
+static int dlHierarchyAddNodes( dlHierarchy *hierarchy, dlObject *root )
+{
+   if(dlHierarchyGrow( &hierarchy->node, &hierarchy->num_node,
+                       hierarchy->use_node + dlHierarchyCount( root ) ) != RETURN_OK)
+      return( RETURN_FAIL );
+
+   dlHierarchyFlatten( hierarchy, root );
+   return( RETURN_OK );
+}
+
+/* Add root */
+int dlHierarchyAdd( dlHierarchy *hierarchy, dlObject *root )
+{
+   CALL("%p, %p", hierarchy, root);
+
+   if(!hierarchy || !root)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlHierarchyGrow( &hierarchy->root, &hierarchy->num_root,
+                       hierarchy->use_root + 1 ) != RETURN_OK)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlHierarchyAddNodes( hierarchy, root ) != RETURN_OK)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   hierarchy->root[ hierarchy->use_root++ ] = root;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Remove root */
+int dlHierarchyRemove( dlHierarchy *hierarchy, dlObject *root )
+{
+   unsigned int i;
+   int ret;
+   CALL("%p, %p", hierarchy, root);
+
+   if(!hierarchy || !root)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   i = 0;
+   for(; i != hierarchy->use_root; ++i)
+      if(hierarchy->root[i] == root) break;
+
+   if(i == hierarchy->use_root)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* keep order of roots */
+   --hierarchy->use_root;
+   for(; i != hierarchy->use_root; ++i)
+      hierarchy->root[i] = hierarchy->root[i + 1];
+
+   ret = dlHierarchyRebuild( hierarchy );
+
+   RET("%d", ret);
+   return( ret );
+}
+
+/* Remove every root */
+void dlHierarchyClear( dlHierarchy *hierarchy )
+{
+   CALL("%p", hierarchy);
+
+   if(!hierarchy)
+      return;
+
+   hierarchy->use_root = 0;
+   hierarchy->use_node = 0;
+}
+
+/* Flatten again */
+int dlHierarchyRebuild( dlHierarchy *hierarchy )
+{
+   unsigned int i;
+   CALL("%p", hierarchy);
+
+   if(!hierarchy)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   hierarchy->use_node = 0;
+   i = 0;
+   for(; i != hierarchy->use_root; ++i)
+      if(dlHierarchyAddNodes( hierarchy, hierarchy->root[i] ) != RETURN_OK)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Update changed world matrices,
+ * parent is always done when its child is reached */
+unsigned int dlHierarchyUpdate( dlHierarchy *hierarchy )
+{
+   dlObject   **node;
+   unsigned int i, updated = 0;
+   CALL("%p", hierarchy);
+
+   if(!hierarchy)
+   { RET("%u", 0); return( 0 ); }
+
+   node = hierarchy->node;
+   i = 0;
+   for(; i != hierarchy->use_node; ++i)
+   {
+      if(!node[i]->transform_changed)
+         continue;
+
+      dlUpdateMatrix( node[i] );
+      ++updated;
+   }
+
+   RET("%u", updated);
+   return( updated );
+}
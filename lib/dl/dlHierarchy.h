@@ -0,0 +1,45 @@
+#ifndef DL_HIERARCHY_H
+#define DL_HIERARCHY_H
+
+#include "dlSceneobject.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* scene graphs flattened parent before child,
+ * objects are not referenced and must be removed before they are freed */
+typedef struct dlHierarchy_t
+{
+   /* roots as added */
+   dlObject    **root;
+   unsigned int  num_root, use_root;
+
+   /* every object of roots, parents always come before their childs */
+   dlObject    **node;
+   unsigned int  num_node, use_node;
+
+   unsigned int refCounter;
+} dlHierarchy;
+
+dlHierarchy*   dlNewHierarchy( void );
+dlHierarchy*   dlRefHierarchy( dlHierarchy *src );
+int            dlFreeHierarchy( dlHierarchy *hierarchy );
+
+/* Add root with its childs */
+int            dlHierarchyAdd( dlHierarchy *hierarchy, dlObject *root );
+int            dlHierarchyRemove( dlHierarchy *hierarchy, dlObject *root );
+void           dlHierarchyClear( dlHierarchy *hierarchy );
+
+/* Flatten roots again, call after childs are added or freed */
+int            dlHierarchyRebuild( dlHierarchy *hierarchy );
+
+/* Update world matrices of changed objects in one pass,
+ * returns number of matrices built */
+unsigned int   dlHierarchyUpdate( dlHierarchy *hierarchy );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_HIERARCHY_H */
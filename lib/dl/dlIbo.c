@@ -19,9 +19,27 @@
 #  include <GL/glew.h>
 #  include <GL/gl.h>
 #endif
+#include "dlGL.h"
 
 #define DL_DEBUG_CHANNEL "IBO"
 
+/* bytes of system memory indices */
+static size_t dlIBODataSize( dlIBO *ibo )
+{
+#if USE_BUFFERS
+   unsigned int i;
+   size_t size = 0;
+
+   i = 0;
+   for(; i != DL_MAX_BUFFERS; ++i)
+      size += (size_t)ibo->i_num[i] * sizeof(unsigned short);
+
+   return( size );
+#else
+   return( (size_t)ibo->i_num * sizeof(unsigned int) );
+#endif
+}
+
 /* Allocate IBO object */
 dlIBO* dlNewIBO( void )
 {
@@ -38,6 +56,11 @@ dlIBO* dlNewIBO( void )
 
    /* Default hint */
    ibo->hint = GL_STATIC_DRAW;
+#if USE_BUFFERS
+   ibo->type = GL_UNSIGNED_SHORT;
+#else
+   ibo->type = GL_UNSIGNED_INT;
+#endif
 
 #if USE_BUFFERS
    i = 0;
@@ -58,7 +81,8 @@ dlIBO* dlNewIBO( void )
    return( ibo );
 }
 
-/* Copy IBO object */
+/* Copy IBO object,
+ * copy shares data with src until either is modified */
 dlIBO* dlCopyIBO( dlIBO *src )
 {
    dlIBO *ibo;
@@ -67,21 +91,35 @@ dlIBO* dlCopyIBO( dlIBO *src )
    /* Fuuuuuuuuu--- We have non valid object */
    if(!src) { RET("%p", NULL); return( NULL ); }
 
-   /* Allocate IBO object */
+   /* upload once, copies share the GL object */
+   if(_dlCore.render.mode == DL_MODE_VBO)
+      dlIBOUpdate( src );
+
    dlSetAlloc( ALLOC_IBO );
-   ibo = (dlIBO*)dlCalloc( 1, sizeof(dlIBO) );
+
+   /* first copy, start counting */
+   if(!src->shared)
+   {
+      src->shared = dlCalloc( 1, sizeof(unsigned int) );
+      if(!src->shared)
+      { RET("%p", NULL); return( NULL ); }
+
+      *src->shared = 1;
+   }
+
+   /* Copy IBO object */
+   ibo = (dlIBO*)dlCopy( src, sizeof(dlIBO) );
    if(!ibo)
    { RET("%p", NULL); return( NULL ); }
 
-   /* Copy data */
-   dlCopyIndexBuffer( ibo, src );
-
-   ibo->ibo_size  = src->ibo_size;
-   ibo->hint	  = src->hint;
+   /* share data */
+   ++*ibo->shared;
+   dlShareAlloc( dlIBODataSize( src ) );
 
    LOGWARN("COPY");
 
    /* Increase ref counter */
+   ibo->refCounter = 0;
    ibo->refCounter++;
 
    /* Return IBO object */
@@ -124,11 +162,30 @@ int dlFreeIBO( dlIBO *ibo )
 
    dlSetAlloc( ALLOC_IBO );
 
+   /* data and GL object belong to the other copies */
+   if(ibo->shared && *ibo->shared > 1)
+   {
+      --*ibo->shared;
+      dlUnshareAlloc( dlIBODataSize( ibo ) );
+
+      LOGFREE("FREE");
+
+      dlFree( ibo, sizeof(dlIBO) );
+
+      RET("%d", RETURN_OK);
+      return( RETURN_OK );
+   }
+
+   /* last one owns the data */
+   dlFree( ibo->shared, sizeof(unsigned int) );
+   ibo->shared = NULL;
+
    /* Free all data */
    dlFreeIndexBuffer( ibo );
 
-   /* delete ibo */
-   if( ibo->object ) glDeleteBuffers(1, &ibo->object);
+   /* delete ibo, heap pages are not ours */
+   if( ibo->in_heap ) dlHeapRelease( &ibo->range );
+   else               dlDeleteBuffer( &ibo->object );
    ibo->object = 0;
 
    LOGFREE("FREE");
@@ -140,6 +197,124 @@ int dlFreeIBO( dlIBO *ibo )
    return( RETURN_OK );
 }
 
+/* detach IBO from its copies */
+int dlIBOUnshare( dlIBO *ibo )
+{
+#if USE_BUFFERS
+   unsigned int i;
+   unsigned short *indices[DL_MAX_BUFFERS + 1];
+#else
+   unsigned int *indices;
+#endif
+   size_t size;
+   CALL("%p", ibo);
+
+   if(!ibo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!ibo->shared)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_IBO );
+
+   /* others are gone, data is ours */
+   if(*ibo->shared == 1)
+   {
+      dlFree( ibo->shared, sizeof(unsigned int) );
+      ibo->shared = NULL;
+
+      RET("%d", RETURN_OK);
+      return( RETURN_OK );
+   }
+
+   size = dlIBODataSize( ibo );
+
+#if USE_BUFFERS
+   i = 0;
+   for(; i != DL_MAX_BUFFERS; ++i)
+   {
+      indices[i] = NULL;
+      if(!ibo->indices[i])
+         continue;
+
+      indices[i] = dlCopy( ibo->indices[i], ibo->i_num[i] * sizeof(unsigned short) );
+      if(!indices[i])
+      {
+         while(i--) dlFree( indices[i], ibo->i_num[i] * sizeof(unsigned short) );
+
+         RET("%d", RETURN_FAIL);
+         return( RETURN_FAIL );
+      }
+   }
+
+   i = 0;
+   for(; i != DL_MAX_BUFFERS; ++i)
+      ibo->indices[i] = indices[i];
+#else
+   indices = NULL;
+   if(ibo->indices)
+   {
+      indices = dlCopy( ibo->indices, ibo->i_num * sizeof(unsigned int) );
+      if(!indices)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   }
+   ibo->indices = indices;
+#endif
+
+   /* GL object stays with the others */
+   ibo->object     = 0;
+   ibo->in_heap    = 0;
+   ibo->ibo_size   = 0;
+   ibo->up_to_date = 0;
+   memset( &ibo->range, 0, sizeof(dlHeapRange) );
+
+   --*ibo->shared;
+   ibo->shared = NULL;
+   dlUnshareAlloc( size );
+
+   LOGINFO("UNSHARE");
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+#if !USE_BUFFERS
+/* narrowest GL type that holds every index */
+static unsigned int dlIBOIndexType( dlIBO *ibo )
+{
+   unsigned int i, max = 0;
+
+   i = 0;
+   for(; i != ibo->i_use; ++i)
+      if(ibo->indices[i] > max) max = ibo->indices[i];
+
+   return( max <= USHRT_MAX ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT );
+}
+
+/* upload indices narrowed to unsigned short */
+static int dlIBOUploadShort( dlIBO *ibo )
+{
+   unsigned int i;
+   unsigned short *data;
+
+   dlSetAlloc( ALLOC_IBO );
+   if(!(data = dlMalloc( ibo->i_use * sizeof(unsigned short) )))
+      return( RETURN_FAIL );
+
+   i = 0;
+   for(; i != ibo->i_use; ++i)
+      data[i] = ibo->indices[i];
+
+   glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, ibo->range.offset,
+                   ibo->i_use * sizeof(unsigned short), data);
+
+   dlSetAlloc( ALLOC_IBO );
+   dlFree( data, ibo->i_use * sizeof(unsigned short) );
+
+   return( RETURN_OK );
+}
+#endif
+
 /* update IBO */
 int dlIBOUpdate( dlIBO* ibo )
 {
@@ -147,19 +322,28 @@ int dlIBOUpdate( dlIBO* ibo )
    unsigned int i;
    size_t tmp;
 #endif
+   size_t old_size;
 
    CALL("%p", ibo);
 
    if(!ibo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   if(!ibo->object)
+   if(!ibo->object && !ibo->in_heap)
       return( dlIBOConstruct(ibo) );
 
    /* already up to date */
    if(ibo->up_to_date)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   /* copies share GL object, its storage can't change under them */
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!ibo->object && !ibo->in_heap)
+      return( dlIBOConstruct(ibo) );
+
+   old_size      = ibo->ibo_size;
    ibo->ibo_size = 0;
 #if USE_BUFFERS
    i = 0;
@@ -171,30 +355,68 @@ int dlIBOUpdate( dlIBO* ibo )
       ibo->ibo_size     += tmp;
    }
 #else
-   ibo->ibo_size = ibo->i_use * sizeof( unsigned int );
+   /* client arrays draw from system memory */
+   ibo->type = GL_UNSIGNED_INT;
+   if(_dlCore.render.mode != DL_MODE_VERTEX_ARRAY)
+      ibo->type = dlIBOIndexType( ibo );
+
+   ibo->ibo_size = ibo->i_use * (ibo->type == GL_UNSIGNED_SHORT ?
+                   sizeof( unsigned short ) : sizeof( unsigned int ));
 #endif
 
+   /* new range from heap when size changes */
+   if(ibo->in_heap && (ibo->ibo_size != old_size || !ibo->range.size))
+   {
+      dlHeapRelease( &ibo->range );
+      if(dlHeapAlloc( DL_HEAP_INDEX, ibo->ibo_size, &ibo->range ) == RETURN_OK)
+         ibo->object = ibo->range.object;
+      else
+      {
+         /* heap is full, use own buffer */
+         LOGWARN("Geometry heap full, using own buffer");
+         ibo->in_heap = 0;
+         ibo->object  = 0;
+
+         glGenBuffers(1, &ibo->object );
+         if(!ibo->object)
+         { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+      }
+   }
+
+   /* empty heap ibo has nothing to upload */
+   if(!ibo->object)
+   {
+      ibo->up_to_date = 1;
+
+      RET("%d", RETURN_OK);
+      return( RETURN_OK );
+   }
+
    /* bind buffer */
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->object);
+   dlBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->object);
 
    /* make IBO total size */
-   glBufferData(GL_ELEMENT_ARRAY_BUFFER, ibo->ibo_size, NULL, ibo->hint);
+   if(!ibo->in_heap)
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, ibo->ibo_size, NULL, ibo->hint);
 
 #if USE_BUFFERS
    i = 0;
    for(; i != DL_MAX_BUFFERS; ++i)
    {
       if(ibo->i_use[i])
-         glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, ibo->iOffset[i],
+         glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, ibo->range.offset + ibo->iOffset[i],
                          ibo->i_use[i] * sizeof( unsigned short ), &ibo->indices[i][0]);
    }
 #else
-   if(ibo->i_use)
-      glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, ibo->ibo_size, &ibo->indices[0]);
+   if(ibo->i_use && ibo->type == GL_UNSIGNED_SHORT)
+   {
+      if(dlIBOUploadShort( ibo ) != RETURN_OK)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   }
+   else if(ibo->i_use)
+      glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, ibo->range.offset, ibo->ibo_size, &ibo->indices[0]);
 #endif
 
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
    /* mark as up to date */
    ibo->up_to_date = 1;
 
@@ -202,6 +424,42 @@ int dlIBOUpdate( dlIBO* ibo )
    return( RETURN_OK );
 }
 
+/* rewrite indices after vertices were reordered or welded */
+int dlIBORemap( dlIBO *ibo, const unsigned int *remap, unsigned int vertices )
+{
+#if !USE_BUFFERS
+   unsigned int i;
+#endif
+   CALL("%p, %p, %u", ibo, remap, vertices);
+
+   if(!ibo || !remap)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+#if USE_BUFFERS
+   /* buffer of index depends on its value */
+   RET("%d", RETURN_FAIL);
+   return( RETURN_FAIL );
+#else
+   i = 0;
+   for(; i != ibo->i_use; ++i)
+      if(ibo->indices[i] >= vertices)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   i = 0;
+   for(; i != ibo->i_use; ++i)
+      ibo->indices[i] = remap[ ibo->indices[i] ];
+
+   /* mark IBO as outdated */
+   ibo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+#endif
+}
+
 /* construct new IBO data */
 int dlIBOConstruct( dlIBO* ibo )
 {
@@ -216,17 +474,28 @@ int dlIBOConstruct( dlIBO* ibo )
    if(ibo->object)
    { RET("%d", RETURN_OK); return( RETURN_OK ); }
 
-   /* generate IBO */
-   glGenBuffers(1, &ibo->object );
-   if(!ibo->object)
+   /* new GL object would not be shared with copies */
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   /* suballocate from heap, or generate IBO */
+   if(dlHeapEnabled())
+      ibo->in_heap = 1;
+   else
+   {
+      glGenBuffers(1, &ibo->object );
+      if(!ibo->object)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   }
+
    /* this ibo isn't up to date */
    ibo->up_to_date = 0;
    if(dlIBOUpdate( ibo ) != RETURN_OK)
    {
-      glDeleteBuffers(1, &ibo->object);
-      ibo->object = 0;
+      if( ibo->in_heap ) dlHeapRelease( &ibo->range );
+      else               dlDeleteBuffer( &ibo->object );
+      ibo->object  = 0;
+      ibo->in_heap = 0;
 
       RET("%d", RETURN_FAIL);
       return( RETURN_FAIL );
@@ -248,6 +517,9 @@ int dlCopyIndexBuffer( dlIBO *ibo, dlIBO *src )
    if(!ibo || !src)
    { RET("%d", RETURN_FAIL); return(RETURN_FAIL ); }
 
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_IBO );
 
 #if USE_BUFFERS
@@ -279,6 +551,9 @@ int dlFreeIndexBuffer( dlIBO *ibo )
    if(!ibo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_IBO );
 
 #if USE_BUFFERS
@@ -313,6 +588,9 @@ int dlResetIndexBuffer( dlIBO *ibo, unsigned int indices )
    if(!ibo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_IBO );
 
 #if USE_BUFFERS
@@ -376,6 +654,60 @@ int dlResetIndexBuffer( dlIBO *ibo, unsigned int indices )
    return( RETURN_OK );
 }
 
+/* Grow index storage geometrically */
+static void* dlIBOReserve( void *ptr, unsigned int *num, unsigned int need, size_t size )
+{
+   unsigned int capacity;
+   CALL("%p, %u, %u, %llu", ptr, *num, need, size);
+
+   if(ptr && need <= *num)
+   { RET("%p", ptr); return( ptr ); }
+
+   capacity = dlGrowCapacity( *num, need );
+   if(ptr)
+      ptr = dlRealloc( ptr, *num, capacity, size );
+   else
+      ptr = dlCalloc( capacity, size );
+
+   if(ptr)
+      *num = capacity;
+
+   RET("%p", ptr);
+   return( ptr );
+}
+
+/* Append index, caller sets allocation type and marks IBO outdated */
+static int dlIBOAppend( dlIBO *ibo, unsigned int index )
+{
+#if USE_BUFFERS
+   /* select buffer to put the index */
+   unsigned int i = index / USHRT_MAX;
+   if(i > DL_MAX_BUFFERS)
+      return( RETURN_FAIL );
+
+   if(i + 1 > ibo->index_buffer)
+      ibo->index_buffer = i + 1;
+
+   ibo->indices[ i ] = dlIBOReserve( ibo->indices[ i ], &ibo->i_num[ i ],
+                                     ibo->i_use[ i ] + 1, sizeof(unsigned short) );
+   if(!ibo->indices[ i ])
+      return( RETURN_FAIL );
+
+   /* Assign index */
+   ibo->indices[ i ][ ibo->i_use[ i ]++ ] = index;
+#else
+   ibo->indices = dlIBOReserve( ibo->indices, &ibo->i_num,
+                                ibo->i_use + 1, sizeof(unsigned int) );
+   if(!ibo->indices)
+      return( RETURN_FAIL );
+
+   /* Assign index */
+   ibo->indices[ ibo->i_use++ ] = index;
+#endif
+
+   return( RETURN_OK );
+}
+
 int dlInsertIndex( dlIBO *ibo,
                     unsigned int index )
 {
@@ -384,44 +716,49 @@ int dlInsertIndex( dlIBO *ibo,
    if(!ibo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_IBO );
 
-#if USE_BUFFERS
-   /* select buffer to put the index */
-   unsigned int i = index / USHRT_MAX;
-   if(i > DL_MAX_BUFFERS)
+   if(dlIBOAppend( ibo, index ) != RETURN_OK)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   if(i > ibo->index_buffer)
-      ibo->index_buffer = i;
+   /* mark IBO as outdated */
+   ibo->up_to_date = 0;
 
-   ++ibo->i_use[ i ];
-   if(ibo->i_use[ i ] >= ibo->i_num[ i ])
-   {
-      /* Maybe make it realloc more vertices? Or just hope ppl
-       * use the reset function above */
-      ibo->indices[ i ] = dlRealloc(ibo->indices[ i ], ibo->i_num[ i ], ibo->i_use[ i ], sizeof(unsigned short));
-      if(!ibo->indices[ i ])
-      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
 
-      ibo->i_num[ i ] = ibo->i_use[ i ];
-   }
+/* insert n indices in one go */
+int dlInsertIndices( dlIBO *ibo, const unsigned int *indices, unsigned int n )
+{
+   unsigned int i;
+   CALL("%p, %p, %u", ibo, indices, n);
 
-   /* Assign index */
-   ibo->indices[ i ][ ibo->i_use[ i ] - 1 ] = index;
-#else
-   ++ibo->i_use;
-   if(ibo->i_use > ibo->i_num)
-   {
-      ibo->indices = dlRealloc(ibo->indices, ibo->i_num, ibo->i_use, sizeof(unsigned int));
-      if(!ibo->indices)
-      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   if(!ibo || !indices)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-      ibo->i_num = ibo->i_use;
-   }
+   if(dlIBOUnshare( ibo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   /* Assign index */
-   ibo->indices[ ibo->i_use - 1 ] = index;
+   dlSetAlloc( ALLOC_IBO );
+
+#if USE_BUFFERS
+   i = 0;
+   for(; i != n; ++i)
+      if(dlIBOAppend( ibo, indices[i] ) != RETURN_OK)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+#else
+   ibo->indices = dlIBOReserve( ibo->indices, &ibo->i_num,
+                                ibo->i_use + n, sizeof(unsigned int) );
+   if(!ibo->indices)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   i = 0;
+   for(; i != n; ++i)
+      ibo->indices[ ibo->i_use++ ] = indices[i];
 #endif
 
    /* mark IBO as outdated */
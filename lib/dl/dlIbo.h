@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "dlConfig.h"
+#include "dlHeap.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,12 +23,25 @@ typedef struct dlIBO_t
    unsigned int   i_num, i_use;
 #endif
 
+   /* GL index type of buffer, GL_UNSIGNED_SHORT when every index fits.
+    * system memory copy is always unsigned int without USE_BUFFERS */
+   unsigned int type;
+
    /* dl IBO Object */
    unsigned int object;
    unsigned int hint;
    uint8_t      up_to_date;
    size_t       ibo_size;
 
+   /* suballocated from geometry heap,
+    * object is then the heap page and indices start at range offset */
+   uint8_t      in_heap;
+   dlHeapRange  range;
+
+   /* copy on write, copies share indices and GL object
+    * until one of them is modified. counts IBOs sharing them */
+   unsigned int *shared;
+
    unsigned int refCounter;
 } dlIBO;
 
@@ -40,11 +54,18 @@ int         dlFreeIBO( dlIBO *ibo );	     /* Free ibo object */
 int         dlIBOConstruct( dlIBO *ibo );
 int         dlIBOUpdate( dlIBO *ibo );
 
+/* give IBO indices of its own, call before writing to indices in place */
+int         dlIBOUnshare( dlIBO *ibo );
+
+/* rewrite indices, remap[old] = new */
+int         dlIBORemap( dlIBO *ibo, const unsigned int *remap, unsigned int vertices );
+
 /* Index buffer operations */
 int         dlFreeIndexBuffer( dlIBO *ibo );
 int         dlCopyIndexBuffer( dlIBO *ibo, dlIBO *src );
 int         dlResetIndexBuffer( dlIBO *ibo, unsigned int indices );
 int         dlInsertIndex( dlIBO *ibo, unsigned int index );
+int         dlInsertIndices( dlIBO *ibo, const unsigned int *indices, unsigned int n );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,200 @@
+#include <unistd.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlJob.h"
+#include "dlLog.h"
+
+#define DL_DEBUG_CHANNEL "JOB"
+
+#if DL_THREADS
+/* take jobs until current run is out of them, mutex is held */
+static void dlJobPoolWork( dlJobPool *pool )
+{
+   unsigned int index;
+
+   while(pool->next < pool->count)
+   {
+      index = pool->next++;
+
+      pthread_mutex_unlock( &pool->mutex );
+      pool->func( pool->user, index );
+      pthread_mutex_lock( &pool->mutex );
+
+      if(++pool->finished == pool->count)
+         pthread_cond_signal( &pool->done );
+   }
+}
+
+/* worker waits for runs */
+static void* dlJobPoolThread( void *data )
+{
+   dlJobPool    *pool = data;
+   unsigned int  generation;
+
+   pthread_mutex_lock( &pool->mutex );
+   generation = pool->generation;
+   for(;;)
+   {
+      while(!pool->quit && generation == pool->generation)
+         pthread_cond_wait( &pool->work, &pool->mutex );
+
+      if(pool->quit)
+         break;
+
+      generation = pool->generation;
+      dlJobPoolWork( pool );
+   }
+   pthread_mutex_unlock( &pool->mutex );
+
+   return( NULL );
+}
+#endif
+
+/* Start worker threads */
+dlJobPool* dlNewJobPool( unsigned int threads )
+{
+   dlJobPool *pool;
+#if DL_THREADS
+   unsigned int i;
+   long cpus;
+#endif
+   CALL("%u", threads);
+
+   dlSetAlloc( ALLOC_CORE );
+   if(!(pool = dlCalloc( 1, sizeof(dlJobPool) )))
+   { RET("%p", NULL); return( NULL ); }
+
+#if DL_THREADS
+#  ifdef _SC_NPROCESSORS_ONLN
+   if(!threads)
+   {
+      cpus    = sysconf( _SC_NPROCESSORS_ONLN );
+      threads = cpus > 1 ? (unsigned int)cpus - 1 : 0;
+   }
+#  endif
+
+   pthread_mutex_init( &pool->mutex, NULL );
+   pthread_cond_init( &pool->work, NULL );
+   pthread_cond_init( &pool->done, NULL );
+
+   if(threads && !(pool->thread = dlCalloc( threads, sizeof(pthread_t) )))
+   {
+      pool->refCounter = 1;
+      dlFreeJobPool( pool );
+      RET("%p", NULL);
+      return( NULL );
+   }
+   pool->num_thread = threads;
+
+   /* pool runs with the threads it got */
+   i = 0;
+   for(; i != threads; ++i)
+   {
+      if(pthread_create( &pool->thread[i], NULL, dlJobPoolThread, pool ) != 0)
+      {
+         LOGWARNP("Started only %u of %u threads", i, threads);
+         break;
+      }
+      pool->threads++;
+   }
+#else
+   if(threads)
+   { LOGWARN("Built without threads, jobs run on calling thread"); }
+#endif
+
+   LOGOKP("NEW %u threads", pool->threads);
+
+   pool->refCounter++;
+
+   RET("%p", pool);
+   return( pool );
+}
+
+/* Reference job pool */
+dlJobPool* dlRefJobPool( dlJobPool *src )
+{
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   src->refCounter++;
+
+   RET("%p", src);
+   return( src );
+}
+
+/* Stop worker threads */
+int dlFreeJobPool( dlJobPool *pool )
+{
+#if DL_THREADS
+   unsigned int i;
+#endif
+   CALL("%p", pool);
+
+   if(!pool) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* There is still references to this pool alive */
+   if(--pool->refCounter != 0) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_CORE );
+
+#if DL_THREADS
+   pthread_mutex_lock( &pool->mutex );
+   pool->quit = 1;
+   pthread_cond_broadcast( &pool->work );
+   pthread_mutex_unlock( &pool->mutex );
+
+   i = 0;
+   for(; i != pool->threads; ++i)
+      pthread_join( pool->thread[i], NULL );
+
+   if(pool->thread)
+      dlFree( pool->thread, pool->num_thread * sizeof(pthread_t) );
+
+   pthread_cond_destroy( &pool->done );
+   pthread_cond_destroy( &pool->work );
+   pthread_mutex_destroy( &pool->mutex );
+#endif
+
+   LOGFREE("FREE");
+
+   dlFree( pool, sizeof(dlJobPool) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Run jobs and wait for them */
+void dlJobPoolRun( dlJobPool *pool, dlJobPtr *func, void *user, unsigned int count )
+{
+   unsigned int i;
+   CALL("%p, %p, %p, %u", pool, func, user, count);
+
+   if(!func || !count)
+      return;
+
+#if DL_THREADS
+   if(pool && pool->threads && count > 1)
+   {
+      pthread_mutex_lock( &pool->mutex );
+      pool->func     = func;
+      pool->user     = user;
+      pool->count    = count;
+      pool->next     = 0;
+      pool->finished = 0;
+      pool->generation++;
+      pthread_cond_broadcast( &pool->work );
+
+      dlJobPoolWork( pool );
+      while(pool->finished != pool->count)
+         pthread_cond_wait( &pool->done, &pool->mutex );
+      pthread_mutex_unlock( &pool->mutex );
+      return;
+   }
+#endif
+
+   i = 0;
+   for(; i != count; ++i)
+      func( user, i );
+}
@@ -0,0 +1,60 @@
+#ifndef DL_JOB_H
+#define DL_JOB_H
+
+#include "dlConfig.h"
+
+#if DL_THREADS
+#  include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* counter shared by jobs */
+#if DL_THREADS && defined(__GNUC__)
+#  define dlAtomicInc(x) __sync_fetch_and_add( &(x), 1 )
+#else
+#  define dlAtomicInc(x) ((x)++)
+#endif
+
+/* job function, index is in [0, count) of dlJobPoolRun */
+typedef void dlJobPtr( void *user, unsigned int index );
+
+/* worker threads running jobs,
+ * jobs must not call GL, it stays on calling thread */
+typedef struct dlJobPool_t
+{
+#if DL_THREADS
+   pthread_t       *thread;
+   unsigned int     num_thread;
+   pthread_mutex_t  mutex;
+   pthread_cond_t   work, done;
+
+   /* current run */
+   dlJobPtr        *func;
+   void            *user;
+   unsigned int     count, next, finished;
+   unsigned int     generation;
+   int              quit;
+#endif
+
+   /* workers, calling thread is not counted */
+   unsigned int threads;
+
+   unsigned int refCounter;
+} dlJobPool;
+
+dlJobPool*     dlNewJobPool( unsigned int threads );  /* 0 uses one worker per other CPU */
+dlJobPool*     dlRefJobPool( dlJobPool *src );
+int            dlFreeJobPool( dlJobPool *pool );
+
+/* Run jobs 0..count-1 and wait for them,
+ * calling thread runs jobs too. NULL pool runs them in order */
+void           dlJobPoolRun( dlJobPool *pool, dlJobPtr *func, void *user, unsigned int count );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_JOB_H */
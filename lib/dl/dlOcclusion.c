@@ -0,0 +1,721 @@
+#include <math.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlOcclusion.h"
+#include "dlJob.h"
+#include "dlCore.h"
+#include "dlLog.h"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#elif  GLES1
+#  include <GLES/gl.h>
+#  include <GLES/glext.h>
+#else
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#endif
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define DL_OCCLUSION_SSE2 1
+#else
+#  define DL_OCCLUSION_SSE2 0
+#endif
+
+#define DL_DEBUG_CHANNEL "OCCLUSION"
+
+/* occludee must be this much behind occluders to be hidden,
+ * keeps occluders from hiding themselves on rounding */
+#define DL_OCCLUSION_EPSILON 1e-5f
+
+/* max hierarchical-Z levels */
+#define DL_OCCLUSION_LEVELS 16
+
+/* values in hierarchical-Z */
+static unsigned int dlOcclusionHizSize( dlOcclusion *occlusion )
+{
+   unsigned int last = occlusion->levels - 1;
+   return( occlusion->level_offset[last] +
+           occlusion->level_width[last] * occlusion->level_height[last] );
+}
+
+/* Allocate occlusion buffer */
+dlOcclusion* dlNewOcclusion( unsigned int width, unsigned int height )
+{
+   dlOcclusion *occlusion;
+   unsigned int w, h, offset;
+   CALL("%u, %u", width, height);
+
+   if(!width || !height || width % DL_OCCLUSION_TILE || height % DL_OCCLUSION_TILE)
+   {
+      LOGERRP("%ux%u is not multiple of %u", width, height, DL_OCCLUSION_TILE);
+      RET("%p", NULL);
+      return( NULL );
+   }
+
+   dlSetAlloc( ALLOC_CORE );
+   if(!(occlusion = dlCalloc( 1, sizeof(dlOcclusion) )))
+   { RET("%p", NULL); return( NULL ); }
+
+   occlusion->width   = width;
+   occlusion->height  = height;
+   occlusion->tiles_x = width  / DL_OCCLUSION_TILE;
+   occlusion->tiles_y = height / DL_OCCLUSION_TILE;
+
+   /* levels down to single cell */
+   w = width  / DL_OCCLUSION_CELL;
+   h = height / DL_OCCLUSION_CELL;
+   offset = 0;
+   for(;;)
+   {
+      occlusion->level_offset[ occlusion->levels ] = offset;
+      occlusion->level_width[ occlusion->levels ]  = w;
+      occlusion->level_height[ occlusion->levels ] = h;
+      occlusion->levels++;
+      offset += w * h;
+
+      if((w == 1 && h == 1) || occlusion->levels == DL_OCCLUSION_LEVELS)
+         break;
+
+      w = (w + 1) / 2;
+      h = (h + 1) / 2;
+   }
+
+   occlusion->depth = dlMalloc( width * height * sizeof(float) );
+   occlusion->hiz   = dlMalloc( offset * sizeof(float) );
+   occlusion->bin   = dlCalloc( occlusion->tiles_x * occlusion->tiles_y, sizeof(dlOcclusionBin) );
+   if(!occlusion->depth || !occlusion->hiz || !occlusion->bin)
+   {
+      occlusion->refCounter = 1;
+      dlFreeOcclusion( occlusion );
+      RET("%p", NULL);
+      return( NULL );
+   }
+
+   kmMat4Identity( &occlusion->projection );
+   dlOcclusionBegin( occlusion, &occlusion->projection );
+   dlOcclusionEnd( occlusion );
+
+   LOGOK("NEW");
+
+   occlusion->refCounter++;
+
+   RET("%p", occlusion);
+   return( occlusion );
+}
+
+/* Reference occlusion buffer */
+dlOcclusion* dlRefOcclusion( dlOcclusion *src )
+{
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   src->refCounter++;
+
+   RET("%p", src);
+   return( src );
+}
+
+/* Free occlusion buffer */
+int dlFreeOcclusion( dlOcclusion *occlusion )
+{
+   unsigned int i;
+   CALL("%p", occlusion);
+
+   if(!occlusion) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* There is still references to this buffer alive */
+   if(--occlusion->refCounter != 0) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* no longer used for drawing */
+   if(_dlCore.render.occlusion == occlusion)
+      _dlCore.render.occlusion = NULL;
+
+   dlSetAlloc( ALLOC_CORE );
+   if(occlusion->bin)
+   {
+      i = 0;
+      for(; i != occlusion->tiles_x * occlusion->tiles_y; ++i)
+         if(occlusion->bin[i].triangle)
+            dlFree( occlusion->bin[i].triangle, occlusion->bin[i].num * sizeof(unsigned int) );
+
+      dlFree( occlusion->bin, occlusion->tiles_x * occlusion->tiles_y * sizeof(dlOcclusionBin) );
+   }
+
+   if(occlusion->depth)
+      dlFree( occlusion->depth, occlusion->width * occlusion->height * sizeof(float) );
+   if(occlusion->hiz)
+      dlFree( occlusion->hiz, dlOcclusionHizSize( occlusion ) * sizeof(float) );
+   if(occlusion->triangle)
+      dlFree( occlusion->triangle, occlusion->num_triangle * sizeof(dlOccluderTriangle) );
+   if(occlusion->clip)
+      dlFree( occlusion->clip, occlusion->num_clip * sizeof(kmVec4) );
+
+   LOGFREE("FREE");
+
+   dlFree( occlusion, sizeof(dlOcclusion) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Clear for new frame */
+void dlOcclusionBegin( dlOcclusion *occlusion, const kmMat4 *projection )
+{
+   unsigned int i;
+   CALL("%p, %p", occlusion, projection);
+
+   if(!occlusion)
+      return;
+
+   occlusion->projection = projection ? *projection : _dlCore.render.projection;
+
+   /* far plane */
+   i = 0;
+   for(; i != occlusion->width * occlusion->height; ++i)
+      occlusion->depth[i] = 1.0f;
+
+   i = 0;
+   for(; i != occlusion->tiles_x * occlusion->tiles_y; ++i)
+      occlusion->bin[i].use = 0;
+
+   occlusion->use_triangle = 0;
+   occlusion->occluders    = 0;
+   occlusion->tested       = 0;
+   occlusion->rejected     = 0;
+}
+
+/* add triangle to bins of tiles it touches */
+static int dlOcclusionBinTriangle( dlOcclusion *occlusion, unsigned int index )
+{
+   dlOccluderTriangle *tri = &occlusion->triangle[index];
+   dlOcclusionBin     *bin;
+   unsigned int       *triangle, num;
+   int x, y;
+
+   y = tri->minY / DL_OCCLUSION_TILE;
+   for(; y <= tri->maxY / DL_OCCLUSION_TILE; ++y)
+   {
+      x = tri->minX / DL_OCCLUSION_TILE;
+      for(; x <= tri->maxX / DL_OCCLUSION_TILE; ++x)
+      {
+         bin = &occlusion->bin[ y * occlusion->tiles_x + x ];
+         if(bin->use == bin->num)
+         {
+            num = dlGrowCapacity( bin->num, bin->use + 1 );
+            if(bin->triangle)
+               triangle = dlRealloc( bin->triangle, bin->num, num, sizeof(unsigned int) );
+            else
+               triangle = dlCalloc( num, sizeof(unsigned int) );
+
+            if(!triangle)
+               return( RETURN_FAIL );
+
+            bin->triangle = triangle;
+            bin->num      = num;
+         }
+
+         bin->triangle[ bin->use++ ] = index;
+      }
+   }
+
+   return( RETURN_OK );
+}
+
+/* edge functions and depth plane of triangle already past near plane */
+static int dlOcclusionSetup( dlOcclusion *occlusion, const kmVec4 *v0, const kmVec4 *v1, const kmVec4 *v2 )
+{
+   dlOccluderTriangle *tri;
+   const kmVec4 *clip[3];
+   float x[3], y[3], z[3], area, minX, minY, maxX, maxY, t;
+   unsigned int num, i, j;
+
+   clip[0] = v0; clip[1] = v1; clip[2] = v2;
+   i = 0;
+   for(; i != 3; ++i)
+   {
+      x[i] = (clip[i]->x / clip[i]->w * 0.5f + 0.5f) * occlusion->width;
+      y[i] = (clip[i]->y / clip[i]->w * 0.5f + 0.5f) * occlusion->height;
+      z[i] =  clip[i]->z / clip[i]->w;
+   }
+
+   /* both windings are drawn, walls can be seen from either side */
+   area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+   if(area < 0)
+   {
+      t = x[1]; x[1] = x[2]; x[2] = t;
+      t = y[1]; y[1] = y[2]; y[2] = t;
+      t = z[1]; z[1] = z[2]; z[2] = t;
+      area = -area;
+   }
+
+   if(area < 1e-6f)
+      return( RETURN_OK );
+
+   minX = fminf( x[0], fminf( x[1], x[2] ) ); maxX = fmaxf( x[0], fmaxf( x[1], x[2] ) );
+   minY = fminf( y[0], fminf( y[1], y[2] ) ); maxY = fmaxf( y[0], fmaxf( y[1], y[2] ) );
+   if(maxX < 0 || maxY < 0 || minX >= occlusion->width || minY >= occlusion->height)
+      return( RETURN_OK );
+
+   if(occlusion->use_triangle == occlusion->num_triangle)
+   {
+      num = dlGrowCapacity( occlusion->num_triangle, occlusion->use_triangle + 1 );
+      if(occlusion->triangle)
+         tri = dlRealloc( occlusion->triangle, occlusion->num_triangle, num, sizeof(dlOccluderTriangle) );
+      else
+         tri = dlCalloc( num, sizeof(dlOccluderTriangle) );
+
+      if(!tri)
+         return( RETURN_FAIL );
+
+      occlusion->triangle     = tri;
+      occlusion->num_triangle = num;
+   }
+
+   tri = &occlusion->triangle[ occlusion->use_triangle ];
+
+   /* E(p) = a * px + b * py + c, positive inside */
+   i = 0;
+   for(; i != 3; ++i)
+   {
+      j = (i + 1) % 3;
+      tri->a[i] = -(y[j] - y[i]);
+      tri->b[i] =   x[j] - x[i];
+      tri->c[i] = -(tri->a[i] * x[i] + tri->b[i] * y[i]);
+   }
+
+   /* z/w is linear in screen space */
+   tri->za = ((z[1] - z[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (z[2] - z[0])) / area;
+   tri->zb = ((x[1] - x[0]) * (z[2] - z[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+   tri->zc = z[0] - tri->za * x[0] - tri->zb * y[0];
+
+   tri->minX = minX < 0 ? 0 : (int)minX;
+   tri->minY = minY < 0 ? 0 : (int)minY;
+   tri->maxX = maxX >= occlusion->width  ? (int)occlusion->width  - 1 : (int)maxX;
+   tri->maxY = maxY >= occlusion->height ? (int)occlusion->height - 1 : (int)maxY;
+
+   return( dlOcclusionBinTriangle( occlusion, occlusion->use_triangle++ ) );
+}
+
+/* clip triangle to near plane z + w >= 0 and set it up */
+static int dlOcclusionClip( dlOcclusion *occlusion, const kmVec4 *v0, const kmVec4 *v1, const kmVec4 *v2 )
+{
+   const kmVec4 *in[3];
+   kmVec4 out[4];
+   float d[3], t;
+   unsigned int i, j, n;
+
+   in[0] = v0; in[1] = v1; in[2] = v2;
+   i = 0;
+   for(; i != 3; ++i)
+      d[i] = in[i]->z + in[i]->w;
+
+   if(d[0] >= 0 && d[1] >= 0 && d[2] >= 0)
+      return( dlOcclusionSetup( occlusion, v0, v1, v2 ) );
+
+   if(d[0] < 0 && d[1] < 0 && d[2] < 0)
+      return( RETURN_OK );
+
+   /* Sutherland-Hodgman against single plane */
+   n = 0;
+   i = 0;
+   for(; i != 3; ++i)
+   {
+      j = (i + 1) % 3;
+      if(d[i] >= 0)
+         out[n++] = *in[i];
+
+      if((d[i] >= 0) != (d[j] >= 0))
+      {
+         t = d[i] / (d[i] - d[j]);
+         out[n].x = in[i]->x + (in[j]->x - in[i]->x) * t;
+         out[n].y = in[i]->y + (in[j]->y - in[i]->y) * t;
+         out[n].z = in[i]->z + (in[j]->z - in[i]->z) * t;
+         out[n].w = in[i]->w + (in[j]->w - in[i]->w) * t;
+         ++n;
+      }
+   }
+
+   /* fan of 1 or 2 triangles */
+   i = 2;
+   for(; i < n; ++i)
+      if(dlOcclusionSetup( occlusion, &out[0], &out[i - 1], &out[i] ) != RETURN_OK)
+         return( RETURN_FAIL );
+
+   return( RETURN_OK );
+}
+
+/* index k of index buffer */
+static unsigned int dlOcclusionIndex( dlIBO *ibo, unsigned int buffer, unsigned int k )
+{
+   if(!ibo)
+      return( k );
+
+#if USE_BUFFERS
+   return( ibo->indices[buffer][k] + buffer * USHRT_MAX );
+#else
+   return( ibo->indices[k] );
+#endif
+}
+
+/* indices in buffer */
+static unsigned int dlOcclusionIndexCount( dlObject *object, unsigned int buffer )
+{
+   if(!object->ibo)
+      return( object->vbo->v_use );
+
+#if USE_BUFFERS
+   return( object->ibo->i_use[buffer] );
+#else
+   return( object->ibo->i_use );
+#endif
+}
+
+/* Bin occluder triangles */
+int dlOcclusionAddOccluder( dlOcclusion *occlusion, dlObject *object )
+{
+   kmMat4       mvp;
+   kmVec4       *clip, *tri[3];
+   kmVec3       *v;
+   const float  *m;
+   unsigned int i, k, n, buffer, buffers, num, index[3];
+   CALL("%p, %p", occlusion, object);
+
+   if(!occlusion || !object)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   if(!object->vbo || !object->vbo->vertices)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+   if(object->primitive_type != GL_TRIANGLES && object->primitive_type != GL_TRIANGLE_STRIP)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   if(object->transform_changed)
+      dlUpdateMatrix( object );
+
+   dlSetAlloc( ALLOC_CORE );
+
+   /* every vertex to clip space once */
+   if(occlusion->num_clip < object->vbo->v_use)
+   {
+      num = dlGrowCapacity( occlusion->num_clip, object->vbo->v_use );
+      if(occlusion->clip)
+         clip = dlRealloc( occlusion->clip, occlusion->num_clip, num, sizeof(kmVec4) );
+      else
+         clip = dlCalloc( num, sizeof(kmVec4) );
+
+      if(!clip)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      occlusion->clip     = clip;
+      occlusion->num_clip = num;
+   }
+
+   kmMat4Multiply( &mvp, &occlusion->projection, &object->matrix );
+   m = mvp.mat;
+   i = 0;
+   for(; i != object->vbo->v_use; ++i)
+   {
+      v = &object->vbo->vertices[i];
+      occlusion->clip[i].x = m[0] * v->x + m[4] * v->y + m[8]  * v->z + m[12];
+      occlusion->clip[i].y = m[1] * v->x + m[5] * v->y + m[9]  * v->z + m[13];
+      occlusion->clip[i].z = m[2] * v->x + m[6] * v->y + m[10] * v->z + m[14];
+      occlusion->clip[i].w = m[3] * v->x + m[7] * v->y + m[11] * v->z + m[15];
+   }
+
+   buffers = 1;
+#if USE_BUFFERS
+   if(object->ibo)
+      buffers = object->ibo->index_buffer;
+#endif
+
+   buffer = 0;
+   for(; buffer != buffers; ++buffer)
+   {
+      n = dlOcclusionIndexCount( object, buffer );
+      if(n < 3)
+         continue;
+
+      k = 0;
+      for(; k + 2 < n; k += (object->primitive_type == GL_TRIANGLES ? 3 : 1))
+      {
+         i = 0;
+         for(; i != 3; ++i)
+         {
+            index[i] = dlOcclusionIndex( object->ibo, buffer, k + i );
+            if(index[i] >= object->vbo->v_use)
+               break;
+            tri[i] = &occlusion->clip[ index[i] ];
+         }
+
+         /* degenerate strip joins and broken indices */
+         if(i != 3 || index[0] == index[1] || index[1] == index[2] || index[0] == index[2])
+            continue;
+
+         if(dlOcclusionClip( occlusion, tri[0], tri[1], tri[2] ) != RETURN_OK)
+         { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+      }
+   }
+
+   occlusion->occluders++;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* rasterize triangle inside tile bounds, keeps nearest depth */
+static void dlOcclusionRaster( dlOcclusion *occlusion, const dlOccluderTriangle *tri,
+                               int tileX, int tileY )
+{
+   int x, y, minX, minY, maxX, maxY;
+   float *row;
+
+   minX = tri->minX > tileX ? tri->minX : tileX;
+   minY = tri->minY > tileY ? tri->minY : tileY;
+   maxX = tri->maxX < tileX + DL_OCCLUSION_TILE - 1 ? tri->maxX : tileX + DL_OCCLUSION_TILE - 1;
+   maxY = tri->maxY < tileY + DL_OCCLUSION_TILE - 1 ? tri->maxY : tileY + DL_OCCLUSION_TILE - 1;
+   if(minX > maxX || minY > maxY)
+      return;
+
+   /* 4 pixel groups, tiles are multiple of 4 so groups stay inside */
+   minX &= ~3;
+
+#if DL_OCCLUSION_SSE2
+   {
+      __m128 a0 = _mm_set1_ps( tri->a[0] ), b0 = _mm_set1_ps( tri->b[0] ), c0 = _mm_set1_ps( tri->c[0] );
+      __m128 a1 = _mm_set1_ps( tri->a[1] ), b1 = _mm_set1_ps( tri->b[1] ), c1 = _mm_set1_ps( tri->c[1] );
+      __m128 a2 = _mm_set1_ps( tri->a[2] ), b2 = _mm_set1_ps( tri->b[2] ), c2 = _mm_set1_ps( tri->c[2] );
+      __m128 za = _mm_set1_ps( tri->za ),   zb = _mm_set1_ps( tri->zb ),   zc = _mm_set1_ps( tri->zc );
+      __m128 offset = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+      __m128 step   = _mm_set1_ps( 4.0f );
+      __m128 zero   = _mm_setzero_ps();
+      __m128 vx, vy, w0, w1, w2, vz, mask, old;
+
+      y = minY;
+      for(; y <= maxY; ++y)
+      {
+         row = &occlusion->depth[ y * occlusion->width ];
+         vy  = _mm_set1_ps( y + 0.5f );
+         vx  = _mm_add_ps( _mm_set1_ps( (float)minX ), offset );
+
+         /* edge and depth values of first group, then stepped */
+         w0 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a0, vx ), _mm_mul_ps( b0, vy ) ), c0 );
+         w1 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a1, vx ), _mm_mul_ps( b1, vy ) ), c1 );
+         w2 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a2, vx ), _mm_mul_ps( b2, vy ) ), c2 );
+         vz = _mm_add_ps( _mm_add_ps( _mm_mul_ps( za, vx ), _mm_mul_ps( zb, vy ) ), zc );
+
+         x = minX;
+         for(; x <= maxX; x += 4)
+         {
+            mask = _mm_and_ps( _mm_cmpge_ps( w0, zero ),
+                   _mm_and_ps( _mm_cmpge_ps( w1, zero ), _mm_cmpge_ps( w2, zero ) ) );
+
+            if(_mm_movemask_ps( mask ))
+            {
+               old = _mm_loadu_ps( &row[x] );
+               _mm_storeu_ps( &row[x], _mm_or_ps( _mm_and_ps( mask, _mm_min_ps( old, vz ) ),
+                                                  _mm_andnot_ps( mask, old ) ) );
+            }
+
+            w0 = _mm_add_ps( w0, _mm_mul_ps( a0, step ) );
+            w1 = _mm_add_ps( w1, _mm_mul_ps( a1, step ) );
+            w2 = _mm_add_ps( w2, _mm_mul_ps( a2, step ) );
+            vz = _mm_add_ps( vz, _mm_mul_ps( za, step ) );
+         }
+      }
+   }
+#else
+   {
+      float px, py, e0, e1, e2, z;
+
+      y = minY;
+      for(; y <= maxY; ++y)
+      {
+         row = &occlusion->depth[ y * occlusion->width ];
+         py  = y + 0.5f;
+         x = minX;
+         for(; x <= maxX; ++x)
+         {
+            px = x + 0.5f;
+            e0 = tri->a[0] * px + tri->b[0] * py + tri->c[0];
+            e1 = tri->a[1] * px + tri->b[1] * py + tri->c[1];
+            e2 = tri->a[2] * px + tri->b[2] * py + tri->c[2];
+            if(e0 < 0 || e1 < 0 || e2 < 0)
+               continue;
+
+            z = tri->za * px + tri->zb * py + tri->zc;
+            if(z < row[x]) row[x] = z;
+         }
+      }
+   }
+#endif
+}
+
+/* farthest depth of cells, level 0 from pixels and others from level below */
+static void dlOcclusionBuildHiz( dlOcclusion *occlusion )
+{
+   unsigned int l, x, y, i, j, sx, sy, w, h;
+   float far, *level, *below;
+
+   level = occlusion->hiz;
+   y = 0;
+   for(; y != occlusion->level_height[0]; ++y)
+   {
+      x = 0;
+      for(; x != occlusion->level_width[0]; ++x)
+      {
+         far = -1.0f;
+         j = 0;
+         for(; j != DL_OCCLUSION_CELL; ++j)
+         {
+            i = 0;
+            for(; i != DL_OCCLUSION_CELL; ++i)
+               far = fmaxf( far, occlusion->depth[ (y * DL_OCCLUSION_CELL + j) * occlusion->width +
+                                                   x * DL_OCCLUSION_CELL + i ] );
+         }
+         level[ y * occlusion->level_width[0] + x ] = far;
+      }
+   }
+
+   l = 1;
+   for(; l != occlusion->levels; ++l)
+   {
+      below = occlusion->hiz + occlusion->level_offset[l - 1];
+      level = occlusion->hiz + occlusion->level_offset[l];
+      w = occlusion->level_width[l - 1];
+      h = occlusion->level_height[l - 1];
+
+      y = 0;
+      for(; y != occlusion->level_height[l]; ++y)
+      {
+         x = 0;
+         for(; x != occlusion->level_width[l]; ++x)
+         {
+            far = -1.0f;
+            j = 0;
+            for(; j != 2; ++j)
+            {
+               i = 0;
+               for(; i != 2; ++i)
+               {
+                  /* odd sizes repeat last cell */
+                  sx = x * 2 + i < w ? x * 2 + i : w - 1;
+                  sy = y * 2 + j < h ? y * 2 + j : h - 1;
+                  far = fmaxf( far, below[ sy * w + sx ] );
+               }
+            }
+            level[ y * occlusion->level_width[l] + x ] = far;
+         }
+      }
+   }
+}
+
+/* Rasterize bins and build hierarchical-Z */
+void dlOcclusionEnd( dlOcclusion *occlusion )
+{
+   dlOcclusionBin *bin;
+   unsigned int x, y, i;
+   CALL("%p", occlusion);
+
+   if(!occlusion)
+      return;
+
+   /* tile at time stays in cache */
+   y = 0;
+   for(; y != occlusion->tiles_y; ++y)
+   {
+      x = 0;
+      for(; x != occlusion->tiles_x; ++x)
+      {
+         bin = &occlusion->bin[ y * occlusion->tiles_x + x ];
+         i = 0;
+         for(; i != bin->use; ++i)
+            dlOcclusionRaster( occlusion, &occlusion->triangle[ bin->triangle[i] ],
+                               x * DL_OCCLUSION_TILE, y * DL_OCCLUSION_TILE );
+      }
+   }
+
+   dlOcclusionBuildHiz( occlusion );
+}
+
+/* Test box against hierarchical-Z */
+int dlOcclusionTestAABB( dlOcclusion *occlusion, const kmAABB *box )
+{
+   const float *m = occlusion->projection.mat, *level;
+   float cx, cy, cz, cw, sx, sy, minX, minY, maxX, maxY, nearest;
+   unsigned int i, l, x, y, x0, y0, x1, y1, cell;
+
+   /* tests may run on job threads */
+   dlAtomicInc( occlusion->tested );
+
+   minX = minY = FLT_MAX;
+   maxX = maxY = -FLT_MAX;
+   nearest = FLT_MAX;
+   i = 0;
+   for(; i != 8; ++i)
+   {
+      cx = (i & 1) ? box->max.x : box->min.x;
+      cy = (i & 2) ? box->max.y : box->min.y;
+      cz = (i & 4) ? box->max.z : box->min.z;
+      cw = m[3] * cx + m[7] * cy + m[11] * cz + m[15];
+
+      /* crosses near plane, can't be hidden */
+      if(cw <= 1e-6f)
+         return( 1 );
+
+      sx = (m[0] * cx + m[4] * cy + m[8]  * cz + m[12]) / cw;
+      sy = (m[1] * cx + m[5] * cy + m[9]  * cz + m[13]) / cw;
+      nearest = fminf( nearest, (m[2] * cx + m[6] * cy + m[10] * cz + m[14]) / cw );
+
+      minX = fminf( minX, sx ); maxX = fmaxf( maxX, sx );
+      minY = fminf( minY, sy ); maxY = fmaxf( maxY, sy );
+   }
+
+   /* outside of screen is frustum culling's business */
+   if(maxX < -1 || maxY < -1 || minX > 1 || minY > 1)
+      return( 1 );
+
+   minX = fmaxf( (minX * 0.5f + 0.5f) * occlusion->width,  0 );
+   minY = fmaxf( (minY * 0.5f + 0.5f) * occlusion->height, 0 );
+   maxX = fminf( (maxX * 0.5f + 0.5f) * occlusion->width,  occlusion->width  - 1 );
+   maxY = fminf( (maxY * 0.5f + 0.5f) * occlusion->height, occlusion->height - 1 );
+
+   /* coarsest level where box spans at most 2x2 cells */
+   x0 = (unsigned int)minX / DL_OCCLUSION_CELL; x1 = (unsigned int)maxX / DL_OCCLUSION_CELL;
+   y0 = (unsigned int)minY / DL_OCCLUSION_CELL; y1 = (unsigned int)maxY / DL_OCCLUSION_CELL;
+   l = 0;
+   for(; l + 1 < occlusion->levels && (x1 - x0 > 1 || y1 - y0 > 1); ++l)
+   {
+      x0 /= 2; x1 /= 2;
+      y0 /= 2; y1 /= 2;
+   }
+
+   level = occlusion->hiz + occlusion->level_offset[l];
+   y = y0;
+   for(; y <= y1; ++y)
+   {
+      x = x0;
+      for(; x <= x1; ++x)
+      {
+         cell = y * occlusion->level_width[l] + x;
+         if(nearest <= level[cell] + DL_OCCLUSION_EPSILON)
+            return( 1 );
+      }
+   }
+
+   dlAtomicInc( occlusion->rejected );
+   return( 0 );
+}
+
+/* Depth of pixel */
+float dlOcclusionDepth( dlOcclusion *occlusion, unsigned int x, unsigned int y )
+{
+   if(!occlusion || x >= occlusion->width || y >= occlusion->height)
+      return( 1.0f );
+
+   return( occlusion->depth[ y * occlusion->width + x ] );
+}
@@ -0,0 +1,92 @@
+#ifndef DL_OCCLUSION_H
+#define DL_OCCLUSION_H
+
+#include "kazmath/kazmath.h"
+#include "kazmath/vec4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* pixels per tile side, triangles are binned per tile */
+#define DL_OCCLUSION_TILE  32
+
+/* pixels per side of finest hierarchical-Z cell */
+#define DL_OCCLUSION_CELL  8
+
+struct dlObject_t;
+
+/* screen space triangle, edge functions and depth plane */
+typedef struct dlOccluderTriangle_t
+{
+   float a[3], b[3], c[3];
+   float za, zb, zc;
+   int   minX, minY, maxX, maxY;
+} dlOccluderTriangle;
+
+/* triangles touching tile */
+typedef struct dlOcclusionBin_t
+{
+   unsigned int *triangle;
+   unsigned int num, use;
+} dlOcclusionBin;
+
+/* low resolution depth buffer occluders are rasterized to,
+ * depth is NDC z and smaller is nearer */
+typedef struct dlOcclusion_t
+{
+   unsigned int width, height;
+
+   float *depth;
+
+   /* hierarchical-Z, farthest depth of cells.
+    * level 0 cells are DL_OCCLUSION_CELL pixels, each level halves */
+   float        *hiz;
+   unsigned int  levels;
+   unsigned int  level_offset[16];
+   unsigned int  level_width[16], level_height[16];
+
+   /* triangles of frame and tile bins */
+   dlOccluderTriangle *triangle;
+   unsigned int        num_triangle, use_triangle;
+   dlOcclusionBin     *bin;
+   unsigned int        tiles_x, tiles_y;
+
+   /* occluder vertices in clip space */
+   kmVec4       *clip;
+   unsigned int  num_clip;
+
+   kmMat4 projection;
+
+   /* counters of frame */
+   unsigned int occluders, tested, rejected;
+
+   unsigned int refCounter;
+} dlOcclusion;
+
+dlOcclusion*   dlNewOcclusion( unsigned int width, unsigned int height ); /* multiple of DL_OCCLUSION_TILE */
+dlOcclusion*   dlRefOcclusion( dlOcclusion *src );
+int            dlFreeOcclusion( dlOcclusion *occlusion );
+
+/* Clear depth and start frame with world to clip matrix,
+ * NULL uses current projection */
+void           dlOcclusionBegin( dlOcclusion *occlusion, const kmMat4 *projection );
+
+/* Bin triangles of occluder object, childs are not added */
+int            dlOcclusionAddOccluder( dlOcclusion *occlusion, struct dlObject_t *object );
+
+/* Rasterize binned triangles tile by tile and build hierarchical-Z */
+void           dlOcclusionEnd( dlOcclusion *occlusion );
+
+/* Test world space box, returns 0 when it is hidden behind occluders.
+ * safe to call from job threads */
+int            dlOcclusionTestAABB( dlOcclusion *occlusion, const kmAABB *box );
+
+/* Depth of pixel, for debugging */
+float          dlOcclusionDepth( dlOcclusion *occlusion, unsigned int x, unsigned int y );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_OCCLUSION_H */
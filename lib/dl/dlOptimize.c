@@ -0,0 +1,825 @@
+#include <limits.h>
+#include <malloc.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlOptimize.h"
+#include "dlCore.h"
+#include "dlLog.h"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#endif
+#ifdef GLES1
+#  include <GLES/gl.h>
+#  include <GLES/glext.h>
+#endif
+#if !defined(GLES1) && !defined(GLES2)
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#endif
+
+#define DL_DEBUG_CHANNEL "OPTIMIZE"
+
+/* LRU cache simulated by vertex cache pass */
+#define DL_OPTIMIZE_LRU_SIZE 32
+
+/* score weights from Forsyth's "Linear-Speed Vertex Cache Optimisation" */
+#define DL_OPTIMIZE_CACHE_DECAY     1.5f
+#define DL_OPTIMIZE_LAST_TRI_SCORE  0.75f
+#define DL_OPTIMIZE_VALENCE_SCALE   2.0f
+#define DL_OPTIMIZE_VALENCE_POWER   0.5f
+
+/* check every index is inside vertex range */
+static int dlOptimizeValidate( const unsigned int *indices, unsigned int count,
+      unsigned int vertices )
+{
+   unsigned int i;
+
+   if(!indices || count % 3)
+      return( RETURN_FAIL );
+
+   i = 0;
+   for(; i != count; ++i)
+      if(indices[i] >= vertices)
+         return( RETURN_FAIL );
+
+   return( RETURN_OK );
+}
+
+/* transformed vertices per triangle with FIFO cache */
+float dlOptimizeACMR( const unsigned int *indices, unsigned int count,
+      unsigned int vertices, unsigned int cache_size )
+{
+   unsigned int i, misses = 0, time = 0;
+   unsigned int *stamp;
+   CALL("%p, %u, %u, %u", indices, count, vertices, cache_size);
+
+   if(count < 3 || dlOptimizeValidate( indices, count, vertices ) != RETURN_OK)
+   { RET("%f", 0.0f); return( 0.0f ); }
+
+   /* time each vertex entered cache, 0 = never */
+   dlSetAlloc( ALLOC_IBO );
+   if(!(stamp = dlCalloc( vertices, sizeof(unsigned int) )))
+   { RET("%f", 0.0f); return( 0.0f ); }
+
+   i = 0;
+   for(; i != count; ++i)
+   {
+      if(stamp[ indices[i] ] && time - stamp[ indices[i] ] < cache_size)
+         continue;
+
+      stamp[ indices[i] ] = ++time;
+      misses++;
+   }
+
+   dlSetAlloc( ALLOC_IBO );
+   dlFree( stamp, vertices * sizeof(unsigned int) );
+
+   RET("%f", (float)misses / (count / 3));
+   return( (float)misses / (count / 3) );
+}
+
+/* Forsyth vertex score */
+static float dlOptimizeVertexScore( int position, unsigned int valence )
+{
+   float score = 0.0f;
+
+   /* no triangles left */
+   if(!valence)
+      return( -1.0f );
+
+   if(position >= 0)
+   {
+      /* vertices of last triangle get fixed score,
+       * so the next triangle doesn't only reuse one edge */
+      if(position < 3)
+         score = DL_OPTIMIZE_LAST_TRI_SCORE;
+      else
+         score = powf( 1.0f - (float)(position - 3) / (DL_OPTIMIZE_LRU_SIZE - 3),
+                       DL_OPTIMIZE_CACHE_DECAY );
+   }
+
+   /* boost vertices with few triangles left */
+   score += DL_OPTIMIZE_VALENCE_SCALE * powf( (float)valence, -DL_OPTIMIZE_VALENCE_POWER );
+   return( score );
+}
+
+/* reorder triangles for post-transform cache */
+int dlOptimizeVertexCache( unsigned int *dst, const unsigned int *indices,
+      unsigned int count, unsigned int vertices )
+{
+   unsigned int triangles, i, c, t, v, k, cache_size = 0, new_size, cursor = 0;
+   unsigned int *valence = NULL, *offset = NULL, *adjacency = NULL, *out = NULL;
+   unsigned int cache[DL_OPTIMIZE_LRU_SIZE + 3], new_cache[DL_OPTIMIZE_LRU_SIZE + 3];
+   int *position = NULL, best;
+   float *vscore = NULL, *tscore = NULL, best_score;
+   uint8_t *emitted = NULL;
+   int ret = RETURN_FAIL;
+   CALL("%p, %p, %u, %u", dst, indices, count, vertices);
+
+   if(!dst || dlOptimizeValidate( indices, count, vertices ) != RETURN_OK)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   triangles = count / 3;
+   if(!triangles)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_IBO );
+   valence   = dlCalloc( vertices, sizeof(unsigned int) );
+   offset    = dlCalloc( vertices + 1, sizeof(unsigned int) );
+   adjacency = dlMalloc( count * sizeof(unsigned int) );
+   position  = dlMalloc( vertices * sizeof(int) );
+   vscore    = dlMalloc( vertices * sizeof(float) );
+   tscore    = dlMalloc( triangles * sizeof(float) );
+   emitted   = dlCalloc( triangles, sizeof(uint8_t) );
+   out       = dlMalloc( count * sizeof(unsigned int) );
+   if(!valence || !offset || !adjacency || !position ||
+      !vscore  || !tscore || !emitted   || !out)
+      goto fail;
+
+   /* triangles of each vertex,
+    * offset[v] .. offset[v] + valence[v] are the live ones */
+   i = 0;
+   for(; i != count; ++i)
+      valence[ indices[i] ]++;
+
+   v = 0;
+   for(; v != vertices; ++v)
+      offset[v + 1] = offset[v] + valence[v];
+
+   memset( valence, 0, vertices * sizeof(unsigned int) );
+   i = 0;
+   for(; i != count; ++i)
+   {
+      v = indices[i];
+      adjacency[ offset[v] + valence[v]++ ] = i / 3;
+   }
+
+   v = 0;
+   for(; v != vertices; ++v)
+   {
+      position[v] = -1;
+      vscore[v]   = dlOptimizeVertexScore( -1, valence[v] );
+   }
+
+   best = 0; best_score = -1.0f;
+   t = 0;
+   for(; t != triangles; ++t)
+   {
+      tscore[t] = vscore[ indices[t * 3] ] + vscore[ indices[t * 3 + 1] ] +
+                  vscore[ indices[t * 3 + 2] ];
+      if(tscore[t] > best_score)
+      {
+         best_score = tscore[t];
+         best       = t;
+      }
+   }
+
+   i = 0;
+   for(; i != triangles; ++i)
+   {
+      /* nothing in cache has triangles left, take next unused one */
+      if(best < 0)
+      {
+         for(; emitted[cursor]; ++cursor);
+         best = cursor;
+      }
+
+      t = best;
+      emitted[t] = 1;
+      memcpy( &out[i * 3], &indices[t * 3], 3 * sizeof(unsigned int) );
+
+      /* remove triangle from its vertices */
+      c = 0;
+      for(; c != 3; ++c)
+      {
+         v = indices[t * 3 + c];
+         k = offset[v];
+         for(; adjacency[k] != t; ++k);
+         adjacency[k] = adjacency[ offset[v] + valence[v] - 1 ];
+         valence[v]--;
+      }
+
+      /* triangle goes to front of cache, rest keep their order */
+      new_size = 0;
+      c = 0;
+      for(; c != 3; ++c)
+      {
+         v = indices[t * 3 + c];
+         k = 0;
+         for(; k != new_size && new_cache[k] != v; ++k);
+         if(k == new_size) new_cache[ new_size++ ] = v;
+      }
+
+      c = 0;
+      for(; c != cache_size; ++c)
+      {
+         v = cache[c];
+         if(v != indices[t * 3] && v != indices[t * 3 + 1] && v != indices[t * 3 + 2])
+            new_cache[ new_size++ ] = v;
+      }
+
+      /* rescore, vertices past LRU size fall out */
+      c = 0;
+      for(; c != new_size; ++c)
+      {
+         v = new_cache[c];
+         position[v] = c < DL_OPTIMIZE_LRU_SIZE ? (int)c : -1;
+         vscore[v]   = dlOptimizeVertexScore( position[v], valence[v] );
+      }
+
+      /* best triangle touching cache */
+      best = -1; best_score = -1.0f;
+      c = 0;
+      for(; c != new_size; ++c)
+      {
+         v = new_cache[c];
+         k = offset[v];
+         for(; k != offset[v] + valence[v]; ++k)
+         {
+            t = adjacency[k];
+            tscore[t] = vscore[ indices[t * 3] ] + vscore[ indices[t * 3 + 1] ] +
+                        vscore[ indices[t * 3 + 2] ];
+            if(tscore[t] > best_score)
+            {
+               best_score = tscore[t];
+               best       = t;
+            }
+         }
+      }
+
+      cache_size = new_size < DL_OPTIMIZE_LRU_SIZE ? new_size : DL_OPTIMIZE_LRU_SIZE;
+      memcpy( cache, new_cache, cache_size * sizeof(unsigned int) );
+   }
+
+   memcpy( dst, out, count * sizeof(unsigned int) );
+   ret = RETURN_OK;
+
+fail:
+   dlSetAlloc( ALLOC_IBO );
+   dlFree( valence,   vertices * sizeof(unsigned int) );
+   dlFree( offset,    (vertices + 1) * sizeof(unsigned int) );
+   dlFree( adjacency, count * sizeof(unsigned int) );
+   dlFree( position,  vertices * sizeof(int) );
+   dlFree( vscore,    vertices * sizeof(float) );
+   dlFree( tscore,    triangles * sizeof(float) );
+   dlFree( emitted,   triangles * sizeof(uint8_t) );
+   dlFree( out,       count * sizeof(unsigned int) );
+
+   RET("%d", ret);
+   return( ret );
+}
+
+/* cluster sorting */
+typedef struct dlOptimizeCluster_t
+{
+   unsigned int start, count;
+   float        key;
+} dlOptimizeCluster;
+
+static int dlOptimizeClusterCmp( const void *a, const void *b )
+{
+   const dlOptimizeCluster *ca = a, *cb = b;
+
+   /* larger key first, keep order otherwise */
+   if(ca->key > cb->key) return( -1 );
+   if(ca->key < cb->key) return(  1 );
+   return( ca->start < cb->start ? -1 : 1 );
+}
+
+/* split cache ordered triangles into clusters at cache flushes
+ * and draw clusters facing away from mesh center first */
+int dlOptimizeOverdraw( unsigned int *dst, const unsigned int *indices,
+      unsigned int count, const kmVec3 *positions,
+      unsigned int vertices, unsigned int *clusters )
+{
+   unsigned int triangles, t, c, v, num = 0, time = 0, misses;
+   unsigned int *stamp = NULL, *out = NULL;
+   dlOptimizeCluster *cluster = NULL;
+   kmVec3 center = { 0, 0, 0 }, ccenter, normal, e1, e2, n;
+   const kmVec3 *p0, *p1, *p2;
+   int ret = RETURN_FAIL;
+   CALL("%p, %p, %u, %p, %u, %p", dst, indices, count, positions, vertices, clusters);
+
+   if(!dst || !positions || dlOptimizeValidate( indices, count, vertices ) != RETURN_OK)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   triangles = count / 3;
+   if(!triangles)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_IBO );
+   stamp   = dlCalloc( vertices, sizeof(unsigned int) );
+   cluster = dlMalloc( triangles * sizeof(dlOptimizeCluster) );
+   out     = dlMalloc( count * sizeof(unsigned int) );
+   if(!stamp || !cluster || !out)
+      goto fail;
+
+   /* new cluster where every vertex of triangle misses */
+   t = 0;
+   for(; t != triangles; ++t)
+   {
+      misses = 0;
+      c = 0;
+      for(; c != 3; ++c)
+      {
+         v = indices[t * 3 + c];
+         if(stamp[v] && time - stamp[v] < DL_OPTIMIZE_FIFO_SIZE)
+            continue;
+
+         stamp[v] = ++time;
+         misses++;
+      }
+
+      if(!num || misses == 3)
+      {
+         cluster[num].start = t;
+         cluster[num].count = 0;
+         num++;
+      }
+      cluster[num - 1].count++;
+
+      p0 = &positions[ indices[t * 3] ];
+      p1 = &positions[ indices[t * 3 + 1] ];
+      p2 = &positions[ indices[t * 3 + 2] ];
+      center.x += p0->x + p1->x + p2->x;
+      center.y += p0->y + p1->y + p2->y;
+      center.z += p0->z + p1->z + p2->z;
+   }
+   kmVec3Scale( &center, &center, 1.0f / count );
+
+   /* area weighted cluster normal against direction from mesh center */
+   c = 0;
+   for(; c != num; ++c)
+   {
+      kmVec3Fill( &ccenter, 0, 0, 0 );
+      kmVec3Fill( &normal, 0, 0, 0 );
+
+      t = cluster[c].start;
+      for(; t != cluster[c].start + cluster[c].count; ++t)
+      {
+         p0 = &positions[ indices[t * 3] ];
+         p1 = &positions[ indices[t * 3 + 1] ];
+         p2 = &positions[ indices[t * 3 + 2] ];
+
+         kmVec3Subtract( &e1, p1, p0 );
+         kmVec3Subtract( &e2, p2, p0 );
+         kmVec3Cross( &n, &e1, &e2 );
+         kmVec3Add( &normal, &normal, &n );
+
+         ccenter.x += p0->x + p1->x + p2->x;
+         ccenter.y += p0->y + p1->y + p2->y;
+         ccenter.z += p0->z + p1->z + p2->z;
+      }
+
+      kmVec3Scale( &ccenter, &ccenter, 1.0f / (cluster[c].count * 3) );
+      kmVec3Subtract( &ccenter, &ccenter, &center );
+      if(kmVec3LengthSq( &normal ) > 0.0f)
+         kmVec3Normalize( &normal, &normal );
+
+      cluster[c].key = kmVec3Dot( &ccenter, &normal );
+   }
+
+   qsort( cluster, num, sizeof(dlOptimizeCluster), dlOptimizeClusterCmp );
+
+   t = 0;
+   c = 0;
+   for(; c != num; ++c)
+   {
+      memcpy( &out[t * 3], &indices[ cluster[c].start * 3 ],
+              cluster[c].count * 3 * sizeof(unsigned int) );
+      t += cluster[c].count;
+   }
+
+   memcpy( dst, out, count * sizeof(unsigned int) );
+   if(clusters) *clusters = num;
+   ret = RETURN_OK;
+
+fail:
+   dlSetAlloc( ALLOC_IBO );
+   dlFree( stamp,   vertices * sizeof(unsigned int) );
+   dlFree( cluster, triangles * sizeof(dlOptimizeCluster) );
+   dlFree( out,     count * sizeof(unsigned int) );
+
+   RET("%d", ret);
+   return( ret );
+}
+
+/* number vertices in order of first use */
+int dlOptimizeVertexFetch( unsigned int *remap, const unsigned int *indices,
+      unsigned int count, unsigned int vertices )
+{
+   unsigned int i, next = 0;
+   CALL("%p, %p, %u, %u", remap, indices, count, vertices);
+
+   if(!remap || dlOptimizeValidate( indices, count, vertices ) != RETURN_OK)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memset( remap, 0xff, vertices * sizeof(unsigned int) );
+
+   i = 0;
+   for(; i != count; ++i)
+      if(remap[ indices[i] ] == UINT_MAX)
+         remap[ indices[i] ] = next++;
+
+   /* unused vertices keep their relative order at the end */
+   i = 0;
+   for(; i != vertices; ++i)
+      if(remap[i] == UINT_MAX)
+         remap[i] = next++;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* rewrite indices with remap */
+void dlOptimizeRemapIndices( unsigned int *indices, unsigned int count,
+      const unsigned int *remap )
+{
+   unsigned int i;
+
+   i = 0;
+   for(; i != count; ++i)
+      indices[i] = remap[ indices[i] ];
+}
+
+/* run passes on object */
+int dlObjectOptimizeMesh( dlObject *object, unsigned int flags, dlOptimizeStats *stats )
+{
+#if !USE_BUFFERS
+   unsigned int count, *remap;
+   dlOptimizeStats result;
+#endif
+   CALL("%p, %u, %p", object, flags, stats);
+
+   if(!object || !object->vbo || !object->ibo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+#if USE_BUFFERS
+   /* indices are split to 16-bit buffers by vertex range,
+    * reordering would move them between buffers */
+   LOGWARN("Mesh optimization needs 32-bit index storage");
+   RET("%d", RETURN_NOTHING);
+   return( RETURN_NOTHING );
+#else
+   if(object->primitive_type != GL_TRIANGLES)
+   {
+      LOGWARN("Mesh optimization needs triangle list");
+      RET("%d", RETURN_NOTHING);
+      return( RETURN_NOTHING );
+   }
+
+   count = object->ibo->i_use - object->ibo->i_use % 3;
+   if(!count || !object->vbo->v_use)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   memset( &result, 0, sizeof(dlOptimizeStats) );
+   result.triangles   = count / 3;
+   result.acmr_before = dlOptimizeACMR( object->ibo->indices, count,
+                                        object->vbo->v_use, DL_OPTIMIZE_FIFO_SIZE );
+
+   if(flags & DL_OPTIMIZE_VERTEX_CACHE)
+      if(dlOptimizeVertexCache( object->ibo->indices, object->ibo->indices,
+                                count, object->vbo->v_use ) != RETURN_OK)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(flags & DL_OPTIMIZE_OVERDRAW)
+      if(dlOptimizeOverdraw( object->ibo->indices, object->ibo->indices, count,
+                             object->vbo->vertices, object->vbo->v_use,
+                             &result.clusters ) != RETURN_OK)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(flags & DL_OPTIMIZE_VERTEX_FETCH)
+   {
+      dlSetAlloc( ALLOC_VBO );
+      if(!(remap = dlMalloc( object->vbo->v_use * sizeof(unsigned int) )))
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      /* incomplete trailing triangle is never drawn */
+      if(dlOptimizeVertexFetch( remap, object->ibo->indices, count,
+                                object->vbo->v_use ) == RETURN_OK &&
+         dlVBORemap( object->vbo, remap ) == RETURN_OK)
+      {
+         dlOptimizeRemapIndices( object->ibo->indices, count, remap );
+         if(object->animator)
+            dlAnimatorRemapWeights( object->animator, remap, object->vbo->v_use );
+
+         /* influences are rebuilt from remapped weights */
+         dlFreeSkin( object->skin );
+         object->skin = NULL;
+      }
+      else
+      { LOGWARN("Vertex streams differ in size, skipping vertex fetch pass"); }
+
+      /* remap keeps vertex count */
+      dlSetAlloc( ALLOC_VBO );
+      dlFree( remap, object->vbo->v_use * sizeof(unsigned int) );
+   }
+
+   result.acmr_after = dlOptimizeACMR( object->ibo->indices, count,
+                                       object->vbo->v_use, DL_OPTIMIZE_FIFO_SIZE );
+
+   /* Mark IBO outdated */
+   object->ibo->up_to_date = 0;
+
+   LOGINFOP("%u triangles, ACMR %.3f -> %.3f",
+            result.triangles, result.acmr_before, result.acmr_after);
+
+   if(stats)
+      memcpy( stats, &result, sizeof(dlOptimizeStats) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+#endif
+}
+
+/* every used stream has the same amount of vertices */
+static int dlWeldStreams( const dlVBO *vbo )
+{
+   unsigned int i;
+
+   if(vbo->n_use && vbo->n_use != vbo->v_use) return( 0 );
+#if VERTEX_COLOR
+   if(vbo->c_use && vbo->c_use != vbo->v_use) return( 0 );
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      if(vbo->uvw[i].c_use && vbo->uvw[i].c_use != vbo->v_use) return( 0 );
+
+   return( 1 );
+}
+
+/* FNV-1a */
+static uint32_t dlWeldHashBytes( uint32_t hash, const void *data, size_t size )
+{
+   const unsigned char *p = data;
+
+   for(; size; --size, ++p)
+      hash = (hash ^ *p) * 16777619u;
+
+   return( hash );
+}
+
+/* hash of every attribute of vertex */
+static uint32_t dlWeldHashVertex( const dlVBO *vbo, unsigned int v )
+{
+   unsigned int i;
+   uint32_t hash = 2166136261u;
+
+   hash = dlWeldHashBytes( hash, &vbo->vertices[v], sizeof(kmVec3) );
+   if(vbo->n_use)
+      hash = dlWeldHashBytes( hash, &vbo->normals[v], sizeof(kmVec3) );
+#if VERTEX_COLOR
+   if(vbo->c_use)
+      hash = dlWeldHashBytes( hash, &vbo->colors[v], sizeof(dlColor) );
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      if(vbo->uvw[i].c_use)
+         hash = dlWeldHashBytes( hash, &vbo->uvw[i].coords[v], sizeof(kmVec2) );
+
+   return( hash );
+}
+
+/* position cell of vertex for epsilon welding */
+static void dlWeldCell( const dlVBO *vbo, unsigned int v, float epsilon, int *cell )
+{
+   cell[0] = (int)floorf( vbo->vertices[v].x / epsilon );
+   cell[1] = (int)floorf( vbo->vertices[v].y / epsilon );
+   cell[2] = (int)floorf( vbo->vertices[v].z / epsilon );
+}
+
+static uint32_t dlWeldHashCell( const int *cell )
+{
+   return( ((uint32_t)cell[0] * 73856093u) ^
+           ((uint32_t)cell[1] * 19349663u) ^
+           ((uint32_t)cell[2] * 83492791u) );
+}
+
+/* floats differ at most by epsilon */
+static int dlWeldNear( const float *a, const float *b, unsigned int n, float epsilon )
+{
+   for(; n; --n, ++a, ++b)
+      if(fabsf( *a - *b ) > epsilon)
+         return( 0 );
+
+   return( 1 );
+}
+
+/* every attribute matches */
+static int dlWeldEqual( const dlVBO *vbo, unsigned int a, unsigned int b, float epsilon )
+{
+   unsigned int i;
+
+   if(!dlWeldNear( &vbo->vertices[a].x, &vbo->vertices[b].x, 3, epsilon ))
+      return( 0 );
+   if(vbo->n_use && !dlWeldNear( &vbo->normals[a].x, &vbo->normals[b].x, 3, epsilon ))
+      return( 0 );
+#if VERTEX_COLOR
+   if(vbo->c_use && memcmp( &vbo->colors[a], &vbo->colors[b], sizeof(dlColor) ))
+      return( 0 );
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      if(vbo->uvw[i].c_use &&
+         !dlWeldNear( &vbo->uvw[i].coords[a].x, &vbo->uvw[i].coords[b].x, 2, epsilon ))
+         return( 0 );
+
+   return( 1 );
+}
+
+/* bit identical, also keeps 0 and -0 apart */
+static int dlWeldSame( const dlVBO *vbo, unsigned int a, unsigned int b )
+{
+   unsigned int i;
+
+   if(memcmp( &vbo->vertices[a], &vbo->vertices[b], sizeof(kmVec3) ))
+      return( 0 );
+   if(vbo->n_use && memcmp( &vbo->normals[a], &vbo->normals[b], sizeof(kmVec3) ))
+      return( 0 );
+#if VERTEX_COLOR
+   if(vbo->c_use && memcmp( &vbo->colors[a], &vbo->colors[b], sizeof(dlColor) ))
+      return( 0 );
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      if(vbo->uvw[i].c_use &&
+         memcmp( &vbo->uvw[i].coords[a], &vbo->uvw[i].coords[b], sizeof(kmVec2) ))
+         return( 0 );
+
+   return( 1 );
+}
+
+/* find duplicate vertices with open addressing hash */
+unsigned int dlOptimizeWeld( unsigned int *remap, const dlVBO *vbo, float epsilon )
+{
+   unsigned int v, size, slot, mask, unique = 0, found, n;
+   unsigned int *table;
+   int cell[3], other[3], near[3];
+   CALL("%p, %p, %f", remap, vbo, epsilon);
+
+   if(!remap || !vbo || !vbo->v_use || !dlWeldStreams( vbo ))
+   { RET("%u", 0); return( 0 ); }
+
+   /* load factor at most 0.5 */
+   size = 1;
+   while(size < vbo->v_use * 2) size <<= 1;
+   mask = size - 1;
+
+   /* slots hold first vertex of each unique one */
+   dlSetAlloc( ALLOC_VBO );
+   if(!(table = dlMalloc( size * sizeof(unsigned int) )))
+   { RET("%u", 0); return( 0 ); }
+   memset( table, 0xff, size * sizeof(unsigned int) );
+
+   v = 0;
+   for(; v != vbo->v_use; ++v)
+   {
+      found = UINT_MAX;
+
+      if(epsilon <= 0.0f)
+      {
+         slot = dlWeldHashVertex( vbo, v ) & mask;
+         for(; table[slot] != UINT_MAX; slot = (slot + 1) & mask)
+            if(dlWeldSame( vbo, table[slot], v ))
+            { found = table[slot]; break; }
+      }
+      else
+      {
+         /* match can be in any neighbour cell */
+         dlWeldCell( vbo, v, epsilon, cell );
+         n = 0;
+         for(; n != 27 && found == UINT_MAX; ++n)
+         {
+            near[0] = cell[0] + (int)(n % 3) - 1;
+            near[1] = cell[1] + (int)(n / 3 % 3) - 1;
+            near[2] = cell[2] + (int)(n / 9) - 1;
+
+            slot = dlWeldHashCell( near ) & mask;
+            for(; table[slot] != UINT_MAX; slot = (slot + 1) & mask)
+            {
+               dlWeldCell( vbo, table[slot], epsilon, other );
+               if(memcmp( other, near, sizeof(other) ))
+                  continue;
+
+               if(dlWeldEqual( vbo, table[slot], v, epsilon ))
+               { found = table[slot]; break; }
+            }
+         }
+
+         slot = dlWeldHashCell( cell ) & mask;
+         if(found == UINT_MAX)
+            for(; table[slot] != UINT_MAX; slot = (slot + 1) & mask);
+      }
+
+      if(found != UINT_MAX)
+      {
+         remap[v] = remap[found];
+         continue;
+      }
+
+      /* slot is at end of probe chain */
+      table[slot] = v;
+      remap[v]    = unique++;
+   }
+
+   dlSetAlloc( ALLOC_VBO );
+   dlFree( table, size * sizeof(unsigned int) );
+
+   RET("%u", unique);
+   return( unique );
+}
+
+/* rewrite IBO of object and childs drawing from vbo */
+static int dlWeldRemapIBOs( dlObject *object, dlVBO *vbo,
+      const unsigned int *remap, unsigned int vertices )
+{
+   unsigned int i;
+
+   if(object->vbo == vbo && object->ibo)
+      if(dlIBORemap( object->ibo, remap, vertices ) != RETURN_OK)
+         return( RETURN_FAIL );
+
+   i = 0;
+   for(; i != object->num_childs; ++i)
+      if(dlWeldRemapIBOs( object->child[i], vbo, remap, vertices ) != RETURN_OK)
+         return( RETURN_FAIL );
+
+   return( RETURN_OK );
+}
+
+/* IBO of object and childs drawing from vbo can be rewritten */
+static int dlWeldCanRemap( dlObject *object, dlVBO *vbo )
+{
+   unsigned int i;
+
+#if USE_BUFFERS
+   return( 0 );
+#endif
+
+   /* drawn without indices */
+   if(object->vbo == vbo && !object->ibo)
+      return( 0 );
+
+   i = 0;
+   for(; i != object->num_childs; ++i)
+      if(!dlWeldCanRemap( object->child[i], vbo ))
+         return( 0 );
+
+   return( 1 );
+}
+
+/* weld vertices of object */
+int dlObjectWeldVertices( dlObject *object, float epsilon )
+{
+   unsigned int i, vertices, unique, *remap;
+   int ret = RETURN_OK;
+   CALL("%p, %f", object, epsilon);
+
+   if(!object)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(object->vbo && object->vbo->v_use && dlWeldCanRemap( object, object->vbo ))
+   {
+      vertices = object->vbo->v_use;
+
+      dlSetAlloc( ALLOC_VBO );
+      if(!(remap = dlMalloc( vertices * sizeof(unsigned int) )))
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      unique = dlOptimizeWeld( remap, object->vbo, epsilon );
+      if(unique && unique != vertices)
+      {
+         if(dlWeldRemapIBOs( object, object->vbo, remap, vertices ) != RETURN_OK ||
+            dlVBOCompact( object->vbo, remap, unique ) != RETURN_OK)
+            ret = RETURN_FAIL;
+         else if(object->animator)
+            ret = dlAnimatorRemapWeights( object->animator, remap, vertices );
+
+         dlFreeSkin( object->skin );
+         object->skin = NULL;
+
+         LOGINFOP("Welded %u vertices to %u", vertices, unique);
+      }
+
+      dlSetAlloc( ALLOC_VBO );
+      dlFree( remap, vertices * sizeof(unsigned int) );
+   }
+
+   /* childs with their own VBO */
+   i = 0;
+   for(; i != object->num_childs && ret == RETURN_OK; ++i)
+      if(object->child[i]->vbo != object->vbo)
+         ret = dlObjectWeldVertices( object->child[i], epsilon );
+
+   RET("%d", ret);
+   return( ret );
+}
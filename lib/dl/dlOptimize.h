@@ -0,0 +1,67 @@
+#ifndef DL_OPTIMIZE_H
+#define DL_OPTIMIZE_H
+
+#include "kazmath/kazmath.h"
+#include "dlSceneobject.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* mesh optimization passes */
+typedef enum
+{
+   DL_OPTIMIZE_VERTEX_CACHE   = 1,  /* reorder triangles for post-transform cache */
+   DL_OPTIMIZE_OVERDRAW       = 2,  /* sort triangle clusters front facing first */
+   DL_OPTIMIZE_VERTEX_FETCH   = 4,  /* reorder vertices in order of first use */
+   DL_OPTIMIZE_ALL            = 7
+} dleOptimize;
+
+/* FIFO cache size used for ACMR */
+#define DL_OPTIMIZE_FIFO_SIZE 16
+
+/* result of optimization */
+typedef struct dlOptimizeStats_t
+{
+   /* average cache miss ratio, transformed vertices per triangle */
+   float acmr_before, acmr_after;
+
+   unsigned int triangles, clusters;
+} dlOptimizeStats;
+
+/* Index list operations, triangle lists only.
+ * dst may be same as indices */
+float       dlOptimizeACMR( const unsigned int *indices, unsigned int count,
+                            unsigned int vertices, unsigned int cache_size );
+int         dlOptimizeVertexCache( unsigned int *dst, const unsigned int *indices,
+                                   unsigned int count, unsigned int vertices );
+int         dlOptimizeOverdraw( unsigned int *dst, const unsigned int *indices,
+                                unsigned int count, const kmVec3 *positions,
+                                unsigned int vertices, unsigned int *clusters );
+
+/* numbers vertices in order of first use, unused vertices go last.
+ * fills remap[old] = new, apply with dlOptimizeRemapIndices and dlVBORemap */
+int         dlOptimizeVertexFetch( unsigned int *remap, const unsigned int *indices,
+                                   unsigned int count, unsigned int vertices );
+void        dlOptimizeRemapIndices( unsigned int *indices, unsigned int count,
+                                    const unsigned int *remap );
+
+/* finds duplicate vertices of every used stream,
+ * epsilon 0 merges only bit identical vertices.
+ * fills remap[old] = new and returns amount of unique vertices */
+unsigned int dlOptimizeWeld( unsigned int *remap, const dlVBO *vbo, float epsilon );
+
+/* Weld duplicate vertices of object and its childs,
+ * rewrites IBOs, bone weights and childs sharing the VBO */
+int         dlObjectWeldVertices( dlObject *object, float epsilon );
+
+/* Run passes on object's IBO and VBO, stats may be NULL.
+ * Run after import and before the object is copied,
+ * copies share IBO and bones with the original. */
+int         dlObjectOptimizeMesh( dlObject *object, unsigned int flags, dlOptimizeStats *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_OPTIMIZE_H */
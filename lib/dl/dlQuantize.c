@@ -0,0 +1,559 @@
+#include <math.h>
+#include <string.h>
+
+#include "dlQuantize.h"
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define DL_QUANTIZE_SSE2 1
+#else
+#  define DL_QUANTIZE_SSE2 0
+#endif
+
+/* float <-> bits */
+typedef union
+{
+   float    f;
+   uint32_t u;
+} dlFloatBits;
+
+/* round to nearest, ties to even like cvtps2dq */
+static int32_t dlRound( float f )
+{
+   return( (int32_t)lrintf( f ) );
+}
+
+static float dlClamp( float f, float min, float max )
+{
+   return( f < min ? min : (f > max ? max : f) );
+}
+
+/* scalar float -> half, round to nearest even */
+static uint16_t dlFloatToHalf( float value )
+{
+   dlFloatBits f, f16max, infty, denorm;
+   uint32_t sign, mant_odd, o;
+
+   f.f         = value;
+   f16max.u    = (127 + 16) << 23;
+   infty.u     = 255 << 23;
+   denorm.u    = ((127 - 15) + (23 - 10) + 1) << 23;
+
+   sign = f.u & 0x80000000u;
+   f.u ^= sign;
+
+   /* inf or NaN */
+   if(f.u >= f16max.u)
+      o = (f.u > infty.u) ? 0x7e00 : 0x7c00;
+   /* subnormal or zero */
+   else if(f.u < (113u << 23))
+   {
+      f.f += denorm.f;
+      o = f.u - denorm.u;
+   }
+   else
+   {
+      mant_odd = (f.u >> 13) & 1;
+      f.u += ((uint32_t)(15 - 127) << 23) + 0xfff;
+      f.u += mant_odd;
+      o = f.u >> 13;
+   }
+
+   return( (uint16_t)(o | (sign >> 16)) );
+}
+
+/* scalar half -> float */
+static float dlHalfToFloat( uint16_t h )
+{
+   dlFloatBits o, magic;
+   uint32_t exp;
+
+   magic.u = 113 << 23;
+   o.u     = (uint32_t)(h & 0x7fff) << 13;
+   exp     = o.u & (0x7c00 << 13);
+   o.u    += (127 - 15) << 23;
+
+   /* inf or NaN */
+   if(exp == (0x7c00 << 13))
+      o.u += (128 - 16) << 23;
+   /* subnormal or zero */
+   else if(!exp)
+   {
+      o.u += 1 << 23;
+      o.f -= magic.f;
+   }
+
+   o.u |= (uint32_t)(h & 0x8000) << 16;
+   return( o.f );
+}
+
+#if DL_QUANTIZE_SSE2
+/* 4 floats -> 4 halfs in low 16 bits of lanes */
+static __m128i dlFloatToHalf4( __m128 f )
+{
+   const __m128i c_f16max     = _mm_set1_epi32( (127 + 16) << 23 );
+   const __m128i c_nanbit     = _mm_set1_epi32( 0x200 );
+   const __m128i c_infty      = _mm_set1_epi32( 0x7c00 );
+   const __m128i c_min_normal = _mm_set1_epi32( (127 - 14) << 23 );
+   const __m128i c_denorm     = _mm_set1_epi32( ((127 - 15) + (23 - 10) + 1) << 23 );
+   const __m128i c_bias       = _mm_set1_epi32( 0xfff - ((127 - 15) << 23) );
+
+   __m128  justsign = _mm_and_ps( _mm_castsi128_ps( _mm_set1_epi32( 0x80000000u ) ), f );
+   __m128  absf     = _mm_xor_ps( f, justsign );
+   __m128i absi     = _mm_castps_si128( absf );
+
+   __m128  isnan    = _mm_cmpunord_ps( absf, absf );
+   __m128i regular  = _mm_cmpgt_epi32( c_f16max, absi );
+   __m128i special  = _mm_or_si128( _mm_and_si128( _mm_castps_si128( isnan ), c_nanbit ), c_infty );
+   __m128i issub    = _mm_cmpgt_epi32( c_min_normal, absi );
+
+   /* subnormal */
+   __m128  sub1     = _mm_add_ps( absf, _mm_castsi128_ps( c_denorm ) );
+   __m128i sub2     = _mm_sub_epi32( _mm_castps_si128( sub1 ), c_denorm );
+
+   /* normal */
+   __m128i mantodd  = _mm_srai_epi32( _mm_slli_epi32( absi, 31 - 13 ), 31 );
+   __m128i normal   = _mm_srli_epi32( _mm_sub_epi32( _mm_add_epi32( absi, c_bias ), mantodd ), 13 );
+
+   __m128i nonspec  = _mm_or_si128( _mm_and_si128( sub2, issub ), _mm_andnot_si128( issub, normal ) );
+   __m128i joined   = _mm_or_si128( _mm_and_si128( nonspec, regular ), _mm_andnot_si128( regular, special ) );
+
+   return( _mm_or_si128( joined, _mm_srai_epi32( _mm_castps_si128( justsign ), 16 ) ) );
+}
+
+/* 4 halfs in low 16 bits of lanes -> 4 floats */
+static __m128 dlHalfToFloat4( __m128i h )
+{
+   const __m128i c_shifted_exp = _mm_set1_epi32( 0x7c00 << 13 );
+   const __m128  c_magic       = _mm_castsi128_ps( _mm_set1_epi32( 113 << 23 ) );
+
+   __m128i o      = _mm_slli_epi32( _mm_and_si128( h, _mm_set1_epi32( 0x7fff ) ), 13 );
+   __m128i exp    = _mm_and_si128( o, c_shifted_exp );
+   __m128i isinf  = _mm_cmpeq_epi32( exp, c_shifted_exp );
+   __m128i iszero = _mm_cmpeq_epi32( exp, _mm_setzero_si128() );
+   __m128  sub;
+
+   o   = _mm_add_epi32( o, _mm_set1_epi32( (127 - 15) << 23 ) );
+   o   = _mm_add_epi32( o, _mm_and_si128( isinf, _mm_set1_epi32( (128 - 16) << 23 ) ) );
+   sub = _mm_sub_ps( _mm_castsi128_ps( _mm_add_epi32( o, _mm_set1_epi32( 1 << 23 ) ) ), c_magic );
+   o   = _mm_or_si128( _mm_and_si128( iszero, _mm_castps_si128( sub ) ), _mm_andnot_si128( iszero, o ) );
+   o   = _mm_or_si128( o, _mm_slli_epi32( _mm_and_si128( h, _mm_set1_epi32( 0x8000 ) ), 16 ) );
+
+   return( _mm_castsi128_ps( o ) );
+}
+
+/* pack low 16 bits of two vectors, keeps bit pattern */
+static __m128i dlPack16( __m128i a, __m128i b )
+{
+   a = _mm_srai_epi32( _mm_slli_epi32( a, 16 ), 16 );
+   b = _mm_srai_epi32( _mm_slli_epi32( b, 16 ), 16 );
+   return( _mm_packs_epi32( a, b ) );
+}
+
+/* sign extend 4 shorts to 4 ints */
+static __m128i dlUnpack16( const int16_t *src )
+{
+   __m128i v = _mm_loadl_epi64( (const __m128i*)src );
+   return( _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 ) );
+}
+#endif
+
+/* half floats */
+void dlQuantizeHalf( const float *src, uint16_t *dst, size_t count )
+{
+   size_t i = 0;
+
+#if DL_QUANTIZE_SSE2
+   for(; i + 8 <= count; i += 8)
+   {
+      __m128i a = dlFloatToHalf4( _mm_loadu_ps( src + i ) );
+      __m128i b = dlFloatToHalf4( _mm_loadu_ps( src + i + 4 ) );
+      _mm_storeu_si128( (__m128i*)(dst + i), dlPack16( a, b ) );
+   }
+#endif
+
+   for(; i != count; ++i)
+      dst[i] = dlFloatToHalf( src[i] );
+}
+
+void dlDequantizeHalf( const uint16_t *src, float *dst, size_t count )
+{
+   size_t i = 0;
+
+#if DL_QUANTIZE_SSE2
+   for(; i + 4 <= count; i += 4)
+   {
+      __m128i h = _mm_loadl_epi64( (const __m128i*)(src + i) );
+      _mm_storeu_ps( dst + i, dlHalfToFloat4( _mm_unpacklo_epi16( h, _mm_setzero_si128() ) ) );
+   }
+#endif
+
+   for(; i != count; ++i)
+      dst[i] = dlHalfToFloat( src[i] );
+}
+
+/* half positions */
+void dlQuantizePositionsHalf( const kmVec3 *src, uint16_t *dst, size_t num )
+{
+   size_t i = 0;
+
+#if DL_QUANTIZE_SSE2
+   for(; i + 2 <= num; i += 2)
+   {
+      __m128i a = dlFloatToHalf4( _mm_setr_ps( src[i].x,   src[i].y,   src[i].z,   0 ) );
+      __m128i b = dlFloatToHalf4( _mm_setr_ps( src[i+1].x, src[i+1].y, src[i+1].z, 0 ) );
+      _mm_storeu_si128( (__m128i*)(dst + i * 4), dlPack16( a, b ) );
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      dst[i * 4    ] = dlFloatToHalf( src[i].x );
+      dst[i * 4 + 1] = dlFloatToHalf( src[i].y );
+      dst[i * 4 + 2] = dlFloatToHalf( src[i].z );
+      dst[i * 4 + 3] = 0;
+   }
+}
+
+void dlDequantizePositionsHalf( const uint16_t *src, kmVec3 *dst, size_t num )
+{
+   size_t i = 0;
+#if DL_QUANTIZE_SSE2
+   float tmp[4];
+
+   for(; i != num; ++i)
+   {
+      __m128i h = _mm_loadl_epi64( (const __m128i*)(src + i * 4) );
+      _mm_storeu_ps( tmp, dlHalfToFloat4( _mm_unpacklo_epi16( h, _mm_setzero_si128() ) ) );
+      dst[i].x = tmp[0]; dst[i].y = tmp[1]; dst[i].z = tmp[2];
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      dst[i].x = dlHalfToFloat( src[i * 4    ] );
+      dst[i].y = dlHalfToFloat( src[i * 4 + 1] );
+      dst[i].z = dlHalfToFloat( src[i * 4 + 2] );
+   }
+}
+
+/* center and half extent of positions, maps bounds to [-32767, 32767] */
+void dlQuantizePositionRange( const kmVec3 *src, size_t num, kmVec3 *scale, kmVec3 *bias )
+{
+   size_t i;
+   kmVec3 min, max;
+
+   if(!num)
+   {
+      scale->x = scale->y = scale->z = 1;
+      bias->x  = bias->y  = bias->z  = 0;
+      return;
+   }
+
+   min = max = src[0];
+   i = 1;
+   for(; i != num; ++i)
+   {
+      if(src[i].x < min.x) min.x = src[i].x;
+      if(src[i].y < min.y) min.y = src[i].y;
+      if(src[i].z < min.z) min.z = src[i].z;
+      if(src[i].x > max.x) max.x = src[i].x;
+      if(src[i].y > max.y) max.y = src[i].y;
+      if(src[i].z > max.z) max.z = src[i].z;
+   }
+
+   bias->x  = (min.x + max.x) * 0.5f;
+   bias->y  = (min.y + max.y) * 0.5f;
+   bias->z  = (min.z + max.z) * 0.5f;
+   scale->x = (max.x - min.x) * 0.5f / 32767.0f;
+   scale->y = (max.y - min.y) * 0.5f / 32767.0f;
+   scale->z = (max.z - min.z) * 0.5f / 32767.0f;
+
+   /* flat axis */
+   if(scale->x <= 0.0f) scale->x = 1;
+   if(scale->y <= 0.0f) scale->y = 1;
+   if(scale->z <= 0.0f) scale->z = 1;
+}
+
+void dlQuantizePositions( const kmVec3 *src, int16_t *dst, size_t num,
+                          const kmVec3 *scale, const kmVec3 *bias )
+{
+   size_t i = 0;
+   kmVec3 inv;
+
+   inv.x = 1.0f / scale->x;
+   inv.y = 1.0f / scale->y;
+   inv.z = 1.0f / scale->z;
+
+#if DL_QUANTIZE_SSE2
+   {
+      __m128 vbias = _mm_setr_ps( bias->x, bias->y, bias->z, 0 );
+      __m128 vinv  = _mm_setr_ps( inv.x, inv.y, inv.z, 0 );
+
+      for(; i + 2 <= num; i += 2)
+      {
+         __m128 a = _mm_setr_ps( src[i].x,   src[i].y,   src[i].z,   0 );
+         __m128 b = _mm_setr_ps( src[i+1].x, src[i+1].y, src[i+1].z, 0 );
+         a = _mm_mul_ps( _mm_sub_ps( a, vbias ), vinv );
+         b = _mm_mul_ps( _mm_sub_ps( b, vbias ), vinv );
+         _mm_storeu_si128( (__m128i*)(dst + i * 4),
+               _mm_packs_epi32( _mm_cvtps_epi32( a ), _mm_cvtps_epi32( b ) ) );
+      }
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      dst[i * 4    ] = dlRound( dlClamp( (src[i].x - bias->x) * inv.x, -32768, 32767 ) );
+      dst[i * 4 + 1] = dlRound( dlClamp( (src[i].y - bias->y) * inv.y, -32768, 32767 ) );
+      dst[i * 4 + 2] = dlRound( dlClamp( (src[i].z - bias->z) * inv.z, -32768, 32767 ) );
+      dst[i * 4 + 3] = 0;
+   }
+}
+
+void dlDequantizePositions( const int16_t *src, kmVec3 *dst, size_t num,
+                            const kmVec3 *scale, const kmVec3 *bias )
+{
+   size_t i = 0;
+#if DL_QUANTIZE_SSE2
+   float tmp[4];
+   __m128 vbias  = _mm_setr_ps( bias->x, bias->y, bias->z, 0 );
+   __m128 vscale = _mm_setr_ps( scale->x, scale->y, scale->z, 0 );
+
+   for(; i != num; ++i)
+   {
+      __m128 v = _mm_cvtepi32_ps( dlUnpack16( src + i * 4 ) );
+      _mm_storeu_ps( tmp, _mm_add_ps( _mm_mul_ps( v, vscale ), vbias ) );
+      dst[i].x = tmp[0]; dst[i].y = tmp[1]; dst[i].z = tmp[2];
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      dst[i].x = src[i * 4    ] * scale->x + bias->x;
+      dst[i].y = src[i * 4 + 1] * scale->y + bias->y;
+      dst[i].z = src[i * 4 + 2] * scale->z + bias->z;
+   }
+}
+
+/* maps coord bounds to [-32768, 32767] */
+void dlQuantizeCoordRange( const kmVec2 *src, size_t num, kmVec2 *scale, kmVec2 *bias )
+{
+   size_t i;
+   kmVec2 min, max;
+
+   if(!num)
+   {
+      scale->x = scale->y = 1;
+      bias->x  = bias->y  = 0;
+      return;
+   }
+
+   min = max = src[0];
+   i = 1;
+   for(; i != num; ++i)
+   {
+      if(src[i].x < min.x) min.x = src[i].x;
+      if(src[i].y < min.y) min.y = src[i].y;
+      if(src[i].x > max.x) max.x = src[i].x;
+      if(src[i].y > max.y) max.y = src[i].y;
+   }
+
+   scale->x = (max.x - min.x) / 65535.0f;
+   scale->y = (max.y - min.y) / 65535.0f;
+   if(scale->x <= 0.0f) scale->x = 1;
+   if(scale->y <= 0.0f) scale->y = 1;
+
+   bias->x = min.x + 32768.0f * scale->x;
+   bias->y = min.y + 32768.0f * scale->y;
+}
+
+void dlQuantizeCoords( const kmVec2 *src, int16_t *dst, size_t num,
+                       const kmVec2 *scale, const kmVec2 *bias )
+{
+   size_t i = 0;
+   kmVec2 inv;
+
+   inv.x = 1.0f / scale->x;
+   inv.y = 1.0f / scale->y;
+
+#if DL_QUANTIZE_SSE2
+   {
+      __m128 vbias = _mm_setr_ps( bias->x, bias->y, bias->x, bias->y );
+      __m128 vinv  = _mm_setr_ps( inv.x, inv.y, inv.x, inv.y );
+
+      for(; i + 4 <= num; i += 4)
+      {
+         __m128 a = _mm_loadu_ps( &src[i].x );
+         __m128 b = _mm_loadu_ps( &src[i + 2].x );
+         a = _mm_mul_ps( _mm_sub_ps( a, vbias ), vinv );
+         b = _mm_mul_ps( _mm_sub_ps( b, vbias ), vinv );
+         _mm_storeu_si128( (__m128i*)(dst + i * 2),
+               _mm_packs_epi32( _mm_cvtps_epi32( a ), _mm_cvtps_epi32( b ) ) );
+      }
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      dst[i * 2    ] = dlRound( dlClamp( (src[i].x - bias->x) * inv.x, -32768, 32767 ) );
+      dst[i * 2 + 1] = dlRound( dlClamp( (src[i].y - bias->y) * inv.y, -32768, 32767 ) );
+   }
+}
+
+void dlDequantizeCoords( const int16_t *src, kmVec2 *dst, size_t num,
+                         const kmVec2 *scale, const kmVec2 *bias )
+{
+   size_t i = 0;
+
+#if DL_QUANTIZE_SSE2
+   {
+      __m128 vbias  = _mm_setr_ps( bias->x, bias->y, bias->x, bias->y );
+      __m128 vscale = _mm_setr_ps( scale->x, scale->y, scale->x, scale->y );
+
+      for(; i + 2 <= num; i += 2)
+      {
+         __m128 v = _mm_cvtepi32_ps( dlUnpack16( src + i * 2 ) );
+         _mm_storeu_ps( &dst[i].x, _mm_add_ps( _mm_mul_ps( v, vscale ), vbias ) );
+      }
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      dst[i].x = src[i * 2    ] * scale->x + bias->x;
+      dst[i].y = src[i * 2 + 1] * scale->y + bias->y;
+   }
+}
+
+/* 2_10_10_10 normals, w is left 0 */
+void dlQuantizeNormals( const kmVec3 *src, uint32_t *dst, size_t num )
+{
+   size_t i = 0;
+   int32_t x, y, z;
+
+#if DL_QUANTIZE_SSE2
+   {
+      const __m128  one  = _mm_set1_ps( 1.0f );
+      const __m128  mone = _mm_set1_ps( -1.0f );
+      const __m128  s    = _mm_set1_ps( 511.0f );
+      const __m128i mask = _mm_set1_epi32( 0x3ff );
+
+      for(; i + 4 <= num; i += 4)
+      {
+         __m128 vx = _mm_setr_ps( src[i].x, src[i+1].x, src[i+2].x, src[i+3].x );
+         __m128 vy = _mm_setr_ps( src[i].y, src[i+1].y, src[i+2].y, src[i+3].y );
+         __m128 vz = _mm_setr_ps( src[i].z, src[i+1].z, src[i+2].z, src[i+3].z );
+         __m128i qx, qy, qz;
+
+         qx = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( vx, mone ), one ), s ) );
+         qy = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( vy, mone ), one ), s ) );
+         qz = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( vz, mone ), one ), s ) );
+
+         qx = _mm_and_si128( qx, mask );
+         qy = _mm_slli_epi32( _mm_and_si128( qy, mask ), 10 );
+         qz = _mm_slli_epi32( _mm_and_si128( qz, mask ), 20 );
+
+         _mm_storeu_si128( (__m128i*)(dst + i), _mm_or_si128( _mm_or_si128( qx, qy ), qz ) );
+      }
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      x = dlRound( dlClamp( src[i].x, -1, 1 ) * 511.0f );
+      y = dlRound( dlClamp( src[i].y, -1, 1 ) * 511.0f );
+      z = dlRound( dlClamp( src[i].z, -1, 1 ) * 511.0f );
+      dst[i] = ((uint32_t)x & 0x3ff) | (((uint32_t)y & 0x3ff) << 10) | (((uint32_t)z & 0x3ff) << 20);
+   }
+}
+
+void dlDequantizeNormals( const uint32_t *src, kmVec3 *dst, size_t num )
+{
+   size_t i = 0;
+
+#if DL_QUANTIZE_SSE2
+   {
+      float tmp[3][4];
+      const __m128 inv  = _mm_set1_ps( 1.0f / 511.0f );
+      const __m128 mone = _mm_set1_ps( -1.0f );
+
+      for(; i + 4 <= num; i += 4)
+      {
+         __m128i p = _mm_loadu_si128( (const __m128i*)(src + i) );
+         __m128i qx = _mm_srai_epi32( _mm_slli_epi32( p, 22 ), 22 );
+         __m128i qy = _mm_srai_epi32( _mm_slli_epi32( p, 12 ), 22 );
+         __m128i qz = _mm_srai_epi32( _mm_slli_epi32( p, 2 ), 22 );
+
+         _mm_storeu_ps( tmp[0], _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( qx ), inv ), mone ) );
+         _mm_storeu_ps( tmp[1], _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( qy ), inv ), mone ) );
+         _mm_storeu_ps( tmp[2], _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( qz ), inv ), mone ) );
+
+         dst[i  ].x = tmp[0][0]; dst[i  ].y = tmp[1][0]; dst[i  ].z = tmp[2][0];
+         dst[i+1].x = tmp[0][1]; dst[i+1].y = tmp[1][1]; dst[i+1].z = tmp[2][1];
+         dst[i+2].x = tmp[0][2]; dst[i+2].y = tmp[1][2]; dst[i+2].z = tmp[2][2];
+         dst[i+3].x = tmp[0][3]; dst[i+3].y = tmp[1][3]; dst[i+3].z = tmp[2][3];
+      }
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      /* sign extend each 10 bit field */
+      dst[i].x = dlClamp( (float)((int32_t)(src[i] << 22) >> 22) / 511.0f, -1, 1 );
+      dst[i].y = dlClamp( (float)((int32_t)(src[i] << 12) >> 22) / 511.0f, -1, 1 );
+      dst[i].z = dlClamp( (float)((int32_t)(src[i] <<  2) >> 22) / 511.0f, -1, 1 );
+   }
+}
+
+/* byte normals */
+void dlQuantizeNormalsByte( const kmVec3 *src, int8_t *dst, size_t num )
+{
+   size_t i = 0;
+
+#if DL_QUANTIZE_SSE2
+   {
+      const __m128 one  = _mm_set1_ps( 1.0f );
+      const __m128 mone = _mm_set1_ps( -1.0f );
+      const __m128 s    = _mm_set1_ps( 127.0f );
+
+      for(; i + 4 <= num; i += 4)
+      {
+         __m128 a = _mm_setr_ps( src[i  ].x, src[i  ].y, src[i  ].z, 0 );
+         __m128 b = _mm_setr_ps( src[i+1].x, src[i+1].y, src[i+1].z, 0 );
+         __m128 c = _mm_setr_ps( src[i+2].x, src[i+2].y, src[i+2].z, 0 );
+         __m128 d = _mm_setr_ps( src[i+3].x, src[i+3].y, src[i+3].z, 0 );
+         __m128i ab, cd;
+
+         a = _mm_mul_ps( _mm_min_ps( _mm_max_ps( a, mone ), one ), s );
+         b = _mm_mul_ps( _mm_min_ps( _mm_max_ps( b, mone ), one ), s );
+         c = _mm_mul_ps( _mm_min_ps( _mm_max_ps( c, mone ), one ), s );
+         d = _mm_mul_ps( _mm_min_ps( _mm_max_ps( d, mone ), one ), s );
+
+         ab = _mm_packs_epi32( _mm_cvtps_epi32( a ), _mm_cvtps_epi32( b ) );
+         cd = _mm_packs_epi32( _mm_cvtps_epi32( c ), _mm_cvtps_epi32( d ) );
+         _mm_storeu_si128( (__m128i*)(dst + i * 4), _mm_packs_epi16( ab, cd ) );
+      }
+   }
+#endif
+
+   for(; i != num; ++i)
+   {
+      dst[i * 4    ] = dlRound( dlClamp( src[i].x, -1, 1 ) * 127.0f );
+      dst[i * 4 + 1] = dlRound( dlClamp( src[i].y, -1, 1 ) * 127.0f );
+      dst[i * 4 + 2] = dlRound( dlClamp( src[i].z, -1, 1 ) * 127.0f );
+      dst[i * 4 + 3] = 0;
+   }
+}
+
+void dlDequantizeNormalsByte( const int8_t *src, kmVec3 *dst, size_t num )
+{
+   size_t i = 0;
+
+   for(; i != num; ++i)
+   {
+      dst[i].x = dlClamp( src[i * 4    ] / 127.0f, -1, 1 );
+      dst[i].y = dlClamp( src[i * 4 + 1] / 127.0f, -1, 1 );
+      dst[i].z = dlClamp( src[i * 4 + 2] / 127.0f, -1, 1 );
+   }
+}
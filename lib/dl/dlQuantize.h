@@ -0,0 +1,51 @@
+#ifndef DL_QUANTIZE_H
+#define DL_QUANTIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kazmath/kazmath.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Vertex attribute compression.
+ * Quantized values decode as q * scale + bias.
+ * SSE2 is used when available, results match scalar path. */
+
+/* half floats, count = number of floats */
+void dlQuantizeHalf( const float *src, uint16_t *dst, size_t count );
+void dlDequantizeHalf( const uint16_t *src, float *dst, size_t count );
+
+/* positions as 4 half floats per vertex, last one is padding */
+void dlQuantizePositionsHalf( const kmVec3 *src, uint16_t *dst, size_t num );
+void dlDequantizePositionsHalf( const uint16_t *src, kmVec3 *dst, size_t num );
+
+/* positions as 4 shorts per vertex, last one is padding */
+void dlQuantizePositionRange( const kmVec3 *src, size_t num, kmVec3 *scale, kmVec3 *bias );
+void dlQuantizePositions( const kmVec3 *src, int16_t *dst, size_t num,
+                          const kmVec3 *scale, const kmVec3 *bias );
+void dlDequantizePositions( const int16_t *src, kmVec3 *dst, size_t num,
+                            const kmVec3 *scale, const kmVec3 *bias );
+
+/* coords as 2 shorts per vertex, full 16-bit range is used */
+void dlQuantizeCoordRange( const kmVec2 *src, size_t num, kmVec2 *scale, kmVec2 *bias );
+void dlQuantizeCoords( const kmVec2 *src, int16_t *dst, size_t num,
+                       const kmVec2 *scale, const kmVec2 *bias );
+void dlDequantizeCoords( const int16_t *src, kmVec2 *dst, size_t num,
+                         const kmVec2 *scale, const kmVec2 *bias );
+
+/* normals packed to GL_INT_2_10_10_10_REV */
+void dlQuantizeNormals( const kmVec3 *src, uint32_t *dst, size_t num );
+void dlDequantizeNormals( const uint32_t *src, kmVec3 *dst, size_t num );
+
+/* normals as 4 signed bytes, last one is padding */
+void dlQuantizeNormalsByte( const kmVec3 *src, int8_t *dst, size_t num );
+void dlDequantizeNormalsByte( const int8_t *src, kmVec3 *dst, size_t num );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_QUANTIZE_H */
@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlQueue.h"
+#include "dlArena.h"
+#include "dlCore.h"
+#include "dlLog.h"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#elif  GLES1
+#  include <GLES/gl.h>
+#  include <GLES/glext.h>
+#else
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#endif
+
+#define DL_DEBUG_CHANNEL "QUEUE"
+
+/* queue of current frame */
+typedef struct dlQueue_t
+{
+   dlQueueItem  *item;
+   unsigned int num, use;
+} dlQueue;
+
+static dlQueue queue = { NULL, 0, 0 };
+
+/* float to unsigned int that sorts the same way */
+static uint32_t dlQueueDepthBits( float depth )
+{
+   uint32_t bits;
+
+   memcpy( &bits, &depth, sizeof(uint32_t) );
+   return( (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u) );
+}
+
+/* clip space depth of object's bounding box center */
+static float dlQueueDepth( dlObject *object )
+{
+   kmVec3 center;
+   kmMat4 mvp;
+
+   kmVec3Add( &center, &object->aabb_box.min, &object->aabb_box.max );
+   kmVec3Scale( &center, &center, 0.5f );
+
+   /* kmVec3Transform takes matrix by rows */
+   kmMat4Multiply( &mvp, &_dlCore.render.projection, &object->matrix );
+   kmMat4Transpose( &mvp, &mvp );
+   kmVec3Transform( &center, &center, &mvp );
+
+   return( center.z );
+}
+
+/* sort key of object */
+uint64_t dlQueueKey( dlObject *object, dlShader *shader, unsigned int pass )
+{
+   uint64_t key, state = 0;
+   uint32_t depth;
+   int alpha = 0;
+
+   if(object->material)
+   {
+      alpha  = (object->material->flags & DL_MATERIAL_ALPHA) != 0;
+      state |= (uint64_t)(object->material->flags & 0xff) << DL_QUEUE_FLAGS_SHIFT;
+
+      if(object->material->texture)
+         state |= (uint64_t)(object->material->texture->object & 0xfff) << DL_QUEUE_TEXTURE_SHIFT;
+   }
+
+   if(shader)
+      state |= (uint64_t)(shader->object & 0xff) << DL_QUEUE_SHADER_SHIFT;
+
+   depth = dlQueueDepthBits( dlQueueDepth( object ) );
+
+   key  = (uint64_t)(pass & (DL_QUEUE_PASSES - 1)) << DL_QUEUE_PASS_SHIFT;
+   key |= (uint64_t)alpha << DL_QUEUE_ALPHA_SHIFT;
+
+   /* far first, state bits move below depth */
+   if(alpha)
+      key |= ((uint64_t)~depth << 29) | (state >> 33);
+   else
+      key |= state | depth;
+
+   return( key );
+}
+
+static int dlQueueCompare( const void *a, const void *b )
+{
+   const dlQueueItem *ia = a, *ib = b;
+
+   if(ia->key < ib->key) return( -1 );
+   if(ia->key > ib->key) return(  1 );
+   return( 0 );
+}
+
+/* items of roots collected by one job,
+ * slices write to own range of queue so jobs need no locking */
+typedef struct dlQueueSlice_t
+{
+   dlObject     **object;
+   unsigned int   n, pass;
+
+   dlQueueItem   *item;
+   unsigned int   offset, use;
+   unsigned int   culled, occluded;
+} dlQueueSlice;
+
+/* roots are split to this many jobs per thread,
+ * uneven hierarchies still balance */
+#define DL_QUEUE_JOBS_PER_THREAD 4
+
+/* objects in hierarchy, upper bound of items it queues */
+static unsigned int dlQueueCount( dlObject *object )
+{
+   unsigned int i, count = 1;
+
+   i = 0;
+   for(; i != object->num_childs; ++i)
+      if(object->child[i]->parent == object)
+         count += dlQueueCount( object->child[i] );
+
+   return( count );
+}
+
+/* add object and its childs, planes are the ones parent intersected.
+ * runs on job threads, touches only objects of slice.
+ * shared childs are queued by their parent only, another
+ * slice could be culling them at the same time */
+static void dlQueueCollect( dlQueueSlice *slice, dlObject *object, unsigned int planes )
+{
+   unsigned int i;
+   dlQueueItem *item;
+
+   if(!object->vbo)
+      return;
+
+   /* culled objects never reach the queue */
+   switch(dlObjectCull( object, &planes ))
+   {
+      case DL_CULL_FRUSTUM:  slice->culled++;   return;
+      case DL_CULL_OCCLUDED: slice->occluded++; return;
+      default: break;
+   }
+
+   item          = &slice->item[ slice->use++ ];
+   item->object  = object;
+   item->shader  = _dlCore.render.shader;
+   item->key     = dlQueueKey( object, item->shader, slice->pass );
+
+   i = 0;
+   for(; i != object->num_childs; ++i)
+      if(object->child[i]->parent == object)
+         dlQueueCollect( slice, object->child[i], planes );
+}
+
+/* job collecting one slice */
+static void dlQueueJob( void *user, unsigned int index )
+{
+   dlQueueSlice *slice = &((dlQueueSlice*)user)[index];
+   unsigned int i;
+
+   i = 0;
+   for(; i != slice->n; ++i)
+      dlQueueCollect( slice, slice->object[i], DL_FRUSTUM_ALL );
+}
+
+/* room for count more items */
+static int dlQueueReserve( unsigned int count )
+{
+   unsigned int num;
+   dlQueueItem *item;
+
+   if(queue.use + count <= queue.num)
+      return( RETURN_OK );
+
+   dlSetAlloc( ALLOC_CORE );
+
+   num = dlGrowCapacity( queue.num, queue.use + count );
+   if(queue.item)
+      item = dlRealloc( queue.item, queue.num, num, sizeof(dlQueueItem) );
+   else
+      item = dlCalloc( num, sizeof(dlQueueItem) );
+
+   if(!item)
+      return( RETURN_FAIL );
+
+   queue.item = item;
+   queue.num  = num;
+
+   return( RETURN_OK );
+}
+
+/* queue objects culled and keyed on job threads */
+int dlQueueDrawList( dlJobPool *pool, dlObject **object, unsigned int n, unsigned int pass )
+{
+   dlQueueSlice  one, *slice;
+   unsigned int  i, j, jobs, count, first;
+   CALL("%p, %p, %u, %u", pool, object, n, pass);
+
+   if(!object || pass >= DL_QUEUE_PASSES)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!n)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   jobs = 1;
+   if(pool && pool->threads)
+      jobs = (pool->threads + 1) * DL_QUEUE_JOBS_PER_THREAD;
+   if(jobs > n)
+      jobs = n;
+
+   /* slices live until end of frame */
+   slice = &one;
+   if(jobs > 1 && !(slice = dlFrameAlloc( jobs * sizeof(dlQueueSlice) )))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   /* contiguous roots per slice, ranges sized for every object */
+   count = 0;
+   i = 0;
+   for(; i != jobs; ++i)
+   {
+      first           = (unsigned int)((unsigned long long)n * i / jobs);
+      slice[i].object = &object[first];
+      slice[i].n      = (unsigned int)((unsigned long long)n * (i + 1) / jobs) - first;
+      slice[i].pass   = pass;
+      slice[i].use    = slice[i].culled = slice[i].occluded = 0;
+
+      /* queue may move when it grows, items are set after */
+      slice[i].offset = count;
+      j = 0;
+      for(; j != slice[i].n; ++j)
+         count += dlQueueCount( slice[i].object[j] );
+   }
+
+   if(dlQueueReserve( count ) != RETURN_OK)
+   {
+      LOGERR("Failed to grow render queue");
+
+      RET("%d", RETURN_FAIL);
+      return( RETURN_FAIL );
+   }
+
+   i = 0;
+   for(; i != jobs; ++i)
+      slice[i].item = &queue.item[ queue.use + slice[i].offset ];
+
+   dlJobPoolRun( pool, dlQueueJob, slice, jobs );
+
+   /* merge in order on GL thread, buffers are uploaded here.
+    * streamed ones wait for flush, ring may move before it */
+   i = 0;
+   for(; i != jobs; ++i)
+   {
+      if(slice[i].item != &queue.item[ queue.use ])
+         memmove( &queue.item[ queue.use ], slice[i].item, slice[i].use * sizeof(dlQueueItem) );
+
+      if(_dlCore.render.mode == DL_MODE_VBO)
+      {
+         j = queue.use;
+         for(; j != queue.use + slice[i].use; ++j)
+         {
+            dlIBOUpdate( queue.item[j].object->ibo );
+            if(queue.item[j].object->vbo->hint != GL_STREAM_DRAW)
+               dlVBOUpdate( queue.item[j].object->vbo );
+         }
+      }
+
+      queue.use += slice[i].use;
+      _dlCore.render.stats.culled   += slice[i].culled;
+      _dlCore.render.stats.occluded += slice[i].occluded;
+   }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* queue object for drawing */
+int dlQueueDraw( dlObject *object, unsigned int pass )
+{
+   int ret;
+   CALL("%p, %u", object, pass);
+
+   if(!object)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   ret = dlQueueDrawList( NULL, &object, 1, pass );
+
+   RET("%d", ret);
+   return( ret );
+}
+
+/* sort and draw queued items */
+int dlFlushQueue( void )
+{
+   unsigned int i;
+   dlShader *shader;
+   TRACE();
+
+   if(!queue.use)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   qsort( queue.item, queue.use, sizeof(dlQueueItem), dlQueueCompare );
+
+   /* draw with shader that was active when queued */
+   shader = _dlCore.render.shader;
+
+   i = 0;
+   for(; i != queue.use; ++i)
+   {
+      /* written to current segment right before use */
+      if(_dlCore.render.mode == DL_MODE_VBO &&
+         queue.item[i].object->vbo->hint == GL_STREAM_DRAW)
+         dlVBOUpdate( queue.item[i].object->vbo );
+
+      _dlCore.render.shader = queue.item[i].shader;
+      _dlCore.render.draw( queue.item[i].object );
+      _dlCore.render.stats.visible++;
+   }
+
+   _dlCore.render.shader = shader;
+   queue.use = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* free queue storage */
+int dlFreeQueue( void )
+{
+   TRACE();
+
+   dlSetAlloc( ALLOC_CORE );
+
+   dlFree( queue.item, queue.num * sizeof(dlQueueItem) );
+   queue.item = NULL;
+   queue.num  = 0;
+   queue.use  = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
@@ -0,0 +1,57 @@
+#ifndef DL_QUEUE_H
+#define DL_QUEUE_H
+
+#include <stdint.h>
+
+#include "dlSceneobject.h"
+#include "dlJob.h"
+#include "shader/dlShader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* render passes, lower pass is drawn first */
+#define DL_QUEUE_PASSES 4
+
+/* Sort key from high to low bits:
+ * pass, opacity, shader, texture, material flags and depth.
+ * opaque items draw front to back, alpha items back to front
+ * with depth before state so blending stays correct */
+#define DL_QUEUE_PASS_SHIFT    62
+#define DL_QUEUE_ALPHA_SHIFT   61
+#define DL_QUEUE_SHADER_SHIFT  53
+#define DL_QUEUE_TEXTURE_SHIFT 41
+#define DL_QUEUE_FLAGS_SHIFT   33
+
+/* queued draw */
+typedef struct dlQueueItem_t
+{
+   uint64_t  key;
+   dlObject *object;
+   dlShader *shader;
+} dlQueueItem;
+
+/* Queue object and its childs with shader active now,
+ * objects are drawn by dlFlushQueue */
+int            dlQueueDraw( dlObject *object, unsigned int pass );
+
+/* Queue objects and their childs, culling and sort keys
+ * are computed on pool's threads and only buffer uploads stay on calling thread.
+ * objects and their childs must not repeat. NULL pool works serially */
+int            dlQueueDrawList( dlJobPool *pool, dlObject **object, unsigned int n, unsigned int pass );
+
+/* Sort queued items and draw them, queue is empty afterwards */
+int            dlFlushQueue( void );
+
+/* Drop queued items and free queue storage */
+int            dlFreeQueue( void );
+
+/* sort key of object, exposed for debugging */
+uint64_t       dlQueueKey( dlObject *object, dlShader *shader, unsigned int pass );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_QUEUE_H */
@@ -0,0 +1,145 @@
+#ifndef DL_RECORD_H
+#define DL_RECORD_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Recording GL backend for headless testing.
+ * Build framework with DL_GL_RECORD=1 and create display
+ * with DL_RENDER_RECORD, every GL call is then logged
+ * instead of sent to a driver. */
+
+/* recorded calls */
+typedef enum
+{
+   DL_RECORD_OBJECT,          /* renderer draws dlObject, arg 0 is object, arg 1 instances */
+   DL_RECORD_ENABLE,
+   DL_RECORD_DISABLE,
+   DL_RECORD_ENABLE_CLIENT_STATE,
+   DL_RECORD_DISABLE_CLIENT_STATE,
+   DL_RECORD_BLEND_FUNC,
+   DL_RECORD_DEPTH_FUNC,
+   DL_RECORD_CLEAR,
+   DL_RECORD_VIEWPORT,
+   DL_RECORD_COLOR,
+   DL_RECORD_MATRIX_MODE,
+   DL_RECORD_LOAD_MATRIX,
+   DL_RECORD_LOAD_IDENTITY,
+   DL_RECORD_PUSH_MATRIX,
+   DL_RECORD_POP_MATRIX,
+   DL_RECORD_TRANSLATE,
+   DL_RECORD_SCALE,
+   DL_RECORD_BEGIN,
+   DL_RECORD_END,
+   DL_RECORD_VERTEX,
+   DL_RECORD_VERTEX_POINTER,
+   DL_RECORD_NORMAL_POINTER,
+   DL_RECORD_TEXCOORD_POINTER,
+   DL_RECORD_COLOR_POINTER,
+   DL_RECORD_DRAW_ARRAYS,
+   DL_RECORD_DRAW_ELEMENTS,
+   DL_RECORD_GEN_BUFFERS,
+   DL_RECORD_DELETE_BUFFERS,
+   DL_RECORD_BIND_BUFFER,
+   DL_RECORD_BUFFER_DATA,
+   DL_RECORD_BUFFER_SUB_DATA,
+   DL_RECORD_MAP_BUFFER_RANGE,
+   DL_RECORD_UNMAP_BUFFER,
+   DL_RECORD_FENCE_SYNC,
+   DL_RECORD_CLIENT_WAIT_SYNC,
+   DL_RECORD_DELETE_SYNC,
+   DL_RECORD_GEN_TEXTURES,
+   DL_RECORD_DELETE_TEXTURES,
+   DL_RECORD_BIND_TEXTURE,
+   DL_RECORD_TEX_IMAGE_2D,
+   DL_RECORD_GET_INTEGER,
+   DL_RECORD_GET_STRING,
+   DL_RECORD_CREATE_SHADER,
+   DL_RECORD_SHADER_SOURCE,
+   DL_RECORD_COMPILE_SHADER,
+   DL_RECORD_DELETE_SHADER,
+   DL_RECORD_CREATE_PROGRAM,
+   DL_RECORD_ATTACH_SHADER,
+   DL_RECORD_BIND_ATTRIB_LOCATION,
+   DL_RECORD_GET_ATTRIB_LOCATION,
+   DL_RECORD_LINK_PROGRAM,
+   DL_RECORD_USE_PROGRAM,
+   DL_RECORD_DELETE_PROGRAM,
+   DL_RECORD_GET_PROGRAM,
+   DL_RECORD_GET_PROGRAM_INFO_LOG,
+   DL_RECORD_GET_UNIFORM_LOCATION,
+   DL_RECORD_GET_ACTIVE_UNIFORM,
+   DL_RECORD_UNIFORM_MATRIX,
+   DL_RECORD_VERTEX_ATTRIB_POINTER,
+   DL_RECORD_ENABLE_VERTEX_ATTRIB,
+   DL_RECORD_DISABLE_VERTEX_ATTRIB,
+   DL_RECORD_VERTEX_ATTRIB,
+   DL_RECORD_VERTEX_ATTRIB_DIVISOR,
+   DL_RECORD_DRAW_ARRAYS_INSTANCED,
+   DL_RECORD_DRAW_ELEMENTS_INSTANCED,
+   DL_RECORD_GEN_VERTEX_ARRAYS,
+   DL_RECORD_DELETE_VERTEX_ARRAYS,
+   DL_RECORD_BIND_VERTEX_ARRAY,
+   DL_RECORD_GET_UNIFORM_BLOCK_INDEX,
+   DL_RECORD_UNIFORM_BLOCK_BINDING,
+   DL_RECORD_BIND_BUFFER_BASE,
+   DL_RECORD_LAST
+} dleRecordCall;
+
+/* logged call, integer arguments in call order.
+ * floats are truncated, pointers are kept as is */
+typedef struct dlRecordCommand_t
+{
+   dleRecordCall call;
+   intptr_t      arg[4];
+   size_t        bytes;       /* bytes uploaded by call */
+   uint8_t       redundant;   /* call set state that was set already */
+} dlRecordCommand;
+
+/* counters over logged calls */
+typedef struct dlRecordStats_t
+{
+   unsigned int calls;
+   unsigned int draws;        /* glDrawArrays and glDrawElements */
+   unsigned int objects;      /* dlObjects drawn */
+   unsigned int binds;        /* buffer, vertex array, texture and program binds */
+   unsigned int stateChanges; /* state calls that changed state */
+   unsigned int redundant;    /* state calls and binds that did not */
+   size_t       uploaded;     /* bytes to buffers and textures */
+} dlRecordStats;
+
+/* Recording renderer, wraps OpenGL 1.4+ renderer */
+int            dlRecord( void );
+
+/* Install recording GL table, done by dlCreateDisplay */
+int            dlRecordInit( void );
+
+/* Free command log */
+int            dlRecordFree( void );
+
+/* Clear command log and counters.
+ * every call is kept until then, long runs reset each frame */
+void           dlRecordReset( void );
+
+/* Counters since last reset */
+void           dlRecordGetStats( dlRecordStats *stats );
+
+/* Command log since last reset */
+const dlRecordCommand* dlRecordLog( unsigned int *count );
+
+/* Name of recorded call */
+const char*    dlRecordCallName( dleRecordCall call );
+
+/* Write command log as text, one call per line */
+int            dlRecordWrite( FILE *file );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_RECORD_H */
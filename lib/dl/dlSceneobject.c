@@ -2,6 +2,7 @@
 #include "dlTypes.h"
 #include "dlCore.h"
 #include "dlTexture.h"
+#include "dlBatch.h"
 #include "dlLog.h"
 
 #ifdef GLES2
@@ -13,9 +14,20 @@
 #  include <GL/glew.h>
 #  include <GL/gl.h>
 #endif
+#include "dlGL.h"
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define DL_OBJECT_SSE2 1
+#else
+#  define DL_OBJECT_SSE2 0
+#endif
 
 #define DL_DEBUG_CHANNEL "SCENEOBJECT"
 
+static void dlObjectWorldChanged( dlObject *object );
+static void dlObjectBoundsChanged( dlObject *object );
+
 /* Allocate scene object */
 dlObject* dlNewObject( void )
 {
@@ -33,6 +45,7 @@ dlObject* dlNewObject( void )
    object->ibo             = NULL;
 
    object->animator        = NULL;
+   object->skin            = NULL;
    object->child           = NULL;
 
    /* Default primitive type */
@@ -41,8 +54,9 @@ dlObject* dlNewObject( void )
    /* Default transformation */
    object->scale.x = 100; object->scale.y = 100; object->scale.z = 100;
 
-   /* Update matrix on start */
-   object->transform_changed = 1;
+   /* Update matrix and bounds on start */
+   object->transform_changed = DL_TRANSFORM_LOCAL;
+   object->bounds_changed    = 1;
 
    LOGOK("NEW");
 
@@ -58,6 +72,7 @@ dlObject* dlNewObject( void )
 dlObject* dlCopyObject( dlObject *src )
 {
    dlObject *object;
+   unsigned int i;
    CALL("%p", src);
 
    /* Fuuuuuuuuu--- We have non valid object */
@@ -71,12 +86,14 @@ dlObject* dlCopyObject( dlObject *src )
 
    /* Copy data */
    object->matrix                = src->matrix;
+   object->local                 = src->local;
    object->translation	         = src->translation;
    object->rotation              = src->rotation;
    object->scale		 = src->scale;
    object->target	         = src->target;
 
    object->aabb_box              = src->aabb_box;
+   object->bounds                = src->bounds;
 
    /* Reference data */
    object->material	         = dlRefMaterial( src->material );
@@ -88,16 +105,22 @@ dlObject* dlCopyObject( dlObject *src )
 
    object->ibo                   = dlRefIBO( src->ibo );
    object->animator              = dlCopyAnimator( src->animator );
+   object->skin                  = dlRefSkin( src->skin );
+   object->batch                 = dlCopyBatch( src->batch );
 
    /* Copy childs */
    object->child                 = dlObjectCopyChilds( src );
    object->num_childs            = src->num_childs;
+   i = 0;
+   for(; object->child && i != object->num_childs; ++i)
+      if(object->child[i]) object->child[i]->parent = object;
 
    /* Copy hints */
    object->primitive_type	 = src->primitive_type;
 
    /* Update it */
-   object->transform_changed = 1;
+   object->transform_changed = DL_TRANSFORM_LOCAL;
+   object->bounds_changed    = 1;
 
    LOGWARN("COPY");
 
@@ -126,6 +149,8 @@ dlObject* dlRefObject( dlObject *src )
    object->vbo		      = dlRefVBO( src->vbo );
    object->ibo                 = dlRefIBO( src->ibo );
    object->animator            = dlRefAnimator( src->animator );
+   object->skin                = dlRefSkin( src->skin );
+   object->batch               = dlRefBatch( src->batch );
 
    LOGWARN("REFERENCE");
 
@@ -162,6 +187,14 @@ int dlFreeObject( dlObject *object )
    if(object->animator)
    { if( dlFreeAnimator( object->animator ) == RETURN_OK ); object->animator = NULL; }
 
+   /* Free skin */
+   if(dlFreeSkin( object->skin )         == RETURN_OK)
+      object->skin = NULL;
+
+   /* Free batch ranges */
+   if(dlFreeBatch( object->batch )       == RETURN_OK)
+      object->batch = NULL;
+
    /* Free as in, decrease reference on childs */
    i = 0;
    for(; i != object->num_childs; ++i)
@@ -173,6 +206,14 @@ int dlFreeObject( dlObject *object )
    /* There is still references to this object alive */
    if(--object->refCounter != 0) return( RETURN_NOTHING );
 
+   /* childs referenced elsewhere outlive us */
+   i = 0;
+   for(; i != object->num_childs; ++i)
+   {
+      if(object->child[i] && object->child[i]->parent == object)
+         object->child[i]->parent = NULL;
+   }
+
    dlSetAlloc( ALLOC_SCENEOBJECT );
 
    /* Free child list */
@@ -218,60 +259,35 @@ void dlObjectDrawSkeleton( dlObject *object )
 /* update skeletal animation */
 static void dlObjectUpdateSkeletal( dlObject *object )
 {
-   unsigned int x;
-   dlBone         *bone;
-   dlVertexWeight *weight;
-
-   kmVec3 tStance;
-   kmMat4 boneMat;
-   dlAnimator *animator;
-
+   kmMat4 *normal = NULL;
+   dlVBO  *vbo;
    CALL("%p", object);
 
-   animator = object->animator;
+   if(!object->animator || !object->vbo || !object->vbo->tstance)
+      return;
+
+   /* copy skins its own vertices */
+   if(dlVBOUnshare( object->vbo ) == RETURN_FAIL)
+      return;
 
    /* TO-DO: Shader implentation */
-   /* Reset all vertices to 0 here */
-   x = 0;
-   for(; x != object->vbo->v_num; ++x)
-   {
-      object->vbo->vertices[x].x = 0;
-      object->vbo->vertices[x].y = 0;
-      object->vbo->vertices[x].z = 0;
-   }
+   /* influences per vertex, when importer did not build them */
+   vbo = object->vbo;
+   if(!object->skin &&
+      !(object->skin = dlNewSkin( object->animator, vbo->v_use )))
+      return;
 
-   bone = animator->bone;
-   for(; bone; bone = bone->next)
-   {
-      boneMat = bone->globalMatrix;
-      weight = bone->weight;
-      for(; weight; weight = weight->next)
-      {
-         /* Get bone matrices */
-         /* and shift t-stance vertices */
-
-         tStance  = object->vbo->tstance[weight->vertex];
-         kmVec3Transform( &tStance, &tStance, &boneMat );
-
-         object->vbo->vertices[weight->vertex].x += tStance.x * weight->value;
-         object->vbo->vertices[weight->vertex].y += tStance.y * weight->value;
-         object->vbo->vertices[weight->vertex].z += tStance.z * weight->value;
-
-         /*
-          * index  = object->bone[i]->weight[x].vertex;
-          * weight = object->bone[i]->weight[x].weight;
-          * kmVec3 tStance = TSTANCE[ index ];
-          * tStance *= boneMat;
-          *
-          * vbo->vertices[index].x += tStance.x*weight;
-          * vbo->vertices[index].y += tStance.y*weight;
-          * vbo->vertices[index].z += tStance.z*weight;
-          */
-      }
-   }
+   /* normals follow bones when every vertex has one */
+   if(vbo->tnormal && vbo->n_use >= vbo->v_use)
+      normal = object->skin->normal;
+
+   dlSkinMatrices( object->skin, object->animator, object->skin->matrix, normal );
+   dlSkinVerticesNormals( object->skin, object->skin->matrix, normal,
+                          vbo->tstance, vbo->vertices,
+                          vbo->tnormal, vbo->normals, vbo->v_use );
 
-   /* VBO needs update */
-   object->vbo->up_to_date = 0;
+   dlVBOModifiedVertices( vbo, 0, vbo->v_use );
+   if(normal) dlVBOModifiedNormals( vbo, 0, vbo->v_use );
 }
 
 /* Update animation */
@@ -334,6 +350,12 @@ int dlObjectAddChild( dlObject *object, dlObject *child )
 
    /* assign */
    object->child[ object->num_childs - 1 ] = child;
+   if(!child->parent)
+   {
+      child->parent = object;
+      dlObjectWorldChanged( child );
+   }
+   dlObjectBoundsChanged( object );
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
@@ -418,7 +440,7 @@ int dlObjectFreeChild( dlObject *object, dlObject *child )
    {
       if( object->child[i] != child )
       {
-         tmp[++found] = object->child[i];
+         tmp[found++] = object->child[i];
       }
    }
 
@@ -433,6 +455,7 @@ int dlObjectFreeChild( dlObject *object, dlObject *child )
 
          RET("%d", RETURN_FAIL); return( RETURN_FAIL );
       }
+      tmp = tmp2;
    }
    else
    {
@@ -442,11 +465,17 @@ int dlObjectFreeChild( dlObject *object, dlObject *child )
 
    /* ok, free the old list */
    dlFree( object->child, object->num_childs * sizeof(dlObject*) );
+   if(child->parent == object)
+   {
+      child->parent = NULL;
+      dlObjectWorldChanged( child );
+   }
    dlFreeObject( child );
 
    /* use the new list and new count */
    object->child        = tmp;
    object->num_childs   = found;
+   dlObjectBoundsChanged( object );
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
@@ -467,6 +496,12 @@ int dlObjectFreeChilds( dlObject *object )
    i = 0;
    for(; i != object->num_childs; ++i)
    {
+      if(object->child[i]->parent == object)
+      {
+         object->child[i]->parent = NULL;
+         dlObjectWorldChanged( object->child[i] );
+      }
+
       if( dlFreeObject( object->child[i] ) == RETURN_OK )
          object->child[i] = NULL;
    }
@@ -475,72 +510,297 @@ int dlObjectFreeChilds( dlObject *object )
    dlFree( object->child, object->num_childs * sizeof(dlObject*) );
    object->child = NULL;
    object->num_childs = 0;
+   dlObjectBoundsChanged( object );
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
 }
 
-static void dlUpdateMatrix( dlObject *object )
+/* build object matrix from translation, rotation and scale */
+/* local matrix straight from rotation quaternion and scale,
+ * rotation is applied in X, Y, Z order like separate axis matrices would */
+static void dlObjectLocalMatrix( dlObject *object )
+{
+   float cx, sx, cy, sy, cz, sz;
+   float x, y, z, w, *m;
+
+   cx = cosf( kmDegreesToRadians( object->rotation.x ) * 0.5f );
+   sx = sinf( kmDegreesToRadians( object->rotation.x ) * 0.5f );
+   cy = cosf( kmDegreesToRadians( object->rotation.y ) * 0.5f );
+   sy = sinf( kmDegreesToRadians( object->rotation.y ) * 0.5f );
+   cz = cosf( kmDegreesToRadians( object->rotation.z ) * 0.5f );
+   sz = sinf( kmDegreesToRadians( object->rotation.z ) * 0.5f );
+
+   /* qx * qy * qz */
+   x = sx * cy * cz + cx * sy * sz;
+   y = cx * sy * cz - sx * cy * sz;
+   z = cx * cy * sz + sx * sy * cz;
+   w = cx * cy * cz - sx * sy * sz;
+
+   m = object->local.mat;
+   m[0]  = (1 - 2 * (y * y + z * z)) * object->scale.x;
+   m[1]  = (    2 * (x * y + w * z)) * object->scale.x;
+   m[2]  = (    2 * (x * z - w * y)) * object->scale.x;
+   m[3]  = 0;
+   m[4]  = (    2 * (x * y - w * z)) * object->scale.y;
+   m[5]  = (1 - 2 * (x * x + z * z)) * object->scale.y;
+   m[6]  = (    2 * (y * z + w * x)) * object->scale.y;
+   m[7]  = 0;
+   m[8]  = (    2 * (x * z + w * y)) * object->scale.z;
+   m[9]  = (    2 * (y * z - w * x)) * object->scale.z;
+   m[10] = (1 - 2 * (x * x + y * y)) * object->scale.z;
+   m[11] = 0;
+   m[12] = object->translation.x;
+   m[13] = object->translation.y;
+   m[14] = object->translation.z;
+   m[15] = 1;
+}
+
+/* out = a * b for column major matrices, out may alias either */
+static void dlObjectMultiply( kmMat4 *out, const kmMat4 *a, const kmMat4 *b )
 {
-   kmMat4 translation,
-          rotation,
-          scale,
-          temp;
+#if DL_OBJECT_SSE2
+   __m128 c0, c1, c2, c3, r[4];
+   unsigned int i;
 
+   c0 = _mm_loadu_ps( &a->mat[0] );
+   c1 = _mm_loadu_ps( &a->mat[4] );
+   c2 = _mm_loadu_ps( &a->mat[8] );
+   c3 = _mm_loadu_ps( &a->mat[12] );
+
+   i = 0;
+   for(; i != 4; ++i)
+      r[i] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( b->mat[i * 4 + 0] ) ),
+                                     _mm_mul_ps( c1, _mm_set1_ps( b->mat[i * 4 + 1] ) ) ),
+                         _mm_add_ps( _mm_mul_ps( c2, _mm_set1_ps( b->mat[i * 4 + 2] ) ),
+                                     _mm_mul_ps( c3, _mm_set1_ps( b->mat[i * 4 + 3] ) ) ) );
+
+   i = 0;
+   for(; i != 4; ++i)
+      _mm_storeu_ps( &out->mat[i * 4], r[i] );
+#else
+   kmMat4Multiply( out, a, b );
+#endif
+}
+
+/* build world matrix */
+void dlUpdateMatrix( dlObject *object )
+{
    CALL("%p", object);
 
-   /* translation */
-   kmMat4Translation( &translation,
-                      object->translation.x,
-                      object->translation.y,
-                      object->translation.z  );
-
-   /* rotation */
-   kmMat4RotationX( &rotation, kmDegreesToRadians(object->rotation.x) );
-   kmMat4Multiply(  &rotation, &rotation,
-                    kmMat4RotationY( &temp, kmDegreesToRadians(object->rotation.y) ) );
-   kmMat4Multiply(  &rotation, &rotation,
-                    kmMat4RotationZ( &temp, kmDegreesToRadians(object->rotation.z) ) );
-
-   /* scale */
-   kmMat4Scaling( &scale,
-                  object->scale.x,
-                  object->scale.y,
-                  object->scale.z  );
-
-   /* build matrix */
-   kmMat4Multiply( &translation, &translation, &rotation );
-   kmMat4Multiply( &object->matrix, &translation, &scale );
+   /* world of parent first */
+   if(object->parent && object->parent->transform_changed)
+      dlUpdateMatrix( object->parent );
+
+   if(object->transform_changed & DL_TRANSFORM_LOCAL)
+      dlObjectLocalMatrix( object );
+
+   if(object->parent)
+      dlObjectMultiply( &object->matrix, &object->parent->matrix, &object->local );
+   else
+      object->matrix = object->local;
+
    object->transform_changed = 0;
 }
 
-void dlDraw( dlObject *object )
+/* world matrices of childs are stale,
+ * subtree already marked is skipped */
+static void dlObjectWorldChanged( dlObject *object )
 {
    unsigned int i;
+
+   object->transform_changed |= DL_TRANSFORM_WORLD;
+
+   i = 0;
+   for(; i != object->num_childs; ++i)
+   {
+      if(object->child[i]->parent != object)
+         continue;
+
+      if(!(object->child[i]->transform_changed & DL_TRANSFORM_WORLD))
+         dlObjectWorldChanged( object->child[i] );
+   }
+}
+
+/* bounds of object and its parents contain changed child */
+static void dlObjectBoundsChanged( dlObject *object )
+{
+   for(; object; object = object->parent)
+      object->bounds_changed = 1;
+}
+
+/* own transformation changed */
+static void dlObjectTransformChanged( dlObject *object )
+{
+   dlObjectWorldChanged( object );
+   object->transform_changed |= DL_TRANSFORM_LOCAL;
+
+   /* childs move parent bounds */
+   dlObjectBoundsChanged( object->parent );
+}
+
+/* box of object and childs in model space */
+void dlObjectCalculateBounds( dlObject *object )
+{
+   dlObject    *child;
+   kmAABB       box;
+   unsigned int i;
    CALL("%p", object);
 
    if(!object)
       return;
-   if(!object->vbo)
-      return;
 
-   /* don't do any checking here expect for transformation.
-    * draw loop is supposed to be fast. */
-   if(_dlCore.render.mode == DL_MODE_VBO)
+   object->bounds = object->aabb_box;
+
+   /* childs are in space of their local matrix */
+   i = 0;
+   for(; i != object->num_childs; ++i)
    {
-      dlIBOUpdate( object->ibo );
-      dlVBOUpdate( object->vbo );
+      child = object->child[i];
+      if(child->transform_changed & DL_TRANSFORM_LOCAL)
+      {
+         dlObjectLocalMatrix( child );
+         child->transform_changed &= ~DL_TRANSFORM_LOCAL;
+         child->transform_changed |=  DL_TRANSFORM_WORLD;
+      }
+
+      dlObjectCalculateBounds( child );
+      dlAABBTransform( &box, &child->bounds, &child->local );
+      kmAABBUnion( &object->bounds, &object->bounds, &box );
    }
 
+   object->bounds_changed = 0;
+}
+
+/* world space bounds, matrix and bounds are updated first */
+kmAABB* dlObjectWorldBounds( dlObject *object, kmAABB *out )
+{
+   CALL("%p, %p", object, out);
+
    if(object->transform_changed)
       dlUpdateMatrix( object );
 
-   _dlCore.render.draw( object );
+   if(object->bounds_changed)
+      dlObjectCalculateBounds( object );
+
+   return( dlAABBTransform( out, &object->bounds, &object->matrix ) );
+}
+
+/* test box in model space against planes of projection */
+static dleFrustumTest dlObjectTest( dlObject *object, const kmAABB *box, unsigned int *planes )
+{
+   kmAABB world;
+
+   dlAABBTransform( &world, box, &object->matrix );
+   return( dlFrustumTestAABB( &_dlCore.render.frustum, &world, planes ) );
+}
+
+/* cull object and its childs,
+ * planes box is inside of are cleared so childs skip them */
+int dlObjectCull( dlObject *object, unsigned int *planes )
+{
+   kmAABB world;
+   CALL("%p, %p", object, planes);
+
+   /* parent was inside every plane */
+   if(!*planes && !_dlCore.render.occlusion)
+   {
+      if(object->transform_changed)
+         dlUpdateMatrix( object );
+      return( DL_CULL_NONE );
+   }
+
+   dlObjectWorldBounds( object, &world );
+   if(*planes && dlFrustumTestAABB( &_dlCore.render.frustum, &world, planes ) == DL_FRUSTUM_OUTSIDE)
+      return( DL_CULL_FRUSTUM );
+
+   if(_dlCore.render.occlusion && !dlOcclusionTestAABB( _dlCore.render.occlusion, &world ))
+      return( DL_CULL_OCCLUDED );
+
+   return( DL_CULL_NONE );
+}
+
+/* culled draw, planes are the ones parent intersected */
+void dlDrawCulled( dlObject *object, unsigned int planes )
+{
+   unsigned int i, own;
+
+   if(!object)
+      return;
+   if(!object->vbo)
+      return;
+
+   switch(dlObjectCull( object, &planes ))
+   {
+      case DL_CULL_FRUSTUM:  _dlCore.render.stats.culled++;   return;
+      case DL_CULL_OCCLUDED: _dlCore.render.stats.occluded++; return;
+      default: break;
+   }
+
+   /* childs may keep bounds visible when object itself is not */
+   own = planes;
+   if(own && object->num_childs &&
+      dlObjectTest( object, &object->aabb_box, &own ) == DL_FRUSTUM_OUTSIDE)
+      _dlCore.render.stats.culled++;
+   else
+   {
+      /* don't do any checking here expect for transformation.
+       * draw loop is supposed to be fast. */
+      if(_dlCore.render.mode == DL_MODE_VBO)
+      {
+         dlIBOUpdate( object->ibo );
+         dlVBOUpdate( object->vbo );
+      }
+
+      _dlCore.render.draw( object );
+      _dlCore.render.stats.visible++;
+   }
 
    /* draw childs */
    i = 0;
    for(; i != object->num_childs; ++i)
-      dlDraw( object->child[i] );
+      dlDrawCulled( object->child[i], planes );
+}
+
+void dlDraw( dlObject *object )
+{
+   CALL("%p", object);
+   dlDrawCulled( object, DL_FRUSTUM_ALL );
+}
+
+/* draw object with each matrix */
+void dlDrawInstanced( dlObject *object, const kmMat4 *matrices, unsigned int n )
+{
+   kmMat4 matrix;
+   unsigned int i;
+   CALL("%p, %p, %u", object, matrices, n);
+
+   if(!object || !matrices || !n)
+      return;
+   if(!object->vbo)
+      return;
+
+   if(_dlCore.render.mode == DL_MODE_VBO)
+   {
+      dlIBOUpdate( object->ibo );
+      dlVBOUpdate( object->vbo );
+   }
+
+   if(_dlCore.render.drawInstanced)
+   {
+      _dlCore.render.drawInstanced( object, matrices, n );
+      return;
+   }
+
+   /* renderer without instancing */
+   matrix = object->matrix;
+   i = 0;
+   for(; i != n; ++i)
+   {
+      object->matrix = matrices[i];
+      _dlCore.render.draw( object );
+   }
+   object->matrix = matrix;
 }
 
 /* Operations */
@@ -590,9 +850,10 @@ int dlObjectCalculateAABB( dlObject *object )
    aabb_box.min = min;
    aabb_box.max = max;
    object->aabb_box = aabb_box;
+   object->bounds_changed = 1;
 
 #if 0
-   printf("v_use: %u\n", vbo->v_num);
+   printf("v_use: %u\n", vbo->v_use);
    printf("min: %f, %f, %f\n", min.x, min.y, min.z );
    printf("max: %f, %f, %f\n", max.x, max.y, max.z );
 #endif
@@ -604,16 +865,11 @@ int dlObjectCalculateAABB( dlObject *object )
 /* position sceneobject */
 void dlPositionObject( dlObject *object, kmVec3 *position )
 {
-   unsigned int i;
    CALL( "%p, vec3[%f, %f, %f]", object,
          position->x, position->y, position->z );
 
    object->translation        = *position;
-   object->transform_changed  = 1;
-
-   i = 0;
-   for(; i != object->num_childs; ++i)
-      dlPositionObject( object->child[i], position );
+   dlObjectTransformChanged( object );
 }
 
 /* position sceneobject */
@@ -629,16 +885,11 @@ void dlPositionObjectf( dlObject *object,
 /* move sceneobject */
 void dlMoveObject( dlObject *object, kmVec3 *move )
 {
-   unsigned int i;
    CALL("%p, vec3[%f, %f, %f]", object,
          move->x, move->y, move->z);
 
    kmVec3Add( &object->translation, &object->translation, move );
-   object->transform_changed  = 1;
-
-   i = 0;
-   for(; i != object->num_childs; ++i)
-      dlMoveObject( object->child[i], move );
+   dlObjectTransformChanged( object );
 }
 
 /* move sceneobject */
@@ -654,16 +905,11 @@ void dlMoveObjectf( dlObject *object,
 /* rotate sceneobject */
 void dlRotateObject( dlObject *object, kmVec3 *rotate )
 {
-   unsigned int i;
    CALL("%p, vec3[%f, %f, %f]", object,
          rotate->x, rotate->y, rotate->z);
 
    object->rotation = *rotate;
-   object->transform_changed = 1;
-
-   i = 0;
-   for(; i != object->num_childs; ++i)
-      dlRotateObject( object->child[i], rotate );
+   dlObjectTransformChanged( object );
 }
 
 /* rotate sceneobject */
@@ -679,16 +925,11 @@ void dlRotateObjectf( dlObject *object,
 /* scale sceneobject */
 void dlScaleObject( dlObject *object, kmVec3 *scale )
 {
-   unsigned int i;
    CALL("%p, vec3[%f, %f, %f]", object,
          scale->x, scale->y, scale->z);
 
    object->scale = *scale;
-   object->transform_changed = 1;
-
-   i = 0;
-   for(; i != object->num_childs; ++i)
-      dlScaleObject( object->child[i], scale );
+   dlObjectTransformChanged( object );
 }
 
 /* scale sceneobject */
@@ -724,6 +965,10 @@ void dlShiftObject( dlObject *object, int width, int height, unsigned int index,
    if(!texture)
       return;
 
+   /* coords are written in place */
+   if(dlVBOUnshare( object->vbo ) == RETURN_FAIL)
+      return;
+
    if(!baseCoords)
       baseCoords = object->vbo->uvw[ texture->uvw ].coords;
 
@@ -750,13 +995,14 @@ void dlShiftObject( dlObject *object, int width, int height, unsigned int index,
    aheight = height / (float)texture->height;
 
    x = 0;
-   for(; x != object->vbo->uvw[ texture->uvw ].c_num; ++x)
+   for(; x != object->vbo->uvw[ texture->uvw ].c_use; ++x)
    {
       object->vbo->uvw[ texture->uvw ].coords[ x ].x = baseCoords[x].x * awidth  + pos.x / (float)texture->width;
       object->vbo->uvw[ texture->uvw ].coords[ x ].y = baseCoords[x].y * aheight + pos.y / (float)texture->height;
    }
 
-   object->vbo->up_to_date = 0;
+   dlVBOModifiedCoords( object->vbo, texture->uvw, 0,
+                        object->vbo->uvw[ texture->uvw ].c_use );
    dlVBOUpdate( object->vbo );
 }
 
@@ -783,6 +1029,10 @@ void dlOffsetObjectTexture( dlObject *object, int px, int py, int width, int hei
    if(!texture)
       return;
 
+   /* coords are written in place */
+   if(dlVBOUnshare( object->vbo ) == RETURN_FAIL)
+      return;
+
    if(!baseCoords)
       baseCoords = object->vbo->uvw[ texture->uvw ].coords;
 
@@ -790,13 +1040,14 @@ void dlOffsetObjectTexture( dlObject *object, int px, int py, int width, int hei
    aheight = height / (float)texture->height;
 
    x = 0;
-   for(; x != object->vbo->uvw[ texture->uvw ].c_num; ++x)
+   for(; x != object->vbo->uvw[ texture->uvw ].c_use; ++x)
    {
       object->vbo->uvw[ texture->uvw ].coords[ x ].x = baseCoords[x].x * awidth  + px / (float)texture->width;
       object->vbo->uvw[ texture->uvw ].coords[ x ].y = baseCoords[x].y * aheight + py / (float)texture->height;
    }
 
-   object->vbo->up_to_date = 0;
+   dlVBOModifiedCoords( object->vbo, texture->uvw, 0,
+                        object->vbo->uvw[ texture->uvw ].c_use );
    dlVBOUpdate( object->vbo );
 }
 
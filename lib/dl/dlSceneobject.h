@@ -5,11 +5,24 @@
 #include "dlIbo.h"
 #include "dlMaterial.h"
 #include "skeletal/dlAnimator.h"
+#include "skeletal/dlSkin.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* result of dlObjectCull */
+typedef enum
+{
+   DL_CULL_NONE,
+   DL_CULL_FRUSTUM,     /* outside of frustum */
+   DL_CULL_OCCLUDED     /* hidden behind occluders */
+} dleCull;
+
+/* transform_changed bits */
+#define DL_TRANSFORM_LOCAL 1  /* translation, rotation or scale changed */
+#define DL_TRANSFORM_WORLD 2  /* parent moved, world matrix is stale */
+
 /* sceneobject struct */
 typedef struct dlObject_t
 {
@@ -20,10 +33,19 @@ typedef struct dlObject_t
    /* Animator */
    dlAnimator  *animator;
 
-   /* Matrix */
+   /* bone influences per vertex, built from animator */
+   dlSkin      *skin;
+
+   /* static batch this object was merged from, see dlBatch.h */
+   struct dlBatch_t *batch;
+
+   /* World matrix, parent's world matrix * local */
    kmMat4 matrix;
 
-   /* Translation */
+   /* Matrix from translation, rotation and scale */
+   kmMat4 local;
+
+   /* Translation, relative to parent */
    kmVec3 translation;
    kmVec3 rotation;
    kmVec3 scale;
@@ -32,16 +54,23 @@ typedef struct dlObject_t
    /* Bounding box */
    kmAABB aabb_box;
 
+   /* Bounding box of object and its childs in model space, used for culling */
+   kmAABB bounds;
+
    /* GL Primitive type,
     * GL_TRIANGlES, GL_TRIANGLE_STRIP etc */
    unsigned int primitive_type;
 
    uint8_t      transform_changed;
+   uint8_t      bounds_changed;
 
-   /* childs */
+   /* childs, their transformation is relative to this */
    struct dlObject_t **child;
    unsigned int num_childs;
 
+   /* object this was added to as child, referenced childs keep first one */
+   struct dlObject_t *parent;
+
    unsigned int refCounter;
 } dlObject;
 
@@ -50,6 +79,14 @@ dlObject*   dlCopyObject( dlObject *src );	      /* Copy sceneobject  */
 dlObject*   dlRefObject( dlObject *src );	      /* Reference sceneobject  */
 int         dlFreeObject( dlObject *object );	      /* Free sceneobject */
 void        dlDraw( dlObject *object );               /* Draw sceneobject */
+void        dlDrawCulled( dlObject *object,           /* Draw testing only given frustum planes, */
+                          unsigned int planes );      /* 0 draws without culling */
+void        dlDrawInstanced( dlObject *object,        /* Draw sceneobject once per matrix, */
+                             const kmMat4 *matrices,  /* childs are not drawn */
+                             unsigned int n );
+void        dlUpdateMatrix( dlObject *object );       /* Build world matrix, parents are updated first */
+int         dlObjectCull( dlObject *object,           /* Test against current projection and occlusion, */
+                          unsigned int *planes );     /* returns dleCull of object and childs */
 
 void        dlObjectDrawSkeleton( dlObject *object );
 void        dlObjectTick( dlObject *object, float tick );
@@ -70,6 +107,13 @@ int         dlFlagObject( dlObject*, unsigned int );
 /* Calculate AABB */
 int dlObjectCalculateAABB( dlObject* );
 
+/* Bounds of object and childs in world space */
+kmAABB* dlObjectWorldBounds( dlObject*, kmAABB* );
+
+/* Recalculate culling bounds from AABBs of object and childs,
+ * done on draw after childs change or AABB is recalculated */
+void dlObjectCalculateBounds( dlObject* );
+
 /* Translation */
 void dlPositionObject(  dlObject*, kmVec3* );
 void dlPositionObjectf( dlObject*,
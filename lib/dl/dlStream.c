@@ -0,0 +1,349 @@
+#include <stdint.h>
+
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlStream.h"
+#include "dlHeap.h"
+#include "dlConfig.h"
+#include "dlCore.h"
+#include "dlLog.h"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#endif
+#ifdef GLES1
+#  include <GLES/gl.h>
+#  include <GLES/glext.h>
+#endif
+#if !defined(GLES1) && !defined(GLES2)
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#  define DL_STREAM_SYNC 1
+#else
+#  define DL_STREAM_SYNC 0
+#endif
+#include "dlGL.h"
+
+#define DL_DEBUG_CHANNEL "STREAM"
+
+/* allocations inside ring are aligned to this */
+#define DL_STREAM_ALIGN 64
+
+/* fence wait timeout in nanoseconds */
+#define DL_STREAM_TIMEOUT 1000000000
+
+/* ring struct */
+typedef struct dlStreamRing_t
+{
+   /* GL buffer object, 0 on CPU method */
+   unsigned int    object;
+
+   /* CPU storage, or staging for orphaning */
+   unsigned char   *data;
+   size_t          data_size;
+
+   /* bytes per segment and write position in current segment */
+   size_t          segment;
+   size_t          head;
+
+   /* current map */
+   size_t          map_offset, map_size;
+   uint8_t         mapped;
+
+   unsigned int    current;
+   unsigned int    serial;
+   dleStreamMethod method;
+
+#if DL_STREAM_SYNC
+   GLsync          fence[DL_STREAM_FRAMES];
+#endif
+} dlStreamRing;
+
+static dlStreamRing _DL_STREAM_RING;
+
+/* wait until GPU is done with segment */
+static void dlStreamWait( unsigned int segment )
+{
+#if DL_STREAM_SYNC
+   GLenum status;
+   dlStreamRing *ring = &_DL_STREAM_RING;
+
+   if(!ring->fence[ segment ])
+      return;
+
+   do
+   {
+      status = glClientWaitSync( ring->fence[ segment ],
+                                 GL_SYNC_FLUSH_COMMANDS_BIT, DL_STREAM_TIMEOUT );
+   } while(status == GL_TIMEOUT_EXPIRED);
+
+   if(status == GL_WAIT_FAILED)
+   { LOGWARN("Waiting for stream fence failed"); }
+
+   glDeleteSync( ring->fence[ segment ] );
+   ring->fence[ segment ] = NULL;
+#endif
+}
+
+/* retire current segment */
+static void dlStreamAdvance( void )
+{
+   dlStreamRing *ring = &_DL_STREAM_RING;
+
+#if DL_STREAM_SYNC
+   if(ring->method == DL_STREAM_MAP)
+      ring->fence[ ring->current ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+#endif
+
+   ring->current = (ring->current + 1) % DL_STREAM_FRAMES;
+   ring->head    = 0;
+   ring->serial++;
+
+   /* make sure nobody is reading the segment we are about to write */
+   if(ring->method == DL_STREAM_MAP)
+      dlStreamWait( ring->current );
+
+   /* back at start, give driver fresh storage */
+   if(ring->method == DL_STREAM_ORPHAN && !ring->current)
+   {
+      dlBindBuffer( GL_ARRAY_BUFFER, ring->object );
+      glBufferData( GL_ARRAY_BUFFER, ring->segment * DL_STREAM_FRAMES, NULL, GL_STREAM_DRAW );
+   }
+}
+
+/* init ring */
+int dlStreamInit( size_t segment, dleStreamMethod method )
+{
+   dlStreamRing *ring = &_DL_STREAM_RING;
+   CALL("%llu, %d", segment, method);
+
+   dlStreamFree();
+
+   if(!segment)
+      segment = DL_STREAM_SIZE;
+   segment = (segment + DL_STREAM_ALIGN - 1) & ~((size_t)DL_STREAM_ALIGN - 1);
+
+   /* pick method, mapping needs driver support for ranges and fences */
+   if(method == DL_STREAM_AUTO)
+      method = DL_STREAM_MAP;
+#if DL_STREAM_SYNC
+   if(method == DL_STREAM_MAP && !(GLEW_ARB_map_buffer_range && GLEW_ARB_sync))
+      method = DL_STREAM_ORPHAN;
+#else
+   if(method == DL_STREAM_MAP)
+      method = DL_STREAM_ORPHAN;
+#endif
+
+   ring->segment = segment;
+   ring->method  = method;
+
+   /* GL storage */
+   if(method != DL_STREAM_CPU)
+   {
+      glGenBuffers( 1, &ring->object );
+      if(ring->object)
+      {
+         dlBindBuffer( GL_ARRAY_BUFFER, ring->object );
+         glBufferData( GL_ARRAY_BUFFER, segment * DL_STREAM_FRAMES, NULL, GL_STREAM_DRAW );
+      }
+      else
+      {
+         LOGWARN("Could not create stream buffer, using system memory");
+         ring->method = method = DL_STREAM_CPU;
+      }
+   }
+
+   /* CPU storage */
+   if(method == DL_STREAM_CPU)
+   {
+      dlSetAlloc( ALLOC_CORE );
+      ring->data = dlMalloc( segment * DL_STREAM_FRAMES );
+      if(!ring->data)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      ring->data_size = segment * DL_STREAM_FRAMES;
+   }
+
+   LOGINFOP("Stream ring %llu x %d, method %d", segment, DL_STREAM_FRAMES, method);
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* free ring */
+int dlStreamFree( void )
+{
+   unsigned int i, serial;
+   dlStreamRing *ring = &_DL_STREAM_RING;
+   TRACE();
+
+   if(!ring->segment)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+#if DL_STREAM_SYNC
+   i = 0;
+   for(; i != DL_STREAM_FRAMES; ++i)
+   {
+      if(ring->fence[i]) glDeleteSync( ring->fence[i] );
+      ring->fence[i] = NULL;
+   }
+#endif
+
+   dlDeleteBuffer( &ring->object );
+
+   dlSetAlloc( ALLOC_CORE );
+   if(ring->data)
+      dlFree( ring->data, ring->data_size );
+
+   /* serial keeps counting, data streamed to this ring expires */
+   serial = ring->serial;
+   memset( ring, 0, sizeof(dlStreamRing) );
+   ring->serial = serial + 1;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* get memory for this frame */
+void* dlStreamMap( size_t size, size_t *offset )
+{
+   void *ptr;
+   size_t head;
+   dlStreamRing *ring = &_DL_STREAM_RING;
+   CALL("%llu, %p", size, offset);
+
+   if(!ring->segment && dlStreamInit( DL_STREAM_SIZE, DL_STREAM_AUTO ) != RETURN_OK)
+   { RET("%p", NULL); return( NULL ); }
+
+   if(ring->mapped || !size)
+   { RET("%p", NULL); return( NULL ); }
+
+   if(size > ring->segment)
+   {
+      LOGWARNP("%llu bytes does not fit stream segment", size);
+      RET("%p", NULL);
+      return( NULL );
+   }
+
+   /* segment full, move on */
+   head = (ring->head + DL_STREAM_ALIGN - 1) & ~((size_t)DL_STREAM_ALIGN - 1);
+   if(head + size > ring->segment)
+   {
+      dlStreamAdvance();
+      head = 0;
+   }
+
+   ring->map_offset = ring->current * ring->segment + head;
+   ring->map_size   = size;
+   ring->head       = head + size;
+   *offset          = ring->map_offset;
+
+   switch(ring->method)
+   {
+      case DL_STREAM_CPU:
+         ring->mapped = 1;
+         RET("%p", ring->data + ring->map_offset);
+         return( ring->data + ring->map_offset );
+
+#if DL_STREAM_SYNC
+      case DL_STREAM_MAP:
+         dlBindBuffer( GL_ARRAY_BUFFER, ring->object );
+         ptr = glMapBufferRange( GL_ARRAY_BUFFER, ring->map_offset, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                 GL_MAP_UNSYNCHRONIZED_BIT );
+
+         ring->mapped = ptr ? 1 : 0;
+         RET("%p", ptr);
+         return( ptr );
+#endif
+
+      default:
+         /* staging memory, uploaded on unmap */
+         if(ring->data_size < size)
+         {
+            dlSetAlloc( ALLOC_CORE );
+            if(ring->data) dlFree( ring->data, ring->data_size );
+            ring->data_size = 0;
+
+            ring->data = dlMalloc( size );
+            if(!ring->data)
+            { RET("%p", NULL); return( NULL ); }
+
+            ring->data_size = size;
+         }
+
+         ring->mapped = 1;
+         RET("%p", ring->data);
+         return( ring->data );
+   }
+}
+
+/* finish writing mapped memory */
+int dlStreamUnmap( void )
+{
+   dlStreamRing *ring = &_DL_STREAM_RING;
+   TRACE();
+
+   if(!ring->mapped)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   ring->mapped = 0;
+
+   switch(ring->method)
+   {
+      case DL_STREAM_CPU:
+         break;
+
+#if DL_STREAM_SYNC
+      case DL_STREAM_MAP:
+         glUnmapBuffer( GL_ARRAY_BUFFER );
+         break;
+#endif
+
+      default:
+         dlBindBuffer( GL_ARRAY_BUFFER, ring->object );
+         glBufferSubData( GL_ARRAY_BUFFER, ring->map_offset, ring->map_size, ring->data );
+         break;
+   }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* frame is done */
+void dlStreamEndFrame( void )
+{
+   dlStreamRing *ring = &_DL_STREAM_RING;
+   TRACE();
+
+   /* nothing written, segment can stay */
+   if(!ring->segment || !ring->head)
+      return;
+
+   dlStreamUnmap();
+   dlStreamAdvance();
+}
+
+/* ring information */
+dleStreamMethod dlStreamMethod( void )
+{
+   return( _DL_STREAM_RING.method );
+}
+
+unsigned int dlStreamObject( void )
+{
+   return( _DL_STREAM_RING.object );
+}
+
+unsigned char* dlStreamData( void )
+{
+   if(_DL_STREAM_RING.method != DL_STREAM_CPU)
+      return( NULL );
+
+   return( _DL_STREAM_RING.data );
+}
+
+unsigned int dlStreamSerial( void )
+{
+   return( _DL_STREAM_RING.serial );
+}
@@ -0,0 +1,42 @@
+#ifndef DL_STREAM_H
+#define DL_STREAM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* how data gets into the ring */
+typedef enum
+{
+   DL_STREAM_AUTO,      /* pick best supported */
+   DL_STREAM_MAP,       /* unsynchronized mapping + fences */
+   DL_STREAM_ORPHAN,    /* glBufferSubData, orphan on wrap */
+   DL_STREAM_CPU        /* system memory, drawn as client arrays */
+} dleStreamMethod;
+
+/* Init/deinit ring, initialized on first use if not called */
+int            dlStreamInit( size_t segment, dleStreamMethod method );
+int            dlStreamFree( void );
+
+/* Get writable memory for size bytes of this frame,
+ * offset is the position inside ring buffer object.
+ * Every map needs matching unmap before drawing. */
+void*          dlStreamMap( size_t size, size_t *offset );
+int            dlStreamUnmap( void );
+
+/* Retire current segment and move to next one */
+void           dlStreamEndFrame( void );
+
+/* Ring information */
+dleStreamMethod dlStreamMethod( void );
+unsigned int   dlStreamObject( void );    /* GL buffer, 0 for CPU */
+unsigned char* dlStreamData( void );      /* CPU storage or NULL */
+unsigned int   dlStreamSerial( void );    /* changes when segment changes */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_STREAM_H */
@@ -19,6 +19,7 @@
 #  include <GL/glew.h>
 #  include <GL/gl.h>
 #endif
+#include "dlGL.h"
 
 #define DL_DEBUG_CHANNEL "TEXTURE"
 
@@ -183,11 +184,22 @@ int dlTextureCreate( dlTexture *texture, unsigned char *data,
    if(texture->object)  glDeleteTextures( 1, &texture->object );
    if(texture->data)    dlFree(texture->data, texture->size);
 
+#if DL_GL_RECORD
+   /* SOIL talks to GL directly, upload through dlGL instead */
+   glGenTextures( 1, &texture->object );
+   glBindTexture( GL_TEXTURE_2D, texture->object );
+   glTexImage2D( GL_TEXTURE_2D, 0, channels, width, height, 0,
+                 channels == 4 ? GL_RGBA            :
+                 channels == 3 ? GL_RGB             :
+                 channels == 2 ? GL_LUMINANCE_ALPHA : GL_LUMINANCE,
+                 GL_UNSIGNED_BYTE, data );
+#else
    texture->object =
    SOIL_create_OGL_texture(
       data, width, height, channels,
       0,
       flags );
+#endif
 
    texture->width    = width;
    texture->height   = height;
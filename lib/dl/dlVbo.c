@@ -7,6 +7,7 @@
 #  include "dlScolor.h"
 #endif
 #include "dlVbo.h"
+#include "dlQuantize.h"
 #include "dlConfig.h"
 #include "dlCore.h"
 #include "dlLog.h"
@@ -21,10 +22,69 @@
 #if !defined(GLES1) && !defined(GLES2)
 #  include <GL/glew.h>
 #  include <GL/gl.h>
+/* driver support, checked when formats are selected */
+#  define DL_VBO_HALF_FLOAT     (GLEW_ARB_half_float_vertex || GLEW_VERSION_3_0)
+#  define DL_VBO_PACKED_NORMAL  (GLEW_ARB_vertex_type_2_10_10_10_rev || GLEW_VERSION_3_3)
+#else
+#  define DL_VBO_HALF_FLOAT     0
+#  define DL_VBO_PACKED_NORMAL  0
+#  ifndef GL_HALF_FLOAT
+#     define GL_HALF_FLOAT          0x140B
+#  endif
+#  ifndef GL_INT_2_10_10_10_REV
+#     define GL_INT_2_10_10_10_REV  0x8D9F
+#  endif
 #endif
+#include "dlGL.h"
 
 #define DL_DEBUG_CHANNEL "VBO"
 
+/* elements encoded at once when interleaving */
+#define DL_VBO_ENCODE_CHUNK 64
+
+/* encodes count elements from first to contiguous dst */
+typedef void (*dlVBOEncoder)( dlVBO *vbo, unsigned int index,
+      void *dst, unsigned int first, unsigned int count );
+
+static void dlVBOSelectFormats( dlVBO *vbo );
+
+/* last handed out layout generation */
+static unsigned int _DL_VBO_GENERATION = 0;
+
+/* bytes of system memory arrays */
+static size_t dlVBODataSize( dlVBO *vbo )
+{
+   unsigned int i;
+   size_t size;
+
+   size = (size_t)(vbo->v_num + vbo->n_num) * sizeof(kmVec3);
+   if(vbo->tstance) size += (size_t)vbo->v_num * sizeof(kmVec3);
+   if(vbo->tnormal) size += (size_t)vbo->n_num * sizeof(kmVec3);
+#if VERTEX_COLOR
+   size += (size_t)vbo->c_num * sizeof(dlColor);
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      size += (size_t)vbo->uvw[i].c_num * sizeof(kmVec2);
+
+   return( size );
+}
+
+/* copy of shared stream, ok is cleared on failure */
+static void* dlVBOCopyStream( void *data, size_t size, int *ok )
+{
+   void *copy;
+
+   if(!data)
+      return( NULL );
+
+   copy = dlCopy( data, size );
+   if(!copy) *ok = 0;
+
+   return( copy );
+}
+
 /* Allocate VBO object */
 dlVBO* dlNewVBO( void )
 {
@@ -55,12 +115,15 @@ dlVBO* dlNewVBO( void )
       vbo->uvw[i].coords  = NULL;
 
    vbo->tstance   = NULL;
+   vbo->tnormal   = NULL;
    vbo->vertices  = NULL;
    vbo->normals   = NULL;
 #if VERTEX_COLOR
    vbo->colors    = NULL;
 #endif
 
+   /* float streams until quantized */
+   dlVBOSelectFormats( vbo );
 
    LOGOK("NEW");
 
@@ -72,24 +135,39 @@ dlVBO* dlNewVBO( void )
    return( vbo );
 }
 
-/* Copy VBO object */
+/* Copy VBO object,
+ * copy shares data with src until either is modified */
 dlVBO* dlCopyVBO( dlVBO *src )
 {
-   unsigned int i = 0;
    dlVBO *vbo;
    CALL("%p", src);
 
    /* Fuuuuuuuuu--- We have non valid object */
    if(!src) { RET("%p", NULL); return( NULL ); }
 
-   /* Allocate VBO object */
+   /* upload once, copies share the GL object */
+   if(_dlCore.render.mode == DL_MODE_VBO && src->hint != GL_STREAM_DRAW)
+      dlVBOUpdate( src );
+
    dlSetAlloc( ALLOC_VBO );
-   vbo = (dlVBO*)dlCalloc( 1, sizeof(dlVBO) );
+
+   /* first copy, start counting */
+   if(!src->shared)
+   {
+      src->shared = dlCalloc( 1, sizeof(unsigned int) );
+      if(!src->shared)
+      { RET("%p", NULL); return( NULL ); }
+
+      *src->shared = 1;
+   }
+
+   /* Copy VBO object */
+   vbo = (dlVBO*)dlCopy( src, sizeof(dlVBO) );
    if(!vbo)
    { RET("%p", NULL); return( NULL ); }
 
-   /* Allocate uvws */
-   vbo->uvw = dlCalloc( _dlCore.info.maxTextureUnits, sizeof(dlUVW) );
+   /* uvws hold per VBO state */
+   vbo->uvw = dlCopy( src->uvw, _dlCore.info.maxTextureUnits * sizeof(dlUVW) );
    if(!vbo->uvw)
    {
       dlFree(vbo, sizeof(dlVBO));
@@ -98,23 +176,14 @@ dlVBO* dlCopyVBO( dlVBO *src )
       return( NULL );
    }
 
-   /* Copy data */
-   for(;i != _dlCore.info.maxTextureUnits; ++i)
-      dlCopyCoordBuffer( vbo, src, i );
-
-   dlCopyVertexBuffer( vbo, src );
-   dlCopyNormalBuffer( vbo, src );
-#if VERTEX_COLOR
-   dlCopyColorBuffer( vbo, src );
-#endif
-   if(src->tstance) dlVBOPrepareTstance( vbo );
-
-   vbo->vbo_size  = src->vbo_size;
-   vbo->hint      = src->hint;
+   /* share data */
+   ++*vbo->shared;
+   dlShareAlloc( dlVBODataSize( src ) );
 
    LOGWARN("COPY");
 
    /* Increase ref counter */
+   vbo->refCounter = 0;
    vbo->refCounter++;
 
    /* Return VBO object */
@@ -158,124 +227,1108 @@ int dlFreeVBO( dlVBO *vbo )
 
    dlSetAlloc( ALLOC_VBO );
 
+   /* data and GL object belong to the other copies */
+   if(vbo->shared && *vbo->shared > 1)
+   {
+      --*vbo->shared;
+      dlUnshareAlloc( dlVBODataSize( vbo ) );
+      dlFree( vbo->uvw, _dlCore.info.maxTextureUnits * sizeof(dlUVW) );
+
+      LOGFREE("FREE");
+
+      dlFree( vbo, sizeof(dlVBO) );
+
+      RET("%d", RETURN_OK);
+      return( RETURN_OK );
+   }
+
+   /* last one owns the data */
+   dlFree( vbo->shared, sizeof(unsigned int) );
+   vbo->shared = NULL;
+
    /* Free all data */
    i = 0;
    for(;i != _dlCore.info.maxTextureUnits; ++i)
       dlFreeCoordBuffer( vbo, i );
    dlFree( vbo->uvw, _dlCore.info.maxTextureUnits * sizeof(dlUVW) );
 
-   if(vbo->tstance) free(vbo->tstance);
-   dlFreeVertexBuffer( vbo );
-   dlFreeNormalBuffer( vbo );
+   if(vbo->tstance) free(vbo->tstance);
+   if(vbo->tnormal) free(vbo->tnormal);
+   dlFreeVertexBuffer( vbo );
+   dlFreeNormalBuffer( vbo );
+#if VERTEX_COLOR
+   dlFreeColorBuffer( vbo );
+#endif
+
+   /* delete vbo, heap pages are not ours */
+   if( vbo->in_heap ) dlHeapRelease( &vbo->range );
+   else               dlDeleteBuffer( &vbo->object );
+   vbo->object = 0;
+
+   LOGFREE("FREE");
+
+   /* Free VBO object */
+   dlFree( vbo, sizeof(dlVBO) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* detach VBO from its copies */
+int dlVBOUnshare( dlVBO *vbo )
+{
+   unsigned int i;
+   int ok = 1;
+   size_t size;
+   dlUVW *uvw;
+   kmVec3 *vertices, *normals, *tstance = NULL, *tnormal = NULL;
+#if VERTEX_COLOR
+   dlColor *colors;
+#endif
+   CALL("%p", vbo);
+
+   if(!vbo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!vbo->shared)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_VBO );
+
+   /* others are gone, data is ours */
+   if(*vbo->shared == 1)
+   {
+      dlFree( vbo->shared, sizeof(unsigned int) );
+      vbo->shared = NULL;
+
+      RET("%d", RETURN_OK);
+      return( RETURN_OK );
+   }
+
+   /* copy every stream */
+   uvw = dlCopy( vbo->uvw, _dlCore.info.maxTextureUnits * sizeof(dlUVW) );
+   if(!uvw)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      uvw[i].coords = dlVBOCopyStream( vbo->uvw[i].coords,
+                                       vbo->uvw[i].c_num * sizeof(kmVec2), &ok );
+
+   vertices = dlVBOCopyStream( vbo->vertices, vbo->v_num * sizeof(kmVec3), &ok );
+   normals  = dlVBOCopyStream( vbo->normals,  vbo->n_num * sizeof(kmVec3), &ok );
+#if VERTEX_COLOR
+   colors   = dlVBOCopyStream( vbo->colors,   vbo->c_num * sizeof(dlColor), &ok );
+#endif
+
+   /* transform buffers are plain malloc, see dlVBOPrepareTstance */
+   if(vbo->tstance)
+   {
+      tstance = malloc( vbo->v_num * sizeof(kmVec3) );
+      if(tstance) memcpy( tstance, vbo->tstance, vbo->v_num * sizeof(kmVec3) );
+      else        ok = 0;
+   }
+   if(vbo->tnormal)
+   {
+      tnormal = malloc( vbo->n_num * sizeof(kmVec3) );
+      if(tnormal) memcpy( tnormal, vbo->tnormal, vbo->n_num * sizeof(kmVec3) );
+      else        ok = 0;
+   }
+
+   if(!ok)
+   {
+      i = 0;
+      for(; i != _dlCore.info.maxTextureUnits; ++i)
+         dlFree( uvw[i].coords, uvw[i].c_num * sizeof(kmVec2) );
+      dlFree( uvw, _dlCore.info.maxTextureUnits * sizeof(dlUVW) );
+
+      dlFree( vertices, vbo->v_num * sizeof(kmVec3) );
+      dlFree( normals,  vbo->n_num * sizeof(kmVec3) );
+#if VERTEX_COLOR
+      dlFree( colors,   vbo->c_num * sizeof(dlColor) );
+#endif
+      free( tstance );
+      free( tnormal );
+
+      RET("%d", RETURN_FAIL);
+      return( RETURN_FAIL );
+   }
+
+   size = dlVBODataSize( vbo );
+   dlFree( vbo->uvw, _dlCore.info.maxTextureUnits * sizeof(dlUVW) );
+
+   vbo->uvw       = uvw;
+   vbo->vertices  = vertices;
+   vbo->normals   = normals;
+   vbo->tstance   = tstance;
+   vbo->tnormal   = tnormal;
+#if VERTEX_COLOR
+   vbo->colors    = colors;
+#endif
+
+   /* GL object stays with the others,
+    * zero size forces new storage for the buffer */
+   vbo->object     = 0;
+   vbo->in_heap    = 0;
+   vbo->streamed   = 0;
+   vbo->base       = 0;
+   vbo->vbo_size   = 0;
+   vbo->up_to_date = 0;
+   memset( &vbo->range, 0, sizeof(dlHeapRange) );
+
+   --*vbo->shared;
+   vbo->shared = NULL;
+   dlUnshareAlloc( size );
+
+   LOGINFO("UNSHARE");
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* check if streams can be interleaved,
+ * every used stream needs the same amount of vertices */
+static int dlVBOCanInterleave( dlVBO *vbo )
+{
+   unsigned int i;
+   CALL("%p", vbo);
+
+   if(!vbo->v_use)
+   { RET("%d", 0); return( 0 ); }
+
+   if(vbo->n_use && vbo->n_use != vbo->v_use)
+   { RET("%d", 0); return( 0 ); }
+
+#if VERTEX_COLOR
+   if(vbo->c_use && vbo->c_use != vbo->v_use)
+   { RET("%d", 0); return( 0 ); }
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      if(vbo->uvw[i].c_use && vbo->uvw[i].c_use != vbo->v_use)
+      { RET("%d", 0); return( 0 ); }
+
+   RET("%d", 1);
+   return( 1 );
+}
+
+/* grow dirty range to cover [first, first + count) */
+static void dlDirtyAdd( dlDirty *dirty, unsigned int first, unsigned int count )
+{
+   if(!count)
+      return;
+
+   if(dirty->start == dirty->end)
+   {
+      dirty->start = first;
+      dirty->end   = first + count;
+      return;
+   }
+
+   if(first < dirty->start)         dirty->start = first;
+   if(first + count > dirty->end)   dirty->end   = first + count;
+}
+
+/* clamp dirty range to used elements,
+ * returns 0 when there is nothing to upload */
+static int dlDirtyClamp( dlDirty *dirty, unsigned int use )
+{
+   if(dirty->end > use) dirty->end = use;
+   return( dirty->start < dirty->end );
+}
+
+/* forget all dirty ranges */
+static void dlVBOClearDirty( dlVBO *vbo )
+{
+   unsigned int i;
+
+   vbo->v_dirty.start = vbo->v_dirty.end = 0;
+   vbo->n_dirty.start = vbo->n_dirty.end = 0;
+#if VERTEX_COLOR
+   vbo->c_dirty.start = vbo->c_dirty.end = 0;
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      vbo->uvw[i].dirty.start = vbo->uvw[i].dirty.end = 0;
+}
+
+/* store offset, remember if it changed */
+static void dlVBOSetOffset( size_t *dst, size_t value, int *changed )
+{
+   if(*dst == value)
+      return;
+
+   *dst     = value;
+   *changed = 1;
+}
+
+/* pick GL formats of streams from quantize flags */
+static void dlVBOSelectFormats( dlVBO *vbo )
+{
+   unsigned int i, flags = vbo->quantize;
+
+   /* client arrays are drawn straight from float data */
+   if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+      flags = DL_VBO_QUANTIZE_NONE;
+
+   /* positions, padded to 4 components for alignment */
+   vbo->vType = GL_FLOAT;
+   vbo->vSize = 3 * sizeof(float);
+   if((flags & DL_VBO_QUANTIZE_HALF) && DL_VBO_HALF_FLOAT)
+   {
+      vbo->vType = GL_HALF_FLOAT;
+      vbo->vSize = 4 * sizeof(uint16_t);
+   }
+   else if(flags & (DL_VBO_QUANTIZE_HALF | DL_VBO_QUANTIZE_POSITION))
+   {
+      vbo->vType = GL_SHORT;
+      vbo->vSize = 4 * sizeof(int16_t);
+   }
+
+   /* normals */
+   vbo->nType = GL_FLOAT;
+   vbo->nSize = 3 * sizeof(float);
+   if(flags & DL_VBO_QUANTIZE_NORMAL)
+   {
+      vbo->nType = DL_VBO_PACKED_NORMAL ? GL_INT_2_10_10_10_REV : GL_BYTE;
+      vbo->nSize = 4 * sizeof(int8_t);
+   }
+
+   /* coords */
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+   {
+      vbo->uvw[i].cType = GL_FLOAT;
+      vbo->uvw[i].cSize = 2 * sizeof(float);
+      if(flags & DL_VBO_QUANTIZE_COORD)
+      {
+         vbo->uvw[i].cType = GL_SHORT;
+         vbo->uvw[i].cSize = 2 * sizeof(int16_t);
+      }
+   }
+}
+
+/* store decode range, remember if it changed */
+static void dlVBOSetRange( float *dst, const float *value, size_t n, int *changed )
+{
+   if(!memcmp( dst, value, n * sizeof(float) ))
+      return;
+
+   memcpy( dst, value, n * sizeof(float) );
+   *changed = 1;
+}
+
+/* compute decode scale and bias of quantized streams,
+ * returns 1 if they changed and every element needs encoding again */
+static int dlVBOQuantizeRange( dlVBO *vbo )
+{
+   unsigned int i;
+   kmVec3 scale3 = { 1, 1, 1 }, bias3 = { 0, 0, 0 };
+   kmVec2 scale2, bias2;
+   int changed = 0;
+   CALL("%p", vbo);
+
+   if(vbo->vType == GL_SHORT)
+      dlQuantizePositionRange( vbo->vertices, vbo->v_use, &scale3, &bias3 );
+
+   dlVBOSetRange( &vbo->qScale.x, &scale3.x, 3, &changed );
+   dlVBOSetRange( &vbo->qBias.x,  &bias3.x,  3, &changed );
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+   {
+      scale2.x = scale2.y = 1;
+      bias2.x  = bias2.y  = 0;
+      if(vbo->uvw[i].cType == GL_SHORT)
+         dlQuantizeCoordRange( vbo->uvw[i].coords, vbo->uvw[i].c_use, &scale2, &bias2 );
+
+      dlVBOSetRange( &vbo->uvw[i].qScale.x, &scale2.x, 2, &changed );
+      dlVBOSetRange( &vbo->uvw[i].qBias.x,  &bias2.x,  2, &changed );
+   }
+
+   RET("%d", changed);
+   return( changed );
+}
+
+/* stream encoders */
+static void dlVBOEncodeVertices( dlVBO *vbo, unsigned int index,
+      void *dst, unsigned int first, unsigned int count )
+{
+   switch(vbo->vType)
+   {
+      case GL_HALF_FLOAT:
+         dlQuantizePositionsHalf( &vbo->vertices[first], dst, count );
+         break;
+      case GL_SHORT:
+         dlQuantizePositions( &vbo->vertices[first], dst, count, &vbo->qScale, &vbo->qBias );
+         break;
+      default:
+         memcpy( dst, &vbo->vertices[first], count * sizeof(kmVec3) );
+         break;
+   }
+}
+
+static void dlVBOEncodeNormals( dlVBO *vbo, unsigned int index,
+      void *dst, unsigned int first, unsigned int count )
+{
+   switch(vbo->nType)
+   {
+      case GL_INT_2_10_10_10_REV:
+         dlQuantizeNormals( &vbo->normals[first], dst, count );
+         break;
+      case GL_BYTE:
+         dlQuantizeNormalsByte( &vbo->normals[first], dst, count );
+         break;
+      default:
+         memcpy( dst, &vbo->normals[first], count * sizeof(kmVec3) );
+         break;
+   }
+}
+
+static void dlVBOEncodeCoords( dlVBO *vbo, unsigned int index,
+      void *dst, unsigned int first, unsigned int count )
+{
+   dlUVW *uvw = &vbo->uvw[index];
+
+   if(uvw->cType == GL_SHORT)
+      dlQuantizeCoords( &uvw->coords[first], dst, count, &uvw->qScale, &uvw->qBias );
+   else
+      memcpy( dst, &uvw->coords[first], count * sizeof(kmVec2) );
+}
+
+#if VERTEX_COLOR
+static void dlVBOEncodeColors( dlVBO *vbo, unsigned int index,
+      void *dst, unsigned int first, unsigned int count )
+{
+   memcpy( dst, &vbo->colors[first], count * sizeof(dlColor) );
+}
+#endif
+
+/* lay streams out as seperate blocks,
+ * returns 1 if the buffer layout changed */
+static int dlVBOLayoutPlanar( dlVBO *vbo )
+{
+   unsigned int i;
+   size_t vboOffset = 0;
+   int changed = 0;
+   CALL("%p", vbo);
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+   {
+      dlVBOSetOffset( &vbo->uvw[i].cOffset, vboOffset, &changed );
+      vboOffset += vbo->uvw[i].c_use * vbo->uvw[i].cSize;
+   }
+
+   dlVBOSetOffset( &vbo->vOffset, vboOffset, &changed );
+   vboOffset += vbo->v_use * vbo->vSize;
+
+   dlVBOSetOffset( &vbo->nOffset, vboOffset, &changed );
+   vboOffset += vbo->n_use * vbo->nSize;
+
+#if VERTEX_COLOR
+   dlVBOSetOffset( &vbo->cOffset, vboOffset, &changed );
+   vboOffset += vbo->c_use * 4 * sizeof(uint8_t);
+#endif
+
+   dlVBOSetOffset( &vbo->stride,   0,         &changed );
+   dlVBOSetOffset( &vbo->vbo_size, vboOffset, &changed );
+
+   RET("%d", changed);
+   return( changed );
+}
+
+/* lay streams out interleaved,
+ * one vertex = [vertex][normal][uvw0..n][color]
+ * returns 1 if the buffer layout changed */
+static int dlVBOLayoutInterleaved( dlVBO *vbo )
+{
+   unsigned int i;
+   size_t stride = 0;
+   int changed = 0;
+   CALL("%p", vbo);
+
+   /* offsets inside one vertex */
+   dlVBOSetOffset( &vbo->vOffset, stride, &changed );
+   stride += vbo->vSize;
+
+   dlVBOSetOffset( &vbo->nOffset, stride, &changed );
+   if(vbo->n_use) stride += vbo->nSize;
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+   {
+      dlVBOSetOffset( &vbo->uvw[i].cOffset, stride, &changed );
+      if(vbo->uvw[i].c_use) stride += vbo->uvw[i].cSize;
+   }
+
+#if VERTEX_COLOR
+   dlVBOSetOffset( &vbo->cOffset, stride, &changed );
+   if(vbo->c_use) stride += 4 * sizeof(uint8_t);
+#endif
+
+   dlVBOSetOffset( &vbo->stride,   stride,              &changed );
+   dlVBOSetOffset( &vbo->vbo_size, vbo->v_use * stride, &changed );
+
+   RET("%d", changed);
+   return( changed );
+}
+
+/* encode count elements and copy them size bytes at a time to every stride bytes */
+static void dlVBOScatter( dlVBO *vbo, dlVBOEncoder encode, unsigned int index,
+      unsigned char *dst, unsigned int first, unsigned int count, size_t size )
+{
+   unsigned int i;
+   unsigned char tmp[DL_VBO_ENCODE_CHUNK * sizeof(kmVec3)];
+
+   encode( vbo, index, tmp, first, count );
+
+   i = 0;
+   for(; i != count; ++i, dst += vbo->stride)
+      memcpy( dst, tmp + i * size, size );
+}
+
+/* write vertices [first, last) interleaved to dst */
+static void dlVBOInterleave( dlVBO *vbo, unsigned char *dst,
+      unsigned int first, unsigned int last )
+{
+   unsigned int i, v, count;
+
+   v = first;
+   for(; v != last; v += count, dst += count * vbo->stride)
+   {
+      count = last - v;
+      if(count > DL_VBO_ENCODE_CHUNK) count = DL_VBO_ENCODE_CHUNK;
+
+      dlVBOScatter( vbo, dlVBOEncodeVertices, 0, dst + vbo->vOffset, v, count, vbo->vSize );
+      if(vbo->n_use)
+         dlVBOScatter( vbo, dlVBOEncodeNormals, 0, dst + vbo->nOffset, v, count, vbo->nSize );
+
+      i = 0;
+      for(; i != _dlCore.info.maxTextureUnits; ++i)
+         if(vbo->uvw[i].c_use)
+            dlVBOScatter( vbo, dlVBOEncodeCoords, i, dst + vbo->uvw[i].cOffset,
+                          v, count, vbo->uvw[i].cSize );
+
+#if VERTEX_COLOR
+      if(vbo->c_use)
+         dlVBOScatter( vbo, dlVBOEncodeColors, 0, dst + vbo->cOffset, v, count, sizeof(dlColor) );
+#endif
+   }
+}
+
+/* write every planar stream to dst */
+static void dlVBOWritePlanar( dlVBO *vbo, unsigned char *dst )
+{
+   unsigned int i;
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      if(vbo->uvw[i].c_use)
+         dlVBOEncodeCoords( vbo, i, dst + vbo->uvw[i].cOffset, 0, vbo->uvw[i].c_use );
+
+   if(vbo->v_use)
+      dlVBOEncodeVertices( vbo, 0, dst + vbo->vOffset, 0, vbo->v_use );
+   if(vbo->n_use)
+      dlVBOEncodeNormals( vbo, 0, dst + vbo->nOffset, 0, vbo->n_use );
+#if VERTEX_COLOR
+   if(vbo->c_use)
+      dlVBOEncodeColors( vbo, 0, dst + vbo->cOffset, 0, vbo->c_use );
+#endif
+}
+
+/* upload range of one planar stream,
+ * float streams go straight from CPU array, quantized ones through temporary memory */
+static int dlVBOUploadRange( dlVBO *vbo, dlVBOEncoder encode, unsigned int index,
+      const void *raw, size_t offset, size_t size, dlDirty *range )
+{
+   void *data;
+   size_t bytes;
+
+   offset = vbo->base + offset + range->start * size;
+   bytes  = (range->end - range->start) * size;
+
+   if(raw)
+   {
+      glBufferSubData( GL_ARRAY_BUFFER, offset, bytes, raw );
+      return( RETURN_OK );
+   }
+
+   dlSetAlloc( ALLOC_VBO );
+   if(!(data = dlMalloc( bytes )))
+      return( RETURN_FAIL );
+
+   encode( vbo, index, data, range->start, range->end - range->start );
+   glBufferSubData( GL_ARRAY_BUFFER, offset, bytes, data );
+
+   dlSetAlloc( ALLOC_VBO );
+   dlFree( data, bytes );
+
+   return( RETURN_OK );
+}
+
+/* upload planar streams,
+ * full uploads every used element, otherwise only dirty ranges */
+static int dlVBOUploadPlanar( dlVBO *vbo, int full )
+{
+   unsigned int i;
+   int ret = RETURN_OK;
+   dlDirty range;
+   CALL("%p, %d", vbo, full);
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+   {
+      range = vbo->uvw[i].dirty;
+      if(full) { range.start = 0; range.end = vbo->uvw[i].c_use; }
+      if(dlDirtyClamp( &range, vbo->uvw[i].c_use ))
+         ret |= dlVBOUploadRange( vbo, dlVBOEncodeCoords, i,
+               vbo->uvw[i].cType == GL_FLOAT ? &vbo->uvw[i].coords[range.start] : NULL,
+               vbo->uvw[i].cOffset, vbo->uvw[i].cSize, &range );
+   }
+
+   /* buffer vertices */
+   range = vbo->v_dirty;
+   if(full) { range.start = 0; range.end = vbo->v_use; }
+   if(dlDirtyClamp( &range, vbo->v_use ))
+      ret |= dlVBOUploadRange( vbo, dlVBOEncodeVertices, 0,
+            vbo->vType == GL_FLOAT ? &vbo->vertices[range.start] : NULL,
+            vbo->vOffset, vbo->vSize, &range );
+
+   /* buffer normals */
+   range = vbo->n_dirty;
+   if(full) { range.start = 0; range.end = vbo->n_use; }
+   if(dlDirtyClamp( &range, vbo->n_use ))
+      ret |= dlVBOUploadRange( vbo, dlVBOEncodeNormals, 0,
+            vbo->nType == GL_FLOAT ? &vbo->normals[range.start] : NULL,
+            vbo->nOffset, vbo->nSize, &range );
+
+   /* buffer colors */
+#if VERTEX_COLOR
+   range = vbo->c_dirty;
+   if(full) { range.start = 0; range.end = vbo->c_use; }
+   if(dlDirtyClamp( &range, vbo->c_use ))
+      ret |= dlVBOUploadRange( vbo, dlVBOEncodeColors, 0, &vbo->colors[range.start],
+            vbo->cOffset, sizeof(dlColor), &range );
+#endif
+
+   if(ret != RETURN_OK)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* upload interleaved vertices,
+ * full uploads every vertex, otherwise union of dirty ranges */
+static int dlVBOUploadInterleaved( dlVBO *vbo, int full )
+{
+   unsigned int i;
+   dlDirty range = { 0, 0 };
+   unsigned char *data;
+   size_t bytes;
+   CALL("%p, %d", vbo, full);
+
+   if(full)
+      range.end = vbo->v_use;
+   else
+   {
+      dlDirtyAdd( &range, vbo->v_dirty.start, vbo->v_dirty.end - vbo->v_dirty.start );
+      dlDirtyAdd( &range, vbo->n_dirty.start, vbo->n_dirty.end - vbo->n_dirty.start );
+#if VERTEX_COLOR
+      dlDirtyAdd( &range, vbo->c_dirty.start, vbo->c_dirty.end - vbo->c_dirty.start );
+#endif
+      i = 0;
+      for(; i != _dlCore.info.maxTextureUnits; ++i)
+         dlDirtyAdd( &range, vbo->uvw[i].dirty.start,
+                     vbo->uvw[i].dirty.end - vbo->uvw[i].dirty.start );
+   }
+
+   if(!dlDirtyClamp( &range, vbo->v_use ))
+   { RET("%d", RETURN_OK); return( RETURN_OK ); }
+
+   /* temporary interleaved copy */
+   bytes = (range.end - range.start) * vbo->stride;
+   dlSetAlloc( ALLOC_VBO );
+   if(!(data = dlMalloc( bytes )))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlVBOInterleave( vbo, data, range.start, range.end );
+
+   glBufferSubData(GL_ARRAY_BUFFER, vbo->base + range.start * vbo->stride,
+         bytes, data);
+
+   dlSetAlloc( ALLOC_VBO );
+   dlFree( data, bytes );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* check if any stream has dirty range */
+static int dlVBOHasDirty( dlVBO *vbo )
+{
+   unsigned int i;
+
+   if(vbo->v_dirty.start != vbo->v_dirty.end) return( 1 );
+   if(vbo->n_dirty.start != vbo->n_dirty.end) return( 1 );
+#if VERTEX_COLOR
+   if(vbo->c_dirty.start != vbo->c_dirty.end) return( 1 );
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      if(vbo->uvw[i].dirty.start != vbo->uvw[i].dirty.end) return( 1 );
+
+   return( 0 );
+}
+
+/* write whole vbo to this frame's stream segment */
+static int dlVBOUpdateStream( dlVBO *vbo, int interleave )
+{
+   unsigned char *dst;
+   size_t offset = 0;
+   CALL("%p, %d", vbo, interleave);
+
+   dlVBOQuantizeRange( vbo );
+   if(interleave) dlVBOLayoutInterleaved( vbo );
+   else           dlVBOLayoutPlanar( vbo );
+
+   if(vbo->vbo_size)
+   {
+      dst = dlStreamMap( vbo->vbo_size, &offset );
+      if(!dst)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      if(interleave) dlVBOInterleave( vbo, dst, 0, vbo->v_use );
+      else           dlVBOWritePlanar( vbo, dst );
+
+      dlStreamUnmap();
+   }
+
+   vbo->streamed = 1;
+   vbo->base     = offset;
+   vbo->serial   = dlStreamSerial();
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* update vbo */
+int dlVBOUpdate( dlVBO* vbo )
+{
+   int ret, interleave, resized, requantized, full;
+   CALL("%p", vbo);
+
+   if(!vbo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   /* streamed data expires when ring moves to next segment */
+   if(vbo->streamed && vbo->serial != dlStreamSerial())
+      vbo->up_to_date = 0;
+
+   /* already up to date */
+   if(vbo->up_to_date)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   /* formats of GL side streams */
+   dlVBOSelectFormats( vbo );
+
+   /* interleave only when streams match */
+   interleave = 0;
+   if(vbo->layout == DL_VBO_INTERLEAVED)
+   {
+      interleave = dlVBOCanInterleave( vbo );
+      if(!interleave)
+      { LOGWARN("Streams differ in size, using planar layout"); }
+   }
+
+   /* dynamic data goes to stream ring,
+    * falls back to own buffer if it does not fit */
+   if(vbo->hint == GL_STREAM_DRAW && _dlCore.render.mode == DL_MODE_VBO)
+   {
+      if(dlVBOUpdateStream( vbo, interleave ) == RETURN_OK)
+      {
+         dlVBOClearDirty( vbo );
+         vbo->up_to_date = 1;
+
+         RET("%d", RETURN_OK);
+         return( RETURN_OK );
+      }
+   }
+
+   /* copies share GL object, its storage can't change under them */
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!vbo->object && !vbo->in_heap)
+      return( dlVBOConstruct( vbo ) );
+
+   /* reallocate only when layout of buffer changes,
+    * modifications without range upload everything */
+   resized = interleave ? dlVBOLayoutInterleaved( vbo ) : dlVBOLayoutPlanar( vbo );
+   if(vbo->streamed)
+   {
+      /* own buffer was not kept in sync while streaming */
+      vbo->streamed = 0;
+      vbo->base     = 0;
+      resized       = 1;
+   }
+   /* new decode range invalidates every quantized element */
+   requantized = dlVBOQuantizeRange( vbo );
+   full        = resized || requantized || !dlVBOHasDirty( vbo );
+
+   /* new range from heap */
+   if(vbo->in_heap && resized)
+   {
+      dlHeapRelease( &vbo->range );
+      if(dlHeapAlloc( DL_HEAP_VERTEX, vbo->vbo_size, &vbo->range ) == RETURN_OK)
+      {
+         vbo->object = vbo->range.object;
+         vbo->base   = vbo->range.offset;
+      }
+      else
+      {
+         /* heap is full, use own buffer */
+         LOGWARN("Geometry heap full, using own buffer");
+         vbo->in_heap = 0;
+         vbo->object  = 0;
+         vbo->base    = 0;
+
+         glGenBuffers(1, &vbo->object );
+         if(!vbo->object)
+         { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+      }
+   }
+
+   /* pointers set up against old layout are stale */
+   if(resized || requantized)
+      vbo->generation = ++_DL_VBO_GENERATION;
+
+   /* empty heap vbo has nothing to upload */
+   if(!vbo->object)
+   {
+      dlVBOClearDirty( vbo );
+      vbo->up_to_date = 1;
+
+      RET("%d", RETURN_OK);
+      return( RETURN_OK );
+   }
+
+   /* bind buffer */
+   dlBindBuffer(GL_ARRAY_BUFFER, vbo->object);
+
+   if(resized && !vbo->in_heap)
+      glBufferData(GL_ARRAY_BUFFER, vbo->vbo_size, NULL, vbo->hint);
+
+   if(interleave)
+      ret = dlVBOUploadInterleaved( vbo, full );
+   else
+      ret = dlVBOUploadPlanar( vbo, full );
+
+   if(ret != RETURN_OK)
+   { RET("%d", ret); return( ret ); }
+
+   /* mark as up to date */
+   dlVBOClearDirty( vbo );
+   vbo->up_to_date = 1;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* set storage layout of vbo */
+int dlVBOSetLayout( dlVBO *vbo, dleVBOLayout layout )
+{
+   CALL("%p, %d", vbo, layout);
+
+   if(!vbo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(vbo->layout == layout)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   vbo->layout = layout;
+
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* set quantization flags of vbo, see dleVBOQuantize */
+int dlVBOSetQuantize( dlVBO *vbo, unsigned int flags )
+{
+   CALL("%p, %u", vbo, flags);
+
+   if(!vbo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(vbo->quantize == flags)
+   { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   vbo->quantize = flags;
+
+   /* Mark VBO outdated,
+    * zero size forces new storage for the buffer */
+   vbo->up_to_date = 0;
+   vbo->vbo_size   = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* move elements of stream to remapped positions through tmp */
+static void dlVBOPermute( void *data, unsigned int use, size_t size,
+      const unsigned int *remap, unsigned char *tmp )
+{
+   unsigned int i;
+
+   if(!data || !use)
+      return;
+
+   i = 0;
+   for(; i != use; ++i)
+      memcpy( tmp + remap[i] * size, (unsigned char*)data + i * size, size );
+
+   memcpy( data, tmp, use * size );
+}
+
+/* bytes of stream, if it is larger than bytes */
+static size_t dlVBOLargerStream( size_t bytes, const void *data, unsigned int use, size_t size )
+{
+   if(!data || use * size <= bytes)
+      return( bytes );
+
+   return( use * size );
+}
+
+/* reorder vertices,
+ * every used stream needs the same amount of vertices */
+int dlVBORemap( dlVBO *vbo, const unsigned int *remap )
+{
+   unsigned int  i;
+   size_t        bytes;
+   unsigned char *tmp = NULL;
+   CALL("%p, %p", vbo, remap);
+
+   if(!vbo || !remap)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!dlVBOCanInterleave( vbo ))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   /* one scratch for every stream,
+    * nothing is moved if it can't be had */
+   bytes = dlVBOLargerStream( 0,     vbo->vertices, vbo->v_use, sizeof(kmVec3) );
+   bytes = dlVBOLargerStream( bytes, vbo->normals,  vbo->n_use, sizeof(kmVec3) );
+   bytes = dlVBOLargerStream( bytes, vbo->tstance,  vbo->v_use, sizeof(kmVec3) );
+   bytes = dlVBOLargerStream( bytes, vbo->tnormal,  vbo->n_use, sizeof(kmVec3) );
+#if VERTEX_COLOR
+   bytes = dlVBOLargerStream( bytes, vbo->colors,   vbo->c_use, sizeof(dlColor) );
+#endif
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      bytes = dlVBOLargerStream( bytes, vbo->uvw[i].coords, vbo->uvw[i].c_use, sizeof(kmVec2) );
+
+   dlSetAlloc( ALLOC_VBO );
+   if(bytes && !(tmp = dlMalloc( bytes )))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlVBOPermute( vbo->vertices, vbo->v_use, sizeof(kmVec3), remap, tmp );
+   dlVBOPermute( vbo->normals,  vbo->n_use, sizeof(kmVec3), remap, tmp );
+   dlVBOPermute( vbo->tstance,  vbo->v_use, sizeof(kmVec3), remap, tmp );
+   dlVBOPermute( vbo->tnormal,  vbo->n_use, sizeof(kmVec3), remap, tmp );
+#if VERTEX_COLOR
+   dlVBOPermute( vbo->colors,   vbo->c_use, sizeof(dlColor), remap, tmp );
+#endif
+
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+      dlVBOPermute( vbo->uvw[i].coords, vbo->uvw[i].c_use, sizeof(kmVec2), remap, tmp );
+
+   dlSetAlloc( ALLOC_VBO );
+   dlFree( tmp, bytes );
+
+   /* Mark VBO outdated,
+    * every element moved so no dirty range means full upload */
+   dlVBOClearDirty( vbo );
+   vbo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* move first element of each new index down */
+static void dlVBOCompactStream( void *data, unsigned int use, size_t size,
+      const unsigned int *remap )
+{
+   unsigned int i, next = 0;
+
+   if(!data)
+      return;
+
+   i = 0;
+   for(; i != use; ++i)
+   {
+      if(remap[i] != next)
+         continue;
+
+      if(i != next)
+         memcpy( (unsigned char*)data + next * size, (unsigned char*)data + i * size, size );
+      next++;
+   }
+}
+
+/* merge welded vertices,
+ * every used stream needs the same amount of vertices */
+int dlVBOCompact( dlVBO *vbo, const unsigned int *remap, unsigned int vertices )
+{
+   unsigned int i;
+   CALL("%p, %p, %u", vbo, remap, vertices);
+
+   if(!vbo || !remap || vertices > vbo->v_use)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!dlVBOCanInterleave( vbo ))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlVBOCompactStream( vbo->vertices, vbo->v_use, sizeof(kmVec3), remap );
+   dlVBOCompactStream( vbo->tstance,  vbo->v_use, sizeof(kmVec3), remap );
+   vbo->v_use = vertices;
+
+   if(vbo->n_use)
+   {
+      dlVBOCompactStream( vbo->normals, vbo->n_use, sizeof(kmVec3), remap );
+      dlVBOCompactStream( vbo->tnormal, vbo->n_use, sizeof(kmVec3), remap );
+      vbo->n_use = vertices;
+   }
+
 #if VERTEX_COLOR
-   dlFreeColorBuffer( vbo );
+   if(vbo->c_use)
+   {
+      dlVBOCompactStream( vbo->colors, vbo->c_use, sizeof(dlColor), remap );
+      vbo->c_use = vertices;
+   }
 #endif
 
-   /* delete vbo */
-   if( vbo->object ) glDeleteBuffers(1, &vbo->object);
-   vbo->object = 0;
+   i = 0;
+   for(; i != _dlCore.info.maxTextureUnits; ++i)
+   {
+      if(!vbo->uvw[i].c_use)
+         continue;
 
-   LOGFREE("FREE");
+      dlVBOCompactStream( vbo->uvw[i].coords, vbo->uvw[i].c_use, sizeof(kmVec2), remap );
+      vbo->uvw[i].c_use = vertices;
+   }
 
-   /* Free VBO object */
-   dlFree( vbo, sizeof(dlVBO) );
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
 }
 
-/* update vbo */
-int dlVBOUpdate( dlVBO* vbo )
+/* mark vertices modified */
+int dlVBOModifiedVertices( dlVBO *vbo, unsigned int first, unsigned int count )
 {
-   unsigned int i;
-   size_t vboOffset = 0, vboSize = 0;
-   size_t tmp;
-   CALL("%p", vbo);
+   CALL("%p, %u, %u", vbo, first, count);
 
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   if(!vbo->object)
-      return( dlVBOConstruct( vbo ) );
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   /* already up to date */
-   if(vbo->up_to_date)
+   dlDirtyAdd( &vbo->v_dirty, first, count );
+
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* mark normals modified */
+int dlVBOModifiedNormals( dlVBO *vbo, unsigned int first, unsigned int count )
+{
+   CALL("%p, %u, %u", vbo, first, count);
+
+   if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   /* bind buffer */
-   glBindBuffer(GL_ARRAY_BUFFER, vbo->object);
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   /* calculate total size of vbo */
-   i = 0;
-   for(;i !=  _dlCore.info.maxTextureUnits; ++i)
-      if(vbo->uvw[i].c_use)
-         vboSize += vbo->uvw[i].c_use * 2 * sizeof(float);
+   dlDirtyAdd( &vbo->n_dirty, first, count );
 
-   if(vbo->v_use)
-      vboSize += vbo->v_use * 3 * sizeof(float);
-   if(vbo->n_use)
-      vboSize += vbo->n_use * 3 * sizeof(float);
-#if VERTEX_COLOR
-   if(vbo->c_use)
-      vboSize += vbo->c_use * 4 * sizeof(uint8_t);
-#endif
-   vbo->vbo_size = vboSize;
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
 
-   /* make VBO total size */
-   glBufferData(GL_ARRAY_BUFFER, vbo->vbo_size, NULL, vbo->hint);
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
 
-   /* buffer data to the VBO */
-   i = 0;
-   for(; i != _dlCore.info.maxTextureUnits; ++i)
-   {
-      if(vbo->uvw[i].c_use)
-      {
-         vbo->uvw[i].cOffset = vboOffset;
-         tmp = vbo->uvw[i].c_use * 2 * sizeof(float);
+/* mark coords modified */
+int dlVBOModifiedCoords( dlVBO *vbo, unsigned int index,
+      unsigned int first, unsigned int count )
+{
+   CALL("%p, %u, %u, %u", vbo, index, first, count);
 
-         if(vbo->uvw[i].c_use)
-            glBufferSubData(GL_ARRAY_BUFFER, vboOffset, tmp, &vbo->uvw[i].coords[0]);
+   if(!vbo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-         vboOffset += tmp;
-      }
-   }
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   /* buffer vertices */
-   vbo->vOffset = vboOffset;
-   if(vbo->v_use)
-   {
-      tmp = vbo->v_use * 3 * sizeof(float);
+   if(index >= _dlCore.info.maxTextureUnits)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-      glBufferSubData(GL_ARRAY_BUFFER, vboOffset, tmp, &vbo->vertices[0]);
-      vboOffset += tmp;
-   }
+   dlDirtyAdd( &vbo->uvw[index].dirty, first, count );
 
-   /* buffer normals */
-   vbo->nOffset = vboOffset;
-   if(vbo->n_use)
-   {
-      tmp = vbo->n_use * 3 * sizeof(float);
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
 
-      glBufferSubData(GL_ARRAY_BUFFER, vboOffset, tmp, &vbo->normals[0]);
-      vboOffset += tmp;
-   }
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
 
-   /* buffer colors */
 #if VERTEX_COLOR
-   vbo->cOffset = vboOffset;
-   if(vbo->c_use)
-   {
-      glBufferSubData(GL_ARRAY_BUFFER, vboOffset, vbo->ce * 4 * sizeof(uint8_t), &vbo->colors[0]);
-   }
-#endif
-   glBindBuffer(GL_ARRAY_BUFFER, 0);
+/* mark colors modified */
+int dlVBOModifiedColors( dlVBO *vbo, unsigned int first, unsigned int count )
+{
+   CALL("%p, %u, %u", vbo, first, count);
 
-   /* mark as up to date */
-   vbo->up_to_date = 1;
+   if(!vbo)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlDirtyAdd( &vbo->c_dirty, first, count );
+
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
 }
+#endif
 
 /* construct new VBO data */
 int dlVBOConstruct( dlVBO* vbo )
@@ -291,17 +1344,30 @@ int dlVBOConstruct( dlVBO* vbo )
    if(vbo->object)
    { RET("%d", RETURN_OK); return( RETURN_OK ); }
 
-   /* generate VBO */
-   glGenBuffers(1, &vbo->object );
-   if(!vbo->object)
+   /* new GL object would not be shared with copies */
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   /* this vbo isn't up to date */
+   /* suballocate from heap, or generate VBO */
+   if(dlHeapEnabled() && vbo->hint != GL_STREAM_DRAW)
+      vbo->in_heap = 1;
+   else
+   {
+      glGenBuffers(1, &vbo->object );
+      if(!vbo->object)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   }
+
+   /* this vbo isn't up to date,
+    * zero size forces new storage for the buffer */
    vbo->up_to_date = 0;
+   vbo->vbo_size   = 0;
    if(dlVBOUpdate( vbo ) != RETURN_OK)
    {
-      glDeleteBuffers(1, &vbo->object);
-      vbo->object = 0;
+      if( vbo->in_heap ) dlHeapRelease( &vbo->range );
+      else               dlDeleteBuffer( &vbo->object );
+      vbo->object  = 0;
+      vbo->in_heap = 0;
 
       RET("%d", RETURN_FAIL);
       return( RETURN_FAIL );
@@ -319,6 +1385,9 @@ int dlVBOPrepareTstance( dlVBO *vbo )
 
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
    if(!vbo->vertices)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
@@ -334,10 +1403,48 @@ int dlVBOPrepareTstance( dlVBO *vbo )
    memcpy( vbo->tstance, vbo->vertices,
          vbo->v_num * sizeof(kmVec3) );
 
+   /* normals are skinned too */
+   if(vbo->tnormal)
+      free( vbo->tnormal );
+   vbo->tnormal = NULL;
+
+   if(vbo->normals && vbo->n_num)
+   {
+      vbo->tnormal = malloc( vbo->n_num * sizeof(kmVec3) );
+      if(!vbo->tnormal)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      memcpy( vbo->tnormal, vbo->normals,
+            vbo->n_num * sizeof(kmVec3) );
+   }
+
    RET("%d", RETURN_OK);
    return( RETURN_OK );
 }
 
+/* make sure stream has room for need items.
+ * capacity grows geometrically, num is updated on success */
+static void* dlVBOReserve( void *ptr, unsigned int *num, unsigned int need, size_t size )
+{
+   unsigned int capacity;
+   CALL("%p, %u, %u, %llu", ptr, *num, need, size);
+
+   if(ptr && need <= *num)
+   { RET("%p", ptr); return( ptr ); }
+
+   capacity = dlGrowCapacity( *num, need );
+   if(ptr)
+      ptr = dlRealloc( ptr, *num, capacity, size );
+   else
+      ptr = dlCalloc( capacity, size );
+
+   if(ptr)
+      *num = capacity;
+
+   RET("%p", ptr);
+   return( ptr );
+}
+
 /* vertices */
 int dlCopyVertexBuffer( dlVBO *vbo, dlVBO *src )
 {
@@ -346,6 +1453,9 @@ int dlCopyVertexBuffer( dlVBO *vbo, dlVBO *src )
    if(!vbo || !src)
    { RET("%d", RETURN_FAIL); return(RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    vbo->vertices  = dlCopy( src->vertices, src->v_num * sizeof(kmVec3) );
@@ -366,6 +1476,9 @@ int dlFreeVertexBuffer( dlVBO *vbo )
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    dlFree( vbo->vertices, sizeof(kmVec3) * vbo->v_num );
@@ -387,6 +1500,9 @@ int dlResetVertexBuffer( dlVBO *vbo, unsigned int vertices )
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    if(vbo->vertices)
@@ -420,26 +1536,50 @@ int dlInsertVertex( dlVBO *vbo,
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    if(!vbo->vertices)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
    dlSetAlloc( ALLOC_VBO );
 
-   ++vbo->v_use;
-   if(vbo->v_use > vbo->v_num)
-   {
-      /* Maybe make it realloc more vertices? Or just hope ppl
-       * use the reset function above */
-      vbo->vertices = dlRealloc(vbo->vertices, vbo->v_num, vbo->v_use, sizeof(kmVec3));
-      if(!vbo->vertices)
-      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
-
-      vbo->v_num = vbo->v_use;
-   }
+   vbo->vertices = dlVBOReserve( vbo->vertices, &vbo->v_num, vbo->v_use + 1, sizeof(kmVec3) );
+   if(!vbo->vertices)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
    /* Assign vertex */
    vertex.x = x; vertex.y = y; vertex.z = z;
-   vbo->vertices[ vbo->v_use - 1 ] = vertex;
+   dlDirtyAdd( &vbo->v_dirty, vbo->v_use, 1 );
+   vbo->vertices[ vbo->v_use++ ] = vertex;
+
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* insert n vertices in one go */
+int dlInsertVertices( dlVBO *vbo, const kmVec3 *vertices, unsigned int n )
+{
+   CALL("%p, %p, %u", vbo, vertices, n);
+
+   if(!vbo || !vertices)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlSetAlloc( ALLOC_VBO );
+
+   vbo->vertices = dlVBOReserve( vbo->vertices, &vbo->v_num, vbo->v_use + n, sizeof(kmVec3) );
+   if(!vbo->vertices)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memcpy( &vbo->vertices[ vbo->v_use ], vertices, n * sizeof(kmVec3) );
+   dlDirtyAdd( &vbo->v_dirty, vbo->v_use, n );
+   vbo->v_use += n;
 
    /* Mark VBO outdated */
    vbo->up_to_date = 0;
@@ -456,6 +1596,9 @@ int dlCopyCoordBuffer( dlVBO *vbo, dlVBO *src, unsigned int index )
    if(!vbo || !src)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    if(index > _dlCore.info.maxTextureUnits)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
@@ -479,6 +1622,9 @@ int dlFreeCoordBuffer( dlVBO *vbo, unsigned int index )
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    if(index > _dlCore.info.maxTextureUnits)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
@@ -504,6 +1650,9 @@ int dlResetCoordBuffer( dlVBO *vbo, unsigned int index, unsigned int vertices )
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    if(index > _dlCore.info.maxTextureUnits)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
@@ -543,26 +1692,56 @@ int dlInsertCoord( dlVBO *vbo, unsigned int index,
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    if(!vbo->uvw[index].coords)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
    dlSetAlloc( ALLOC_VBO );
 
-   ++vbo->uvw[index].c_use;
-   if(vbo->uvw[index].c_use >= vbo->uvw[index].c_num)
-   {
-      /* Maybe make it realloc more vertices? Or just hope ppl
-       * use the reset function above */
-      vbo->uvw[index].coords = dlRealloc(vbo->uvw[index].coords, vbo->uvw[index].c_num, vbo->uvw[index].c_use, sizeof(kmVec2));
-      if(!vbo->uvw[index].coords)
-      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
-
-      vbo->uvw[index].c_num = vbo->uvw[index].c_use;
-   }
+   vbo->uvw[index].coords = dlVBOReserve( vbo->uvw[index].coords, &vbo->uvw[index].c_num,
+                                          vbo->uvw[index].c_use + 1, sizeof(kmVec2) );
+   if(!vbo->uvw[index].coords)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
    /* Assign vertex */
    vertex.x = x; vertex.y = y;
-   vbo->uvw[index].coords[ vbo->uvw[index].c_use - 1 ] = vertex;
+   dlDirtyAdd( &vbo->uvw[index].dirty, vbo->uvw[index].c_use, 1 );
+   vbo->uvw[index].coords[ vbo->uvw[index].c_use++ ] = vertex;
+
+   /* Mark VBO outdated */
+   vbo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* insert n coords in one go */
+int dlInsertCoords( dlVBO *vbo, unsigned int index,
+      const kmVec2 *coords, unsigned int n )
+{
+   CALL("%p, %u, %p, %u", vbo, index, coords, n);
+
+   if(index > _dlCore.info.maxTextureUnits)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(!vbo || !coords)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlSetAlloc( ALLOC_VBO );
+
+   vbo->uvw[index].coords = dlVBOReserve( vbo->uvw[index].coords, &vbo->uvw[index].c_num,
+                                          vbo->uvw[index].c_use + n, sizeof(kmVec2) );
+   if(!vbo->uvw[index].coords)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memcpy( &vbo->uvw[index].coords[ vbo->uvw[index].c_use ], coords, n * sizeof(kmVec2) );
+   dlDirtyAdd( &vbo->uvw[index].dirty, vbo->uvw[index].c_use, n );
+   vbo->uvw[index].c_use += n;
 
    /* Mark VBO outdated */
    vbo->up_to_date = 0;
@@ -579,6 +1758,9 @@ int dlCopyNormalBuffer( dlVBO *vbo, dlVBO *src )
    if(!vbo || !src)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    vbo->normals   = dlCopy( src->normals, src->n_num * sizeof(kmVec3) );
@@ -598,6 +1780,9 @@ int dlFreeNormalBuffer( dlVBO *vbo )
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    dlFree( vbo->normals, vbo->n_num * sizeof(kmVec3) );
@@ -619,6 +1804,9 @@ int dlResetNormalBuffer( dlVBO *vbo, unsigned int vertices )
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    if(vbo->normals)
@@ -652,23 +1840,47 @@ int dlInsertNormal( dlVBO *vbo,
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   dlSetAlloc( ALLOC_VBO );
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   ++vbo->n_use;
-   if(vbo->n_use >= vbo->n_num)
-   {
-      /* Maybe make it realloc more vertices? Or just hope ppl
-       * use the reset function above */
-      vbo->normals = dlRealloc(vbo->normals, vbo->n_num, vbo->n_use, sizeof(kmVec3));
-      if(!vbo->normals)
-      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   dlSetAlloc( ALLOC_VBO );
 
-      vbo->n_num = vbo->n_use;
-   }
+   vbo->normals = dlVBOReserve( vbo->normals, &vbo->n_num, vbo->n_use + 1, sizeof(kmVec3) );
+   if(!vbo->normals)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
    /* Assign vertex */
    vertex.x = x; vertex.y = y; vertex.z = z;
-   vbo->normals[ vbo->n_use - 1 ] = vertex;
+   dlDirtyAdd( &vbo->n_dirty, vbo->n_use, 1 );
+   vbo->normals[ vbo->n_use++ ] = vertex;
+
+   /* Mark vbo outdated */
+   vbo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* insert n normals in one go */
+int dlInsertNormals( dlVBO *vbo, const kmVec3 *normals, unsigned int n )
+{
+   CALL("%p, %p, %u", vbo, normals, n);
+
+   if(!vbo || !normals)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlSetAlloc( ALLOC_VBO );
+
+   vbo->normals = dlVBOReserve( vbo->normals, &vbo->n_num, vbo->n_use + n, sizeof(kmVec3) );
+   if(!vbo->normals)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memcpy( &vbo->normals[ vbo->n_use ], normals, n * sizeof(kmVec3) );
+   dlDirtyAdd( &vbo->n_dirty, vbo->n_use, n );
+   vbo->n_use += n;
 
    /* Mark vbo outdated */
    vbo->up_to_date = 0;
@@ -686,6 +1898,9 @@ int dlCopyColorBuffer( dlVBO *vbo, dlVBO *src )
    if(!vbo || !src)
    { RET("%d", RETURN_FAIL); return(RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    vbo->colors    = dlCopy( src->colors, src->c_num * sizeof(dlColor) );
@@ -705,6 +1920,9 @@ int dlFreeColorBuffer( dlVBO *vbo )
    if(!vbo)
    { RET("%d", vbo); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    dlFree( vbo->colors, vbo->c_num * sizeof(dlColor) );
@@ -726,6 +1944,9 @@ int dlResetColorBuffer( dlVBO *vbo, unsigned int vertices )
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
    dlSetAlloc( ALLOC_VBO );
 
    if(vbo->colors)
@@ -753,28 +1974,53 @@ int dlResetColorBuffer( dlVBO *vbo, unsigned int vertices )
 int dlInsertColor( dlVBO *vbo,
       const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a )
 {
+   dlColor vertex;
    CALL("%p, %c, %c, %c, %c", vbo, r, g, b, a);
 
    if(!vbo)
    { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   dlSetAlloc( ALLOC_VBO );
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-   ++vbo->c_use;
-   if(vbo->c_use >= vbo->c_num)
-   {
-      /* Maybe make it realloc more vertices? Or just hope ppl
-       * use the reset function above */
-      vbo->colors = dlRealloc(vbo->colors, vbo->c_num, vbo->c_use, sizeof(dlColor));
-      if(!vbo->colors)
-      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+   dlSetAlloc( ALLOC_VBO );
 
-      vbo->c_num = vbo->c_use;
-   }
+   vbo->colors = dlVBOReserve( vbo->colors, &vbo->c_num, vbo->c_use + 1, sizeof(dlColor) );
+   if(!vbo->colors)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
    /* Assign vertex */
-   dlColor vertex; vertex.r = r; vertex.g = g; vertex.b = b; vertex.a = a;
-   vbo->colors[ vbo->c_use - 1 ] = vertex;
+   vertex.r = r; vertex.g = g; vertex.b = b; vertex.a = a;
+   dlDirtyAdd( &vbo->c_dirty, vbo->c_use, 1 );
+   vbo->colors[ vbo->c_use++ ] = vertex;
+
+   /* Mark vbo outdated */
+   vbo->up_to_date = 0;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* insert n colors in one go */
+int dlInsertColors( dlVBO *vbo, const dlColor *colors, unsigned int n )
+{
+   CALL("%p, %p, %u", vbo, colors, n);
+
+   if(!vbo || !colors)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   if(dlVBOUnshare( vbo ) == RETURN_FAIL)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   dlSetAlloc( ALLOC_VBO );
+
+   vbo->colors = dlVBOReserve( vbo->colors, &vbo->c_num, vbo->c_use + n, sizeof(dlColor) );
+   if(!vbo->colors)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memcpy( &vbo->colors[ vbo->c_use ], colors, n * sizeof(dlColor) );
+   dlDirtyAdd( &vbo->c_dirty, vbo->c_use, n );
+   vbo->c_use += n;
 
    /* Mark vbo outdated */
    vbo->up_to_date = 0;
@@ -7,20 +7,54 @@
 #include "dlScolor.h"
 #include "dlConfig.h"
 #include "dlTexture.h"
+#include "dlStream.h"
+#include "dlHeap.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* VBO layout enums, how the streams are stored in GL buffer */
+typedef enum
+{
+   DL_VBO_PLANAR,       /* each stream in its own block */
+   DL_VBO_INTERLEAVED   /* all attributes of vertex next to each other */
+} dleVBOLayout;
+
+/* VBO quantization flags, compresses GL side storage.
+ * CPU side arrays stay float, decode is done by the renderer */
+typedef enum
+{
+   DL_VBO_QUANTIZE_NONE     = 0,
+   DL_VBO_QUANTIZE_HALF     = 1,  /* half float positions, int16 if not supported */
+   DL_VBO_QUANTIZE_POSITION = 2,  /* int16 positions with scale and bias */
+   DL_VBO_QUANTIZE_NORMAL   = 4,  /* 2_10_10_10 normals, bytes if not supported */
+   DL_VBO_QUANTIZE_COORD    = 8   /* int16 coords with scale and bias */
+} dleVBOQuantize;
+
+/* modified range of stream in elements,
+ * start == end when nothing is dirty */
+typedef struct dlDirty_t
+{
+   unsigned int start, end;
+} dlDirty;
+
 typedef struct dlUVW_t
 {
    /* coordinates */
    kmVec2         *coords;
    unsigned int   c_num, c_use;
+   dlDirty        dirty;
 
    /* VBO Offset */
    size_t cOffset;
 
+   /* GL format of coords,
+    * quantized coords decode as q * qScale + qBias */
+   unsigned int cType;
+   size_t       cSize;
+   kmVec2       qScale, qBias;
+
 } dlUVW;
 
 /* VBO struct */
@@ -31,12 +65,14 @@ typedef struct dlVBO_t
    dlUVW    *uvw;
    kmVec3   *normals;
 
-   /* only used for animation */
+   /* only used for animation, bind pose positions and normals */
    kmVec3   *tstance;
+   kmVec3   *tnormal;
 
 #if VERTEX_COLOR
    dlColor   *colors;
    unsigned int c_num, c_use;
+   dlDirty      c_dirty;
 #endif
 
    /* num = amount allocated, use = amount used
@@ -44,11 +80,37 @@ typedef struct dlVBO_t
    unsigned int v_num, v_use;
    unsigned int n_num, n_use;
 
-   /* dl VBO object */
+   /* ranges changed since last upload */
+   dlDirty      v_dirty, n_dirty;
+
+   /* dl VBO object,
+    * GL_STREAM_DRAW hint places data in per frame stream ring instead */
    unsigned int object;
    int          hint;
    uint8_t      up_to_date;
 
+   /* data lives in stream ring at base,
+    * valid while stream serial matches */
+   uint8_t      streamed;
+   size_t       base;
+   unsigned int serial;
+
+   /* suballocated from geometry heap,
+    * object is then the heap page and base the range offset */
+   uint8_t      in_heap;
+   dlHeapRange  range;
+
+   /* storage layout, stride is 0 for planar */
+   dleVBOLayout layout;
+   size_t       stride;
+
+   /* dleVBOQuantize flags and resulting GL formats,
+    * quantized positions decode as q * qScale + qBias */
+   unsigned int quantize;
+   unsigned int vType, nType;
+   size_t       vSize, nSize;
+   kmVec3       qScale, qBias;
+
    /* VBO Offsets */
    size_t vbo_size;
    size_t vOffset, nOffset;
@@ -56,6 +118,14 @@ typedef struct dlVBO_t
    size_t cOffset;
 #endif
 
+   /* renewed whenever GL object or offsets change,
+    * unique between VBOs so renderer can cache pointer setup with it */
+   unsigned int generation;
+
+   /* copy on write, copies share arrays and GL object
+    * until one of them is modified. counts VBOs sharing them */
+   unsigned int *shared;
+
    unsigned int refCounter;
 } dlVBO;
 
@@ -67,8 +137,31 @@ int         dlFreeVBO( dlVBO *vbo );   /* Free vbo object */
 /* VBO actions */
 int         dlVBOConstruct( dlVBO *vbo );
 int         dlVBOUpdate( dlVBO *vbo );
+int         dlVBOSetLayout( dlVBO *vbo, dleVBOLayout layout );
+int         dlVBOSetQuantize( dlVBO *vbo, unsigned int flags );
+
+/* give VBO arrays of its own, call before writing to arrays in place.
+ * insert, reset and other VBO functions do this themself */
+int         dlVBOUnshare( dlVBO *vbo );
+
+/* reorder vertices of every stream, remap[old] = new */
+int         dlVBORemap( dlVBO *vbo, const unsigned int *remap );
+
+/* merge vertices, remap[old] = new with remap[old] <= old.
+ * first vertex mapped to each new index is kept */
+int         dlVBOCompact( dlVBO *vbo, const unsigned int *remap, unsigned int vertices );
+
+/* tell VBO that data was modified in place,
+ * only the modified ranges get uploaded on next update */
+int         dlVBOModifiedVertices( dlVBO *vbo, unsigned int first, unsigned int count );
+int         dlVBOModifiedNormals( dlVBO *vbo, unsigned int first, unsigned int count );
+int         dlVBOModifiedCoords( dlVBO *vbo, unsigned int index,
+                                 unsigned int first, unsigned int count );
+#if VERTEX_COLOR
+int         dlVBOModifiedColors( dlVBO *vbo, unsigned int first, unsigned int count );
+#endif
 
-/* copy tstance vertices if animation is used */
+/* copy tstance vertices and normals if animation is used */
 int dlVBOPrepareTstance( dlVBO *vbo );
 
 /* Vertex buffer operations */
@@ -77,14 +170,16 @@ int         dlCopyVertexBuffer( dlVBO *vbo, dlVBO *src );
 int         dlResetVertexBuffer( dlVBO *vbo, unsigned int vertices );
 int         dlInsertVertex( dlVBO *vbo,
                             const kmScalar x, const kmScalar y, const kmScalar z );
+int         dlInsertVertices( dlVBO *vbo, const kmVec3 *vertices, unsigned int n );
 
 #if VERTEX_COLOR
-/* Normal buffer operations */
+/* Color buffer operations */
 int         dlFreeColorBuffer( dlVBO *vbo );
 int         dlCopyColorBuffer( dlVBO *vbo, dlVBO *src );
 int         dlResetColorBuffer( dlVBO *vbo, unsigned int vertices );
 int         dlInsertColor( dlVBO *vbo,
                            const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a );
+int         dlInsertColors( dlVBO *vbo, const dlColor *colors, unsigned int n );
 #endif
 
 /* Texture coord buffer operations */
@@ -94,6 +189,8 @@ int         dlResetCoordBuffer( dlVBO *vbo, unsigned int index,
                                  unsigned int vertices );
 int         dlInsertCoord( dlVBO *vbo, unsigned int index,
                            const kmScalar x, const kmScalar y );
+int         dlInsertCoords( dlVBO *vbo, unsigned int index,
+                            const kmVec2 *coords, unsigned int n );
 
 /* Normal buffer operations */
 int         dlFreeNormalBuffer( dlVBO *vbo );
@@ -101,6 +198,7 @@ int         dlCopyNormalBuffer( dlVBO *vbo, dlVBO *src );
 int         dlResetNormalBuffer( dlVBO *vbo, unsigned int vertices );
 int         dlInsertNormal( dlVBO *vbo,
                             const kmScalar x, const kmScalar y, const kmScalar z );
+int         dlInsertNormals( dlVBO *vbo, const kmVec3 *normals, unsigned int n );
 
 #ifdef __cplusplus
 }
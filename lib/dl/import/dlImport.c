@@ -23,6 +23,12 @@
  * since it would just bloat my texture structure. It's much better like this :) */
 #include "SOIL.h"
 
+/* recorded builds upload textures through dlGL */
+#if DL_GL_RECORD
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#  include "dlGL.h"
+#endif
 
 #define HEADER_MAX 20 /* Should be good enough,
                        * dont think anyone would use this long
@@ -258,6 +264,22 @@ int dlImportImage( dlTexture *texture,
    CALL("%p, %s, %u", texture, file, flags);
    LOGINFOP("Image: %s", file);
 
+#if DL_GL_RECORD
+   /* SOIL talks to GL directly, only decode with it */
+   texture->data = SOIL_load_image( file,
+         &texture->width, &texture->height, &channels, SOIL_LOAD_AUTO );
+
+   if(texture->data)
+   {
+      glGenTextures( 1, &texture->object );
+      glBindTexture( GL_TEXTURE_2D, texture->object );
+      glTexImage2D( GL_TEXTURE_2D, 0, channels, texture->width, texture->height, 0,
+                    channels == 4 ? GL_RGBA            :
+                    channels == 3 ? GL_RGB             :
+                    channels == 2 ? GL_LUMINANCE_ALPHA : GL_LUMINANCE,
+                    GL_UNSIGNED_BYTE, texture->data );
+   }
+#else
    /* load using SOIL */
    texture->object = SOIL_load_OGL_texture_EX
       (
@@ -270,6 +292,7 @@ int dlImportImage( dlTexture *texture,
             SOIL_CREATE_NEW_ID,
             flags
       );
+#endif
    texture->channels = channels;
 
    /* check succes */
@@ -16,6 +16,7 @@
 #include "dlLog.h"
 #include "dlCore.h"
 #include "dlAlloc.h"
+#include "dlOptimize.h"
 
 /* maybe map the basic GL enums
  * to own structure, so these become useless */
@@ -367,39 +368,47 @@ static int construct_animation(dlAnimator *object, const struct aiScene *sc, con
 static int construct(const char *file, dlObject *object, const struct aiScene *sc, const struct aiNode *nd, const struct aiMesh *mesh, int bAnimated)
 {
    unsigned int i = 0;
-   unsigned int index = 0;
    unsigned int f = 0, t = 0;
    CALL("%s, %p, %p, %p, %p, %d", file, object, sc, nd, mesh, bAnimated);
 
    /* Check out what our mesh has */
    if(mesh->mVertices)
+   {
       dlResetVertexBuffer( object->vbo, mesh->mNumVertices );
+      dlInsertVertices( object->vbo, (kmVec3*)mesh->mVertices, mesh->mNumVertices );
+   }
    if(mesh->mNormals)
+   {
       dlResetNormalBuffer( object->vbo, mesh->mNumVertices );
+      dlInsertNormals( object->vbo, (kmVec3*)mesh->mNormals, mesh->mNumVertices );
+   }
 
-   object->vbo->v_use = object->vbo->v_num;
-   object->vbo->n_use = object->vbo->n_num;
-
-   /* Texture coords */
+   /* Texture coords, assimp stores these as 3D vectors */
    i = 0;
    while( i != _dlCore.info.maxTextureUnits )
    {
       if(mesh->mTextureCoords[i])
+      {
          dlResetCoordBuffer( object->vbo, i, mesh->mNumVertices );
 
-      object->vbo->uvw[i].c_use = object->vbo->uvw[i].c_num;
+         t = 0;
+         for(; t != mesh->mNumVertices; ++t)
+            dlInsertCoord( object->vbo, i,
+                           mesh->mTextureCoords[i][t].x,
+                           mesh->mTextureCoords[i][t].y );
+      }
       i++;
    }
 
-   /* We don't know how many indices there is total
-    * so let the glInsertIndex command to allocate dynamically */
-   dlResetIndexBuffer( object->ibo, 1 );
+   /* Triangulated meshes have 3 indices per face,
+    * the rest will grow dynamically */
+   dlResetIndexBuffer( object->ibo, mesh->mNumFaces * 3 );
 
    /* Material check */
    if(mesh->mMaterialIndex)
       setMaterial( file, object,  sc->mMaterials[mesh->mMaterialIndex] );
 
-   /* Yush! Then assing the data to our structure */
+   /* Yush! Then assing the indices to our structure */
    for(; f != mesh->mNumFaces; ++f)
    {
       /* That's some beautiful face */
@@ -407,48 +416,7 @@ static int construct(const char *file, dlObject *object, const struct aiScene *s
       if(!face)
       { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
 
-      i = 0;
-      for(; i != face->mNumIndices; ++i)
-      {
-         index = face->mIndices[i];
-
-         if(mesh->mVertices)
-         {
-            object->vbo->vertices[ index ].x =
-               mesh->mVertices[index].x;
-            object->vbo->vertices[ index ].y =
-               mesh->mVertices[index].y;
-            object->vbo->vertices[ index ].z =
-               mesh->mVertices[index].z;
-         }
-
-         if(mesh->mNormals)
-         {
-            object->vbo->normals[ index ].x =
-               mesh->mNormals[index].x;
-            object->vbo->normals[ index ].y =
-               mesh->mNormals[index].y;
-            object->vbo->normals[ index ].z =
-               mesh->mNormals[index].z;
-         }
-
-         t = 0;
-         while( t != _dlCore.info.maxTextureUnits )
-         {
-            if(mesh->mTextureCoords[t])
-            {
-               object->vbo->uvw[t].coords[ index ].x =
-                  mesh->mTextureCoords[t][ index ].x;
-               object->vbo->uvw[t].coords[ index ].y =
-                  mesh->mTextureCoords[t][ index ].y;
-            }
-
-            t++;
-         }
-
-         /* finally index */
-         dlInsertIndex( object->ibo, index );
-      }
+      dlInsertIndices( object->ibo, face->mIndices, face->mNumIndices );
    }
 
    /* be done, if we only want static stuff */
@@ -550,6 +518,8 @@ static int process(const char *file, dlObject *object, const struct aiScene *sc,
             return( RETURN_FAIL );
          }
 
+         /* child is in space of parent */
+         mObject->scale.x = 1; mObject->scale.y = 1; mObject->scale.z = 1;
          dlObjectAddChild(object, mObject);
          dlObjectCalculateAABB(mObject);
          mObject->primitive_type = GL_TRIANGLES;
@@ -617,9 +587,16 @@ int dlImportASSIMP( dlObject *object, const char *file, int bAnimated )
     * Add tristripper code? */
    object->primitive_type = GL_TRIANGLES;
 
-   /* if was animated */
+   /* merge duplicate vertices before tstance is built */
+   if(dlObjectWeldVertices( object, 0.0f ) != RETURN_OK)
+   { LOGWARN("Vertex welding failed"); }
+
+   /* if was animated, convert weights of bones to influences of vertices */
    if(object->animator)
+   {
       dlVBOPrepareTstance( object->vbo );
+      object->skin = dlNewSkin( object->animator, object->vbo->v_use );
+   }
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
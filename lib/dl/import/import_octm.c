@@ -108,18 +108,10 @@ int dlImportOCTM( dlObject* object, const char *file, int bAnimated )
    dlResetIndexBuffer( object->ibo, triCount * 3 );
 
    /* indices */
-   i = 0;
-   for(; i != triCount * 3; ++i)
-      dlInsertIndex( object->ibo,
-                     indices[i]  );
+   dlInsertIndices( object->ibo, indices, triCount * 3 );
 
    /* vertices */
-   i = 0;
-   for(; i != vertCount; ++i)
-      dlInsertVertex( object->vbo,
-                      vertices[ i * 3 ],
-                      vertices[ i * 3 + 1 ],
-                      vertices[ i * 3 + 2 ]  );
+   dlInsertVertices( object->vbo, (kmVec3*)vertices, vertCount );
 
    /* texture coords */
    i = 0;
@@ -146,13 +138,7 @@ int dlImportOCTM( dlObject* object, const char *file, int bAnimated )
          free( texturePath );
       }
 
-      i2 = 0;
-      for(; i2 != vertCount; ++i2)
-      {
-         dlInsertCoord( object->vbo, i,
-                        coords[ i2 * 2 ],
-                        coords[ i2 * 2 + 1 ] );
-      }
+      dlInsertCoords( object->vbo, i, (kmVec2*)coords, vertCount );
 
       ++i;
    }
@@ -163,12 +149,7 @@ int dlImportOCTM( dlObject* object, const char *file, int bAnimated )
        dlResetNormalBuffer( object->vbo, vertCount );
        normals = ctmGetFloatArray( context, CTM_NORMALS );
 
-       i = 0;
-       for(; i != vertCount; ++i)
-          dlInsertNormal( object->vbo,
-                          normals[ i * 3 ],
-                          normals[ i * 3 + 1 ],
-                          normals[ i * 3 + 2 ]  );
+       dlInsertNormals( object->vbo, (kmVec3*)normals, vertCount );
    }
 
    /* custom attribs, only for vertex colors atm */
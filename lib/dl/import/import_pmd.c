@@ -12,6 +12,7 @@
 #include "dlLog.h"
 #include "dlTexture.h"
 #include "dlAtlas.h"
+#include "dlOptimize.h"
 
 /* importer */
 #include "mmd_import/mmd.h"
@@ -143,6 +144,9 @@ int dlImportPMD( dlObject* object, const char *file, int bAnimated )
    unsigned int ix;
    dlAtlas *atlas;
    dlTexture **textureList;
+   kmVec3 *vertices, *normals;
+   kmVec2 *coords;
+   unsigned int *indices;
 #else
    dlObject *mObject;
 #endif
@@ -347,11 +351,25 @@ int dlImportPMD( dlObject* object, const char *file, int bAnimated )
    if(object->material) dlFreeMaterial(object->material);
    object->material = dlNewMaterialFromTexture( texture );
 
-   /* reset buffers */
-   dlResetIndexBuffer( object->ibo,    mmd->num_indices );
-   dlResetVertexBuffer( object->vbo,   mmd->num_vertices );
-   dlResetNormalBuffer( object->vbo,   mmd->num_vertices );
-   dlResetCoordBuffer( object->vbo, 0, mmd->num_vertices );
+   /* de-index into temporary arrays, then feed them in one go */
+   vertices = malloc( mmd->num_indices * sizeof(kmVec3) );
+   normals  = malloc( mmd->num_indices * sizeof(kmVec3) );
+   coords   = malloc( mmd->num_indices * sizeof(kmVec2) );
+   indices  = malloc( mmd->num_indices * sizeof(unsigned int) );
+   if(!vertices || !normals || !coords || !indices)
+   {
+      LOGERR("Could not allocate temporary vertex data");
+      if(vertices) free( vertices );
+      if(normals)  free( normals );
+      if(coords)   free( coords );
+      if(indices)  free( indices );
+      dlFreeAtlas( atlas );
+      free( textureList );
+      freeMMD( mmd );
+
+      RET("%d", RETURN_FAIL);
+      return( RETURN_FAIL );
+   }
 
    /* materials
     * each material = 1 object */
@@ -364,35 +382,41 @@ int dlImportPMD( dlObject* object, const char *file, int bAnimated )
       for(; i2 != start + num_faces; ++i2)
       {
          ix = mmd->indices[i2];
-         dlInsertVertex( object->vbo,
-               mmd->vertices[ ix * 3     ],
-               mmd->vertices[ ix * 3 + 1 ],
-               mmd->vertices[ ix * 3 + 2 ] );
-
-         dlInsertCoord( object->vbo, 0,
-               mmd->coords[ ix * 2     ],
-               mmd->coords[ ix * 2 + 1 ] );
-
-         dlInsertNormal( object->vbo,
-               mmd->normals[ ix * 3     ],
-               mmd->normals[ ix * 3 + 1 ],
-               mmd->normals[ ix * 3 + 2 ] );
+         memcpy( &vertices[i2], &mmd->vertices[ ix * 3 ], sizeof(kmVec3) );
+         memcpy( &normals[i2],  &mmd->normals[ ix * 3 ],  sizeof(kmVec3) );
+         memcpy( &coords[i2],   &mmd->coords[ ix * 2 ],   sizeof(kmVec2) );
 
          /* fix coords */
-         if(object->vbo->uvw[0].coords[i2].y < 0.0f)
-            object->vbo->uvw[0].coords[i2].y += 1;
-         if(object->vbo->uvw[0].coords[i2].x < 0.0f)
-            object->vbo->uvw[0].coords[i2].x += 1;
+         if(coords[i2].y < 0.0f)
+            coords[i2].y += 1;
+         if(coords[i2].x < 0.0f)
+            coords[i2].x += 1;
 
-         //dlPrint( "%f, %f\n", object->vbo->uvw[0].coords[i2].x, object->vbo->uvw[0].coords[i2].y);
-         dlAtlasGetTransformed( atlas, textureList[i], &object->vbo->uvw[0].coords[i2] );
+         //dlPrint( "%f, %f\n", coords[i2].x, coords[i2].y);
+         dlAtlasGetTransformed( atlas, textureList[i], &coords[i2] );
 
-         dlInsertIndex( object->ibo, i2 );
+         indices[i2] = i2;
       }
       //dlPuts("");
       start += num_faces;
    }
 
+   /* reset buffers */
+   dlResetIndexBuffer( object->ibo,    mmd->num_indices );
+   dlResetVertexBuffer( object->vbo,   mmd->num_indices );
+   dlResetNormalBuffer( object->vbo,   mmd->num_indices );
+   dlResetCoordBuffer( object->vbo, 0, mmd->num_indices );
+
+   dlInsertVertices( object->vbo, vertices, start );
+   dlInsertNormals( object->vbo, normals, start );
+   dlInsertCoords( object->vbo, 0, coords, start );
+   dlInsertIndices( object->ibo, indices, start );
+
+   free( vertices );
+   free( normals );
+   free( coords );
+   free( indices );
+
    /* free atlas */
    dlFreeAtlas( atlas );
    free( textureList );
@@ -406,23 +430,9 @@ int dlImportPMD( dlObject* object, const char *file, int bAnimated )
    dlResetNormalBuffer( object->vbo,   mmd->num_vertices );
    dlResetCoordBuffer( object->vbo, 0, mmd->num_vertices );
 
-   i = 0;
-   for(; i != mmd->num_vertices; ++i)
-   {
-         dlInsertVertex( object->vbo,
-               mmd->vertices[ i * 3     ],
-               mmd->vertices[ i * 3 + 1 ],
-               mmd->vertices[ i * 3 + 2 ] );
-
-         dlInsertCoord( object->vbo, 0,
-               mmd->coords[ i * 2     ],
-               mmd->coords[ i * 2 + 1 ] );
-
-         dlInsertNormal( object->vbo,
-               mmd->normals[ i * 3     ],
-               mmd->normals[ i * 3 + 1 ],
-               mmd->normals[ i * 3 + 2 ] );
-   }
+   dlInsertVertices( object->vbo, (kmVec3*)mmd->vertices, mmd->num_vertices );
+   dlInsertCoords( object->vbo, 0, (kmVec2*)mmd->coords, mmd->num_vertices );
+   dlInsertNormals( object->vbo, (kmVec3*)mmd->normals, mmd->num_vertices );
 
    /* materials
     * each material = 1 object */
@@ -457,6 +467,8 @@ int dlImportPMD( dlObject* object, const char *file, int bAnimated )
             return( RETURN_FAIL );
          }
 
+         /* child is in space of parent */
+         mObject->scale.x = 1; mObject->scale.y = 1; mObject->scale.z = 1;
          dlObjectAddChild( object, mObject );
       }
       else  mObject = object;
@@ -489,6 +501,10 @@ int dlImportPMD( dlObject* object, const char *file, int bAnimated )
 
 #endif
 
+   /* atlas path emits a vertex per index, merge them back */
+   if(dlObjectWeldVertices( object, 0.0f ) != RETURN_OK)
+   { LOGWARN("Vertex welding failed"); }
+
    /* free mmd_data structure */
    freeMMD( mmd );
 
@@ -2,6 +2,7 @@
 
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "dlConfig.h"
 #include "dlCore.h"
@@ -19,10 +20,36 @@
 #  include <GL/glew.h>
 #  include <GL/gl.h>
 #endif
+#include "dlGL.h"
 #define DL_DEBUG_CHANNEL "OGL140"
 
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
+/* hardware instancing, per instance matrix is read by shader */
+#if !defined(GLES1) && GL_ARB_instanced_arrays && GL_ARB_draw_instanced
+#  define OGL140_INSTANCING 1
+#else
+#  define OGL140_INSTANCING 0
+#endif
+
+/* vertex array objects cache pointer setup of objects */
+#if !defined(GLES1) && GL_ARB_vertex_array_object
+#  define OGL140_VAO 1
+#else
+#  define OGL140_VAO 0
+#endif
+
+/* cached vertex arrays, power of two */
+#define OGL140_VAO_CACHE 256
+
+/* streams object is drawn with,
+ * coord set is stored above these */
+#define OGL140_VERTEX   1
+#define OGL140_NORMAL   2
+#define OGL140_COORD    4
+#define OGL140_COLOR    8
+#define OGL140_UVW_SHIFT 4
+
 typedef struct
 {
    uint8_t vertex;
@@ -41,31 +68,61 @@ typedef struct
 
    unsigned int active_texture;
    unsigned int last_texture;
+
+   /* texture matrix decodes quantized coords */
+   uint8_t texture_matrix;
+
+   /* driver has instancing and vertex array object entry points,
+    * headers alone don't tell */
+   uint8_t instancing;
+   uint8_t vao;
+
+   /* DL_IN_INSTANCE holds identity */
+   uint8_t instance_identity;
+
+   /* streams of current object,
+    * client states above are those of default vertex array */
+   unsigned int arrays;
 } dlState;
 
 /* global draw state */
 static dlState draw;
 
-/* bind VBO */
-static void bindVBO( dlVBO *vbo )
+#if OGL140_VAO
+/* vertex array with pointers of one object setup */
+typedef struct
 {
-   CALL("%p", vbo);
-
-   if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
-      return;
+   unsigned int object;       /* GL vertex array, 0 if slot is free */
+   unsigned int generation;   /* VBO layout it was built for */
+   unsigned int element;      /* element buffer bound in it */
+   unsigned int buffer;       /* index buffer with USE_BUFFERS */
+   unsigned int arrays;       /* enabled streams and coord set */
+} dlVAO;
+
+/* direct mapped vertex array cache */
+typedef struct
+{
+   dlVAO        slot[ OGL140_VAO_CACHE ];
+   unsigned int deleted;      /* dlDeletedBuffers when built */
+} dlVAOCache;
 
-   glBindBuffer( GL_ARRAY_BUFFER, vbo->object );
-}
+static dlVAOCache vao;
+#endif
 
-/* unbind VBO */
-static void unbindVBO( dlVBO *vbo )
+/* bind VBO, binding is cached so objects sharing
+ * heap page or stream ring don't rebind */
+static void bindVBO( dlVBO *vbo )
 {
    CALL("%p", vbo);
 
+   /* client arrays */
    if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
-      return;
-
-   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+      dlBindBuffer( GL_ARRAY_BUFFER, 0 );
+   /* streamed data lives in the ring */
+   else if(vbo->streamed)
+      dlBindBuffer( GL_ARRAY_BUFFER, dlStreamObject() );
+   else
+      dlBindBuffer( GL_ARRAY_BUFFER, vbo->object );
 }
 
 /* bind texture from UVW */
@@ -79,10 +136,34 @@ static void bindTexture( dlObject *object )
        return;
 
    draw.last_texture = object->material->texture->object;
+   _dlCore.render.stats.textureBinds++;
    glBindTexture( GL_TEXTURE_2D,
                   object->material->texture->object );
 }
 
+/* pointer to element inside VBO,
+ * interleaved VBOs step by stride, planar ones by element size.
+ * stream ring without GL buffer is drawn from system memory */
+static const void* vboOffset( dlVBO *vbo, size_t base, size_t offset, size_t size )
+{
+   base += vbo->base;
+   if(vbo->stride)
+      base += offset * vbo->stride;
+   else
+      base += offset * size;
+
+   if(vbo->streamed && !dlStreamObject())
+      return( dlStreamData() + base );
+
+   return( BUFFER_OFFSET( base ) );
+}
+
+/* stride of stream, planar streams are packed by element size */
+static size_t vboStride( dlVBO *vbo, size_t size )
+{
+   return( vbo->stride ? vbo->stride : size );
+}
+
 /* texture coordinates */
 static void coordPointer( dlVBO *vbo, unsigned int index, size_t offset )
 {
@@ -98,7 +179,8 @@ static void coordPointer( dlVBO *vbo, unsigned int index, size_t offset )
    }
    else
    {
-      glTexCoordPointer( 2, GL_FLOAT, 0, BUFFER_OFFSET( vbo->uvw[ index ].cOffset + offset ) );
+      glTexCoordPointer( 2, vbo->uvw[ index ].cType, vboStride( vbo, vbo->uvw[ index ].cSize ),
+            vboOffset( vbo, vbo->uvw[ index ].cOffset, offset, vbo->uvw[ index ].cSize ) );
    }
 }
 
@@ -110,7 +192,6 @@ static void uvwPointer( dlObject *object, size_t offset )
    if(!draw.texture)
       return;
 
-   bindTexture( object );
    coordPointer( object->vbo, object->material->texture->uvw, offset );
 }
 
@@ -119,13 +200,14 @@ static void vertexPointer( dlVBO *vbo, size_t offset )
 {
    CALL("%p, %llu", vbo, offset);
 
-   if(!draw.vertex)
+   if(!(draw.arrays & OGL140_VERTEX))
       return;
 
    if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
       glVertexPointer( 3, GL_FLOAT, 0, &vbo->vertices[ offset ] );
    else
-      glVertexPointer( 3, GL_FLOAT, 0, BUFFER_OFFSET( vbo->vOffset + offset ) );
+      glVertexPointer( 3, vbo->vType, vboStride( vbo, vbo->vSize ),
+            vboOffset( vbo, vbo->vOffset, offset, vbo->vSize ) );
 }
 
 /* normals */
@@ -133,13 +215,14 @@ static void normalPointer( dlVBO *vbo, size_t offset )
 {
    CALL("%p, %llu", vbo, offset);
 
-   if(!draw.normal)
+   if(!(draw.arrays & OGL140_NORMAL))
       return;
 
    if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
       glNormalPointer( GL_FLOAT, 0, &vbo->normals[ offset ] );
    else
-      glNormalPointer( GL_FLOAT, 0, BUFFER_OFFSET( vbo->nOffset + offset ) );
+      glNormalPointer( vbo->nType, vboStride( vbo, vbo->nSize ),
+            vboOffset( vbo, vbo->nOffset, offset, vbo->nSize ) );
 
 }
 
@@ -152,12 +235,27 @@ static void colorPointer( dlVBO *vbo, size_t offset )
    if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
       glColorPointer( 4, GL_UNSIGNED_BYTE, 0, &vbo->colors[ offset ] );
    else
-      glColorPointer( 4, GL_UNSIGNED_BYTE, 0, BUFFER_OFFSET( vbo->cOffset + offset ) );
+      glColorPointer( 4, GL_UNSIGNED_BYTE, vboStride( vbo, sizeof(dlColor) ),
+            vboOffset( vbo, vbo->cOffset, offset, sizeof(dlColor) ) );
 #endif
 }
 
-/* indices */
-static void elementDraw( dlObject *object, unsigned int index )
+/* draw arrays, instanced if instances is not 0 */
+static void arraysDraw( dlObject *object, unsigned int instances )
+{
+#if OGL140_INSTANCING
+   if(instances)
+   {
+      glDrawArraysInstancedARB( object->primitive_type, 0, object->vbo->v_use, instances );
+      return;
+   }
+#endif
+
+   glDrawArrays( object->primitive_type, 0, object->vbo->v_use );
+}
+
+/* indices, instanced if instances is not 0 */
+static void elementDraw( dlObject *object, unsigned int index, unsigned int instances )
 {
    unsigned int indices_type;
    unsigned int i_use;
@@ -167,12 +265,15 @@ static void elementDraw( dlObject *object, unsigned int index )
 #else
    unsigned int   *indices;
 #endif
-   CALL("%p, %u", object, index);
+   const void   *offset;
+   CALL("%p, %u, %u", object, index, instances);
+
+   _dlCore.render.stats.draws++;
 
    if(!object->ibo)
    {
       if(object->vbo->v_use)
-         glDrawArrays( object->primitive_type, 0, object->vbo->v_use );
+         arraysDraw( object, instances );
       return;
    }
 
@@ -185,7 +286,10 @@ static void elementDraw( dlObject *object, unsigned int index )
 #else
    indices        = object->ibo->indices;
 
+   /* buffer may hold narrowed copy */
    indices_type   = GL_UNSIGNED_INT;
+   if(_dlCore.render.mode != DL_MODE_VERTEX_ARRAY)
+      indices_type = object->ibo->type;
    i_use          = object->ibo->i_use;
    iOffset        = 0;
 #endif
@@ -194,75 +298,254 @@ static void elementDraw( dlObject *object, unsigned int index )
    {
       /* draw without IBO */
       if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
-         glDrawElements( object->primitive_type, i_use,
-                         indices_type, &indices[ 0 ] );
+      {
+         dlBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+         offset = &indices[ 0 ];
+      }
       else
       {
-         glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, object->ibo->object );
-         glDrawElements( object->primitive_type, i_use,
-                         indices_type, BUFFER_OFFSET( iOffset ) );
-         glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+         dlBindBuffer( GL_ELEMENT_ARRAY_BUFFER, object->ibo->object );
+         offset = BUFFER_OFFSET( object->ibo->range.offset + iOffset );
       }
+
+#if OGL140_INSTANCING
+      if(instances)
+      {
+         glDrawElementsInstancedARB( object->primitive_type, i_use,
+                                     indices_type, offset, instances );
+         return;
+      }
+#endif
+
+      glDrawElements( object->primitive_type, i_use,
+                      indices_type, offset );
    }
    else if(object->vbo->v_use)
-      glDrawArrays( object->primitive_type, 0, object->vbo->v_use );
+      arraysDraw( object, instances );
 }
 
-/* draw the object */
-static void drawObject( dlObject *object )
+/* set pointers of every stream starting from vertex offset */
+static void streamPointers( dlObject *object, size_t offset )
 {
-#if USE_BUFFERS
-   unsigned int i = 0;
-   size_t tmp;
+   CALL("%p, %llu", object, offset);
+
+   bindVBO( object->vbo );
+   vertexPointer( object->vbo, offset );
+   uvwPointer( object, offset );
+   normalPointer( object->vbo, offset );
+   colorPointer( object->vbo, offset );
+}
+
+/* enable streams in default vertex array */
+static void clientArrays( unsigned int arrays )
+{
+   uint8_t vertex, normal, coord;
+#if VERTEX_COLOR
+   uint8_t color;
 #endif
-   CALL("%p", object);
+   CALL("%u", arrays);
 
-#if USE_BUFFERS
-   /* with indices */
-   if( object->ibo )
+   vertex = (arrays & OGL140_VERTEX) != 0;
+   normal = (arrays & OGL140_NORMAL) != 0;
+   coord  = (arrays & OGL140_COORD)  != 0;
+
+   /* check state */
+   if(draw.vertex != vertex)
    {
-      i = 0;
-      for(; i != object->ibo->index_buffer; ++i )
-      {
-         tmp =  i * USHRT_MAX;
+      _dlCore.render.stats.stateChanges++;
+      if(vertex)
+         glEnableClientState(GL_VERTEX_ARRAY);
+      else
+         glDisableClientState(GL_VERTEX_ARRAY);
 
-         bindVBO( object->vbo );
-            uvwPointer( object, tmp );
-            vertexPointer( object->vbo, tmp );
-            normalPointer( object->vbo, tmp );
-            colorPointer( object->vbo, tmp );
-         unbindVBO( object->vbo );
+      draw.vertex = vertex;
+   }
+
+
+   /* check state */
+   if(draw.normal != normal)
+   {
+      _dlCore.render.stats.stateChanges++;
+      if(normal)
+         glEnableClientState(GL_NORMAL_ARRAY);
+      else
+         glDisableClientState(GL_NORMAL_ARRAY);
+
+      draw.normal = normal;
+   }
+
+#if VERTEX_COLOR
+   color = (arrays & OGL140_COLOR) != 0;
 
-         /* bind automatically */
-         elementDraw( object, i );
+   /* check state */
+   if(draw.color != color)
+   {
+      _dlCore.render.stats.stateChanges++;
+      if(color)
+         glEnableClientState(GL_COLOR_ARRAY);
+      else
+      {
+         glDisableClientState(GL_COLOR_ARRAY);
+         glColor4f( 1, 1, 1, 1 );
       }
+
+      draw.color = color;
    }
-   else
-   /* without indices */
+#endif
+
+   /* check state */
+   if(draw.coord != coord)
+   {
+      _dlCore.render.stats.stateChanges++;
+      if(coord)
+         glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+      else
+         glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+      draw.coord = coord;
+   }
+}
+
+/* set pointers in default vertex array */
+static void objectPointers( dlObject *object, size_t offset )
+{
+   CALL("%p, %llu", object, offset);
+
+   dlBindVertexArray( 0, 0 );
+   clientArrays( draw.arrays );
+   streamPointers( object, offset );
+}
+
+#if OGL140_VAO
+/* delete every cached vertex array */
+static void vaoFlush( void )
+{
+   unsigned int i;
+   TRACE();
+
+   i = 0;
+   for(; i != OGL140_VAO_CACHE; ++i)
+      dlDeleteVertexArray( &vao.slot[i].object );
+
+   vao.deleted = dlDeletedBuffers();
+}
+
+/* build vertex array for current object,
+ * a fresh one has every stream disabled */
+static int vaoBuild( dlVAO *slot, dlObject *object, unsigned int buffer )
+{
+   CALL("%p, %p, %u", slot, object, buffer);
+
+   dlDeleteVertexArray( &slot->object );
+   glGenVertexArrays( 1, &slot->object );
+   if(!slot->object)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   /* element binding goes to vertex array,
+    * dlBindBuffer would bind default one first */
+   dlBindVertexArray( slot->object, slot->element );
+   if(slot->element)
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, slot->element );
+
+   if(slot->arrays & OGL140_VERTEX)
+      glEnableClientState(GL_VERTEX_ARRAY);
+   if(slot->arrays & OGL140_NORMAL)
+      glEnableClientState(GL_NORMAL_ARRAY);
+   if(slot->arrays & OGL140_COORD)
+      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+#if VERTEX_COLOR
+   if(slot->arrays & OGL140_COLOR)
+      glEnableClientState(GL_COLOR_ARRAY);
+#endif
+
+   streamPointers( object, (size_t)buffer * USHRT_MAX );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+#endif
+
+/* bind cached vertex array of object and index buffer,
+ * built on first use. returns 0 if pointers have to be set */
+static int vertexArray( dlObject *object, unsigned int buffer )
+{
+#if OGL140_VAO
+   dlVAO        *slot;
+   unsigned int element, hash;
+   CALL("%p, %u", object, buffer);
+
+   /* client arrays and stream ring move every frame */
+   if(!draw.vao || _dlCore.render.mode != DL_MODE_VBO ||
+      object->vbo->streamed || !object->vbo->object)
+   { RET("%d", 0); return( 0 ); }
+
+   /* deleted names may be reused by new buffers */
+   if(vao.deleted != dlDeletedBuffers())
+      vaoFlush();
+
+   element = object->ibo ? object->ibo->object : 0;
+
+   /* generation is unique, copies sharing layout share vertex array */
+   hash = object->vbo->generation * 2654435761u;
+   hash ^= element * 40503u ^ buffer * 31u ^ draw.arrays;
+   slot = &vao.slot[ (hash >> 8) & (OGL140_VAO_CACHE - 1) ];
+
+   if(slot->object                                  &&
+      slot->generation == object->vbo->generation   &&
+      slot->element    == element                   &&
+      slot->buffer     == buffer                    &&
+      slot->arrays     == draw.arrays)
    {
-      bindVBO( object->vbo );
-         uvwPointer( object, 0 );
-         vertexPointer( object->vbo, 0 );
-         normalPointer( object->vbo, 0 );
-         colorPointer( object->vbo, 0 );
-      unbindVBO( object->vbo );
-
-      /* bind automatically */
-      elementDraw( object, 0 );
+      dlBindVertexArray( slot->object, element );
+
+      RET("%d", 1);
+      return( 1 );
    }
+
+   /* replaces whatever was cached in slot */
+   slot->generation = object->vbo->generation;
+   slot->element    = element;
+   slot->buffer     = buffer;
+   slot->arrays     = draw.arrays;
+   if(vaoBuild( slot, object, buffer ) != RETURN_OK)
+   { RET("%d", 0); return( 0 ); }
+
+   RET("%d", 1);
+   return( 1 );
 #else
-   bindVBO( object->vbo );
-      vertexPointer( object->vbo, 0 );
-      uvwPointer( object, 0 );
-      normalPointer( object->vbo, 0 );
-      colorPointer( object->vbo, 0 );
-   unbindVBO( object->vbo );
-
-   /* binds automatically */
-   elementDraw( object, 0 );
+   return( 0 );
 #endif
 }
 
+/* index buffers object is drawn with,
+ * 16-bit buffers each start from their own vertex offset */
+static unsigned int objectBuffers( dlObject *object )
+{
+#if USE_BUFFERS
+   if(object->ibo)
+      return( object->ibo->index_buffer );
+#endif
+
+   return( 1 );
+}
+
+/* draw the object */
+static void drawObject( dlObject *object )
+{
+   unsigned int i;
+   CALL("%p", object);
+
+   i = 0;
+   for(; i != objectBuffers( object ); ++i)
+   {
+      if(!vertexArray( object, i ))
+         objectPointers( object, (size_t)i * USHRT_MAX );
+
+      /* binds automatically */
+      elementDraw( object, i, 0 );
+   }
+}
+
 
 /* draw bounding box */
 static void drawAABB( dlObject *object )
@@ -303,16 +586,14 @@ static void drawAABB( dlObject *object )
 
    if(draw.texture)
       glDisable(GL_TEXTURE_2D);
-   if(draw.coord)
-      glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-   if(draw.normal)
-      glDisableClientState(GL_NORMAL_ARRAY);
-
-   draw.normal  = 0;
    draw.texture = 0;
-   draw.coord   = 0;
+
+   /* lines are drawn from default vertex array */
+   dlBindVertexArray( 0, 0 );
+   clientArrays( OGL140_VERTEX );
 
    glColor4f( 0, 1, 0, 1 );
+   dlBindBuffer( GL_ARRAY_BUFFER, 0 );
    glVertexPointer( 3, GL_FLOAT, 0, &points[0] );
    glDrawArrays( GL_LINES, 0, 24 );
    glColor4f( 1, 1, 1, 1 );
@@ -325,9 +606,7 @@ static void dlOGL140_setup( dlObject *object )
    CALL("%p", object);
 
    state.depth  = 0;
-   state.vertex = 0;
-   state.normal = 0;
-   state.coord  = 0;
+   state.arrays = 0;
    state.cull   = 0;
    state.texture= 0;
 
@@ -353,16 +632,15 @@ static void dlOGL140_setup( dlObject *object )
 
    /* we are going to use vertices */
    if(object->vbo->v_use)
-      state.vertex = 1;
+      state.arrays |= OGL140_VERTEX;
 
    /* we are going to use normals */
    if(object->vbo->n_use)
-      state.normal = 1;
+      state.arrays |= OGL140_NORMAL;
 
 #if VERTEX_COLOR
-   state.color = 0;
    if(object->vbo->c_use)
-      state.color  = 1;
+      state.arrays |= OGL140_COLOR;
 #endif
 
    /* we are going to use coords and texture */
@@ -373,14 +651,19 @@ static void dlOGL140_setup( dlObject *object )
          if(object->vbo->uvw[0].c_use)
          {
             state.texture = 1;
-            state.coord   = 1;
+            state.arrays |= OGL140_COORD |
+               (object->material->texture->uvw << OGL140_UVW_SHIFT);
          }
       }
    }
 
+   /* pointers are set when object is drawn */
+   draw.arrays = state.arrays;
+
    /* check state */
    if(draw.cull != state.cull)
    {
+      _dlCore.render.stats.stateChanges++;
       if(state.cull)
          glEnable( GL_CULL_FACE );
       else
@@ -392,6 +675,7 @@ static void dlOGL140_setup( dlObject *object )
    /* check state */
    if(draw.depth != state.depth)
    {
+      _dlCore.render.stats.stateChanges++;
       if(state.depth)
       {
          glEnable(GL_DEPTH_TEST);
@@ -405,59 +689,10 @@ static void dlOGL140_setup( dlObject *object )
       draw.depth = state.depth;
    }
 
-   /* check state */
-   if(draw.vertex != state.vertex)
-   {
-      if(state.vertex)
-         glEnableClientState(GL_VERTEX_ARRAY);
-      else
-         glDisableClientState(GL_VERTEX_ARRAY);
-
-      draw.vertex = state.vertex;
-   }
-
-
-   /* check state */
-   if(draw.normal != state.normal)
-   {
-      if(state.normal)
-         glEnableClientState(GL_NORMAL_ARRAY);
-      else
-         glDisableClientState(GL_NORMAL_ARRAY);
-
-      draw.normal = state.normal;
-   }
-
-#if VERTEX_COLOR
-   /* check state */
-   if(draw.color != state.color)
-   {
-      if(state.color)
-         lEnableClientState(GL_COLOR_ARRAY);
-      else
-      {
-         glDisableClientState(GL_COLOR_ARRAY);
-         glColor4f( 1, 1, 1, 1 );
-      }
-
-      draw.color = state.color;
-   }
-#endif
-
-   /* check state */
-   if(draw.coord != state.coord)
-   {
-      if(state.coord)
-         glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-      else
-         glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-      draw.coord = state.coord;
-   }
-
    /* check state */
    if(draw.texture != state.texture)
    {
+      _dlCore.render.stats.stateChanges++;
       if(state.texture)
       {
          glEnable(GL_TEXTURE_2D);
@@ -472,8 +707,13 @@ static void dlOGL140_setup( dlObject *object )
       draw.texture = state.texture;
    }
 
+   /* texture is not part of cached pointer setup */
+   if(draw.texture)
+      bindTexture( object );
+
    if(draw.alpha != state.alpha)
    {
+      _dlCore.render.stats.stateChanges++;
       if(state.alpha)
          glEnable(GL_BLEND);
       else
@@ -484,6 +724,7 @@ static void dlOGL140_setup( dlObject *object )
 
    if(draw.blend1 != state.blend1 || draw.blend2 != state.blend2)
    {
+      _dlCore.render.stats.stateChanges++;
       glBlendFunc( state.blend1, state.blend2 );
 
       draw.blend1 = state.blend1;
@@ -492,8 +733,90 @@ static void dlOGL140_setup( dlObject *object )
 
 }
 
+/* decode quantized coords through texture matrix */
+static void quantizeCoords( dlObject *object )
+{
+   dlUVW *uvw = NULL;
+   CALL("%p", object);
+
+   if(draw.texture)
+      uvw = &object->vbo->uvw[ object->material->texture->uvw ];
+
+   if(uvw && uvw->cType == GL_SHORT)
+   {
+      glMatrixMode(GL_TEXTURE);
+      glLoadIdentity();
+      glTranslatef( uvw->qBias.x, uvw->qBias.y, 0 );
+      glScalef( uvw->qScale.x, uvw->qScale.y, 1 );
+      glMatrixMode(GL_MODELVIEW);
+      draw.texture_matrix = 1;
+   }
+   else if(draw.texture_matrix)
+   {
+      glMatrixMode(GL_TEXTURE);
+      glLoadIdentity();
+      glMatrixMode(GL_MODELVIEW);
+      draw.texture_matrix = 0;
+   }
+}
+
+/* decode int16 positions through current modelview */
+static void quantizePositions( dlVBO *vbo )
+{
+   CALL("%p", vbo);
+
+   glTranslatef( vbo->qBias.x, vbo->qBias.y, vbo->qBias.z );
+   glScalef( vbo->qScale.x, vbo->qScale.y, vbo->qScale.z );
+}
+
+/* decode quantized streams,
+ * int16 positions through modelview and coords through texture matrix.
+ * returns 1 if modelview was pushed */
+static int quantizeMatrix( dlObject *object )
+{
+   int pushed = 0;
+   CALL("%p", object);
+
+   if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+   { RET("%d", 0); return( 0 ); }
+
+   quantizeCoords( object );
+
+   /* object->matrix stays in model space for AABB and bones */
+   if(object->vbo->vType == GL_SHORT)
+   {
+      glPushMatrix();
+      quantizePositions( object->vbo );
+      pushed = 1;
+   }
+
+   RET("%d", pushed);
+   return( pushed );
+}
+
+#ifndef GLES1
+/* shader reading DL_IN_INSTANCE outside of hardware instancing
+ * gets identity, current attribute value would be used otherwise */
+static void instanceIdentity( void )
+{
+   unsigned int i;
+   TRACE();
+
+   if(!_dlCore.render.shader || !_dlCore.render.shader->instance ||
+      draw.instance_identity)
+      return;
+
+   i = 0;
+   for(; i != 4; ++i)
+      glVertexAttrib4f( DL_INSTANCE_ATTRIB + i, i == 0, i == 1, i == 2, i == 3 );
+
+   draw.instance_identity = 1;
+}
+#endif
+
 static void dlOGL140_draw( dlObject *object )
 {
+   int pushed;
    CALL("%p", object);
 
    glMatrixMode(GL_PROJECTION);
@@ -503,17 +826,151 @@ static void dlOGL140_draw( dlObject *object )
    glLoadMatrixf( (float*)&object->matrix );
 
    dlOGL140_setup( object );
+   pushed = quantizeMatrix( object );
+#ifndef GLES1
+   instanceIdentity();
+#endif
 
    drawObject( object );
+   if(pushed) glPopMatrix();
    drawAABB( object );
 }
 
+#if OGL140_INSTANCING
+/* stream matrices of this draw in one upload
+ * and point instance attribute at them */
+static int instancePointer( const kmMat4 *matrices, unsigned int n )
+{
+   const char   *base;
+   void         *data;
+   size_t       offset;
+   unsigned int i;
+   CALL("%p, %u", matrices, n);
+
+   /* attributes are set in default vertex array */
+   dlBindVertexArray( 0, 0 );
+
+   if(!(data = dlStreamMap( n * sizeof(kmMat4), &offset )))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memcpy( data, matrices, n * sizeof(kmMat4) );
+   dlStreamUnmap();
+
+   if(dlStreamObject())
+      base = BUFFER_OFFSET( offset );
+   else
+      base = (const char*)dlStreamData() + offset;
+
+   /* mat4 takes four attributes, one per column */
+   dlBindBuffer( GL_ARRAY_BUFFER, dlStreamObject() );
+   i = 0;
+   for(; i != 4; ++i)
+   {
+      glEnableVertexAttribArray( DL_INSTANCE_ATTRIB + i );
+      glVertexAttribPointer( DL_INSTANCE_ATTRIB + i, 4, GL_FLOAT, GL_FALSE,
+                             sizeof(kmMat4), base + i * 4 * sizeof(kmScalar) );
+      glVertexAttribDivisorARB( DL_INSTANCE_ATTRIB + i, 1 );
+   }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* instance attribute off for following draws */
+static void instanceDisable( void )
+{
+   unsigned int i;
+   TRACE();
+
+   i = 0;
+   for(; i != 4; ++i)
+      glDisableVertexAttribArray( DL_INSTANCE_ATTRIB + i );
+
+   /* current value is undefined after array use */
+   draw.instance_identity = 0;
+}
+#endif
+
+/* draw object once per matrix */
+static void dlOGL140_drawInstanced( dlObject *object, const kmMat4 *matrices, unsigned int n )
+{
+   unsigned int b, i;
+   int hardware = 0;
+   CALL("%p, %p, %u", object, matrices, n);
+
+   glMatrixMode(GL_PROJECTION);
+   glLoadMatrixf( (float*)&_dlCore.render.projection );
+   glMatrixMode(GL_MODELVIEW);
+
+   dlOGL140_setup( object );
+   if(_dlCore.render.mode != DL_MODE_VERTEX_ARRAY)
+      quantizeCoords( object );
+
+#if OGL140_INSTANCING
+   /* fixed function can't read per instance data,
+    * shader gets instance matrix from DL_IN_INSTANCE */
+   if(draw.instancing && _dlCore.render.shader &&
+      _dlCore.render.shader->instance && _dlCore.render.mode == DL_MODE_VBO)
+   {
+      glLoadIdentity();
+      if(object->vbo->vType == GL_SHORT)
+         quantizePositions( object->vbo );
+
+      hardware = (instancePointer( matrices, n ) == RETURN_OK);
+   }
+#endif
+#ifndef GLES1
+   if(!hardware) instanceIdentity();
+#endif
+
+   b = 0;
+   for(; b != objectBuffers( object ); ++b)
+   {
+      if(hardware)
+      {
+         objectPointers( object, (size_t)b * USHRT_MAX );
+         elementDraw( object, b, n );
+         continue;
+      }
+
+      if(!vertexArray( object, b ))
+         objectPointers( object, (size_t)b * USHRT_MAX );
+
+      /* only matrix changes between instances */
+      i = 0;
+      for(; i != n; ++i)
+      {
+         glLoadMatrixf( (float*)&matrices[i] );
+         if(_dlCore.render.mode != DL_MODE_VERTEX_ARRAY &&
+            object->vbo->vType == GL_SHORT)
+            quantizePositions( object->vbo );
+
+         elementDraw( object, b, 0 );
+      }
+   }
+
+#if OGL140_INSTANCING
+   if(hardware) instanceDisable();
+#endif
+}
+
+#if OGL140_VAO
+/* delete cached vertex arrays */
+static void dlOGL140_release( void )
+{
+   TRACE();
+
+   vaoFlush();
+}
+#endif
+
 /* OpenGL 1.4+ renderer */
 int dlOGL140( void )
 {
    TRACE();
 
    _dlCore.render.draw     = dlOGL140_draw;
+   _dlCore.render.drawInstanced = dlOGL140_drawInstanced;
    _dlCore.render.string   = OGL140_NAME;
 
    draw.vertex  = 0;
@@ -532,6 +989,25 @@ int dlOGL140( void )
 
    draw.active_texture = 0;
    draw.last_texture   = 0;
+   draw.texture_matrix = 0;
+   draw.arrays         = 0;
+   draw.instancing     = 0;
+   draw.vao            = 0;
+   draw.instance_identity = 0;
+
+#if OGL140_INSTANCING
+   draw.instancing = GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced;
+#endif
+
+#if OGL140_VAO
+   /* vertex arrays of old context are gone */
+   memset( &vao, 0, sizeof(dlVAOCache) );
+   vao.deleted = dlDeletedBuffers();
+
+   /* core since 3.0, objectPointers on every draw without */
+   draw.vao = GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
+   if(draw.vao) _dlCore.render.release = dlOGL140_release;
+#endif
 
    RET("%d", RETURN_OK);
    return(RETURN_OK);
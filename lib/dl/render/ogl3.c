@@ -0,0 +1,881 @@
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dlConfig.h"
+#include "dlCore.h"
+#include "dlSceneobject.h"
+#include "dlTypes.h"
+#include "dlFramework.h"
+#include "dlLog.h"
+
+#define OGL3_NAME "OpenGL 3.1+"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#endif
+#ifdef GLES1
+#  include <GLES/gl.h>
+#endif
+#if !defined(GLES1) && !defined(GLES2)
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#endif
+#include "dlGL.h"
+#define DL_DEBUG_CHANNEL "OGL3"
+
+#define BUFFER_OFFSET(i) ((char *)NULL + (i))
+
+/* core profile draws only from vertex arrays */
+#if !defined(GLES1) && !defined(GLES2) && GL_ARB_vertex_array_object
+#  define OGL3_SUPPORT 1
+#else
+#  define OGL3_SUPPORT 0
+#endif
+
+#if OGL3_SUPPORT
+
+/* frame matrices from uniform buffer */
+#if GL_ARB_uniform_buffer_object
+#  define OGL3_FRAME_BUFFER 1
+#else
+#  define OGL3_FRAME_BUFFER 0
+#endif
+
+/* per instance matrix is read by shader */
+#if GL_ARB_instanced_arrays && GL_ARB_draw_instanced
+#  define OGL3_INSTANCING 1
+#else
+#  define OGL3_INSTANCING 0
+#endif
+
+/* cached vertex arrays, power of two */
+#define OGL3_VAO_CACHE 256
+
+/* attributes object is drawn with,
+ * coord set is stored above these */
+#define OGL3_VERTEX     1
+#define OGL3_NORMAL     2
+#define OGL3_COORD      4
+#define OGL3_COLOR      8
+#define OGL3_UVW_SHIFT  4
+
+/* DL_FRAME uniform block, std140,
+ * projection already holds camera */
+typedef struct
+{
+   kmMat4 projection;
+} dlFrameBlock;
+
+/* vertex array with attributes of one object setup */
+typedef struct
+{
+   unsigned int object;       /* GL vertex array, 0 if slot is free */
+   unsigned int generation;   /* VBO layout it was built for */
+   unsigned int element;      /* element buffer bound in it */
+   unsigned int buffer;       /* index buffer with USE_BUFFERS */
+   unsigned int arrays;       /* enabled attributes and coord set */
+} dlVAO3;
+
+typedef struct
+{
+   uint8_t depth;
+   uint8_t cull;
+
+   uint8_t alpha;
+   unsigned int blend1;
+   unsigned int blend2;
+
+   unsigned int last_texture;
+
+   /* attributes of current object */
+   unsigned int arrays;
+
+   /* direct mapped vertex array cache */
+   dlVAO3       slot[ OGL3_VAO_CACHE ];
+   unsigned int deleted;      /* dlDeletedBuffers when built */
+
+   /* vertex array of streamed and client data,
+    * pointers are set on every draw */
+   dlVAO3       dynamic;
+
+   /* frame uniform buffer and what it holds */
+   unsigned int frame;
+   dlFrameBlock block;
+   uint8_t      block_valid;
+
+   /* drawing without shader was reported */
+   uint8_t      warned;
+
+   /* driver has instancing entry points,
+    * headers alone don't tell */
+   uint8_t      instancing;
+
+   /* DL_IN_INSTANCE holds identity */
+   uint8_t      instance_identity;
+} dlState3;
+
+/* global draw state */
+static dlState3 draw;
+
+/* bind VBO, binding is cached so objects sharing
+ * heap page or stream ring don't rebind */
+static void bindVBO( dlVBO *vbo )
+{
+   CALL("%p", vbo);
+
+   /* client arrays */
+   if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+      dlBindBuffer( GL_ARRAY_BUFFER, 0 );
+   /* streamed data lives in the ring */
+   else if(vbo->streamed)
+      dlBindBuffer( GL_ARRAY_BUFFER, dlStreamObject() );
+   else
+      dlBindBuffer( GL_ARRAY_BUFFER, vbo->object );
+}
+
+/* bind texture of material */
+static void bindTexture( dlObject *object )
+{
+   CALL("%p", object);
+
+   if(!object->material->texture->object)
+       return;
+   if(object->material->texture->object == draw.last_texture)
+       return;
+
+   draw.last_texture = object->material->texture->object;
+   _dlCore.render.stats.textureBinds++;
+   glBindTexture( GL_TEXTURE_2D,
+                  object->material->texture->object );
+}
+
+/* pointer to element inside VBO,
+ * interleaved VBOs step by stride, planar ones by element size.
+ * stream ring without GL buffer is drawn from system memory */
+static const void* vboOffset( dlVBO *vbo, size_t base, size_t offset, size_t size )
+{
+   base += vbo->base;
+   if(vbo->stride)
+      base += offset * vbo->stride;
+   else
+      base += offset * size;
+
+   if(vbo->streamed && !dlStreamObject())
+      return( dlStreamData() + base );
+
+   return( BUFFER_OFFSET( base ) );
+}
+
+/* stride of stream, planar streams are packed by element size */
+static size_t vboStride( dlVBO *vbo, size_t size )
+{
+   return( vbo->stride ? vbo->stride : size );
+}
+
+/* enable or disable attribute in bound vertex array */
+static void attribArray( unsigned int index, int enabled )
+{
+   if(enabled) glEnableVertexAttribArray( index );
+   else        glDisableVertexAttribArray( index );
+}
+
+/* point attributes at streams starting from vertex offset,
+ * only attributes in arrays are set */
+static void attribPointers( dlObject *object, unsigned int arrays, size_t offset )
+{
+   dlVBO        *vbo = object->vbo;
+   dlUVW        *uvw;
+   unsigned int size;
+   CALL("%p, %u, %llu", object, arrays, offset);
+
+   bindVBO( vbo );
+
+   if(arrays & OGL3_VERTEX)
+   {
+      if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+         glVertexAttribPointer( DL_VERTEX_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0,
+                                &vbo->vertices[ offset ] );
+      else
+         glVertexAttribPointer( DL_VERTEX_ATTRIB, 3, vbo->vType, GL_FALSE,
+                                vboStride( vbo, vbo->vSize ),
+                                vboOffset( vbo, vbo->vOffset, offset, vbo->vSize ) );
+   }
+
+   /* quantized normals are normalized integers */
+   if(arrays & OGL3_NORMAL)
+   {
+      if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+         glVertexAttribPointer( DL_NORMAL_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0,
+                                &vbo->normals[ offset ] );
+      else
+      {
+         size = (vbo->nType == GL_INT_2_10_10_10_REV) ? 4 : 3;
+         glVertexAttribPointer( DL_NORMAL_ATTRIB, size, vbo->nType,
+                                vbo->nType != GL_FLOAT,
+                                vboStride( vbo, vbo->nSize ),
+                                vboOffset( vbo, vbo->nOffset, offset, vbo->nSize ) );
+      }
+   }
+
+   if(arrays & OGL3_COORD)
+   {
+      uvw = &vbo->uvw[ arrays >> OGL3_UVW_SHIFT ];
+      if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+         glVertexAttribPointer( DL_COORD_ATTRIB, 2, GL_FLOAT, GL_FALSE, 0,
+                                &uvw->coords[ offset ] );
+      else
+         glVertexAttribPointer( DL_COORD_ATTRIB, 2, uvw->cType, GL_FALSE,
+                                vboStride( vbo, uvw->cSize ),
+                                vboOffset( vbo, uvw->cOffset, offset, uvw->cSize ) );
+   }
+
+#if VERTEX_COLOR
+   if(arrays & OGL3_COLOR)
+   {
+      if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+         glVertexAttribPointer( DL_COLOR_ATTRIB, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0,
+                                &vbo->colors[ offset ] );
+      else
+         glVertexAttribPointer( DL_COLOR_ATTRIB, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                vboStride( vbo, sizeof(dlColor) ),
+                                vboOffset( vbo, vbo->cOffset, offset, sizeof(dlColor) ) );
+   }
+#endif
+}
+
+/* enable attributes that differ from old set */
+static void attribArrays( unsigned int arrays, unsigned int old )
+{
+   CALL("%u, %u", arrays, old);
+
+   if((arrays ^ old) & OGL3_VERTEX)
+      attribArray( DL_VERTEX_ATTRIB, arrays & OGL3_VERTEX );
+   if((arrays ^ old) & OGL3_NORMAL)
+      attribArray( DL_NORMAL_ATTRIB, arrays & OGL3_NORMAL );
+   if((arrays ^ old) & OGL3_COORD)
+      attribArray( DL_COORD_ATTRIB,  arrays & OGL3_COORD );
+#if VERTEX_COLOR
+   if((arrays ^ old) & OGL3_COLOR)
+      attribArray( DL_COLOR_ATTRIB,  arrays & OGL3_COLOR );
+#endif
+}
+
+/* element buffer of object, 0 for client indices */
+static unsigned int objectElement( dlObject *object )
+{
+   if(!object->ibo || _dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+      return( 0 );
+
+   return( object->ibo->object );
+}
+
+/* index buffers object is drawn with,
+ * 16-bit buffers each start from their own vertex offset */
+static unsigned int objectBuffers( dlObject *object )
+{
+#if USE_BUFFERS
+   if(object->ibo)
+      return( object->ibo->index_buffer );
+#endif
+
+   return( 1 );
+}
+
+/* delete every cached vertex array */
+static void vaoFlush( void )
+{
+   unsigned int i;
+   TRACE();
+
+   i = 0;
+   for(; i != OGL3_VAO_CACHE; ++i)
+      dlDeleteVertexArray( &draw.slot[i].object );
+
+   draw.deleted = dlDeletedBuffers();
+}
+
+/* bind vertex array and its element buffer,
+ * dlBindBuffer would bind default vertex array first */
+static void vaoBind( dlVAO3 *vao, unsigned int element )
+{
+   dlBindVertexArray( vao->object, element );
+   if(vao->element == element)
+      return;
+
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, element );
+   vao->element = element;
+}
+
+/* build vertex array for current object,
+ * a fresh one has every attribute disabled */
+static int vaoBuild( dlVAO3 *slot, dlObject *object, unsigned int buffer )
+{
+   unsigned int element;
+   CALL("%p, %p, %u", slot, object, buffer);
+
+   element = slot->element;
+
+   dlDeleteVertexArray( &slot->object );
+   glGenVertexArrays( 1, &slot->object );
+   if(!slot->object)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   slot->element = 0;
+   vaoBind( slot, element );
+
+   attribArrays( slot->arrays, 0 );
+   attribPointers( object, slot->arrays, (size_t)buffer * USHRT_MAX );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* vertex array of data that moves between frames */
+static int vaoDynamic( dlObject *object, unsigned int buffer )
+{
+   CALL("%p, %u", object, buffer);
+
+   if(!draw.dynamic.object)
+   {
+      glGenVertexArrays( 1, &draw.dynamic.object );
+      if(!draw.dynamic.object)
+      { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+      draw.dynamic.element = 0;
+      draw.dynamic.arrays  = 0;
+   }
+
+   vaoBind( &draw.dynamic, objectElement( object ) );
+
+   attribArrays( draw.arrays, draw.dynamic.arrays );
+   draw.dynamic.arrays = draw.arrays;
+   attribPointers( object, draw.arrays, (size_t)buffer * USHRT_MAX );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* bind vertex array of object and index buffer,
+ * cached ones are built on first use */
+static int vertexArray( dlObject *object, unsigned int buffer )
+{
+   dlVAO3       *slot;
+   unsigned int element, hash;
+   int          ret;
+   CALL("%p, %u", object, buffer);
+
+   /* client arrays and stream ring move every frame */
+   if(_dlCore.render.mode != DL_MODE_VBO ||
+      object->vbo->streamed || !object->vbo->object)
+   {
+      ret = vaoDynamic( object, buffer );
+
+      RET("%d", ret);
+      return( ret );
+   }
+
+   /* deleted names may be reused by new buffers */
+   if(draw.deleted != dlDeletedBuffers())
+      vaoFlush();
+
+   element = objectElement( object );
+
+   /* generation is unique, copies sharing layout share vertex array */
+   hash = object->vbo->generation * 2654435761u;
+   hash ^= element * 40503u ^ buffer * 31u ^ draw.arrays;
+   slot = &draw.slot[ (hash >> 8) & (OGL3_VAO_CACHE - 1) ];
+
+   if(slot->object                                  &&
+      slot->generation == object->vbo->generation   &&
+      slot->element    == element                   &&
+      slot->buffer     == buffer                    &&
+      slot->arrays     == draw.arrays)
+   {
+      dlBindVertexArray( slot->object, element );
+
+      RET("%d", RETURN_OK);
+      return( RETURN_OK );
+   }
+
+   /* replaces whatever was cached in slot */
+   slot->generation = object->vbo->generation;
+   slot->element    = element;
+   slot->buffer     = buffer;
+   slot->arrays     = draw.arrays;
+   ret = vaoBuild( slot, object, buffer );
+
+   RET("%d", ret);
+   return( ret );
+}
+
+/* draw arrays, instanced if instances is not 0 */
+static void arraysDraw( dlObject *object, unsigned int instances )
+{
+#if OGL3_INSTANCING
+   if(instances)
+   {
+      glDrawArraysInstancedARB( object->primitive_type, 0, object->vbo->v_use, instances );
+      return;
+   }
+#endif
+
+   glDrawArrays( object->primitive_type, 0, object->vbo->v_use );
+}
+
+/* indices from element buffer of bound vertex array,
+ * instanced if instances is not 0 */
+static void elementDraw( dlObject *object, unsigned int index, unsigned int instances )
+{
+   unsigned int indices_type;
+   unsigned int i_use;
+   size_t       iOffset;
+#if USE_BUFFERS
+   unsigned short *indices;
+#else
+   unsigned int   *indices;
+#endif
+   const void   *offset;
+   CALL("%p, %u, %u", object, index, instances);
+
+   _dlCore.render.stats.draws++;
+
+   if(!object->ibo)
+   {
+      if(object->vbo->v_use)
+         arraysDraw( object, instances );
+      return;
+   }
+
+#if USE_BUFFERS
+   indices        = object->ibo->indices[index];
+
+   indices_type   = GL_UNSIGNED_SHORT;
+   i_use          = object->ibo->i_use[ index ];
+   iOffset        = object->ibo->iOffset[ index ];
+#else
+   indices        = object->ibo->indices;
+
+   /* buffer may hold narrowed copy */
+   indices_type   = GL_UNSIGNED_INT;
+   if(_dlCore.render.mode != DL_MODE_VERTEX_ARRAY)
+      indices_type = object->ibo->type;
+   i_use          = object->ibo->i_use;
+   iOffset        = 0;
+#endif
+
+   if(!i_use)
+   {
+      if(object->vbo->v_use)
+         arraysDraw( object, instances );
+      return;
+   }
+
+   if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+      offset = &indices[ 0 ];
+   else
+      offset = BUFFER_OFFSET( object->ibo->range.offset + iOffset );
+
+#if OGL3_INSTANCING
+   if(instances)
+   {
+      glDrawElementsInstancedARB( object->primitive_type, i_use,
+                                  indices_type, offset, instances );
+      return;
+   }
+#endif
+
+   glDrawElements( object->primitive_type, i_use,
+                   indices_type, offset );
+}
+
+/* projection of this frame,
+ * uploaded only when it changes */
+static void frameUniforms( dlShader *shader )
+{
+   dlFrameBlock block;
+   CALL("%p", shader);
+
+   block.projection = _dlCore.render.projection;
+
+#if OGL3_FRAME_BUFFER
+   if(draw.frame)
+   {
+      if(draw.block_valid && !memcmp( &block, &draw.block, sizeof(dlFrameBlock) ))
+         return;
+
+      dlBindBuffer( GL_UNIFORM_BUFFER, draw.frame );
+      glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof(dlFrameBlock), &block );
+
+      draw.block       = block;
+      draw.block_valid = 1;
+      return;
+   }
+#endif
+
+   /* program without uniform block */
+   dlShaderUniformMatrix4( shader->projection, &block.projection );
+}
+
+/* object matrix to DL_VIEW,
+ * int16 positions are decoded through it
+ * and int16 coords through DL_TEXTURE_MATRIX */
+static void objectUniforms( dlShader *shader, dlObject *object, const kmMat4 *matrix )
+{
+   kmMat4 view, decode, scale;
+   dlUVW  *uvw;
+   CALL("%p, %p, %p", shader, object, matrix);
+
+   view = *matrix;
+   if(_dlCore.render.mode != DL_MODE_VERTEX_ARRAY &&
+      object->vbo->vType == GL_SHORT)
+   {
+      kmMat4Translation( &decode, object->vbo->qBias.x,
+                         object->vbo->qBias.y, object->vbo->qBias.z );
+      kmMat4Scaling( &scale, object->vbo->qScale.x,
+                     object->vbo->qScale.y, object->vbo->qScale.z );
+      kmMat4Multiply( &decode, &decode, &scale );
+      kmMat4Multiply( &view, matrix, &decode );
+   }
+
+   dlShaderUniformMatrix4( shader->view, &view );
+
+   if(!shader->texture || !(draw.arrays & OGL3_COORD))
+      return;
+
+   kmMat4Identity( &decode );
+   uvw = &object->vbo->uvw[ draw.arrays >> OGL3_UVW_SHIFT ];
+   if(_dlCore.render.mode != DL_MODE_VERTEX_ARRAY &&
+      uvw->cType == GL_SHORT)
+   {
+      kmMat4Translation( &decode, uvw->qBias.x, uvw->qBias.y, 0 );
+      kmMat4Scaling( &scale, uvw->qScale.x, uvw->qScale.y, 1 );
+      kmMat4Multiply( &decode, &decode, &scale );
+   }
+
+   dlShaderUniformMatrix4( shader->texture, &decode );
+}
+
+/* shader reading DL_IN_INSTANCE outside of hardware instancing
+ * gets identity, current attribute value would be used otherwise */
+static void instanceIdentity( dlShader *shader )
+{
+   unsigned int i;
+   CALL("%p", shader);
+
+   if(!shader->instance || draw.instance_identity)
+      return;
+
+   i = 0;
+   for(; i != 4; ++i)
+      glVertexAttrib4f( DL_INSTANCE_ATTRIB + i, i == 0, i == 1, i == 2, i == 3 );
+
+   draw.instance_identity = 1;
+}
+
+/* shader and state of object,
+ * returns shader or NULL if object can't be drawn */
+static dlShader* dlOGL3_setup( dlObject *object )
+{
+   /* current object's state */
+   uint8_t      cull, alpha;
+   unsigned int blend1, blend2, texture;
+   dlShader     *shader;
+   CALL("%p", object);
+
+   /* core profile has no fixed function */
+   if(!(shader = _dlCore.render.shader))
+   {
+      if(!draw.warned)
+      { LOGWARN("OpenGL 3.1+ renderer needs a shader, see dlBindShader"); }
+      draw.warned = 1;
+
+      RET("%p", NULL);
+      return( NULL );
+   }
+
+   dlBindShader( shader );
+   frameUniforms( shader );
+
+   /* material flags */
+   if( object->material )
+   {
+      /* properities */
+      alpha  = (object->material->flags  & DL_MATERIAL_ALPHA) != 0;
+      cull   = !(object->material->flags & DL_MATERIAL_DOUBLE_SIDED);
+      blend1 = object->material->blend1;
+      blend2 = object->material->blend2;
+   }
+   else
+   {
+      alpha  = 0;
+      cull   = 1;
+      blend1 = draw.blend1;
+      blend2 = draw.blend2;
+   }
+
+   /* attributes we are going to use */
+   draw.arrays = 0;
+   if(object->vbo->v_use)
+      draw.arrays |= OGL3_VERTEX;
+   if(object->vbo->n_use)
+      draw.arrays |= OGL3_NORMAL;
+#if VERTEX_COLOR
+   if(object->vbo->c_use)
+      draw.arrays |= OGL3_COLOR;
+#endif
+
+   texture = 0;
+   if(object->material && object->material->texture &&
+      object->vbo->uvw[0].c_use)
+   {
+      texture = 1;
+      draw.arrays |= OGL3_COORD |
+         (object->material->texture->uvw << OGL3_UVW_SHIFT);
+   }
+
+   /* depth for now always */
+   if(!draw.depth)
+   {
+      _dlCore.render.stats.stateChanges++;
+      glEnable(GL_DEPTH_TEST);
+      glDepthFunc(GL_LEQUAL);
+      draw.depth = 1;
+   }
+
+   /* check state */
+   if(draw.cull != cull)
+   {
+      _dlCore.render.stats.stateChanges++;
+      if(cull)
+         glEnable( GL_CULL_FACE );
+      else
+         glDisable( GL_CULL_FACE );
+
+      draw.cull = cull;
+   }
+
+   if(draw.alpha != alpha)
+   {
+      _dlCore.render.stats.stateChanges++;
+      if(alpha)
+         glEnable(GL_BLEND);
+      else
+         glDisable(GL_BLEND);
+
+      draw.alpha = alpha;
+   }
+
+   if(draw.blend1 != blend1 || draw.blend2 != blend2)
+   {
+      _dlCore.render.stats.stateChanges++;
+      glBlendFunc( blend1, blend2 );
+
+      draw.blend1 = blend1;
+      draw.blend2 = blend2;
+   }
+
+   if(texture)
+      bindTexture( object );
+
+   RET("%p", shader);
+   return( shader );
+}
+
+static void dlOGL3_draw( dlObject *object )
+{
+   dlShader     *shader;
+   unsigned int i;
+   CALL("%p", object);
+
+   if(!(shader = dlOGL3_setup( object )))
+      return;
+
+   objectUniforms( shader, object, &object->matrix );
+   instanceIdentity( shader );
+
+   i = 0;
+   for(; i != objectBuffers( object ); ++i)
+   {
+      if(vertexArray( object, i ) != RETURN_OK)
+         return;
+
+      elementDraw( object, i, 0 );
+   }
+}
+
+#if OGL3_INSTANCING
+/* stream matrices of this draw in one upload
+ * and point instance attribute of bound vertex array at them */
+static int instancePointer( const kmMat4 *matrices, unsigned int n )
+{
+   const char   *base;
+   void         *data;
+   size_t       offset;
+   unsigned int i;
+   CALL("%p, %u", matrices, n);
+
+   if(!(data = dlStreamMap( n * sizeof(kmMat4), &offset )))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memcpy( data, matrices, n * sizeof(kmMat4) );
+   dlStreamUnmap();
+
+   if(dlStreamObject())
+      base = BUFFER_OFFSET( offset );
+   else
+      base = (const char*)dlStreamData() + offset;
+
+   /* mat4 takes four attributes, one per column */
+   dlBindBuffer( GL_ARRAY_BUFFER, dlStreamObject() );
+   i = 0;
+   for(; i != 4; ++i)
+   {
+      glEnableVertexAttribArray( DL_INSTANCE_ATTRIB + i );
+      glVertexAttribPointer( DL_INSTANCE_ATTRIB + i, 4, GL_FLOAT, GL_FALSE,
+                             sizeof(kmMat4), base + i * 4 * sizeof(kmScalar) );
+      glVertexAttribDivisorARB( DL_INSTANCE_ATTRIB + i, 1 );
+   }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* instance attribute off, vertex array stays as cached */
+static void instanceDisable( void )
+{
+   unsigned int i;
+   TRACE();
+
+   i = 0;
+   for(; i != 4; ++i)
+      glDisableVertexAttribArray( DL_INSTANCE_ATTRIB + i );
+
+   /* current value is undefined after array use */
+   draw.instance_identity = 0;
+}
+
+/* draw object once per matrix in one call per index buffer,
+ * shader gets instance matrix from DL_IN_INSTANCE */
+static void dlOGL3_drawInstanced( dlObject *object, const kmMat4 *matrices, unsigned int n )
+{
+   dlShader     *shader;
+   kmMat4       identity;
+   unsigned int b, i;
+   CALL("%p, %p, %u", object, matrices, n);
+
+   if(!(shader = dlOGL3_setup( object )))
+      return;
+
+   /* instance matrix goes through DL_VIEW one draw at time */
+   if(!draw.instancing || !shader->instance)
+   {
+      instanceIdentity( shader );
+      b = 0;
+      for(; b != objectBuffers( object ); ++b)
+      {
+         if(vertexArray( object, b ) != RETURN_OK)
+            return;
+
+         i = 0;
+         for(; i != n; ++i)
+         {
+            objectUniforms( shader, object, &matrices[i] );
+            elementDraw( object, b, 0 );
+         }
+      }
+      return;
+   }
+
+   kmMat4Identity( &identity );
+   objectUniforms( shader, object, &identity );
+
+   b = 0;
+   for(; b != objectBuffers( object ); ++b)
+   {
+      if(vertexArray( object, b ) != RETURN_OK)
+         return;
+
+      if(instancePointer( matrices, n ) != RETURN_OK)
+         return;
+
+      elementDraw( object, b, n );
+      instanceDisable();
+   }
+}
+#endif
+
+/* delete vertex arrays and frame buffer */
+static void dlOGL3_release( void )
+{
+   TRACE();
+
+   vaoFlush();
+   dlDeleteVertexArray( &draw.dynamic.object );
+   dlDeleteBuffer( &draw.frame );
+   draw.block_valid = 0;
+}
+
+/* OpenGL 3.1+ renderer */
+int dlOGL3( void )
+{
+   TRACE();
+
+   /* every draw goes through vertex arrays */
+   if(!(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object))
+   {
+      LOGERR("OpenGL 3.1+ renderer needs vertex array objects");
+      RET("%d", RETURN_FAIL);
+      return( RETURN_FAIL );
+   }
+
+   /* client arrays are not part of core profile */
+   if(_dlCore.render.mode == DL_MODE_VERTEX_ARRAY)
+   { LOGWARN("Vertex array mode needs compatibility profile"); }
+
+   /* GL objects of old context are gone */
+   memset( &draw, 0, sizeof(dlState3) );
+   draw.deleted = dlDeletedBuffers();
+#if OGL3_INSTANCING
+   draw.instancing = GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced;
+#endif
+
+#if OGL3_FRAME_BUFFER
+   /* shared by every shader through DL_FRAME_BINDING */
+   if(dlShaderFrameBlock())
+   {
+      glGenBuffers( 1, &draw.frame );
+      if(draw.frame)
+      {
+         dlBindBuffer( GL_UNIFORM_BUFFER, draw.frame );
+         glBufferData( GL_UNIFORM_BUFFER, sizeof(dlFrameBlock), NULL, GL_DYNAMIC_DRAW );
+         glBindBufferBase( GL_UNIFORM_BUFFER, DL_FRAME_BINDING, draw.frame );
+      }
+   }
+#endif
+
+   _dlCore.render.draw     = dlOGL3_draw;
+#if OGL3_INSTANCING
+   _dlCore.render.drawInstanced = dlOGL3_drawInstanced;
+#endif
+   _dlCore.render.release  = dlOGL3_release;
+   _dlCore.render.string   = OGL3_NAME;
+
+   RET("%d", RETURN_OK);
+   return(RETURN_OK);
+}
+
+#else
+
+/* OpenGL 3.1+ renderer */
+int dlOGL3( void )
+{
+   TRACE();
+
+   LOGERR("OpenGL 3.1+ renderer needs desktop GL with vertex array objects");
+
+   RET("%d", RETURN_FAIL);
+   return( RETURN_FAIL );
+}
+
+#endif /* OGL3_SUPPORT */
@@ -0,0 +1,1134 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlConfig.h"
+#include "dlCore.h"
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlRecord.h"
+#include "render/dlRender.h"
+#include "dlLog.h"
+
+#ifdef GLES2
+#  include <GLES2/gl2.h>
+#endif
+#ifdef GLES1
+#  include <GLES/gl.h>
+#  include <GLES/glext.h>
+#endif
+#if !defined(GLES1) && !defined(GLES2)
+#  include <GL/glew.h>
+#  include <GL/gl.h>
+#endif
+#include "dlGL.h"
+
+#define DL_DEBUG_CHANNEL "RECORD"
+
+#define RECORD_NAME "Record (OpenGL 1.4+)"
+
+/* names of recorded calls */
+static const char *DL_RECORD_NAMES[ DL_RECORD_LAST ] =
+{
+   "dlObject", "glEnable", "glDisable", "glEnableClientState", "glDisableClientState",
+   "glBlendFunc", "glDepthFunc", "glClear", "glViewport", "glColor4f",
+   "glMatrixMode", "glLoadMatrixf", "glLoadIdentity", "glPushMatrix", "glPopMatrix",
+   "glTranslatef", "glScalef", "glBegin", "glEnd", "glVertex3f",
+   "glVertexPointer", "glNormalPointer", "glTexCoordPointer", "glColorPointer",
+   "glDrawArrays", "glDrawElements",
+   "glGenBuffers", "glDeleteBuffers", "glBindBuffer", "glBufferData", "glBufferSubData",
+   "glMapBufferRange", "glUnmapBuffer", "glFenceSync", "glClientWaitSync", "glDeleteSync",
+   "glGenTextures", "glDeleteTextures", "glBindTexture", "glTexImage2D",
+   "glGetIntegerv", "glGetString",
+   "glCreateShader", "glShaderSource", "glCompileShader", "glDeleteShader",
+   "glCreateProgram", "glAttachShader", "glBindAttribLocation", "glGetAttribLocation",
+   "glLinkProgram",
+   "glUseProgram", "glDeleteProgram", "glGetProgramiv", "glGetProgramInfoLog",
+   "glGetUniformLocation", "glGetActiveUniform", "glUniformMatrix4fv",
+   "glVertexAttribPointer", "glEnableVertexAttribArray", "glDisableVertexAttribArray",
+   "glVertexAttrib4f",
+   "glVertexAttribDivisorARB", "glDrawArraysInstancedARB", "glDrawElementsInstancedARB",
+   "glGenVertexArrays", "glDeleteVertexArrays", "glBindVertexArray",
+   "glGetUniformBlockIndex", "glUniformBlockBinding", "glBindBufferBase"
+};
+
+/* Name of recorded call */
+const char* dlRecordCallName( dleRecordCall call )
+{
+   if(call >= DL_RECORD_LAST)
+      return( "unknown" );
+
+   return( DL_RECORD_NAMES[ call ] );
+}
+
+#if DL_GL_RECORD
+
+/* enabled caps and client states tracked */
+#define DL_RECORD_CAPS 32
+
+/* client states and vertex attributes share cap table */
+#define DL_RECORD_CLIENT 0x80000000u
+#define DL_RECORD_ATTRIB 0x40000000u
+
+/* enable state of cap */
+typedef struct dlRecordCap_t
+{
+   GLenum  cap;
+   uint8_t enabled;
+} dlRecordCap;
+
+/* vertex array object,
+ * client states, attributes and element binding live here */
+typedef struct dlRecordArrays_t
+{
+   GLuint          name;
+   GLuint          element_buffer;
+   dlRecordCap     cap[ DL_RECORD_CAPS ];
+   unsigned int    caps;
+} dlRecordArrays;
+
+/* recorder struct */
+typedef struct dlRecorder_t
+{
+   /* command log */
+   dlRecordCommand *command;
+   unsigned int    num, use;
+   dlRecordStats   stats;
+
+   /* shadowed GL state */
+   dlRecordCap     cap[ DL_RECORD_CAPS ];
+   unsigned int    caps;
+   GLuint          array_buffer, uniform_buffer;
+
+   /* bound vertex array and the ones not bound */
+   dlRecordArrays  arrays;
+   dlRecordArrays  *saved;
+   unsigned int    num_saved, use_saved;
+   GLuint          texture, program;
+   GLenum          blend1, blend2, depth_func, matrix_mode;
+   GLfloat         color[4];
+   GLint           viewport[4];
+
+   /* generated object names */
+   GLuint          names;
+
+   /* storage handed out by glMapBufferRange,
+    * plain malloc so recording stays out of memory statistics */
+   unsigned char   *map;
+   size_t          map_size, map_length;
+
+   /* wrapped renderer */
+   drawPtr         *draw;
+   drawInstancedPtr *drawInstanced;
+} dlRecorder;
+
+/* GL table used by framework */
+dlGLTable dlGL;
+
+static dlRecorder record;
+
+/* append call to log */
+static dlRecordCommand* dlRecordAdd( dleRecordCall call,
+      intptr_t a0, intptr_t a1, intptr_t a2, intptr_t a3 )
+{
+   static dlRecordCommand dummy;
+   dlRecordCommand *command;
+   unsigned int num;
+
+   record.stats.calls++;
+
+   if(record.use == record.num)
+   {
+      dlSetAlloc( ALLOC_CORE );
+
+      num = dlGrowCapacity( record.num, record.use + 1 );
+      if(record.command)
+         command = dlRealloc( record.command, record.num, num, sizeof(dlRecordCommand) );
+      else
+         command = dlCalloc( num, sizeof(dlRecordCommand) );
+
+      /* counters keep working without log */
+      if(!command)
+      {
+         memset( &dummy, 0, sizeof(dlRecordCommand) );
+         return( &dummy );
+      }
+
+      record.command = command;
+      record.num     = num;
+   }
+
+   command = &record.command[ record.use++ ];
+   command->call      = call;
+   command->arg[0]    = a0;
+   command->arg[1]    = a1;
+   command->arg[2]    = a2;
+   command->arg[3]    = a3;
+   command->bytes     = 0;
+   command->redundant = 0;
+
+   return( command );
+}
+
+/* count state call */
+static void dlRecordState( dlRecordCommand *command, int changed )
+{
+   if(changed)
+   {
+      record.stats.stateChanges++;
+      return;
+   }
+
+   record.stats.redundant++;
+   command->redundant = 1;
+}
+
+/* count upload */
+static void dlRecordUpload( dlRecordCommand *command, size_t bytes )
+{
+   command->bytes         = bytes;
+   record.stats.uploaded += bytes;
+}
+
+/* set enable state of cap, returns 1 if it changed.
+ * client states and attributes belong to bound vertex array */
+static int dlRecordSetCap( GLenum cap, uint8_t enabled )
+{
+   dlRecordCap  *table = record.cap;
+   unsigned int *caps  = &record.caps;
+   unsigned int i;
+
+   if(cap & (DL_RECORD_CLIENT | DL_RECORD_ATTRIB))
+   {
+      table = record.arrays.cap;
+      caps  = &record.arrays.caps;
+   }
+
+   i = 0;
+   for(; i != *caps; ++i)
+   {
+      if(table[i].cap != cap)
+         continue;
+
+      if(table[i].enabled == enabled)
+         return( 0 );
+
+      table[i].enabled = enabled;
+      return( 1 );
+   }
+
+   /* untracked caps start disabled */
+   if(*caps != DL_RECORD_CAPS)
+   {
+      table[ *caps ].cap     = cap;
+      table[ *caps ].enabled = enabled;
+      ++*caps;
+   }
+
+   return( enabled );
+}
+
+/* saved vertex array of name, NULL if none */
+static dlRecordArrays* dlRecordSavedArrays( GLuint name )
+{
+   unsigned int i;
+
+   i = 0;
+   for(; i != record.use_saved; ++i)
+      if(record.saved[i].name == name) return( &record.saved[i] );
+
+   return( NULL );
+}
+
+/* keep state of bound vertex array while another one is bound */
+static void dlRecordSaveArrays( void )
+{
+   dlRecordArrays *saved;
+   unsigned int num;
+
+   if(record.use_saved == record.num_saved)
+   {
+      dlSetAlloc( ALLOC_CORE );
+
+      num = dlGrowCapacity( record.num_saved, record.use_saved + 1 );
+      if(record.saved)
+         saved = dlRealloc( record.saved, record.num_saved, num, sizeof(dlRecordArrays) );
+      else
+         saved = dlCalloc( num, sizeof(dlRecordArrays) );
+
+      /* state is forgotten, next calls look like changes */
+      if(!saved)
+         return;
+
+      record.saved     = saved;
+      record.num_saved = num;
+   }
+
+   record.saved[ record.use_saved++ ] = record.arrays;
+}
+
+/* forget saved vertex array */
+static void dlRecordDropArrays( dlRecordArrays *saved )
+{
+   *saved = record.saved[ --record.use_saved ];
+}
+
+/* bound buffer of target */
+static GLuint* dlRecordBufferBinding( GLenum target )
+{
+   if(target == GL_ELEMENT_ARRAY_BUFFER)
+      return( &record.arrays.element_buffer );
+   if(target == GL_UNIFORM_BUFFER)
+      return( &record.uniform_buffer );
+
+   return( &record.array_buffer );
+}
+
+/* bytes per pixel of texture upload */
+static size_t dlRecordPixelSize( GLenum format )
+{
+   switch(format)
+   {
+      case GL_RGBA:              return( 4 );
+      case GL_RGB:               return( 3 );
+      case GL_LUMINANCE_ALPHA:   return( 2 );
+      default:                   return( 1 );
+   }
+}
+
+/* state */
+static void recEnable( GLenum cap )
+{
+   dlRecordState( dlRecordAdd( DL_RECORD_ENABLE, cap, 0, 0, 0 ),
+                  dlRecordSetCap( cap, 1 ) );
+}
+
+static void recDisable( GLenum cap )
+{
+   dlRecordState( dlRecordAdd( DL_RECORD_DISABLE, cap, 0, 0, 0 ),
+                  dlRecordSetCap( cap, 0 ) );
+}
+
+static void recEnableClientState( GLenum array )
+{
+   dlRecordState( dlRecordAdd( DL_RECORD_ENABLE_CLIENT_STATE, array, 0, 0, 0 ),
+                  dlRecordSetCap( array | DL_RECORD_CLIENT, 1 ) );
+}
+
+static void recDisableClientState( GLenum array )
+{
+   dlRecordState( dlRecordAdd( DL_RECORD_DISABLE_CLIENT_STATE, array, 0, 0, 0 ),
+                  dlRecordSetCap( array | DL_RECORD_CLIENT, 0 ) );
+}
+
+static void recBlendFunc( GLenum sfactor, GLenum dfactor )
+{
+   int changed = record.blend1 != sfactor || record.blend2 != dfactor;
+
+   record.blend1 = sfactor;
+   record.blend2 = dfactor;
+   dlRecordState( dlRecordAdd( DL_RECORD_BLEND_FUNC, sfactor, dfactor, 0, 0 ), changed );
+}
+
+static void recDepthFunc( GLenum func )
+{
+   int changed = record.depth_func != func;
+
+   record.depth_func = func;
+   dlRecordState( dlRecordAdd( DL_RECORD_DEPTH_FUNC, func, 0, 0, 0 ), changed );
+}
+
+static void recClear( GLbitfield mask )
+{
+   dlRecordAdd( DL_RECORD_CLEAR, mask, 0, 0, 0 );
+}
+
+static void recViewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+   int changed = record.viewport[0] != x || record.viewport[1] != y ||
+                 record.viewport[2] != width || record.viewport[3] != height;
+
+   record.viewport[0] = x;     record.viewport[1] = y;
+   record.viewport[2] = width; record.viewport[3] = height;
+   dlRecordState( dlRecordAdd( DL_RECORD_VIEWPORT, x, y, width, height ), changed );
+}
+
+static void recColor4f( GLfloat r, GLfloat g, GLfloat b, GLfloat a )
+{
+   int changed = record.color[0] != r || record.color[1] != g ||
+                 record.color[2] != b || record.color[3] != a;
+
+   record.color[0] = r; record.color[1] = g;
+   record.color[2] = b; record.color[3] = a;
+   dlRecordState( dlRecordAdd( DL_RECORD_COLOR, r * 255, g * 255, b * 255, a * 255 ), changed );
+}
+
+/* fixed function matrices */
+static void recMatrixMode( GLenum mode )
+{
+   int changed = record.matrix_mode != mode;
+
+   record.matrix_mode = mode;
+   dlRecordState( dlRecordAdd( DL_RECORD_MATRIX_MODE, mode, 0, 0, 0 ), changed );
+}
+
+static void recLoadMatrixf( const GLfloat *m )
+{
+   dlRecordAdd( DL_RECORD_LOAD_MATRIX, (intptr_t)m, 0, 0, 0 );
+}
+
+static void recLoadIdentity( void )
+{
+   dlRecordAdd( DL_RECORD_LOAD_IDENTITY, 0, 0, 0, 0 );
+}
+
+static void recPushMatrix( void )
+{
+   dlRecordAdd( DL_RECORD_PUSH_MATRIX, 0, 0, 0, 0 );
+}
+
+static void recPopMatrix( void )
+{
+   dlRecordAdd( DL_RECORD_POP_MATRIX, 0, 0, 0, 0 );
+}
+
+static void recTranslatef( GLfloat x, GLfloat y, GLfloat z )
+{
+   dlRecordAdd( DL_RECORD_TRANSLATE, x, y, z, 0 );
+}
+
+static void recScalef( GLfloat x, GLfloat y, GLfloat z )
+{
+   dlRecordAdd( DL_RECORD_SCALE, x, y, z, 0 );
+}
+
+/* immediate mode */
+static void recBegin( GLenum mode )
+{
+   dlRecordAdd( DL_RECORD_BEGIN, mode, 0, 0, 0 );
+}
+
+static void recEnd( void )
+{
+   dlRecordAdd( DL_RECORD_END, 0, 0, 0, 0 );
+   record.stats.draws++;
+}
+
+static void recVertex3f( GLfloat x, GLfloat y, GLfloat z )
+{
+   dlRecordAdd( DL_RECORD_VERTEX, x, y, z, 0 );
+}
+
+/* arrays and drawing */
+static void recVertexPointer( GLint size, GLenum type, GLsizei stride, const GLvoid *ptr )
+{
+   dlRecordAdd( DL_RECORD_VERTEX_POINTER, size, type, stride, (intptr_t)ptr );
+}
+
+static void recNormalPointer( GLenum type, GLsizei stride, const GLvoid *ptr )
+{
+   dlRecordAdd( DL_RECORD_NORMAL_POINTER, type, stride, (intptr_t)ptr, 0 );
+}
+
+static void recTexCoordPointer( GLint size, GLenum type, GLsizei stride, const GLvoid *ptr )
+{
+   dlRecordAdd( DL_RECORD_TEXCOORD_POINTER, size, type, stride, (intptr_t)ptr );
+}
+
+static void recColorPointer( GLint size, GLenum type, GLsizei stride, const GLvoid *ptr )
+{
+   dlRecordAdd( DL_RECORD_COLOR_POINTER, size, type, stride, (intptr_t)ptr );
+}
+
+static void recDrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+   dlRecordAdd( DL_RECORD_DRAW_ARRAYS, mode, first, count, 0 );
+   record.stats.draws++;
+}
+
+static void recDrawElements( GLenum mode, GLsizei count, GLenum type, const GLvoid *indices )
+{
+   dlRecordAdd( DL_RECORD_DRAW_ELEMENTS, mode, count, type, (intptr_t)indices );
+   record.stats.draws++;
+}
+
+/* buffers */
+static void recGenBuffers( GLsizei n, GLuint *buffers )
+{
+   GLsizei i;
+
+   dlRecordAdd( DL_RECORD_GEN_BUFFERS, n, record.names + 1, 0, 0 );
+   i = 0;
+   for(; i != n; ++i)
+      buffers[i] = ++record.names;
+}
+
+static void recDeleteBuffers( GLsizei n, const GLuint *buffers )
+{
+   GLsizei i;
+
+   dlRecordAdd( DL_RECORD_DELETE_BUFFERS, n, n ? buffers[0] : 0, 0, 0 );
+
+   /* deleting bound buffer binds 0 */
+   i = 0;
+   for(; i != n; ++i)
+   {
+      if(record.array_buffer   == buffers[i]) record.array_buffer   = 0;
+      if(record.uniform_buffer == buffers[i]) record.uniform_buffer = 0;
+      if(record.arrays.element_buffer == buffers[i]) record.arrays.element_buffer = 0;
+   }
+}
+
+static void recBindBuffer( GLenum target, GLuint buffer )
+{
+   GLuint *bound = dlRecordBufferBinding( target );
+   int changed   = *bound != buffer;
+
+   *bound = buffer;
+   record.stats.binds++;
+   dlRecordState( dlRecordAdd( DL_RECORD_BIND_BUFFER, target, buffer, 0, 0 ), changed );
+}
+
+static void recBufferData( GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage )
+{
+   dlRecordCommand *command;
+
+   command = dlRecordAdd( DL_RECORD_BUFFER_DATA, target, size, (intptr_t)data, usage );
+   if(data) dlRecordUpload( command, size );
+}
+
+static void recBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data )
+{
+   dlRecordUpload( dlRecordAdd( DL_RECORD_BUFFER_SUB_DATA, target, offset, size, (intptr_t)data ),
+                   size );
+}
+
+static GLvoid* recMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+   unsigned char *map;
+
+   dlRecordAdd( DL_RECORD_MAP_BUFFER_RANGE, target, offset, length, access );
+
+   if((size_t)length > record.map_size)
+   {
+      map = realloc( record.map, length );
+      if(!map)
+         return( NULL );
+
+      record.map      = map;
+      record.map_size = length;
+   }
+
+   record.map_length = length;
+   return( record.map );
+}
+
+static GLboolean recUnmapBuffer( GLenum target )
+{
+   /* mapped range counts as uploaded */
+   dlRecordUpload( dlRecordAdd( DL_RECORD_UNMAP_BUFFER, target, 0, 0, 0 ), record.map_length );
+   record.map_length = 0;
+
+   return( GL_TRUE );
+}
+
+/* sync, everything is signaled */
+static GLsync recFenceSync( GLenum condition, GLbitfield flags )
+{
+   dlRecordAdd( DL_RECORD_FENCE_SYNC, condition, flags, 0, 0 );
+   return( (GLsync)(intptr_t)++record.names );
+}
+
+static GLenum recClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+   dlRecordAdd( DL_RECORD_CLIENT_WAIT_SYNC, (intptr_t)sync, flags, 0, 0 );
+   return( GL_ALREADY_SIGNALED );
+}
+
+static void recDeleteSync( GLsync sync )
+{
+   dlRecordAdd( DL_RECORD_DELETE_SYNC, (intptr_t)sync, 0, 0, 0 );
+}
+
+/* textures */
+static void recGenTextures( GLsizei n, GLuint *textures )
+{
+   GLsizei i;
+
+   dlRecordAdd( DL_RECORD_GEN_TEXTURES, n, record.names + 1, 0, 0 );
+   i = 0;
+   for(; i != n; ++i)
+      textures[i] = ++record.names;
+}
+
+static void recDeleteTextures( GLsizei n, const GLuint *textures )
+{
+   GLsizei i;
+
+   dlRecordAdd( DL_RECORD_DELETE_TEXTURES, n, n ? textures[0] : 0, 0, 0 );
+   i = 0;
+   for(; i != n; ++i)
+      if(record.texture == textures[i]) record.texture = 0;
+}
+
+static void recBindTexture( GLenum target, GLuint texture )
+{
+   int changed = record.texture != texture;
+
+   record.texture = texture;
+   record.stats.binds++;
+   dlRecordState( dlRecordAdd( DL_RECORD_BIND_TEXTURE, target, texture, 0, 0 ), changed );
+}
+
+static void recTexImage2D( GLenum target, GLint level, GLint internalformat,
+      GLsizei width, GLsizei height, GLint border,
+      GLenum format, GLenum type, const GLvoid *pixels )
+{
+   dlRecordCommand *command;
+
+   command = dlRecordAdd( DL_RECORD_TEX_IMAGE_2D, target, level, width, height );
+   if(pixels) dlRecordUpload( command, (size_t)width * height * dlRecordPixelSize( format ) );
+}
+
+/* queries, answers like a GL 3.1 compatibility driver */
+static void recGetIntegerv( GLenum pname, GLint *params )
+{
+   dlRecordAdd( DL_RECORD_GET_INTEGER, pname, 0, 0, 0 );
+
+   switch(pname)
+   {
+      case GL_MAX_LIGHTS:        *params = 8;    break;
+      case GL_MAX_CLIP_PLANES:   *params = 6;    break;
+      case GL_SUBPIXEL_BITS:     *params = 4;    break;
+      case GL_MAX_TEXTURE_SIZE:  *params = 4096; break;
+      case GL_MAX_TEXTURE_UNITS: *params = 4;    break;
+      default:                   *params = 0;    break;
+   }
+}
+
+static const GLubyte* recGetString( GLenum name )
+{
+   dlRecordAdd( DL_RECORD_GET_STRING, name, 0, 0, 0 );
+
+   switch(name)
+   {
+      case GL_VERSION:     return( (const GLubyte*)"3.1.0" );
+      case GL_VENDOR:      return( (const GLubyte*)"dl" );
+      case GL_RENDERER:    return( (const GLubyte*)RECORD_NAME );
+      case GL_EXTENSIONS:  return( (const GLubyte*)
+                                   "GL_ARB_vertex_buffer_object "
+                                   "GL_ARB_map_buffer_range "
+                                   "GL_ARB_sync "
+                                   "GL_ARB_half_float_vertex "
+                                   "GL_ARB_vertex_type_2_10_10_10_rev "
+                                   "GL_ARB_instanced_arrays "
+                                   "GL_ARB_draw_instanced "
+                                   "GL_ARB_vertex_array_object "
+                                   "GL_ARB_uniform_buffer_object" );
+      default:             return( (const GLubyte*)"" );
+   }
+}
+
+/* shaders, every shader compiles and links */
+static GLuint recCreateShader( GLenum type )
+{
+   dlRecordAdd( DL_RECORD_CREATE_SHADER, type, record.names + 1, 0, 0 );
+   return( ++record.names );
+}
+
+static void recShaderSource( GLuint shader, GLsizei count, const GLchar **string, const GLint *length )
+{
+   dlRecordAdd( DL_RECORD_SHADER_SOURCE, shader, count, 0, 0 );
+}
+
+static void recCompileShader( GLuint shader )
+{
+   dlRecordAdd( DL_RECORD_COMPILE_SHADER, shader, 0, 0, 0 );
+}
+
+static void recDeleteShader( GLuint shader )
+{
+   dlRecordAdd( DL_RECORD_DELETE_SHADER, shader, 0, 0, 0 );
+}
+
+static GLuint recCreateProgram( void )
+{
+   dlRecordAdd( DL_RECORD_CREATE_PROGRAM, record.names + 1, 0, 0, 0 );
+   return( ++record.names );
+}
+
+static void recAttachShader( GLuint program, GLuint shader )
+{
+   dlRecordAdd( DL_RECORD_ATTACH_SHADER, program, shader, 0, 0 );
+}
+
+static void recBindAttribLocation( GLuint program, GLuint index, const GLchar *name )
+{
+   dlRecordAdd( DL_RECORD_BIND_ATTRIB_LOCATION, program, index, 0, 0 );
+}
+
+static GLint recGetAttribLocation( GLuint program, const GLchar *name )
+{
+   dlRecordAdd( DL_RECORD_GET_ATTRIB_LOCATION, program, 0, 0, 0 );
+   return( -1 );
+}
+
+static void recLinkProgram( GLuint program )
+{
+   dlRecordAdd( DL_RECORD_LINK_PROGRAM, program, 0, 0, 0 );
+}
+
+static void recUseProgram( GLuint program )
+{
+   int changed = record.program != program;
+
+   record.program = program;
+   record.stats.binds++;
+   dlRecordState( dlRecordAdd( DL_RECORD_USE_PROGRAM, program, 0, 0, 0 ), changed );
+}
+
+static void recDeleteProgram( GLuint program )
+{
+   dlRecordAdd( DL_RECORD_DELETE_PROGRAM, program, 0, 0, 0 );
+   if(record.program == program) record.program = 0;
+}
+
+static void recGetProgramiv( GLuint program, GLenum pname, GLint *params )
+{
+   dlRecordAdd( DL_RECORD_GET_PROGRAM, program, pname, 0, 0 );
+
+   switch(pname)
+   {
+      case GL_LINK_STATUS:
+      case GL_COMPILE_STATUS:    *params = GL_TRUE; break;
+      default:                   *params = 0;       break;
+   }
+}
+
+static void recGetProgramInfoLog( GLuint program, GLsizei size, GLsizei *length, GLchar *log )
+{
+   dlRecordAdd( DL_RECORD_GET_PROGRAM_INFO_LOG, program, size, 0, 0 );
+
+   if(length)   *length = 0;
+   if(log && size) log[0] = 0;
+}
+
+static GLint recGetUniformLocation( GLuint program, const GLchar *name )
+{
+   dlRecordAdd( DL_RECORD_GET_UNIFORM_LOCATION, program, 0, 0, 0 );
+   return( -1 );
+}
+
+static void recGetActiveUniform( GLuint program, GLuint index, GLsizei size, GLsizei *length,
+      GLint *count, GLenum *type, GLchar *name )
+{
+   dlRecordAdd( DL_RECORD_GET_ACTIVE_UNIFORM, program, index, 0, 0 );
+
+   if(length)       *length = 0;
+   if(count)        *count  = 0;
+   if(type)         *type   = 0;
+   if(name && size) name[0] = 0;
+}
+
+static void recUniformMatrix4fv( GLint location, GLsizei count, GLboolean transpose, const GLfloat *value )
+{
+   dlRecordUpload( dlRecordAdd( DL_RECORD_UNIFORM_MATRIX, location, count, transpose, (intptr_t)value ),
+                   count * 16 * sizeof(GLfloat) );
+}
+
+/* vertex attributes and instancing */
+static void recVertexAttribPointer( GLuint index, GLint size, GLenum type, GLboolean normalized,
+      GLsizei stride, const GLvoid *ptr )
+{
+   dlRecordAdd( DL_RECORD_VERTEX_ATTRIB_POINTER, index, size, stride, (intptr_t)ptr );
+}
+
+static void recEnableVertexAttribArray( GLuint index )
+{
+   dlRecordState( dlRecordAdd( DL_RECORD_ENABLE_VERTEX_ATTRIB, index, 0, 0, 0 ),
+                  dlRecordSetCap( index | DL_RECORD_ATTRIB, 1 ) );
+}
+
+static void recDisableVertexAttribArray( GLuint index )
+{
+   dlRecordState( dlRecordAdd( DL_RECORD_DISABLE_VERTEX_ATTRIB, index, 0, 0, 0 ),
+                  dlRecordSetCap( index | DL_RECORD_ATTRIB, 0 ) );
+}
+
+static void recVertexAttrib4f( GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w )
+{
+   dlRecordAdd( DL_RECORD_VERTEX_ATTRIB, index, x, y, z );
+}
+
+static void recVertexAttribDivisorARB( GLuint index, GLuint divisor )
+{
+   dlRecordAdd( DL_RECORD_VERTEX_ATTRIB_DIVISOR, index, divisor, 0, 0 );
+}
+
+static void recDrawArraysInstancedARB( GLenum mode, GLint first, GLsizei count, GLsizei primcount )
+{
+   dlRecordAdd( DL_RECORD_DRAW_ARRAYS_INSTANCED, mode, first, count, primcount );
+   record.stats.draws++;
+}
+
+static void recDrawElementsInstancedARB( GLenum mode, GLsizei count, GLenum type,
+      const GLvoid *indices, GLsizei primcount )
+{
+   dlRecordAdd( DL_RECORD_DRAW_ELEMENTS_INSTANCED, mode, count, (intptr_t)indices, primcount );
+   record.stats.draws++;
+}
+
+/* vertex array objects */
+static void recGenVertexArrays( GLsizei n, GLuint *arrays )
+{
+   GLsizei i;
+
+   dlRecordAdd( DL_RECORD_GEN_VERTEX_ARRAYS, n, record.names + 1, 0, 0 );
+   i = 0;
+   for(; i != n; ++i)
+      arrays[i] = ++record.names;
+}
+
+static void recBindVertexArray( GLuint array )
+{
+   dlRecordArrays *saved;
+   int changed = record.arrays.name != array;
+
+   record.stats.binds++;
+   dlRecordState( dlRecordAdd( DL_RECORD_BIND_VERTEX_ARRAY, array, 0, 0, 0 ), changed );
+
+   if(!changed)
+      return;
+
+   dlRecordSaveArrays();
+
+   /* new vertex arrays start with everything off */
+   if((saved = dlRecordSavedArrays( array )))
+   {
+      record.arrays = *saved;
+      dlRecordDropArrays( saved );
+   }
+   else
+   {
+      memset( &record.arrays, 0, sizeof(dlRecordArrays) );
+      record.arrays.name = array;
+   }
+}
+
+static void recDeleteVertexArrays( GLsizei n, const GLuint *arrays )
+{
+   dlRecordArrays *saved;
+   GLsizei i;
+
+   dlRecordAdd( DL_RECORD_DELETE_VERTEX_ARRAYS, n, n ? arrays[0] : 0, 0, 0 );
+
+   /* deleting bound vertex array binds default */
+   i = 0;
+   for(; i != n; ++i)
+   {
+      if(!arrays[i])
+         continue;
+
+      if(record.arrays.name == arrays[i])
+      {
+         if((saved = dlRecordSavedArrays( 0 )))
+         {
+            record.arrays = *saved;
+            dlRecordDropArrays( saved );
+         }
+         else
+            memset( &record.arrays, 0, sizeof(dlRecordArrays) );
+      }
+      else if((saved = dlRecordSavedArrays( arrays[i] )))
+         dlRecordDropArrays( saved );
+   }
+}
+
+/* uniform buffers */
+static GLuint recGetUniformBlockIndex( GLuint program, const GLchar *name )
+{
+   dlRecordAdd( DL_RECORD_GET_UNIFORM_BLOCK_INDEX, program, 0, 0, 0 );
+   return( 0 );
+}
+
+static void recUniformBlockBinding( GLuint program, GLuint index, GLuint binding )
+{
+   dlRecordAdd( DL_RECORD_UNIFORM_BLOCK_BINDING, program, index, binding, 0 );
+}
+
+/* binds generic target too */
+static void recBindBufferBase( GLenum target, GLuint index, GLuint buffer )
+{
+   *dlRecordBufferBinding( target ) = buffer;
+   record.stats.binds++;
+   dlRecordAdd( DL_RECORD_BIND_BUFFER_BASE, target, index, buffer, 0 );
+}
+
+/* log object and draw it with wrapped renderer */
+static void dlRecord_draw( dlObject *object )
+{
+   CALL("%p", object);
+
+   dlRecordAdd( DL_RECORD_OBJECT, (intptr_t)object, 1, 0, 0 );
+   record.stats.objects++;
+
+   record.draw( object );
+}
+
+/* log instanced object and draw it with wrapped renderer */
+static void dlRecord_drawInstanced( dlObject *object, const kmMat4 *matrices, unsigned int n )
+{
+   CALL("%p, %p, %u", object, matrices, n);
+
+   dlRecordAdd( DL_RECORD_OBJECT, (intptr_t)object, n, 0, 0 );
+   record.stats.objects++;
+
+   record.drawInstanced( object, matrices, n );
+}
+
+/* Install recording GL table */
+int dlRecordInit( void )
+{
+   TRACE();
+
+   dlRecordFree();
+
+   /* GL defaults */
+   record.blend1      = GL_ONE;
+   record.blend2      = GL_ZERO;
+   record.depth_func  = GL_LESS;
+   record.matrix_mode = GL_MODELVIEW;
+   record.color[0]    = record.color[1] = record.color[2] = record.color[3] = 1.0f;
+
+   dlGL.Enable             = recEnable;
+   dlGL.Disable            = recDisable;
+   dlGL.EnableClientState  = recEnableClientState;
+   dlGL.DisableClientState = recDisableClientState;
+   dlGL.BlendFunc          = recBlendFunc;
+   dlGL.DepthFunc          = recDepthFunc;
+   dlGL.Clear              = recClear;
+   dlGL.Viewport           = recViewport;
+   dlGL.Color4f            = recColor4f;
+   dlGL.MatrixMode         = recMatrixMode;
+   dlGL.LoadMatrixf        = recLoadMatrixf;
+   dlGL.LoadIdentity       = recLoadIdentity;
+   dlGL.PushMatrix         = recPushMatrix;
+   dlGL.PopMatrix          = recPopMatrix;
+   dlGL.Translatef         = recTranslatef;
+   dlGL.Scalef             = recScalef;
+   dlGL.Begin              = recBegin;
+   dlGL.End                = recEnd;
+   dlGL.Vertex3f           = recVertex3f;
+   dlGL.VertexPointer      = recVertexPointer;
+   dlGL.NormalPointer      = recNormalPointer;
+   dlGL.TexCoordPointer    = recTexCoordPointer;
+   dlGL.ColorPointer       = recColorPointer;
+   dlGL.DrawArrays         = recDrawArrays;
+   dlGL.DrawElements       = recDrawElements;
+   dlGL.GenBuffers         = recGenBuffers;
+   dlGL.DeleteBuffers      = recDeleteBuffers;
+   dlGL.BindBuffer         = recBindBuffer;
+   dlGL.BufferData         = recBufferData;
+   dlGL.BufferSubData      = recBufferSubData;
+   dlGL.MapBufferRange     = recMapBufferRange;
+   dlGL.UnmapBuffer        = recUnmapBuffer;
+   dlGL.FenceSync          = recFenceSync;
+   dlGL.ClientWaitSync     = recClientWaitSync;
+   dlGL.DeleteSync         = recDeleteSync;
+   dlGL.GenTextures        = recGenTextures;
+   dlGL.DeleteTextures     = recDeleteTextures;
+   dlGL.BindTexture        = recBindTexture;
+   dlGL.TexImage2D         = recTexImage2D;
+   dlGL.GetIntegerv        = recGetIntegerv;
+   dlGL.GetString          = recGetString;
+   dlGL.CreateShader       = recCreateShader;
+   dlGL.ShaderSource       = recShaderSource;
+   dlGL.CompileShader      = recCompileShader;
+   dlGL.DeleteShader       = recDeleteShader;
+   dlGL.CreateProgram      = recCreateProgram;
+   dlGL.AttachShader       = recAttachShader;
+   dlGL.BindAttribLocation = recBindAttribLocation;
+   dlGL.GetAttribLocation  = recGetAttribLocation;
+   dlGL.LinkProgram        = recLinkProgram;
+   dlGL.UseProgram         = recUseProgram;
+   dlGL.DeleteProgram      = recDeleteProgram;
+   dlGL.GetProgramiv       = recGetProgramiv;
+   dlGL.GetProgramInfoLog  = recGetProgramInfoLog;
+   dlGL.GetUniformLocation = recGetUniformLocation;
+   dlGL.GetActiveUniform   = recGetActiveUniform;
+   dlGL.UniformMatrix4fv   = recUniformMatrix4fv;
+   dlGL.VertexAttribPointer      = recVertexAttribPointer;
+   dlGL.EnableVertexAttribArray  = recEnableVertexAttribArray;
+   dlGL.DisableVertexAttribArray = recDisableVertexAttribArray;
+   dlGL.VertexAttrib4f           = recVertexAttrib4f;
+   dlGL.VertexAttribDivisorARB   = recVertexAttribDivisorARB;
+   dlGL.DrawArraysInstancedARB   = recDrawArraysInstancedARB;
+   dlGL.DrawElementsInstancedARB = recDrawElementsInstancedARB;
+   dlGL.GenVertexArrays          = recGenVertexArrays;
+   dlGL.DeleteVertexArrays       = recDeleteVertexArrays;
+   dlGL.BindVertexArray          = recBindVertexArray;
+   dlGL.GetUniformBlockIndex     = recGetUniformBlockIndex;
+   dlGL.UniformBlockBinding      = recUniformBlockBinding;
+   dlGL.BindBufferBase           = recBindBufferBase;
+
+   LOGOK("GL calls are recorded");
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Recording renderer */
+int dlRecord( void )
+{
+   TRACE();
+
+   /* record what OpenGL 1.4+ renderer does */
+   if(dlOGL140() != RETURN_OK)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   record.draw             = _dlCore.render.draw;
+   _dlCore.render.draw     = dlRecord_draw;
+
+   record.drawInstanced    = _dlCore.render.drawInstanced;
+   if(record.drawInstanced)
+      _dlCore.render.drawInstanced = dlRecord_drawInstanced;
+   _dlCore.render.string   = RECORD_NAME;
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Free command log */
+int dlRecordFree( void )
+{
+   TRACE();
+
+   dlSetAlloc( ALLOC_CORE );
+   dlFree( record.command, record.num * sizeof(dlRecordCommand) );
+   dlFree( record.saved, record.num_saved * sizeof(dlRecordArrays) );
+   free( record.map );
+
+   memset( &record, 0, sizeof(dlRecorder) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* Clear command log and counters, GL state is kept */
+void dlRecordReset( void )
+{
+   TRACE();
+
+   record.use = 0;
+   memset( &record.stats, 0, sizeof(dlRecordStats) );
+}
+
+/* Counters since last reset */
+void dlRecordGetStats( dlRecordStats *stats )
+{
+   CALL("%p", stats);
+
+   if(!stats)
+      return;
+
+   *stats = record.stats;
+}
+
+/* Command log since last reset */
+const dlRecordCommand* dlRecordLog( unsigned int *count )
+{
+   CALL("%p", count);
+
+   if(count) *count = record.use;
+
+   RET("%p", record.command);
+   return( record.command );
+}
+
+/* Write command log as text */
+int dlRecordWrite( FILE *file )
+{
+   unsigned int i;
+   dlRecordCommand *command;
+   CALL("%p", file);
+
+   if(!file)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   i = 0;
+   for(; i != record.use; ++i)
+   {
+      command = &record.command[i];
+      fprintf( file, "%-22s %ld %ld %ld %ld", dlRecordCallName( command->call ),
+               (long)command->arg[0], (long)command->arg[1],
+               (long)command->arg[2], (long)command->arg[3] );
+
+      if(command->bytes)     fprintf( file, " (%lu bytes)", (unsigned long)command->bytes );
+      if(command->redundant) fprintf( file, " (redundant)" );
+      fputc( '\n', file );
+   }
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+#else
+
+/* built without recording */
+int dlRecord( void )
+{
+   TRACE();
+
+   LOGERR("Framework was built without DL_GL_RECORD");
+
+   RET("%d", RETURN_FAIL);
+   return( RETURN_FAIL );
+}
+
+int dlRecordInit( void )
+{
+   TRACE();
+
+   LOGERR("Framework was built without DL_GL_RECORD");
+
+   RET("%d", RETURN_FAIL);
+   return( RETURN_FAIL );
+}
+
+int dlRecordFree( void )
+{
+   TRACE();
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+void dlRecordReset( void )
+{
+   TRACE();
+}
+
+void dlRecordGetStats( dlRecordStats *stats )
+{
+   CALL("%p", stats);
+
+   if(stats) memset( stats, 0, sizeof(dlRecordStats) );
+}
+
+const dlRecordCommand* dlRecordLog( unsigned int *count )
+{
+   CALL("%p", count);
+
+   if(count) *count = 0;
+
+   RET("%p", NULL);
+   return( NULL );
+}
+
+int dlRecordWrite( FILE *file )
+{
+   CALL("%p", file);
+   RET("%d", RETURN_FAIL);
+   return( RETURN_FAIL );
+}
+
+#endif /* DL_GL_RECORD */
@@ -22,9 +22,17 @@
 #  include <GL/glew.h>
 #  include <GL/gl.h>
 #endif
+#include "dlGL.h"
 
 #define DL_DEBUG_CHANNEL "SHADER"
 
+/* uniform blocks known by GL headers */
+#if !defined(GLES1) && !defined(GLES2) && GL_ARB_uniform_buffer_object
+#  define SHADER_FRAME_BLOCK 1
+#else
+#  define SHADER_FRAME_BLOCK 0
+#endif
+
 #if SHADER_SUPPORT
 
 #define MAX_SHADER_SIZE   1024 * 10 /* 10240 characters */
@@ -40,6 +48,7 @@
 #define DL_OUT_NORMAL "DL_OUT_NORMAL"
 #define DL_IN_COLOR   "DL_IN_COLOR"
 #define DL_OUT_COLOR  "DL_OUT_COLOR"
+#define DL_IN_INSTANCE "DL_IN_INSTANCE"
 
 #define DL_POSITION   "DL_POSITION"
 #define DL_FRAGMENT   "DL_FRAGMENT"
@@ -49,8 +58,13 @@
 
 #define DL_PROJECTION "DL_PROJECTION"
 #define DL_VIEW       "DL_VIEW"
+#define DL_FRAME      "DL_FRAME"
+
+/* GLSL version of uniform blocks */
+#define DL_FRAME_VERSION "#version 140\n"
 
 #define DL_TEXTURE    "DL_TEXTURE"
+#define DL_TEXTURE_MATRIX "DL_TEXTURE_MATRIX"
 
 static const dlShaderType uniformTypes[] =
 {
@@ -248,10 +262,28 @@ static int link_shader( dlShader *shader )
    GLint    status = 0, logLen = 0;
    GLsizei  length = 0;
    char     *log;
+#if SHADER_FRAME_BLOCK
+   GLuint   block;
+#endif
    CALL("%p", shader);
 
+   /* Assing attribute locations, they take effect on link */
+   glBindAttribLocation(shader->object, DL_VERTEX_ATTRIB, DL_IN_VERTEX);
+   glBindAttribLocation(shader->object, DL_COORD_ATTRIB , DL_IN_COORD);
+   glBindAttribLocation(shader->object, DL_NORMAL_ATTRIB, DL_IN_NORMAL);
+   glBindAttribLocation(shader->object, DL_INSTANCE_ATTRIB, DL_IN_INSTANCE);
+
    glLinkProgram( shader->object );
    glGetProgramiv( shader->object, GL_LINK_STATUS, &status );
+#if SHADER_FRAME_BLOCK
+   /* frame matrices come from shared uniform buffer */
+   if(status && dlShaderFrameBlock())
+   {
+      block = glGetUniformBlockIndex( shader->object, DL_FRAME );
+      if(block != GL_INVALID_INDEX)
+         glUniformBlockBinding( shader->object, block, DL_FRAME_BINDING );
+   }
+#endif
    if(!status)
    {
       LOGERR("Program failed to link");
@@ -266,6 +298,10 @@ static int link_shader( dlShader *shader )
       return( RETURN_FAIL );
    }
 
+   /* unused attribute is optimized out,
+    * renderer sets it only for shaders that read it */
+   shader->instance = (glGetAttribLocation( shader->object, DL_IN_INSTANCE ) >= 0);
+
    RET("%d", RETURN_OK);
    return( RETURN_OK );
 }
@@ -320,14 +356,10 @@ static int process_shader( dlShader *shader )
    }
    free(buffer);
 
-   /* Assing attribute locations */
-   glBindAttribLocation(shader->object, DL_VERTEX_ATTRIB, DL_IN_VERTEX);
-   glBindAttribLocation(shader->object, DL_COORD_ATTRIB , DL_IN_COORD);
-   glBindAttribLocation(shader->object, DL_NORMAL_ATTRIB, DL_IN_NORMAL);
-
    /* Assing projection && view */
    shader->projection = dlShaderGetUniform( shader, DL_PROJECTION );
    shader->view       = dlShaderGetUniform( shader, DL_VIEW );
+   shader->texture    = dlShaderGetUniform( shader, DL_TEXTURE_MATRIX );
 
    RET("%d", RETURN_OK);
    return( RETURN_OK );
@@ -340,16 +372,29 @@ static unsigned int process_vertex_GLSL( char *data )
    CALL("%s", data);
 
    /* vertex shader */
+   if(dlShaderFrameBlock())
+      data2 = append( data2, DL_FRAME_VERSION );
    data2 = append( data2, "#define "VERTEX_SHADER" 1\n" );
    /* if shader->state.projection
     * { */
-   data2 = append( data2, "uniform mat4 "DL_PROJECTION";\n" );
+   if(dlShaderFrameBlock())
+   {
+      data2 = append( data2, "layout(std140) uniform "DL_FRAME" {\n" );
+      data2 = append( data2, "   mat4 "DL_PROJECTION";\n" );
+      data2 = append( data2, "};\n" );
+   }
+   else
+      data2 = append( data2, "uniform mat4 "DL_PROJECTION";\n" );
    data2 = append( data2, "uniform mat4 "DL_VIEW";\n" );
+   /* decodes quantized coords */
+   data2 = append( data2, "uniform mat4 "DL_TEXTURE_MATRIX";\n" );
    /* } */
    /* if shader->state.vertex
     * { */
    data2 = append( data2, "in vec3 "DL_IN_VERTEX";\n" );
    /* } */
+   /* matrix of instance when drawn with dlDrawInstanced */
+   data2 = append( data2, "in mat4 "DL_IN_INSTANCE";\n" );
    /* if shader->state.texture
     * {
     * data2 = append( data2, "in vec3 "DL_IN_COORD";\n" );
@@ -379,6 +424,8 @@ static unsigned int process_fragment_GLSL( char *data )
    CALL("%s", data);
 
    /* fragment shader */
+   if(dlShaderFrameBlock())
+      data2 = append( data2, DL_FRAME_VERSION );
    data2 = append( data2, "#define "FRAGMENT_SHADER" 1\n" );
 
    /* if shader->state.texture
@@ -501,16 +548,19 @@ void dlBindShader( dlShader *shader )
 {
    CALL("%p", shader);
 
-   if(!shader && _DL_BIND_SHADER)
+   if(!shader)
    {
-      glUseProgram( 0 ); _DL_BIND_SHADER = 0;
+      dlSetShader( NULL );
+      if(_DL_BIND_SHADER)
+      { glUseProgram( 0 ); _DL_BIND_SHADER = 0; }
       return;
    }
 
+   /* renderer follows bound shader */
+   dlSetShader( shader );
    if( _DL_BIND_SHADER == shader->object )
       return;
 
-   dlSetShader( shader );
    glUseProgram( shader->object );
    _DL_BIND_SHADER = shader->object;
 }
@@ -552,6 +602,18 @@ dlShaderUniform* dlShaderGetUniform( dlShader *shader, const char *name )
    return( NULL );
 }
 
+/* frame matrices in uniform block */
+int dlShaderFrameBlock( void )
+{
+#if SHADER_FRAME_BLOCK
+   if(_dlCore.version.major > 3 ||
+     (_dlCore.version.major == 3 && _dlCore.version.minor >= 1))
+      return( 1 );
+#endif
+
+   return( 0 );
+}
+
 #else  /* SHADER SUPPORT == 1 */
 
 /* allocate new shader */
@@ -597,4 +659,10 @@ dlShaderUniform* dlShaderGetUniform( dlShader *shader, const char *name )
    return( NULL );
 }
 
+int dlShaderFrameBlock( void )
+{
+   TRACE();
+   return( 0 );
+}
+
 #endif /* SHADER SUPPORT == 0 */
@@ -8,6 +8,14 @@
 #define DL_NORMAL_ATTRIB 2
 #define DL_COLOR_ATTRIB  3
 
+/* per instance mat4 of dlDrawInstanced,
+ * takes four locations from here */
+#define DL_INSTANCE_ATTRIB 4
+
+/* binding point of DL_FRAME uniform block,
+ * holds DL_PROJECTION of current frame */
+#define DL_FRAME_BINDING 0
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -33,6 +41,12 @@ typedef struct dlShader_t
    unsigned int      uniformCount;
 
    dlShaderUniform   *projection, *view;
+
+   /* DL_TEXTURE_MATRIX, coords are multiplied by it */
+   dlShaderUniform   *texture;
+
+   /* 1 if program reads DL_IN_INSTANCE */
+   int               instance;
 } dlShader;
 
 dlShader* dlNewShader( const char *file );
@@ -42,6 +56,10 @@ void dlBindShader( dlShader *shader );
 void dlShaderUniformMatrix4( dlShaderUniform *uniform, kmMat4 *mat  );
 dlShaderUniform* dlShaderGetUniform( dlShader *shader, const char *name );
 
+/* 1 if shaders get DL_PROJECTION from DL_FRAME uniform block,
+ * needs OpenGL 3.1+ */
+int dlShaderFrameBlock( void );
+
 #ifdef __cplusplus
 }
 #endif
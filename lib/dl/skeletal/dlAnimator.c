@@ -1,4 +1,5 @@
 #include <malloc.h>
+#include <string.h>
 
 #include "dlAnimator.h"
 #include "dlAlloc.h"
@@ -317,3 +318,51 @@ void dlAnimatorCalculateGlobalTransformations( dlAnimator *object )
       bone->globalMatrix = globalMat;
    }
 }
+
+/* Remap vertex weights after vertices were reordered or welded */
+int dlAnimatorRemapWeights( dlAnimator *object, const unsigned int *remap, unsigned int vertices )
+{
+   unsigned int v, *first;
+   dlBone *bone;
+   dlVertexWeight *weight, **ptr;
+   CALL("%p, %p, %u", object, remap, vertices);
+
+   if(!object || !remap)
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   /* first old vertex of each new vertex */
+   dlSetAlloc( ALLOC_ANIMATOR );
+   if(!(first = dlMalloc( vertices * sizeof(unsigned int) )))
+   { RET("%d", RETURN_FAIL); return( RETURN_FAIL ); }
+
+   memset( first, 0xff, vertices * sizeof(unsigned int) );
+   v = vertices;
+   while(v--) first[ remap[v] ] = v;
+
+   dlSetAlloc( ALLOC_BONE );
+
+   bone = object->bone;
+   for(; bone; bone = bone->next)
+   {
+      ptr = &bone->weight;
+      while((weight = *ptr))
+      {
+         /* merged vertex, skinning would add it twice */
+         if(weight->vertex >= vertices || first[ remap[ weight->vertex ] ] != weight->vertex)
+         {
+            *ptr = weight->next;
+            dlFree( weight, sizeof(dlVertexWeight) );
+            continue;
+         }
+
+         weight->vertex = remap[ weight->vertex ];
+         ptr = &weight->next;
+      }
+   }
+
+   dlSetAlloc( ALLOC_ANIMATOR );
+   dlFree( first, vertices * sizeof(unsigned int) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
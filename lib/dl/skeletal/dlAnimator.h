@@ -1,5 +1,5 @@
 #ifndef DL_ANIMATOR_H
-#define DL_ANIMAOTR_H
+#define DL_ANIMATOR_H
 
 #include "dlAnim.h"
 #include "dlBone.h"
@@ -41,6 +41,10 @@ void dlAnimatorUpdate( dlAnimator* );
 void dlAnimatorSetAnim( dlAnimator*, DL_NODE_TYPE );
 void dlAnimatorCalculateGlobalTransformations( dlAnimator* );
 
+/* point weights to reordered or welded vertices, remap[old] = new.
+ * when vertices are merged only the first one keeps its weights */
+int  dlAnimatorRemapWeights( dlAnimator*, const unsigned int *remap, unsigned int vertices );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,418 @@
+#include <malloc.h>
+#include <string.h>
+#include <math.h>
+
+#include "dlSkin.h"
+#include "dlAlloc.h"
+#include "dlTypes.h"
+#include "dlLog.h"
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define DL_SKIN_SSE2 1
+#else
+#  define DL_SKIN_SSE2 0
+#endif
+
+/* kernel is copied to each caller, so positions only sweep loses normal branches */
+#if defined(__GNUC__)
+#  define DL_SKIN_KERNEL static inline __attribute__((always_inline))
+#else
+#  define DL_SKIN_KERNEL static
+#endif
+
+#define DL_DEBUG_CHANNEL "SKIN"
+
+/* put influence to its place by weight, weakest falls off when full.
+ * returns 1 when influence was dropped */
+static int dlSkinInsert( unsigned short *bone, float *weight, unsigned short index, float value )
+{
+   int i, dropped;
+
+   dropped = weight[ DL_SKIN_INFLUENCES - 1 ] > 0;
+   if(dropped && weight[ DL_SKIN_INFLUENCES - 1 ] >= value)
+      return( 1 );
+
+   i = DL_SKIN_INFLUENCES - 1;
+   for(; i > 0 && weight[i - 1] < value; --i)
+   {
+      bone[i]   = bone[i - 1];
+      weight[i] = weight[i - 1];
+   }
+   bone[i]   = index;
+   weight[i] = value;
+
+   return( dropped );
+}
+
+/* Build skin */
+dlSkin* dlNewSkin( dlAnimator *animator, unsigned int vertices )
+{
+   dlSkin         *skin;
+   dlBone         *bone;
+   dlVertexWeight *weight;
+   unsigned char  *dropped;
+   unsigned int    b, v, i, count;
+   float           sum, *w;
+   CALL("%p, %u", animator, vertices);
+
+   if(!animator || !vertices)
+   { RET("%p", NULL); return( NULL ); }
+
+   dlSetAlloc( ALLOC_ANIMATOR );
+   if(!(skin = dlCalloc( 1, sizeof(dlSkin) )))
+   { RET("%p", NULL); return( NULL ); }
+   skin->refCounter = 1;
+
+   bone = animator->bone;
+   for(; bone; bone = bone->next)
+      skin->bones++;
+
+   if(skin->bones > 65536)
+   {
+      LOGERRP("%u bones, index does not fit", skin->bones);
+      dlFreeSkin( skin );
+      RET("%p", NULL);
+      return( NULL );
+   }
+
+   skin->vertices = vertices;
+   skin->bone     = dlCalloc( vertices * DL_SKIN_INFLUENCES, sizeof(unsigned short) );
+   skin->weight   = dlCalloc( vertices * DL_SKIN_INFLUENCES, sizeof(float) );
+   if(skin->bones)
+   {
+      skin->matrix = dlMalloc( skin->bones * sizeof(kmMat4) );
+      skin->normal = dlMalloc( skin->bones * sizeof(kmMat4) );
+   }
+   dropped        = dlCalloc( vertices, sizeof(unsigned char) );
+   if(!skin->bone || !skin->weight || !dropped ||
+      (skin->bones && (!skin->matrix || !skin->normal)))
+   {
+      if(dropped) dlFree( dropped, vertices * sizeof(unsigned char) );
+      dlFreeSkin( skin );
+      RET("%p", NULL);
+      return( NULL );
+   }
+
+   /* scatter weight lists to vertices */
+   b = 0;
+   bone = animator->bone;
+   for(; bone; bone = bone->next, ++b)
+   {
+      weight = bone->weight;
+      for(; weight; weight = weight->next)
+      {
+         v = weight->vertex;
+         if(v >= vertices || weight->value <= 0)
+            continue;
+
+         dropped[v] |= dlSkinInsert( &skin->bone[ v * DL_SKIN_INFLUENCES ],
+                                     &skin->weight[ v * DL_SKIN_INFLUENCES ],
+                                     (unsigned short)b, weight->value );
+      }
+   }
+
+   /* vertices which lost influences get their weight back */
+   v = 0;
+   for(; v != vertices; ++v)
+   {
+      w = &skin->weight[ v * DL_SKIN_INFLUENCES ];
+      i = 0; count = 0; sum = 0;
+      for(; i != DL_SKIN_INFLUENCES; ++i)
+         if(w[i] > 0) { sum += w[i]; ++count; }
+
+      if(dropped[v] && sum > 0)
+      {
+         i = 0;
+         for(; i != count; ++i) w[i] /= sum;
+      }
+
+      if(count > skin->influences)
+         skin->influences = count;
+   }
+
+   dlSetAlloc( ALLOC_ANIMATOR );
+   dlFree( dropped, vertices * sizeof(unsigned char) );
+
+   LOGOKP("NEW %u vertices, %u bones, %u influences", vertices, skin->bones, skin->influences);
+
+   RET("%p", skin);
+   return( skin );
+}
+
+/* Reference skin */
+dlSkin* dlRefSkin( dlSkin *src )
+{
+   CALL("%p", src);
+
+   if(!src) { RET("%p", NULL); return( NULL ); }
+
+   src->refCounter++;
+
+   RET("%p", src);
+   return( src );
+}
+
+/* Free skin */
+int dlFreeSkin( dlSkin *skin )
+{
+   CALL("%p", skin);
+
+   if(!skin) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   /* There is still references to this skin alive */
+   if(--skin->refCounter != 0) { RET("%d", RETURN_NOTHING); return( RETURN_NOTHING ); }
+
+   dlSetAlloc( ALLOC_ANIMATOR );
+   dlFree( skin->bone,   skin->vertices * DL_SKIN_INFLUENCES * sizeof(unsigned short) );
+   dlFree( skin->weight, skin->vertices * DL_SKIN_INFLUENCES * sizeof(float) );
+   dlFree( skin->matrix, skin->bones * sizeof(kmMat4) );
+   dlFree( skin->normal, skin->bones * sizeof(kmMat4) );
+
+   LOGFREE("FREE");
+
+   dlFree( skin, sizeof(dlSkin) );
+
+   RET("%d", RETURN_OK);
+   return( RETURN_OK );
+}
+
+/* inverse transpose of upper 3x3, columns are cross products of
+ * columns of m divided by determinant */
+static void dlSkinNormalMatrix( kmMat4 *out, const kmMat4 *m )
+{
+   const float *a = &m->mat[0], *b = &m->mat[4], *c = &m->mat[8];
+   float *n = out->mat, det;
+
+   n[0] = b[1] * c[2] - b[2] * c[1];
+   n[1] = b[2] * c[0] - b[0] * c[2];
+   n[2] = b[0] * c[1] - b[1] * c[0];
+
+   n[4] = c[1] * a[2] - c[2] * a[1];
+   n[5] = c[2] * a[0] - c[0] * a[2];
+   n[6] = c[0] * a[1] - c[1] * a[0];
+
+   n[8]  = a[1] * b[2] - a[2] * b[1];
+   n[9]  = a[2] * b[0] - a[0] * b[2];
+   n[10] = a[0] * b[1] - a[1] * b[0];
+
+   /* flattened bone keeps cofactors, normal gets normalized anyway */
+   det = a[0] * n[0] + a[1] * n[1] + a[2] * n[2];
+   if(det != 0)
+   {
+      det  = 1.0f / det;
+      n[0] *= det; n[1] *= det; n[2]  *= det;
+      n[4] *= det; n[5] *= det; n[6]  *= det;
+      n[8] *= det; n[9] *= det; n[10] *= det;
+   }
+
+   n[3] = n[7] = n[11] = 0;
+   n[12] = n[13] = n[14] = 0; n[15] = 1;
+}
+
+/* Bone matrices */
+void dlSkinMatrices( const dlSkin *skin, const dlAnimator *animator,
+                     kmMat4 *out, kmMat4 *normal )
+{
+   dlBone      *bone;
+   unsigned int b;
+
+   if(!skin || !animator || !out)
+      return;
+
+   /* global matrices are by rows for kmVec3Transform,
+    * kernel reads columns */
+   bone = animator->bone;
+   b = 0;
+   for(; b != skin->bones && bone; ++b, bone = bone->next)
+   {
+      kmMat4Transpose( &out[b], &bone->globalMatrix );
+      if(normal) dlSkinNormalMatrix( &normal[b], &out[b] );
+   }
+}
+
+/* blend positions, and normals when given, in one sweep */
+DL_SKIN_KERNEL void dlSkinBlend( const dlSkin *skin, const kmMat4 *matrix, const kmMat4 *normal,
+                         const kmVec3 *in, kmVec3 *out,
+                         const kmVec3 *inNormal, kmVec3 *outNormal, unsigned int vertices )
+{
+   const unsigned short *bone;
+   const float          *weight;
+   const float          *m;
+   unsigned int          v, i;
+#if DL_SKIN_SSE2
+   __m128 c0, c1, c2, c3, n0, n1, n2, w, r, l;
+   float  last[4];
+#else
+   float  c[12], n[9], w, x, y, z, l;
+#endif
+
+   if(vertices > skin->vertices)
+      vertices = skin->vertices;
+
+   /* no weights, no matrices to read */
+   if(!skin->influences)
+   {
+      memset( out, 0, vertices * sizeof(kmVec3) );
+      if(outNormal) memset( outNormal, 0, vertices * sizeof(kmVec3) );
+      return;
+   }
+
+   bone   = skin->bone;
+   weight = skin->weight;
+   v = 0;
+   for(; v != vertices; ++v, bone += DL_SKIN_INFLUENCES, weight += DL_SKIN_INFLUENCES)
+   {
+#if DL_SKIN_SSE2
+      /* blend columns of bone matrices, then transform once */
+      m  = matrix[ bone[0] ].mat;
+      w  = _mm_set1_ps( weight[0] );
+      c0 = _mm_mul_ps( _mm_loadu_ps( m +  0 ), w );
+      c1 = _mm_mul_ps( _mm_loadu_ps( m +  4 ), w );
+      c2 = _mm_mul_ps( _mm_loadu_ps( m +  8 ), w );
+      c3 = _mm_mul_ps( _mm_loadu_ps( m + 12 ), w );
+
+      i = 1;
+      for(; i < skin->influences; ++i)
+      {
+         m  = matrix[ bone[i] ].mat;
+         w  = _mm_set1_ps( weight[i] );
+         c0 = _mm_add_ps( c0, _mm_mul_ps( _mm_loadu_ps( m +  0 ), w ) );
+         c1 = _mm_add_ps( c1, _mm_mul_ps( _mm_loadu_ps( m +  4 ), w ) );
+         c2 = _mm_add_ps( c2, _mm_mul_ps( _mm_loadu_ps( m +  8 ), w ) );
+         c3 = _mm_add_ps( c3, _mm_mul_ps( _mm_loadu_ps( m + 12 ), w ) );
+      }
+
+      r = _mm_add_ps( _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( in[v].x ) ),
+                                  _mm_mul_ps( c1, _mm_set1_ps( in[v].y ) ) ),
+                      _mm_add_ps( _mm_mul_ps( c2, _mm_set1_ps( in[v].z ) ), c3 ) );
+
+      /* fourth float lands on next vertex, which is written after */
+      if(v + 1 != vertices)
+         _mm_storeu_ps( &out[v].x, r );
+      else
+      {
+         _mm_storeu_ps( last, r );
+         out[v].x = last[0]; out[v].y = last[1]; out[v].z = last[2];
+      }
+
+      if(!outNormal)
+         continue;
+
+      m  = normal[ bone[0] ].mat;
+      w  = _mm_set1_ps( weight[0] );
+      n0 = _mm_mul_ps( _mm_loadu_ps( m + 0 ), w );
+      n1 = _mm_mul_ps( _mm_loadu_ps( m + 4 ), w );
+      n2 = _mm_mul_ps( _mm_loadu_ps( m + 8 ), w );
+
+      i = 1;
+      for(; i < skin->influences; ++i)
+      {
+         m  = normal[ bone[i] ].mat;
+         w  = _mm_set1_ps( weight[i] );
+         n0 = _mm_add_ps( n0, _mm_mul_ps( _mm_loadu_ps( m + 0 ), w ) );
+         n1 = _mm_add_ps( n1, _mm_mul_ps( _mm_loadu_ps( m + 4 ), w ) );
+         n2 = _mm_add_ps( n2, _mm_mul_ps( _mm_loadu_ps( m + 8 ), w ) );
+      }
+
+      r = _mm_add_ps( _mm_add_ps( _mm_mul_ps( n0, _mm_set1_ps( inNormal[v].x ) ),
+                                  _mm_mul_ps( n1, _mm_set1_ps( inNormal[v].y ) ) ),
+                      _mm_mul_ps( n2, _mm_set1_ps( inNormal[v].z ) ) );
+
+      /* w is 0, length from sum of all four lanes */
+      l = _mm_mul_ps( r, r );
+      l = _mm_add_ps( l, _mm_shuffle_ps( l, l, _MM_SHUFFLE(2, 3, 0, 1) ) );
+      l = _mm_add_ps( l, _mm_shuffle_ps( l, l, _MM_SHUFFLE(1, 0, 3, 2) ) );
+      if(_mm_cvtss_f32( l ) > 0)
+         r = _mm_div_ps( r, _mm_sqrt_ps( l ) );
+
+      if(v + 1 != vertices)
+         _mm_storeu_ps( &outNormal[v].x, r );
+      else
+      {
+         _mm_storeu_ps( last, r );
+         outNormal[v].x = last[0]; outNormal[v].y = last[1]; outNormal[v].z = last[2];
+      }
+#else
+      m = matrix[ bone[0] ].mat;
+      w = weight[0];
+      c[0] = m[0]  * w; c[1]  = m[1]  * w; c[2]  = m[2]  * w;
+      c[3] = m[4]  * w; c[4]  = m[5]  * w; c[5]  = m[6]  * w;
+      c[6] = m[8]  * w; c[7]  = m[9]  * w; c[8]  = m[10] * w;
+      c[9] = m[12] * w; c[10] = m[13] * w; c[11] = m[14] * w;
+
+      i = 1;
+      for(; i < skin->influences; ++i)
+      {
+         m = matrix[ bone[i] ].mat;
+         w = weight[i];
+         c[0] += m[0]  * w; c[1]  += m[1]  * w; c[2]  += m[2]  * w;
+         c[3] += m[4]  * w; c[4]  += m[5]  * w; c[5]  += m[6]  * w;
+         c[6] += m[8]  * w; c[7]  += m[9]  * w; c[8]  += m[10] * w;
+         c[9] += m[12] * w; c[10] += m[13] * w; c[11] += m[14] * w;
+      }
+
+      out[v].x = c[0] * in[v].x + c[3] * in[v].y + c[6] * in[v].z + c[9];
+      out[v].y = c[1] * in[v].x + c[4] * in[v].y + c[7] * in[v].z + c[10];
+      out[v].z = c[2] * in[v].x + c[5] * in[v].y + c[8] * in[v].z + c[11];
+
+      if(!outNormal)
+         continue;
+
+      m = normal[ bone[0] ].mat;
+      w = weight[0];
+      n[0] = m[0] * w; n[1] = m[1] * w; n[2] = m[2]  * w;
+      n[3] = m[4] * w; n[4] = m[5] * w; n[5] = m[6]  * w;
+      n[6] = m[8] * w; n[7] = m[9] * w; n[8] = m[10] * w;
+
+      i = 1;
+      for(; i < skin->influences; ++i)
+      {
+         m = normal[ bone[i] ].mat;
+         w = weight[i];
+         n[0] += m[0] * w; n[1] += m[1] * w; n[2] += m[2]  * w;
+         n[3] += m[4] * w; n[4] += m[5] * w; n[5] += m[6]  * w;
+         n[6] += m[8] * w; n[7] += m[9] * w; n[8] += m[10] * w;
+      }
+
+      x = n[0] * inNormal[v].x + n[3] * inNormal[v].y + n[6] * inNormal[v].z;
+      y = n[1] * inNormal[v].x + n[4] * inNormal[v].y + n[7] * inNormal[v].z;
+      z = n[2] * inNormal[v].x + n[5] * inNormal[v].y + n[8] * inNormal[v].z;
+
+      l = x * x + y * y + z * z;
+      if(l > 0) l = 1.0f / sqrtf( l );
+      else      l = 1.0f;
+
+      outNormal[v].x = x * l;
+      outNormal[v].y = y * l;
+      outNormal[v].z = z * l;
+#endif
+   }
+}
+
+/* Blend vertices */
+void dlSkinVertices( const dlSkin *skin, const kmMat4 *matrix,
+                     const kmVec3 *in, kmVec3 *out, unsigned int vertices )
+{
+   if(!skin || !matrix || !in || !out)
+      return;
+
+   dlSkinBlend( skin, matrix, NULL, in, out, NULL, NULL, vertices );
+}
+
+/* Blend vertices and normals */
+void dlSkinVerticesNormals( const dlSkin *skin, const kmMat4 *matrix, const kmMat4 *normal,
+                            const kmVec3 *in, kmVec3 *out,
+                            const kmVec3 *inNormal, kmVec3 *outNormal, unsigned int vertices )
+{
+   if(!skin || !matrix || !in || !out)
+      return;
+
+   if(!normal || !inNormal || !outNormal)
+   {
+      dlSkinBlend( skin, matrix, NULL, in, out, NULL, NULL, vertices );
+      return;
+   }
+
+   dlSkinBlend( skin, matrix, normal, in, out, inNormal, outNormal, vertices );
+}
@@ -0,0 +1,59 @@
+#ifndef DL_SKIN_H
+#define DL_SKIN_H
+
+#include "kazmath/kazmath.h"
+#include "dlAnimator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* most bones affecting one vertex */
+#define DL_SKIN_INFLUENCES 4
+
+/* bone influences of vertices, converted from weight lists of bones.
+ * streams have DL_SKIN_INFLUENCES entries per vertex,
+ * strongest first and weights of vertex sum to 1 */
+typedef struct dlSkin_t
+{
+   unsigned short *bone;         /* index of bone in animator's list */
+   float          *weight;       /* unused entries are 0 */
+
+   unsigned int    vertices;
+   unsigned int    bones;        /* bones in animator when built */
+   unsigned int    influences;   /* most entries any vertex uses */
+
+   /* room for matrices of every bone,
+    * reused by each dlObjectTick */
+   kmMat4         *matrix, *normal;
+
+   unsigned int refCounter;
+} dlSkin;
+
+/* Build influences of vertices from bones of animator,
+ * vertices with more than DL_SKIN_INFLUENCES weights keep strongest ones */
+dlSkin*  dlNewSkin( dlAnimator *animator, unsigned int vertices );
+dlSkin*  dlRefSkin( dlSkin *src );
+int      dlFreeSkin( dlSkin *skin );
+
+/* Global matrices of bones in skin order, out has room for skin->bones.
+ * matrices are stored column-major. normal gets inverse transpose of
+ * each matrix for skinning normals, may be NULL */
+void     dlSkinMatrices( const dlSkin *skin, const dlAnimator *animator,
+                         kmMat4 *out, kmMat4 *normal );
+
+/* Blend bind pose positions to out, each output vertex is written once.
+ * in and out must not overlap */
+void     dlSkinVertices( const dlSkin *skin, const kmMat4 *matrix,
+                         const kmVec3 *in, kmVec3 *out, unsigned int vertices );
+
+/* Same with normals in the same sweep, normals come out normalized */
+void     dlSkinVerticesNormals( const dlSkin *skin, const kmMat4 *matrix, const kmMat4 *normal,
+                                const kmVec3 *in, kmVec3 *out,
+                                const kmVec3 *inNormal, kmVec3 *outNormal, unsigned int vertices );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DL_SKIN_H */
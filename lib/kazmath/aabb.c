@@ -52,5 +52,83 @@ kmAABB* kmAABBScale(kmAABB* pOut, const kmAABB* pIn, kmScalar s)
 	assert(0 && "Not implemented");
 }
 
+/**
+ * Stores the smallest AABB enclosing pA and pB in pOut, returns pOut
+ */
+kmAABB* kmAABBUnion(kmAABB* pOut, const kmAABB* pA, const kmAABB* pB)
+{
+	pOut->min.x = fminf(pA->min.x, pB->min.x);
+	pOut->min.y = fminf(pA->min.y, pB->min.y);
+	pOut->min.z = fminf(pA->min.z, pB->min.z);
+	pOut->max.x = fmaxf(pA->max.x, pB->max.x);
+	pOut->max.y = fmaxf(pA->max.y, pB->max.y);
+	pOut->max.z = fmaxf(pA->max.z, pB->max.z);
+	return pOut;
+}
+
+/**
+ * Returns KM_TRUE if the boxes overlap or touch, KM_FALSE otherwise
+ */
+int kmAABBIntersectsAABB(const kmAABB* pA, const kmAABB* pB)
+{
+	if (pA->max.x < pB->min.x || pA->min.x > pB->max.x) return KM_FALSE;
+	if (pA->max.y < pB->min.y || pA->min.y > pB->max.y) return KM_FALSE;
+	if (pA->max.z < pB->min.z || pA->min.z > pB->max.z) return KM_FALSE;
+	return KM_TRUE;
+}
 
+/**
+ * Returns KM_TRUE if pInner is completely inside pOuter
+ */
+int kmAABBContainsAABB(const kmAABB* pOuter, const kmAABB* pInner)
+{
+	return pOuter->min.x <= pInner->min.x && pOuter->min.y <= pInner->min.y &&
+	       pOuter->min.z <= pInner->min.z && pOuter->max.x >= pInner->max.x &&
+	       pOuter->max.y >= pInner->max.y && pOuter->max.z >= pInner->max.z;
+}
 
+/**
+ * Returns the surface area of the box
+ */
+kmScalar kmAABBSurfaceArea(const kmAABB* pIn)
+{
+	kmScalar x = pIn->max.x - pIn->min.x;
+	kmScalar y = pIn->max.y - pIn->min.y;
+	kmScalar z = pIn->max.z - pIn->min.z;
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+/**
+ * Slab test of ray pOrigin + t * pDir, 0 <= t <= maxT, against the box.
+ * Returns KM_TRUE on hit and stores distance of entry point in pT,
+ * which is 0 when the ray starts inside the box
+ */
+int kmAABBIntersectsRay(const kmAABB* pBox, const kmVec3* pOrigin, const kmVec3* pDir, kmScalar maxT, kmScalar* pT)
+{
+	const kmScalar* min = &pBox->min.x;
+	const kmScalar* max = &pBox->max.x;
+	const kmScalar* o = &pOrigin->x;
+	const kmScalar* d = &pDir->x;
+	kmScalar tmin = 0.0f, tmax = maxT, t1, t2, inv;
+	int i;
+
+	for (i = 0; i < 3; ++i) {
+		if (fabsf(d[i]) < 1e-8f) {
+			/* parallel to slab, must start between its planes */
+			if (o[i] < min[i] || o[i] > max[i]) return KM_FALSE;
+			continue;
+		}
+
+		inv = 1.0f / d[i];
+		t1 = (min[i] - o[i]) * inv;
+		t2 = (max[i] - o[i]) * inv;
+		if (t1 > t2) { kmScalar tmp = t1; t1 = t2; t2 = tmp; }
+
+		if (t1 > tmin) tmin = t1;
+		if (t2 < tmax) tmax = t2;
+		if (tmin > tmax) return KM_FALSE;
+	}
+
+	if (pT) *pT = tmin;
+	return KM_TRUE;
+}
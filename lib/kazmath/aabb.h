@@ -45,6 +45,11 @@ typedef struct kmAABB {
 int kmAABBPointInBox(const kmVec3* pPoint, const kmAABB* pBox);
 kmAABB* kmAABBAssign(kmAABB* pOut, const kmAABB* pIn);
 kmAABB* kmAABBScale(kmAABB* pOut, const kmAABB* pIn, kmScalar s);
+kmAABB* kmAABBUnion(kmAABB* pOut, const kmAABB* pA, const kmAABB* pB);
+int kmAABBIntersectsAABB(const kmAABB* pA, const kmAABB* pB);
+int kmAABBContainsAABB(const kmAABB* pOuter, const kmAABB* pInner);
+kmScalar kmAABBSurfaceArea(const kmAABB* pIn);
+int kmAABBIntersectsRay(const kmAABB* pBox, const kmVec3* pOrigin, const kmVec3* pDir, kmScalar maxT, kmScalar* pT);
 
 #ifdef __cplusplus
 }
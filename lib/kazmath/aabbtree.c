@@ -0,0 +1,463 @@
+/**
+ * @file aabbtree.c
+ *
+ * Dynamic AABB tree after Erin Catto's Box2D b2DynamicTree:
+ * surface area insertion, AVL style rotations and enlarged leaves.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "aabbtree.h"
+
+/* depth of traversal stack, a balanced tree never gets close */
+#define KM_AABB_TREE_STACK 256
+
+static int kmAABBTreeIsLeaf(const kmAABBTreeNode* pNode)
+{
+	return pNode->child1 == KM_AABB_TREE_NULL;
+}
+
+static int kmAABBTreeAllocate(kmAABBTree* pTree)
+{
+	kmAABBTreeNode* nodes;
+	int id, i, capacity;
+
+	if (pTree->freeList == KM_AABB_TREE_NULL) {
+		capacity = pTree->capacity ? pTree->capacity * 2 : 16;
+		nodes = realloc(pTree->nodes, capacity * sizeof(kmAABBTreeNode));
+		if (!nodes) return KM_AABB_TREE_NULL;
+
+		/* chain new nodes to free list */
+		for (i = pTree->capacity; i < capacity; ++i) {
+			nodes[i].parent = i + 1 < capacity ? i + 1 : KM_AABB_TREE_NULL;
+			nodes[i].height = -1;
+		}
+
+		pTree->freeList = pTree->capacity;
+		pTree->nodes = nodes;
+		pTree->capacity = capacity;
+	}
+
+	id = pTree->freeList;
+	pTree->freeList = pTree->nodes[id].parent;
+	pTree->nodes[id].parent = KM_AABB_TREE_NULL;
+	pTree->nodes[id].child1 = KM_AABB_TREE_NULL;
+	pTree->nodes[id].child2 = KM_AABB_TREE_NULL;
+	pTree->nodes[id].height = 0;
+	pTree->nodes[id].data = NULL;
+	++pTree->count;
+	return id;
+}
+
+static void kmAABBTreeRelease(kmAABBTree* pTree, int id)
+{
+	pTree->nodes[id].parent = pTree->freeList;
+	pTree->nodes[id].height = -1;
+	pTree->freeList = id;
+	--pTree->count;
+}
+
+/* box and height of inner node from its children */
+static void kmAABBTreeFit(kmAABBTree* pTree, int id)
+{
+	kmAABBTreeNode* n = pTree->nodes;
+	int c1 = n[id].child1, c2 = n[id].child2;
+
+	kmAABBUnion(&n[id].box, &n[c1].box, &n[c2].box);
+	n[id].height = 1 + (n[c1].height > n[c2].height ? n[c1].height : n[c2].height);
+}
+
+/* replace child of parent, or root */
+static void kmAABBTreeRelink(kmAABBTree* pTree, int parent, int from, int to)
+{
+	if (parent == KM_AABB_TREE_NULL) {
+		pTree->root = to;
+		return;
+	}
+
+	if (pTree->nodes[parent].child1 == from)
+		pTree->nodes[parent].child1 = to;
+	else
+		pTree->nodes[parent].child2 = to;
+}
+
+/* rotate higher grandchild up if node A is imbalanced, returns new subtree root */
+static int kmAABBTreeBalance(kmAABBTree* pTree, int iA)
+{
+	kmAABBTreeNode* n = pTree->nodes;
+	int iB, iC, iUp, iX, iY, balance, *slot;
+
+	if (kmAABBTreeIsLeaf(&n[iA]) || n[iA].height < 2)
+		return iA;
+
+	iB = n[iA].child1;
+	iC = n[iA].child2;
+	balance = n[iC].height - n[iB].height;
+
+	if (balance > 1) {
+		iUp = iC; slot = &n[iA].child2;
+	} else if (balance < -1) {
+		iUp = iB; slot = &n[iA].child1;
+	} else {
+		return iA;
+	}
+
+	/* A becomes child of the raised node */
+	iX = n[iUp].child1;
+	iY = n[iUp].child2;
+	n[iUp].child1 = iA;
+	n[iUp].parent = n[iA].parent;
+	n[iA].parent = iUp;
+	kmAABBTreeRelink(pTree, n[iUp].parent, iA, iUp);
+
+	/* higher grandchild stays with raised node, lower goes to A */
+	if (n[iX].height < n[iY].height) { int t = iX; iX = iY; iY = t; }
+	n[iUp].child2 = iX;
+	*slot = iY;
+	n[iY].parent = iA;
+
+	kmAABBTreeFit(pTree, iA);
+	kmAABBTreeFit(pTree, iUp);
+	return iUp;
+}
+
+/* refit and balance ancestors of node */
+static void kmAABBTreeFixUp(kmAABBTree* pTree, int id)
+{
+	while (id != KM_AABB_TREE_NULL) {
+		id = kmAABBTreeBalance(pTree, id);
+		kmAABBTreeFit(pTree, id);
+		id = pTree->nodes[id].parent;
+	}
+}
+
+/* cost of descending into child with leaf box */
+static kmScalar kmAABBTreeDescendCost(const kmAABBTree* pTree, int child, const kmAABB* pLeaf, kmScalar inheritance)
+{
+	kmAABB combined;
+	const kmAABBTreeNode* n = &pTree->nodes[child];
+	kmScalar area = kmAABBSurfaceArea(kmAABBUnion(&combined, pLeaf, &n->box));
+
+	if (kmAABBTreeIsLeaf(n))
+		return area + inheritance;
+	return area - kmAABBSurfaceArea(&n->box) + inheritance;
+}
+
+static void kmAABBTreeInsertLeaf(kmAABBTree* pTree, int leaf)
+{
+	kmAABB leafBox, combined;
+	kmScalar area, combinedArea, cost, cost1, cost2, inheritance;
+	int index, sibling, oldParent, newParent;
+
+	if (pTree->root == KM_AABB_TREE_NULL) {
+		pTree->root = leaf;
+		pTree->nodes[leaf].parent = KM_AABB_TREE_NULL;
+		return;
+	}
+
+	/* find best sibling */
+	leafBox = pTree->nodes[leaf].box;
+	index = pTree->root;
+	while (!kmAABBTreeIsLeaf(&pTree->nodes[index])) {
+		area = kmAABBSurfaceArea(&pTree->nodes[index].box);
+		combinedArea = kmAABBSurfaceArea(kmAABBUnion(&combined, &pTree->nodes[index].box, &leafBox));
+
+		/* new parent here, or push leaf down and grow this */
+		cost = 2.0f * combinedArea;
+		inheritance = 2.0f * (combinedArea - area);
+
+		cost1 = kmAABBTreeDescendCost(pTree, pTree->nodes[index].child1, &leafBox, inheritance);
+		cost2 = kmAABBTreeDescendCost(pTree, pTree->nodes[index].child2, &leafBox, inheritance);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? pTree->nodes[index].child1 : pTree->nodes[index].child2;
+	}
+	sibling = index;
+
+	/* new parent of sibling and leaf, may move nodes */
+	newParent = kmAABBTreeAllocate(pTree);
+	assert(newParent != KM_AABB_TREE_NULL);
+
+	oldParent = pTree->nodes[sibling].parent;
+	pTree->nodes[newParent].parent = oldParent;
+	pTree->nodes[newParent].child1 = sibling;
+	pTree->nodes[newParent].child2 = leaf;
+	pTree->nodes[sibling].parent = newParent;
+	pTree->nodes[leaf].parent = newParent;
+	kmAABBTreeRelink(pTree, oldParent, sibling, newParent);
+
+	kmAABBTreeFixUp(pTree, newParent);
+}
+
+static void kmAABBTreeRemoveLeaf(kmAABBTree* pTree, int leaf)
+{
+	kmAABBTreeNode* n = pTree->nodes;
+	int parent, grandParent, sibling;
+
+	if (leaf == pTree->root) {
+		pTree->root = KM_AABB_TREE_NULL;
+		return;
+	}
+
+	parent = n[leaf].parent;
+	grandParent = n[parent].parent;
+	sibling = n[parent].child1 == leaf ? n[parent].child2 : n[parent].child1;
+
+	/* sibling takes place of parent */
+	kmAABBTreeRelink(pTree, grandParent, parent, sibling);
+	n[sibling].parent = grandParent;
+	kmAABBTreeRelease(pTree, parent);
+
+	kmAABBTreeFixUp(pTree, grandParent);
+}
+
+/**
+ * Initializes empty tree, leaf boxes are enlarged by margin.
+ * Returns pOut
+ */
+kmAABBTree* kmAABBTreeInit(kmAABBTree* pOut, kmScalar margin)
+{
+	pOut->nodes = NULL;
+	pOut->root = KM_AABB_TREE_NULL;
+	pOut->count = 0;
+	pOut->capacity = 0;
+	pOut->freeList = KM_AABB_TREE_NULL;
+	pOut->margin = margin;
+	return pOut;
+}
+
+/**
+ * Frees nodes of tree, tree is empty afterwards
+ */
+void kmAABBTreeFree(kmAABBTree* pTree)
+{
+	free(pTree->nodes);
+	kmAABBTreeInit(pTree, pTree->margin);
+}
+
+/**
+ * Inserts box with user data, returns proxy id of leaf
+ * or KM_AABB_TREE_NULL when out of memory
+ */
+int kmAABBTreeInsert(kmAABBTree* pTree, const kmAABB* pBox, void* data)
+{
+	kmAABBTreeNode* n;
+	int proxy = kmAABBTreeAllocate(pTree);
+
+	if (proxy == KM_AABB_TREE_NULL)
+		return proxy;
+
+	n = &pTree->nodes[proxy];
+	n->box = *pBox;
+	n->box.min.x -= pTree->margin; n->box.min.y -= pTree->margin; n->box.min.z -= pTree->margin;
+	n->box.max.x += pTree->margin; n->box.max.y += pTree->margin; n->box.max.z += pTree->margin;
+	n->data = data;
+	n->height = 0;
+
+	kmAABBTreeInsertLeaf(pTree, proxy);
+	return proxy;
+}
+
+/**
+ * Removes leaf of proxy id
+ */
+void kmAABBTreeRemove(kmAABBTree* pTree, int proxy)
+{
+	assert(proxy >= 0 && proxy < pTree->capacity);
+	assert(kmAABBTreeIsLeaf(&pTree->nodes[proxy]));
+
+	kmAABBTreeRemoveLeaf(pTree, proxy);
+	kmAABBTreeRelease(pTree, proxy);
+}
+
+/**
+ * Refits leaf to new box. Returns KM_FALSE when enlarged box
+ * still contains it and tree was not touched, KM_TRUE when leaf was reinserted
+ */
+int kmAABBTreeMove(kmAABBTree* pTree, int proxy, const kmAABB* pBox)
+{
+	kmAABBTreeNode* n;
+
+	assert(proxy >= 0 && proxy < pTree->capacity);
+	assert(kmAABBTreeIsLeaf(&pTree->nodes[proxy]));
+
+	if (kmAABBContainsAABB(&pTree->nodes[proxy].box, pBox))
+		return KM_FALSE;
+
+	kmAABBTreeRemoveLeaf(pTree, proxy);
+
+	n = &pTree->nodes[proxy];
+	n->box = *pBox;
+	n->box.min.x -= pTree->margin; n->box.min.y -= pTree->margin; n->box.min.z -= pTree->margin;
+	n->box.max.x += pTree->margin; n->box.max.y += pTree->margin; n->box.max.z += pTree->margin;
+
+	kmAABBTreeInsertLeaf(pTree, proxy);
+	return KM_TRUE;
+}
+
+/* centroid of box on axis, doubled */
+static kmScalar kmAABBTreeCentroid(const kmAABBTree* pTree, int id, int axis)
+{
+	const kmAABB* b = &pTree->nodes[id].box;
+	return (&b->min.x)[axis] + (&b->max.x)[axis];
+}
+
+/* top down build over leaves, splits at median of widest centroid axis */
+static int kmAABBTreeBuild(kmAABBTree* pTree, int* leaves, int count)
+{
+	kmScalar lo[3], hi[3], c, pivot;
+	int axis, i, j, left, right, mid, node, c1, c2, t;
+
+	if (count == 1) return leaves[0];
+
+	for (axis = 0; axis < 3; ++axis) {
+		lo[axis] = hi[axis] = kmAABBTreeCentroid(pTree, leaves[0], axis);
+		for (i = 1; i < count; ++i) {
+			c = kmAABBTreeCentroid(pTree, leaves[i], axis);
+			if (c < lo[axis]) lo[axis] = c;
+			if (c > hi[axis]) hi[axis] = c;
+		}
+	}
+
+	axis = 0;
+	if (hi[1] - lo[1] > hi[axis] - lo[axis]) axis = 1;
+	if (hi[2] - lo[2] > hi[axis] - lo[axis]) axis = 2;
+
+	/* quickselect median */
+	mid = count / 2;
+	left = 0; right = count - 1;
+	while (left < right) {
+		pivot = kmAABBTreeCentroid(pTree, leaves[(left + right) / 2], axis);
+		i = left; j = right;
+		while (i <= j) {
+			while (kmAABBTreeCentroid(pTree, leaves[i], axis) < pivot) ++i;
+			while (kmAABBTreeCentroid(pTree, leaves[j], axis) > pivot) --j;
+			if (i <= j) { t = leaves[i]; leaves[i] = leaves[j]; leaves[j] = t; ++i; --j; }
+		}
+		if (mid <= j) right = j;
+		else if (mid >= i) left = i;
+		else break;
+	}
+
+	c1 = kmAABBTreeBuild(pTree, leaves, mid);
+	c2 = kmAABBTreeBuild(pTree, leaves + mid, count - mid);
+
+	node = kmAABBTreeAllocate(pTree);
+	assert(node != KM_AABB_TREE_NULL);
+
+	pTree->nodes[node].child1 = c1;
+	pTree->nodes[node].child2 = c2;
+	pTree->nodes[c1].parent = node;
+	pTree->nodes[c2].parent = node;
+	kmAABBTreeFit(pTree, node);
+	return node;
+}
+
+/**
+ * Rebuilds tree from its leaves, proxy ids stay valid
+ */
+void kmAABBTreeRebuild(kmAABBTree* pTree)
+{
+	int *leaves, count, i;
+
+	if (pTree->root == KM_AABB_TREE_NULL)
+		return;
+
+	if (!(leaves = malloc(pTree->capacity * sizeof(int))))
+		return;
+
+	/* keep leaves, inner nodes are built again */
+	count = 0;
+	for (i = 0; i < pTree->capacity; ++i) {
+		if (pTree->nodes[i].height < 0)
+			continue;
+
+		if (kmAABBTreeIsLeaf(&pTree->nodes[i])) {
+			pTree->nodes[i].parent = KM_AABB_TREE_NULL;
+			leaves[count++] = i;
+		} else {
+			kmAABBTreeRelease(pTree, i);
+		}
+	}
+
+	pTree->root = kmAABBTreeBuild(pTree, leaves, count);
+	pTree->nodes[pTree->root].parent = KM_AABB_TREE_NULL;
+	free(leaves);
+}
+
+/**
+ * Returns height of tree, 0 for single leaf and -1 when empty
+ */
+int kmAABBTreeHeight(const kmAABBTree* pTree)
+{
+	if (pTree->root == KM_AABB_TREE_NULL)
+		return -1;
+	return pTree->nodes[pTree->root].height;
+}
+
+/**
+ * Calls func for every leaf whose enlarged box overlaps pBox
+ */
+void kmAABBTreeQuery(const kmAABBTree* pTree, const kmAABB* pBox, kmAABBTreeQueryFunc func, void* user)
+{
+	int stack[KM_AABB_TREE_STACK], top = 0, id;
+	const kmAABBTreeNode* n;
+
+	if (pTree->root == KM_AABB_TREE_NULL)
+		return;
+
+	stack[top++] = pTree->root;
+	while (top) {
+		id = stack[--top];
+		n = &pTree->nodes[id];
+
+		if (!kmAABBIntersectsAABB(&n->box, pBox))
+			continue;
+
+		if (kmAABBTreeIsLeaf(n)) {
+			if (!func(n->data, id, user)) return;
+			continue;
+		}
+
+		assert(top + 2 <= KM_AABB_TREE_STACK);
+		stack[top++] = n->child1;
+		stack[top++] = n->child2;
+	}
+}
+
+/**
+ * Calls func for leaves whose enlarged box ray pOrigin + t * pDir hits
+ * with t below maxT, func returns distance the ray is clipped to
+ */
+void kmAABBTreeRayCast(const kmAABBTree* pTree, const kmVec3* pOrigin, const kmVec3* pDir,
+                       kmScalar maxT, kmAABBTreeRayFunc func, void* user)
+{
+	int stack[KM_AABB_TREE_STACK], top = 0, id;
+	const kmAABBTreeNode* n;
+	kmScalar t;
+
+	if (pTree->root == KM_AABB_TREE_NULL)
+		return;
+
+	stack[top++] = pTree->root;
+	while (top) {
+		id = stack[--top];
+		n = &pTree->nodes[id];
+
+		if (!kmAABBIntersectsRay(&n->box, pOrigin, pDir, maxT, &t))
+			continue;
+
+		if (kmAABBTreeIsLeaf(n)) {
+			maxT = func(n->data, id, t, user);
+			if (maxT <= 0.0f) return;
+			continue;
+		}
+
+		assert(top + 2 <= KM_AABB_TREE_STACK);
+		stack[top++] = n->child1;
+		stack[top++] = n->child2;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef KAZMATH_AABBTREE_H_INCLUDED
+#define KAZMATH_AABBTREE_H_INCLUDED
+
+#include "aabb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KM_AABB_TREE_NULL -1
+
+/**
+ * Node of dynamic AABB tree, leaves have height 0
+ * and store user data, unused nodes have height -1
+ */
+typedef struct kmAABBTreeNode {
+	kmAABB box;   /** Enlarged box for leaves */
+	void* data;
+	int parent;   /** Next free node when unused */
+	int child1;
+	int child2;
+	int height;
+} kmAABBTreeNode;
+
+/**
+ * Dynamic AABB tree, leaves are inserted where they grow
+ * the surface area least and rotations keep it balanced.
+ * Leaf boxes are enlarged by margin so small moves don't touch the tree
+ */
+typedef struct kmAABBTree {
+	kmAABBTreeNode* nodes;
+	int root;
+	int count;
+	int capacity;
+	int freeList;
+	kmScalar margin;
+} kmAABBTree;
+
+/** Called for leaves, return KM_FALSE to stop the query */
+typedef int (*kmAABBTreeQueryFunc)(void* data, int proxy, void* user);
+
+/** Called for leaves hit at distance t, returns distance to clip the ray to,
+ *  0 stops the cast */
+typedef kmScalar (*kmAABBTreeRayFunc)(void* data, int proxy, kmScalar t, void* user);
+
+kmAABBTree* kmAABBTreeInit(kmAABBTree* pOut, kmScalar margin);
+void kmAABBTreeFree(kmAABBTree* pTree);
+int kmAABBTreeInsert(kmAABBTree* pTree, const kmAABB* pBox, void* data);
+void kmAABBTreeRemove(kmAABBTree* pTree, int proxy);
+int kmAABBTreeMove(kmAABBTree* pTree, int proxy, const kmAABB* pBox);
+void kmAABBTreeRebuild(kmAABBTree* pTree);
+int kmAABBTreeHeight(const kmAABBTree* pTree);
+void kmAABBTreeQuery(const kmAABBTree* pTree, const kmAABB* pBox, kmAABBTreeQueryFunc func, void* user);
+void kmAABBTreeRayCast(const kmAABBTree* pTree, const kmVec3* pOrigin, const kmVec3* pDir,
+                       kmScalar maxT, kmAABBTreeRayFunc func, void* user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
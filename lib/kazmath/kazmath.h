@@ -34,5 +34,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "quaternion.h"
 #include "plane.h"
 #include "aabb.h"
+#include "aabbtree.h"
 
 #endif // KAZMATH_H_INCLUDED
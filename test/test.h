@@ -0,0 +1,25 @@
+#ifndef DL_TEST_H
+#define DL_TEST_H
+
+/* checks shared by test programs,
+ * include once from the file with main */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failed = 0;
+
+static void check( const char *name, int ok )
+{
+   printf( "%-32s %s\n", name, ok ? "OK" : "FAIL" );
+   if(!ok) failed = 1;
+}
+
+/* print verdict, return exit status for main */
+static int testResult( void )
+{
+   puts( failed ? "FAILED" : "PASSED" );
+   return( failed ? EXIT_FAILURE : EXIT_SUCCESS );
+}
+
+#endif /* DL_TEST_H */
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "../test.h"
+
+/* rigged model sized load */
+#define BONES    256
+#define WEIGHTS  64
+#define NODES    256
+#define KEYS     48
+
+/* small allocations timed */
+#define BLOCKS   100000
+
+/* bones with weights and animation with keys, returns milliseconds */
+static double load( dlBone **bone, dlAnim **anim )
+{
+   dlNodeAnim   *node;
+   kmVec3        vec;
+   kmQuaternion  quat;
+   clock_t       start;
+   unsigned int  i, k;
+
+   vec.x = vec.y = vec.z = 0;
+   kmQuaternionIdentity( &quat );
+
+   start = clock();
+   for(i = 0; i != BONES; ++i)
+   {
+      bone[i] = dlNewBone();
+      for(k = 0; k != WEIGHTS; ++k)
+         dlBoneAddWeight( bone[i], i * WEIGHTS + k, 0.5f );
+   }
+
+   *anim = dlNewAnim();
+   for(i = 0; i != NODES; ++i)
+   {
+      node = dlAnimAddNode( *anim );
+      for(k = 0; k != KEYS; ++k)
+      {
+         dlNodeAddTranslationKey( node, &vec, (float)k );
+         dlNodeAddRotationKey( node, &quat, (float)k );
+      }
+   }
+
+   return( (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC );
+}
+
+int main( int argc, char **argv )
+{
+   static dlBone *bone[BONES];
+   static void   *block[BLOCKS];
+   dlAnim        *anim;
+   dlAllocStats   stats, bones;
+   unsigned char *data;
+   clock_t        start;
+   double         loadTime, slabTime, mallocTime;
+   unsigned int   i, ok;
+
+   dlDEBINIT( argc, argv );
+
+   loadTime = load( bone, &anim );
+   printf( "load: %u bones, %u keys, %.3f ms\n", BONES, NODES * KEYS * 2, loadTime );
+
+   dlAllocGetStats( ALLOC_BONE, &bones );
+   dlAllocGetStats( ALLOC_ANIM, &stats );
+   if(!bones.slab_pages)
+   {
+      puts( "built without slab (DL_SLAB=0), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   printf( "slab: bones %u blocks in %u pages, animation %u blocks in %u pages, %.1f%% used\n",
+           bones.slab_blocks, bones.slab_pages, stats.slab_blocks, stats.slab_pages,
+           100.0 * (bones.slab_used + stats.slab_used) / (bones.slab_total + stats.slab_total) );
+
+   check( "bones pooled", bones.slab_blocks >= BONES * (WEIGHTS + 1) );
+   check( "keys pooled", stats.slab_blocks >= NODES * (KEYS * 2 + 1) );
+   check( "pages mostly used", bones.slab_used + stats.slab_used >
+                               (bones.slab_total + stats.slab_total) * 3 / 4 );
+
+   for(i = 0; i != BONES; ++i)
+      dlFreeBone( bone[i] );
+   dlFreeAnim( anim );
+
+   dlAllocGetStats( ALLOC_BONE, &bones );
+   dlAllocGetStats( ALLOC_ANIM, &stats );
+   check( "blocks returned", !bones.slab_blocks && !stats.slab_blocks );
+   check( "empty pages released", bones.slab_pages <= 2 && stats.slab_pages <= 2 );
+#ifdef DEBUG
+   check( "high-water mark kept", bones.peak >= BONES * WEIGHTS * sizeof(dlVertexWeight) &&
+                                  !bones.bytes );
+#endif
+
+   /* freed blocks are zeroed for calloc */
+   dlSetAlloc( ALLOC_CORE );
+   data = dlMalloc( 40 );
+   memset( data, 0xff, 40 );
+   dlFree( data, 40 );
+   data = dlCalloc( 1, 40 );
+   for(i = 0, ok = 1; i != 40; ++i) if(data[i]) ok = 0;
+   check( "calloc zeroes reused block", ok );
+
+   /* contents survive moving out of slab */
+   for(i = 0; i != 40; ++i) data[i] = (unsigned char)i;
+   data = dlRealloc( data, 40, 4000, 1 );
+   for(i = 0, ok = 1; i != 40; ++i) if(data[i] != i) ok = 0;
+   data = dlRealloc( data, 4000, 20, 1 );
+   for(i = 0; i != 20; ++i) if(data[i] != i) ok = 0;
+   check( "realloc keeps contents", ok );
+   dlFree( data, 20 );
+
+   /* small blocks against malloc */
+   start = clock();
+   for(i = 0; i != BLOCKS; ++i) block[i] = dlMalloc( 16 + (i % 8) * 16 );
+   for(i = 0; i != BLOCKS; ++i) dlFree( block[i], 16 + (i % 8) * 16 );
+   slabTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+   start = clock();
+   for(i = 0; i != BLOCKS; ++i) block[i] = malloc( 16 + (i % 8) * 16 );
+   for(i = 0; i != BLOCKS; ++i) free( block[i] );
+   mallocTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+   printf( "%u small blocks: slab %.3f ms, malloc %.3f ms\n", BLOCKS, slabTime, mallocTime );
+
+   dlAllocTrim();
+   dlAllocGetStats( ALLOC_TOTAL, &stats );
+   check( "trim releases pages", !stats.slab_pages );
+
+   dlMemoryGraph();
+
+   return( testResult() );
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "../test.h"
+
+/* scratch allocations per frame */
+#define ALLOCS 4096
+#define FRAMES 100
+
+/* jobs asking arena of their thread */
+#define JOBS   64
+
+/* job records arena of its thread and scribbles into memory from it */
+static void arenaJob( void *user, unsigned int index )
+{
+   dlFrameArena **arena = user;
+   unsigned char *data;
+
+   arena[index] = dlThreadArena();
+   if((data = dlFrameAlloc( 1024 )))
+      memset( data, index, 1024 );
+}
+
+int main( int argc, char **argv )
+{
+   static dlFrameArena *jobArena[JOBS];
+   static void         *block[ALLOCS];
+   dlFrameArena *arena;
+   dlJobPool    *pool;
+   dlArenaStats  stats;
+   kmMat4       *matrix;
+   void         *first, *ptr;
+   clock_t       start;
+   double        arenaTime, mallocTime;
+   unsigned int  i, f, ok, size;
+
+   dlDEBINIT( argc, argv );
+
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   if(!(arena = dlNewFrameArena( 4096 )))
+      return( EXIT_FAILURE );
+
+   for(i = 0, ok = 1; i != 64; ++i)
+      if((uintptr_t)dlFrameArenaAlloc( arena, i + 1 ) % DL_ARENA_ALIGN) ok = 0;
+   check( "allocations aligned", ok );
+   check( "one block when it fits", arena->blocks == 1 );
+
+   dlFrameArenaReset( arena );
+   first = dlFrameArenaAlloc( arena, 16 );
+   dlFrameArenaReset( arena );
+   check( "reset reuses memory", dlFrameArenaAlloc( arena, 16 ) == first && arena->used == 16 );
+
+   /* frame bigger than block chains more blocks */
+   dlFrameArenaReset( arena );
+   for(i = 0, ok = 1; i != 100; ++i)
+   {
+      if(!(matrix = dlFrameArenaAlloc( arena, sizeof(kmMat4) ))) ok = 0;
+      else kmMat4Identity( matrix );
+   }
+   ptr = dlFrameArenaAlloc( arena, 10000 );
+   check( "overflow chains blocks", ok && ptr && arena->blocks > 1 );
+
+   dlFrameArenaReset( arena );
+   check( "reset merges blocks", arena->blocks == 1 && arena->size >= 100 * sizeof(kmMat4) + 10000 );
+   check( "peak kept", arena->peak >= 100 * sizeof(kmMat4) + 10000 && !arena->used );
+   dlFreeFrameArena( arena );
+
+   /* every worker thread gets its own arena */
+   pool = dlNewJobPool( 3 );
+   dlJobPoolRun( pool, arenaJob, jobArena, JOBS );
+   for(i = 0, ok = 1; i != JOBS; ++i) if(!jobArena[i]) ok = 0;
+   check( "thread arenas", ok );
+
+   dlThreadArenaGetStats( &stats );
+   printf( "%u thread arenas, %u blocks\n", stats.arenas, stats.blocks );
+   check( "arena per thread", stats.arenas >= 1 && stats.arenas <= pool->threads + 1 );
+   check( "same thread same arena", dlThreadArena() == dlThreadArena() );
+
+   dlEndFrame();
+   dlThreadArenaGetStats( &stats );
+   check( "end of frame resets", dlThreadArena()->used == 0 && stats.peak >= 1024 );
+   dlFreeJobPool( pool );
+
+   /* scratch of frame against malloc */
+   start = clock();
+   for(f = 0; f != FRAMES; ++f)
+   {
+      for(i = 0; i != ALLOCS; ++i) block[i] = dlFrameAlloc( 16 + (i % 16) * 16 );
+      dlEndFrame();
+   }
+   arenaTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES;
+
+   start = clock();
+   for(f = 0; f != FRAMES; ++f)
+   {
+      for(i = 0; i != ALLOCS; ++i) block[i] = malloc( 16 + (i % 16) * 16 );
+      for(i = 0; i != ALLOCS; ++i) free( block[i] );
+      dlEndFrame();
+   }
+   mallocTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES;
+
+   for(i = 0, size = 0; i != ALLOCS; ++i) size += 16 + (i % 16) * 16;
+   printf( "%u allocations, %.1f KiB per frame: arena %.3f ms, malloc %.3f ms\n",
+           ALLOCS, size / 1024.0f, arenaTime, mallocTime );
+   check( "scratch in one block", dlThreadArena()->blocks == 1 );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
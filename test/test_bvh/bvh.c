@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "../test.h"
+
+/* boxes in kazmath tree */
+#define BOXES  10000
+
+/* frames of movement timed */
+#define FRAMES 50
+
+/* objects in scene grid side */
+#define GRID   48
+
+static float randf( float min, float max )
+{
+   return( min + (max - min) * (rand() / (float)RAND_MAX) );
+}
+
+static void randomBox( kmAABB *box, const kmVec3 *center )
+{
+   float size = randf( 0.1f, 2.0f );
+   box->min.x = center->x - size; box->max.x = center->x + size;
+   box->min.y = center->y - size; box->max.y = center->y + size;
+   box->min.z = center->z - size; box->max.z = center->z + size;
+}
+
+static int countLeaf( void *data, int proxy, void *user )
+{
+   (*(unsigned int*)user)++;
+   return( 1 );
+}
+
+static double elapsed( clock_t start )
+{
+   return( (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC );
+}
+
+/* count objects dlBVHCull finds */
+static void countObject( dlObject *object, unsigned int planes, void *user )
+{
+   (*(unsigned int*)user)++;
+}
+
+int main( int argc, char **argv )
+{
+   static kmAABB   box[BOXES];
+   static kmVec3   velocity[BOXES];
+   kmVec3          center;
+   static int      proxy[BOXES];
+   static dlObject *object[GRID * GRID];
+   kmAABBTree      tree;
+   kmAABB          query;
+   kmVec3          origin, direction, step;
+   dlBVH           *bvh;
+   dlCamera        *camera;
+   dlRenderStats   stats;
+   clock_t         start;
+   double          refitTime, rebuildTime;
+   unsigned int    i, f, speed, found, brute, moved, linear;
+   float           distance;
+   int             height;
+
+   dlDEBINIT( argc, argv );
+   srand( 1 );
+
+   /* random boxes in tree */
+   kmAABBTreeInit( &tree, 0.5f );
+   for(i = 0; i != BOXES; ++i)
+   {
+      center.x      = randf( -500, 500 ); center.y      = randf( -500, 500 ); center.z      = randf( -500, 500 );
+      velocity[i].x = randf( -1, 1 );     velocity[i].y = randf( -1, 1 );     velocity[i].z = randf( -1, 1 );
+      randomBox( &box[i], &center );
+      proxy[i] = kmAABBTreeInsert( &tree, &box[i], &box[i] );
+   }
+
+   height = kmAABBTreeHeight( &tree );
+   printf( "%u boxes, height %d\n", BOXES, height );
+   check( "tree balanced", height > 0 && height < 40 );
+
+   /* overlap against brute force, enlarged leaves may report more */
+   query.min.x = query.min.y = query.min.z = -50;
+   query.max.x = query.max.y = query.max.z =  50;
+   found = brute = 0;
+   kmAABBTreeQuery( &tree, &query, countLeaf, &found );
+   for(i = 0; i != BOXES; ++i)
+      if(kmAABBIntersectsAABB( &box[i], &query )) ++brute;
+   check( "overlap query", found >= brute && brute > 0 );
+
+   /* refit: move every box each frame, slow moves stay inside enlarged leaves */
+   for(speed = 0; speed != 2; ++speed)
+   {
+      refitTime = 0; moved = 0;
+      for(f = 0; f != FRAMES; ++f)
+      {
+         for(i = 0; i != BOXES; ++i)
+         {
+            kmVec3Scale( &step, &velocity[i], speed ? 1.0f : 0.05f );
+            kmVec3Add( &box[i].min, &box[i].min, &step );
+            kmVec3Add( &box[i].max, &box[i].max, &step );
+         }
+
+         start = clock();
+         for(i = 0; i != BOXES; ++i)
+            moved += kmAABBTreeMove( &tree, proxy[i], &box[i] );
+         refitTime += elapsed( start );
+      }
+
+      printf( "refit %s: %.3f ms per frame, %u leaves reinserted\n",
+              speed ? "fast" : "slow", refitTime / FRAMES, moved / FRAMES );
+   }
+
+   /* rebuild: same boxes, tree built again each frame */
+   rebuildTime = 0;
+   for(f = 0; f != FRAMES; ++f)
+   {
+      for(i = 0; i != BOXES; ++i)
+         tree.nodes[ proxy[i] ].box = box[i];
+
+      start = clock();
+      kmAABBTreeRebuild( &tree );
+      rebuildTime += elapsed( start );
+   }
+
+   printf( "rebuild: %.3f ms per frame\n", rebuildTime / FRAMES );
+   printf( "rebuilt height %d\n", kmAABBTreeHeight( &tree ) );
+
+   found = 0;
+   kmAABBTreeQuery( &tree, &query, countLeaf, &found );
+   brute = 0;
+   for(i = 0; i != BOXES; ++i)
+      if(kmAABBIntersectsAABB( &box[i], &query )) ++brute;
+   check( "rebuilt tree queries", found == brute && tree.count == BOXES * 2 - 1 );
+
+   for(i = 0; i != BOXES; i += 2)
+      kmAABBTreeRemove( &tree, proxy[i] );
+   check( "remove leaves", tree.count == BOXES - 1 );
+
+   kmAABBTreeFree( &tree );
+
+   /* scene objects need renderer for culling */
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping scene" );
+      return( testResult() );
+   }
+
+   if(!(camera = dlNewCamera()) || !(bvh = dlNewBVH( 0.1f )))
+      return( EXIT_FAILURE );
+
+   if(!(object[0] = dlNewPlane( 0.5, 0.5, 1 )))
+      return( EXIT_FAILURE );
+   dlScaleObjectf( object[0], 1, 1, 1 );
+
+   for(i = 0; i != GRID * GRID; ++i)
+   {
+      if(i && !(object[i] = dlCopyObject( object[0] )))
+         return( EXIT_FAILURE );
+
+      dlPositionObjectf( object[i], (float)(i % GRID) - GRID / 2,
+                                    (float)(i / GRID) - GRID / 2, 0 );
+      dlBVHInsert( bvh, object[i] );
+   }
+
+   /* tree culling draws what linear culling does */
+   dlCameraRender( camera );
+   for(i = 0; i != GRID * GRID; ++i)
+      dlDraw( object[i] );
+   dlEndFrame();
+   dlGetRenderStats( &stats );
+   linear = stats.visible;
+
+   found = 0;
+   dlBVHCull( bvh, &_dlCore.render.frustum, countObject, &found );
+   dlBVHDraw( bvh );
+   dlEndFrame();
+   dlGetRenderStats( &stats );
+   printf( "scene: %u objects, %u in frustum\n", GRID * GRID, linear );
+   check( "tree cull", stats.visible == linear && found >= linear && found < GRID * GRID );
+
+   /* moved objects are refit */
+   dlMoveObjectf( object[0], GRID * 4, 0, 0 );
+   check( "refit moved object", dlBVHUpdate( bvh ) == 1 );
+
+   /* pick from camera through center of grid */
+   origin.x = 0.2f; origin.y = 0.2f; origin.z = 40;
+   direction.x = 0; direction.y = 0; direction.z = -1;
+   check( "pick", dlBVHPick( bvh, &origin, &direction, &distance ) ==
+          object[ (GRID / 2) * GRID + GRID / 2 ] && distance > 39 && distance < 41 );
+
+   /* overlap around origin */
+   query.min.x = query.min.y = -1.1f; query.min.z = -1;
+   query.max.x = query.max.y =  1.1f; query.max.z =  1;
+   check( "overlap", dlBVHOverlap( bvh, &query, NULL, NULL ) == 9 );
+
+   check( "remove", dlBVHRemove( bvh, object[0] ) == 0 &&
+          dlBVHRemove( bvh, object[0] ) != 0 && bvh->use_entry == GRID * GRID - 1 );
+
+   dlFreeBVH( bvh );
+   for(i = 0; i != GRID * GRID; ++i)
+      dlFreeObject( object[i] );
+   dlFreeCamera( camera );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "../test.h"
+
+/* objects in grid side, camera sees the center of it */
+#define GRID   64
+#define OBJECTS (GRID * GRID)
+
+/* frames timed per run */
+#define FRAMES 100
+
+/* childs of hierarchy that is out of view */
+#define CHILDS 8
+
+/* draw grid for frames, returns milliseconds per frame */
+static double drawFrames( dlObject **object, dlCamera *camera, dlRenderStats *stats )
+{
+   clock_t start;
+   unsigned int f, i;
+
+   start = clock();
+   for(f = 0; f != FRAMES; ++f)
+   {
+      if(camera) dlCameraRender( camera );
+      for(i = 0; i != OBJECTS; ++i)
+         dlDraw( object[i] );
+      dlEndFrame();
+   }
+
+   dlGetRenderStats( stats );
+   return( (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES );
+}
+
+int main( int argc, char **argv )
+{
+   static dlObject *object[OBJECTS];
+   dlObject      *parent, *child;
+   dlCamera      *camera;
+   dlRenderStats stats;
+   kmMat4        all;
+   double        culledTime, allTime;
+   unsigned int  i, visible;
+
+   dlDEBINIT( argc, argv );
+
+   /* recording renderer only runs the CPU side of drawing */
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   if(!(camera = dlNewCamera()))
+      return( EXIT_FAILURE );
+
+   /* grid of copies on xy plane around origin */
+   if(!(object[0] = dlNewPlane( 0.5, 0.5, 1 )))
+      return( EXIT_FAILURE );
+   dlScaleObjectf( object[0], 1, 1, 1 );
+
+   for(i = 1; i != OBJECTS; ++i)
+      if(!(object[i] = dlCopyObject( object[0] )))
+         return( EXIT_FAILURE );
+
+   for(i = 0; i != OBJECTS; ++i)
+      dlPositionObjectf( object[i], (float)(i % GRID) - GRID / 2,
+                                    (float)(i / GRID) - GRID / 2, 0 );
+
+   /* camera at default distance sees part of grid */
+   culledTime = drawFrames( object, camera, &stats );
+   printf( "culled: %u visible, %u culled, %.3f ms per frame\n",
+           stats.visible, stats.culled, culledTime );
+   check( "every object tested", stats.visible + stats.culled == OBJECTS );
+   check( "objects culled", stats.culled > 0 && stats.visible > 0 );
+   check( "draws only visible", stats.draws == stats.visible );
+   visible = stats.visible;
+
+   /* projection around whole grid, same work without rejects */
+   kmMat4OrthographicProjection( &all, -GRID, GRID, -GRID, GRID, -1, 1 );
+   dlSetProjection( all );
+
+   allTime = drawFrames( object, NULL, &stats );
+   printf( "unculled: %u visible, %u culled, %.3f ms per frame\n",
+           stats.visible, stats.culled, allTime );
+   check( "nothing culled", stats.visible == OBJECTS && !stats.culled );
+
+   /* hierarchy out of view is rejected by its parent,
+    * childs are placed in parent's space */
+   if(!(parent = dlCopyObject( object[0] )))
+      return( EXIT_FAILURE );
+
+   for(i = 0; i != CHILDS; ++i)
+   {
+      if(!(child = dlCopyObject( object[0] )))
+         return( EXIT_FAILURE );
+      dlPositionObjectf( child, 0, 0, 0 );
+      dlObjectAddChild( parent, child );
+   }
+   dlPositionObjectf( parent, 0, 0, 0 );
+
+   dlCameraRender( camera );
+   dlDraw( parent );
+   dlEndFrame();
+   dlGetRenderStats( &stats );
+   check( "hierarchy visible", stats.visible == CHILDS + 1 );
+
+   /* bounds follow parent's move */
+   dlMoveObjectf( parent, GRID * 4, 0, 0 );
+   dlDraw( parent );
+   dlEndFrame();
+   dlGetRenderStats( &stats );
+   check( "hierarchy culled at parent", !stats.visible && stats.culled == 1 );
+
+   printf( "%.1f%% of objects culled, %.2fx faster frame\n",
+           100.0 * (OBJECTS - visible) / OBJECTS,
+           culledTime > 0 ? allTime / culledTime : 0 );
+
+   dlFreeObject( parent );
+   for(i = 0; i != OBJECTS; ++i)
+      dlFreeObject( object[i] );
+   dlFreeCamera( camera );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
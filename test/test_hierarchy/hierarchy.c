@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "../test.h"
+
+/* scene of roots with chains of childs */
+#define ROOTS  256
+#define DEPTH  4
+
+/* sweeps timed */
+#define FRAMES 200
+
+static float randf( float min, float max )
+{
+   return( min + (max - min) * (rand() / (float)RAND_MAX) );
+}
+
+static int sameMatrix( const kmMat4 *a, const kmMat4 *b )
+{
+   unsigned int i;
+
+   for(i = 0; i != 16; ++i)
+      if(fabsf( a->mat[i] - b->mat[i] ) > 1e-3f * (1 + fabsf( b->mat[i] ))) return( 0 );
+
+   return( 1 );
+}
+
+/* T * Rx * Ry * Rz * S with separate matrices */
+static void referenceMatrix( kmMat4 *out, dlObject *object )
+{
+   kmMat4 translation, rotation, scale, temp;
+
+   kmMat4Translation( &translation, object->translation.x,
+                      object->translation.y, object->translation.z );
+   kmMat4RotationX( &rotation, kmDegreesToRadians( object->rotation.x ) );
+   kmMat4Multiply( &rotation, &rotation,
+                   kmMat4RotationY( &temp, kmDegreesToRadians( object->rotation.y ) ) );
+   kmMat4Multiply( &rotation, &rotation,
+                   kmMat4RotationZ( &temp, kmDegreesToRadians( object->rotation.z ) ) );
+   kmMat4Scaling( &scale, object->scale.x, object->scale.y, object->scale.z );
+
+   kmMat4Multiply( &translation, &translation, &rotation );
+   kmMat4Multiply( out, &translation, &scale );
+}
+
+static void randomTransform( dlObject *object )
+{
+   dlPositionObjectf( object, randf( -10, 10 ), randf( -10, 10 ), randf( -10, 10 ) );
+   dlRotateObjectf( object, randf( -360, 360 ), randf( -360, 360 ), randf( -360, 360 ) );
+   dlScaleObjectf( object, randf( 0.5f, 2 ), randf( 0.5f, 2 ), randf( 0.5f, 2 ) );
+}
+
+int main( int argc, char **argv )
+{
+   static dlObject *chain[ROOTS][DEPTH];
+   dlHierarchy  *hierarchy;
+   dlObject     *object, *child;
+   kmMat4        reference, world;
+   clock_t       start;
+   double        sweepTime;
+   unsigned int  i, d, f, ok, updated;
+
+   dlDEBINIT( argc, argv );
+
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   /* local matrix from quaternion equals separate axis matrices */
+   if(!(object = dlNewObject()))
+      return( EXIT_FAILURE );
+
+   for(i = 0, ok = 1; i != 1000; ++i)
+   {
+      randomTransform( object );
+      dlUpdateMatrix( object );
+      referenceMatrix( &reference, object );
+      if(!sameMatrix( &object->matrix, &reference )) ok = 0;
+   }
+   check( "local matches axis matrices", ok );
+
+   /* child world is parent world times child local */
+   if(!(child = dlNewObject()))
+      return( EXIT_FAILURE );
+   randomTransform( child );
+   dlObjectAddChild( object, child );
+   check( "child knows parent", child->parent == object );
+
+   dlUpdateMatrix( child );
+   referenceMatrix( &reference, child );
+   kmMat4Multiply( &world, &object->matrix, &reference );
+   check( "child inherits world", sameMatrix( &child->matrix, &world ) );
+
+   /* moving parent only marks world of child */
+   dlObjectCalculateBounds( object );
+   dlMoveObjectf( object, 5, 0, 0 );
+   check( "child world dirty", child->transform_changed == DL_TRANSFORM_WORLD );
+   check( "parent bounds kept", !object->bounds_changed );
+
+   dlUpdateMatrix( child );
+   check( "parent updated first", !object->transform_changed );
+   kmMat4Multiply( &world, &object->matrix, &reference );
+   check( "child follows parent", sameMatrix( &child->matrix, &world ) );
+
+   /* moving child changes bounds of parent */
+   dlMoveObjectf( child, 1, 0, 0 );
+   check( "parent bounds dirty", object->bounds_changed );
+
+   dlObjectFreeChild( object, child );
+   dlFreeObject( object );
+
+   /* scene of chains updated in one sweep */
+   if(!(hierarchy = dlNewHierarchy()))
+      return( EXIT_FAILURE );
+
+   for(i = 0; i != ROOTS; ++i)
+   {
+      for(d = 0; d != DEPTH; ++d)
+      {
+         if(!(chain[i][d] = dlNewObject()))
+            return( EXIT_FAILURE );
+         randomTransform( chain[i][d] );
+         if(d) dlObjectAddChild( chain[i][d - 1], chain[i][d] );
+      }
+      dlHierarchyAdd( hierarchy, chain[i][0] );
+   }
+   check( "flattened", hierarchy->use_node == ROOTS * DEPTH );
+
+   updated = dlHierarchyUpdate( hierarchy );
+   check( "first sweep builds all", updated == ROOTS * DEPTH );
+   check( "clean sweep builds none", !dlHierarchyUpdate( hierarchy ) );
+
+   /* chains against separate matrices multiplied down */
+   for(i = 0, ok = 1; i != ROOTS; ++i)
+   {
+      referenceMatrix( &world, chain[i][0] );
+      for(d = 1; d != DEPTH; ++d)
+      {
+         referenceMatrix( &reference, chain[i][d] );
+         kmMat4Multiply( &world, &world, &reference );
+      }
+      if(!sameMatrix( &chain[i][DEPTH - 1]->matrix, &world )) ok = 0;
+   }
+   check( "chains match", ok );
+
+   /* only dirty subtrees are built */
+   dlMoveObjectf( chain[0][0], 1, 0, 0 );
+   dlMoveObjectf( chain[1][DEPTH - 1], 1, 0, 0 );
+   check( "dirty subtrees only", dlHierarchyUpdate( hierarchy ) == DEPTH + 1 );
+
+   start = clock();
+   for(f = 0; f != FRAMES; ++f)
+   {
+      for(i = 0; i != ROOTS; ++i)
+         dlRotateObjectf( chain[i][0], 0, (float)f, 0 );
+      dlHierarchyUpdate( hierarchy );
+   }
+   sweepTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES;
+   printf( "%u objects, %.3f ms per sweep\n", ROOTS * DEPTH, sweepTime );
+
+   check( "remove root", dlHierarchyRemove( hierarchy, chain[0][0] ) == 0 &&
+                         hierarchy->use_node == (ROOTS - 1) * DEPTH );
+
+   dlFreeHierarchy( hierarchy );
+   for(i = 0; i != ROOTS; ++i)
+      dlFreeObject( chain[i][0] );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
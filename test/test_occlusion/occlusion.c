@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "../test.h"
+
+/* occlusion buffer resolution */
+#define WIDTH  256
+#define HEIGHT 192
+
+/* objects behind wall, grid side */
+#define GRID   21
+#define OBJECTS (GRID * GRID)
+
+/* frames timed per run */
+#define FRAMES 100
+
+static void setBox( kmAABB *box, float x, float y, float z, float size )
+{
+   box->min.x = x - size; box->max.x = x + size;
+   box->min.y = y - size; box->max.y = y + size;
+   box->min.z = z - size; box->max.z = z + size;
+}
+
+/* draw grid for frames, returns milliseconds per frame */
+static double drawFrames( dlObject **object, dlObject *wall, dlOcclusion *occlusion,
+                          dlRenderStats *stats )
+{
+   clock_t start;
+   unsigned int f, i;
+
+   start = clock();
+   for(f = 0; f != FRAMES; ++f)
+   {
+      /* occluders are rasterized each frame */
+      if(occlusion)
+      {
+         dlOcclusionBegin( occlusion, NULL );
+         dlOcclusionAddOccluder( occlusion, wall );
+         dlOcclusionEnd( occlusion );
+      }
+
+      dlDraw( wall );
+      for(i = 0; i != OBJECTS; ++i)
+         dlDraw( object[i] );
+      dlEndFrame();
+   }
+
+   dlGetRenderStats( stats );
+   return( (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES );
+}
+
+int main( int argc, char **argv )
+{
+   static dlObject *object[OBJECTS];
+   dlObject      *wall;
+   dlOcclusion   *occlusion;
+   dlRenderStats stats;
+   kmMat4        projection, view;
+   kmVec3        eye, center, up;
+   kmAABB        box;
+   double        occludedTime, allTime;
+   unsigned int  i;
+
+   dlDEBINIT( argc, argv );
+
+   /* camera on z axis looking at origin */
+   eye.x = 0;    eye.y = 0;    eye.z = 10;
+   center.x = 0; center.y = 0; center.z = 0;
+   up.x = 0;     up.y = 1;     up.z = 0;
+   kmMat4PerspectiveProjection( &projection, 60, (float)WIDTH / HEIGHT, 1, 100 );
+   kmMat4LookAt( &view, &eye, &center, &up );
+   kmMat4Multiply( &projection, &projection, &view );
+
+   /* buffer is CPU only, recording renderer is needed for objects */
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   check( "tile size required", !dlNewOcclusion( WIDTH + 1, HEIGHT ) );
+   if(!(occlusion = dlNewOcclusion( WIDTH, HEIGHT )))
+      return( EXIT_FAILURE );
+
+   /* 6x6 wall at origin */
+   if(!(wall = dlNewPlane( 1, 1, 1 )))
+      return( EXIT_FAILURE );
+   dlScaleObjectf( wall, 6, 6, 1 );
+
+   dlOcclusionBegin( occlusion, &projection );
+   dlOcclusionAddOccluder( occlusion, wall );
+   dlOcclusionEnd( occlusion );
+
+   check( "wall rasterized", dlOcclusionDepth( occlusion, WIDTH / 2, HEIGHT / 2 ) < 1.0f &&
+                             dlOcclusionDepth( occlusion, 0, 0 ) == 1.0f );
+
+   setBox( &box, 0, 0, -5, 0.5f );
+   check( "box behind wall hidden", !dlOcclusionTestAABB( occlusion, &box ) );
+
+   setBox( &box, 0, 0, 5, 0.5f );
+   check( "box in front visible", dlOcclusionTestAABB( occlusion, &box ) );
+
+   setBox( &box, 8, 0, -5, 0.5f );
+   check( "box beside wall visible", dlOcclusionTestAABB( occlusion, &box ) );
+
+   setBox( &box, 4.5f, 0, -5, 1.5f );
+   check( "box past edge visible", dlOcclusionTestAABB( occlusion, &box ) );
+
+   setBox( &box, 0, 0, 10, 1 );
+   check( "box at near plane visible", dlOcclusionTestAABB( occlusion, &box ) );
+
+   box.min.x = box.min.y = -3; box.min.z = 0;
+   box.max.x = box.max.y =  3; box.max.z = 0;
+   check( "wall not self occluded", dlOcclusionTestAABB( occlusion, &box ) );
+   check( "counters", occlusion->tested == 6 && occlusion->rejected == 1 &&
+                      occlusion->occluders == 1 );
+
+   /* scene drawing rejects objects behind wall */
+   dlSetProjection( projection );
+
+   if(!(object[0] = dlNewPlane( 0.5, 0.5, 1 )))
+      return( EXIT_FAILURE );
+   dlScaleObjectf( object[0], 1, 1, 1 );
+
+   for(i = 1; i != OBJECTS; ++i)
+      if(!(object[i] = dlCopyObject( object[0] )))
+         return( EXIT_FAILURE );
+
+   for(i = 0; i != OBJECTS; ++i)
+      dlPositionObjectf( object[i], (float)(i % GRID) - GRID / 2,
+                                    (float)(i / GRID) - GRID / 2, -5 );
+
+   allTime = drawFrames( object, wall, NULL, &stats );
+   printf( "unoccluded: %u visible, %u culled, %.3f ms per frame\n",
+           stats.visible, stats.culled, allTime );
+   check( "nothing occluded", !stats.occluded );
+
+   dlSetOcclusion( occlusion );
+   occludedTime = drawFrames( object, wall, occlusion, &stats );
+   printf( "occluded: %u visible, %u culled, %u occluded, %.3f ms per frame\n",
+           stats.visible, stats.culled, stats.occluded, occludedTime );
+   check( "every object tested", stats.visible + stats.culled + stats.occluded == OBJECTS + 1 );
+   check( "objects occluded", stats.occluded > 0 && stats.visible > 1 );
+   check( "draws only visible", stats.draws == stats.visible );
+
+   printf( "%.1f%% of draws rejected by occlusion, %.2fx frame time\n",
+           100.0 * stats.occluded / (OBJECTS + 1),
+           allTime > 0 ? occludedTime / allTime : 0 );
+
+   dlSetOcclusion( NULL );
+   dlFreeOcclusion( occlusion );
+   for(i = 0; i != OBJECTS; ++i)
+      dlFreeObject( object[i] );
+   dlFreeObject( wall );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
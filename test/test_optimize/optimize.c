@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "DL/dlOptimize.h"
+#include "../test.h"
+
+/* grid of GRID_SIZE x GRID_SIZE vertices */
+#define GRID_SIZE 64
+#define VERTICES  (GRID_SIZE * GRID_SIZE)
+#define INDICES   ((GRID_SIZE - 1) * (GRID_SIZE - 1) * 6)
+
+/* rotate triangle so smallest index is first, winding is kept */
+static void canonical( unsigned int *tri )
+{
+   unsigned int tmp;
+
+   while(tri[0] > tri[1] || tri[0] > tri[2])
+   {
+      tmp = tri[0]; tri[0] = tri[1]; tri[1] = tri[2]; tri[2] = tmp;
+   }
+}
+
+static int triCmp( const void *a, const void *b )
+{
+   return( memcmp( a, b, 3 * sizeof(unsigned int) ) );
+}
+
+/* same triangles with same winding in any order */
+static int sameTriangles( const unsigned int *a, const unsigned int *b, unsigned int count )
+{
+   static unsigned int ca[INDICES], cb[INDICES];
+   unsigned int t;
+
+   memcpy( ca, a, count * sizeof(unsigned int) );
+   memcpy( cb, b, count * sizeof(unsigned int) );
+   for(t = 0; t != count / 3; ++t)
+   {
+      canonical( &ca[t * 3] );
+      canonical( &cb[t * 3] );
+   }
+
+   qsort( ca, count / 3, 3 * sizeof(unsigned int), triCmp );
+   qsort( cb, count / 3, 3 * sizeof(unsigned int), triCmp );
+   return( !memcmp( ca, cb, count * sizeof(unsigned int) ) );
+}
+
+/* grid emitted unindexed, vertex per index like importers do */
+static void testWeld( const kmVec3 *positions, const unsigned int *source )
+{
+   static kmVec3       expanded[INDICES];
+   static unsigned int remap[INDICES], welded[VERTICES], grid[VERTICES];
+   dlVBO vbo;
+   unsigned int i, unique, ok;
+
+   memset( &vbo, 0, sizeof(dlVBO) );
+   vbo.vertices = expanded;
+   vbo.v_use    = INDICES;
+
+   for(i = 0; i != INDICES; ++i)
+      expanded[i] = positions[source[i]];
+
+   unique = dlOptimizeWeld( remap, &vbo, 0.0f );
+   printf( "welded %u vertices to %u\n", INDICES, unique );
+   check( "exact weld", unique == VERTICES );
+
+   /* grid vertex maps to one welded vertex and back */
+   memset( welded, 0xff, sizeof(welded) );
+   memset( grid, 0xff, sizeof(grid) );
+   ok = 1;
+   for(i = 0; i != INDICES && ok; ++i)
+   {
+      if(remap[i] >= unique) { ok = 0; break; }
+      if(welded[source[i]] == UINT_MAX) welded[source[i]] = remap[i];
+      if(grid[remap[i]] == UINT_MAX)    grid[remap[i]]    = source[i];
+      ok = welded[source[i]] == remap[i] && grid[remap[i]] == source[i];
+   }
+   check( "exact weld remap", ok );
+
+   /* jitter below epsilon still welds */
+   for(i = 0; i != INDICES; ++i)
+      expanded[i].x += (i & 1) ? 0.001f : -0.001f;
+
+   check( "exact weld keeps jitter", dlOptimizeWeld( remap, &vbo, 0.0f ) > VERTICES );
+   check( "epsilon weld", dlOptimizeWeld( remap, &vbo, 0.01f ) == VERTICES );
+}
+
+int main( int argc, char **argv )
+{
+   static kmVec3       positions[VERTICES];
+   static unsigned int source[INDICES], indices[INDICES], remap[VERTICES];
+   unsigned int x, y, i, t, tmp[3], clusters = 0, next;
+   float shuffled, optimized, overdraw;
+
+   /* bumpy grid */
+   for(y = 0; y != GRID_SIZE; ++y)
+      for(x = 0; x != GRID_SIZE; ++x)
+         kmVec3Fill( &positions[y * GRID_SIZE + x], x, (x * y) % 3, y );
+
+   i = 0;
+   for(y = 0; y != GRID_SIZE - 1; ++y)
+      for(x = 0; x != GRID_SIZE - 1; ++x)
+      {
+         source[i++] = y * GRID_SIZE + x;
+         source[i++] = (y + 1) * GRID_SIZE + x;
+         source[i++] = y * GRID_SIZE + x + 1;
+         source[i++] = y * GRID_SIZE + x + 1;
+         source[i++] = (y + 1) * GRID_SIZE + x;
+         source[i++] = (y + 1) * GRID_SIZE + x + 1;
+      }
+
+   /* worst case input, triangles in random order */
+   srand( 1 );
+   for(t = INDICES / 3 - 1; t; --t)
+   {
+      i = rand() % (t + 1);
+      memcpy( tmp, &source[t * 3], sizeof(tmp) );
+      memcpy( &source[t * 3], &source[i * 3], sizeof(tmp) );
+      memcpy( &source[i * 3], tmp, sizeof(tmp) );
+   }
+
+   shuffled = dlOptimizeACMR( source, INDICES, VERTICES, DL_OPTIMIZE_FIFO_SIZE );
+
+   /* vertex cache */
+   memcpy( indices, source, sizeof(indices) );
+   check( "vertex cache pass", dlOptimizeVertexCache( indices, indices, INDICES, VERTICES ) == 0 );
+   optimized = dlOptimizeACMR( indices, INDICES, VERTICES, DL_OPTIMIZE_FIFO_SIZE );
+   printf( "ACMR shuffled %.3f, optimized %.3f\n", shuffled, optimized );
+   check( "triangles kept", sameTriangles( source, indices, INDICES ) );
+   check( "ACMR below 0.8", optimized < 0.8f );
+
+   /* overdraw */
+   check( "overdraw pass", dlOptimizeOverdraw( indices, indices, INDICES,
+                                               positions, VERTICES, &clusters ) == 0 );
+   overdraw = dlOptimizeACMR( indices, INDICES, VERTICES, DL_OPTIMIZE_FIFO_SIZE );
+   printf( "ACMR with %u clusters %.3f\n", clusters, overdraw );
+   check( "triangles kept", sameTriangles( source, indices, INDICES ) );
+   check( "clusters found", clusters > 0 && clusters <= INDICES / 3 );
+
+   /* vertex fetch */
+   check( "vertex fetch pass", dlOptimizeVertexFetch( remap, indices, INDICES, VERTICES ) == 0 );
+   dlOptimizeRemapIndices( indices, INDICES, remap );
+
+   next = 0;
+   for(i = 0; i != INDICES; ++i)
+   {
+      if(indices[i] > next) break;
+      if(indices[i] == next) next++;
+   }
+   check( "vertices in first use order", i == INDICES && next == VERTICES );
+   check( "ACMR kept", dlOptimizeACMR( indices, INDICES, VERTICES,
+                                       DL_OPTIMIZE_FIFO_SIZE ) == overdraw );
+
+   /* weld, source is still in grid vertex order */
+   testWeld( positions, source );
+
+   /* invalid input */
+   indices[0] = VERTICES;
+   check( "out of range index rejected",
+          dlOptimizeVertexCache( indices, indices, INDICES, VERTICES ) != 0 );
+
+   return( testResult() );
+}
@@ -93,6 +93,9 @@ int main( int argc, char **argv )
    if(dlCreateDisplay( WINDOW_WIDTH, WINDOW_HEIGHT, DL_RENDER_OGL140 ) != 0)
       cleanup(EXIT_FAILURE);
 
+   /* planes share geometry heap */
+   dlHeapInit( 0 );
+
    /* create camera */
    camera = dlNewCamera();
    if(!camera)
@@ -150,6 +153,7 @@ int main( int argc, char **argv )
       dlDraw( obj3 );
 
       dlSwapBuffers();
+      dlEndFrame();
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
       if(fpsDelay < SDL_GetTicks())
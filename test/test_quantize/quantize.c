@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "DL/dlQuantize.h"
+
+/* odd count to hit scalar tails after SIMD loops */
+#define TEST_NUM 1027
+
+static int failed = 0;
+
+static float randf( float min, float max )
+{
+   return( min + (max - min) * ((float)rand() / RAND_MAX) );
+}
+
+static void check( const char *name, float error, float limit )
+{
+   printf( "%-20s max error %g (limit %g) %s\n", name, error, limit,
+         error <= limit ? "OK" : "FAIL" );
+   if(error > limit) failed = 1;
+}
+
+/* half floats, relative error is 2^-11 in normal range */
+static void testHalf( void )
+{
+   static float    src[TEST_NUM], dst[TEST_NUM];
+   static uint16_t half[TEST_NUM];
+   const float special[] = { 0.0f, -0.0f, 1.0f, -2.0f, 65504.0f, 6.1035156e-05f, 5.9604645e-08f };
+   float error = 0, e;
+   unsigned int i;
+
+   for(i = 0; i != TEST_NUM; ++i)
+      src[i] = randf( -1000.0f, 1000.0f );
+   for(i = 0; i != sizeof(special) / sizeof(float); ++i)
+      src[i] = special[i];
+
+   dlQuantizeHalf( src, half, TEST_NUM );
+   dlDequantizeHalf( half, dst, TEST_NUM );
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      e = fabsf( dst[i] - src[i] ) / (fabsf( src[i] ) > 6.1035156e-05f ? fabsf( src[i] ) : 1.0f);
+      if(e > error) error = e;
+   }
+   check( "half", error, 1.0f / 2048.0f );
+
+   /* exact values and overflow */
+   src[0] = 1e6f; src[1] = -1e6f;
+   dlQuantizeHalf( src, half, 2 );
+   if(half[0] != 0x7c00 || half[1] != 0xfc00)
+   { printf( "half overflow FAIL\n" ); failed = 1; }
+   if(dst[2] != 1.0f || dst[3] != -2.0f || dst[4] != 65504.0f)
+   { printf( "half exact FAIL\n" ); failed = 1; }
+}
+
+/* half positions */
+static void testPositionsHalf( void )
+{
+   static kmVec3   src[TEST_NUM], dst[TEST_NUM];
+   static uint16_t half[TEST_NUM * 4];
+   float error = 0;
+   unsigned int i;
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      src[i].x = randf( -1.0f, 1.0f );
+      src[i].y = randf( -1.0f, 1.0f );
+      src[i].z = randf( -1.0f, 1.0f );
+   }
+
+   dlQuantizePositionsHalf( src, half, TEST_NUM );
+   dlDequantizePositionsHalf( half, dst, TEST_NUM );
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      if(fabsf( dst[i].x - src[i].x ) > error) error = fabsf( dst[i].x - src[i].x );
+      if(fabsf( dst[i].y - src[i].y ) > error) error = fabsf( dst[i].y - src[i].y );
+      if(fabsf( dst[i].z - src[i].z ) > error) error = fabsf( dst[i].z - src[i].z );
+   }
+   check( "half positions", error, 1.0f / 2048.0f );
+}
+
+/* int16 positions, error is half step of range */
+static void testPositions( void )
+{
+   static kmVec3  src[TEST_NUM], dst[TEST_NUM];
+   static int16_t q[TEST_NUM * 4];
+   kmVec3 scale, bias;
+   float error = 0, limit;
+   unsigned int i;
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      src[i].x = randf( -50.0f, 150.0f );
+      src[i].y = randf(   2.0f,   3.0f );
+      src[i].z = 7.0f;
+   }
+
+   dlQuantizePositionRange( src, TEST_NUM, &scale, &bias );
+   dlQuantizePositions( src, q, TEST_NUM, &scale, &bias );
+   dlDequantizePositions( q, dst, TEST_NUM, &scale, &bias );
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      if(fabsf( dst[i].x - src[i].x ) > error) error = fabsf( dst[i].x - src[i].x );
+      if(fabsf( dst[i].y - src[i].y ) > error) error = fabsf( dst[i].y - src[i].y );
+      if(fabsf( dst[i].z - src[i].z ) > error) error = fabsf( dst[i].z - src[i].z );
+   }
+
+   /* largest axis decides, small slack for float rounding */
+   limit = scale.x * 0.5f + 1e-4f;
+   check( "int16 positions", error, limit );
+}
+
+/* int16 coords */
+static void testCoords( void )
+{
+   static kmVec2  src[TEST_NUM], dst[TEST_NUM];
+   static int16_t q[TEST_NUM * 2];
+   kmVec2 scale, bias;
+   float error = 0;
+   unsigned int i;
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      src[i].x = randf( 0.0f, 1.0f );
+      src[i].y = randf( -2.0f, 4.0f );
+   }
+
+   dlQuantizeCoordRange( src, TEST_NUM, &scale, &bias );
+   dlQuantizeCoords( src, q, TEST_NUM, &scale, &bias );
+   dlDequantizeCoords( q, dst, TEST_NUM, &scale, &bias );
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      if(fabsf( dst[i].x - src[i].x ) > error) error = fabsf( dst[i].x - src[i].x );
+      if(fabsf( dst[i].y - src[i].y ) > error) error = fabsf( dst[i].y - src[i].y );
+   }
+   check( "int16 coords", error, scale.y * 0.5f + 1e-5f );
+}
+
+/* packed normals, error is half step per component */
+static void testNormals( void )
+{
+   static kmVec3   src[TEST_NUM], dst[TEST_NUM];
+   static uint32_t packed[TEST_NUM];
+   static int8_t   bytes[TEST_NUM * 4];
+   float error = 0;
+   unsigned int i;
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      src[i].x = randf( -1.0f, 1.0f );
+      src[i].y = randf( -1.0f, 1.0f );
+      src[i].z = randf( -1.0f, 1.0f );
+      kmVec3Normalize( &src[i], &src[i] );
+   }
+   src[0].x = 1;  src[0].y = 0;  src[0].z = 0;
+   src[1].x = 0;  src[1].y = -1; src[1].z = 0;
+
+   dlQuantizeNormals( src, packed, TEST_NUM );
+   dlDequantizeNormals( packed, dst, TEST_NUM );
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      if(fabsf( dst[i].x - src[i].x ) > error) error = fabsf( dst[i].x - src[i].x );
+      if(fabsf( dst[i].y - src[i].y ) > error) error = fabsf( dst[i].y - src[i].y );
+      if(fabsf( dst[i].z - src[i].z ) > error) error = fabsf( dst[i].z - src[i].z );
+   }
+   check( "2_10_10_10 normals", error, 0.5f / 511.0f + 1e-6f );
+
+   /* axis survives exactly */
+   if(dst[0].x != 1.0f || dst[1].y != -1.0f)
+   { printf( "2_10_10_10 axis FAIL\n" ); failed = 1; }
+
+   error = 0;
+   dlQuantizeNormalsByte( src, bytes, TEST_NUM );
+   dlDequantizeNormalsByte( bytes, dst, TEST_NUM );
+
+   for(i = 0; i != TEST_NUM; ++i)
+   {
+      if(fabsf( dst[i].x - src[i].x ) > error) error = fabsf( dst[i].x - src[i].x );
+      if(fabsf( dst[i].y - src[i].y ) > error) error = fabsf( dst[i].y - src[i].y );
+      if(fabsf( dst[i].z - src[i].z ) > error) error = fabsf( dst[i].z - src[i].z );
+   }
+   check( "byte normals", error, 0.5f / 127.0f + 1e-6f );
+}
+
+int main( int argc, char **argv )
+{
+   srand( 1 );
+
+   testHalf();
+   testPositionsHalf();
+   testPositions();
+   testCoords();
+   testNormals();
+
+   puts( failed ? "FAILED" : "PASSED" );
+   return( failed ? EXIT_FAILURE : EXIT_SUCCESS );
+}
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DL/dl.h"
+#include "DL/dlRecord.h"
+#include "DL/dlStream.h"
+#include "../test.h"
+
+/* objects drawn per frame, alternating between two textures */
+#define OBJECTS 8
+
+/* instances drawn with dlDrawInstanced */
+#define INSTANCES 64
+
+/* OpenGL 1.4+ renderer draws bounding box of every object too */
+#define DRAWS   (OBJECTS * 2)
+
+/* 4x4 RGBA texture of one color */
+static dlTexture* newTexture( unsigned char color )
+{
+   dlTexture     *texture;
+   unsigned char *data;
+
+   if(!(texture = dlNewTexture( NULL, 0 )))
+      return( NULL );
+
+   /* texture takes the data */
+   if(!(data = malloc( 4 * 4 * 4 )))
+      return( NULL );
+
+   memset( data, color, 4 * 4 * 4 );
+   if(dlTextureCreate( texture, data, 4, 4, 4, 0 ) != 0)
+      return( NULL );
+
+   return( texture );
+}
+
+/* count issued calls of type in log,
+ * only ones that did not change GL state if redundant */
+static unsigned int countCalls( dleRecordCall call, int redundant )
+{
+   const dlRecordCommand *command;
+   unsigned int i, count, found;
+
+   command = dlRecordLog( &count );
+   found   = 0;
+   for(i = 0; i != count; ++i)
+      if(command[i].call == call && (!redundant || command[i].redundant)) ++found;
+
+   return( found );
+}
+
+/* index i of batch object's IBO */
+static unsigned int batchIndex( dlObject *object, unsigned int i )
+{
+#if USE_BUFFERS
+   return( object->ibo->indices[0][i] );
+#else
+   return( object->ibo->indices[i] );
+#endif
+}
+
+static void printStats( const char *name, dlRecordStats *stats )
+{
+   printf( "%s: %u calls, %u draws, %u binds, %u state changes, %u redundant, %lu bytes uploaded\n",
+           name, stats->calls, stats->draws, stats->binds, stats->stateChanges,
+           stats->redundant, (unsigned long)stats->uploaded );
+}
+
+int main( int argc, char **argv )
+{
+   dlObject      *object[OBJECTS], *merged, *copy, *streamed;
+   dlBatchRange  *range;
+   kmAABB        box, all;
+   dlShader      shader;
+   kmMat4        instance[INSTANCES];
+   dlRecordStats stats;
+   unsigned int  i, binds;
+   size_t        offset;
+   unsigned int  remap[4];
+
+   dlDEBINIT( argc, argv );
+
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   /* copies share geometry until modified */
+   object[0] = dlNewPlane( 0.1, 0.1, 1 );
+   object[1] = dlNewPlane( 0.1, 0.1, 1 );
+   if(!object[0] || !object[1])
+      return( EXIT_FAILURE );
+
+   object[0]->material = dlNewMaterialFromTexture( newTexture( 0x00 ) );
+   object[1]->material = dlNewMaterialFromTexture( newTexture( 0xff ) );
+   for(i = 2; i != OBJECTS; ++i)
+   {
+      if(!(object[i] = dlCopyObject( object[i % 2] )))
+         return( EXIT_FAILURE );
+      dlMoveObjectf( object[i], i, 0, 0 );
+   }
+
+   /* first frame uploads geometry */
+   dlRecordReset();
+   for(i = 0; i != OBJECTS; ++i)
+      dlDraw( object[i] );
+   dlEndFrame();
+
+   dlRecordGetStats( &stats );
+   printStats( "first frame", &stats );
+   check( "one draw per object", stats.draws == DRAWS && stats.objects == OBJECTS );
+   check( "geometry uploaded", stats.uploaded > 0 );
+
+   /* second frame draws from GL objects */
+   dlRecordReset();
+   for(i = 0; i != OBJECTS; ++i)
+      dlDraw( object[i] );
+   dlEndFrame();
+
+   dlRecordGetStats( &stats );
+   printStats( "second frame", &stats );
+   check( "nothing uploaded", stats.uploaded == 0 );
+   binds = countCalls( DL_RECORD_BIND_TEXTURE, 0 );
+   check( "texture bound per object", binds == OBJECTS );
+
+   /* pointers live in cached vertex arrays,
+    * only bounding boxes set theirs */
+   check( "vertex arrays cached", !countCalls( DL_RECORD_TEXCOORD_POINTER, 0 ) &&
+          countCalls( DL_RECORD_VERTEX_POINTER, 0 ) == OBJECTS &&
+          !countCalls( DL_RECORD_GEN_VERTEX_ARRAYS, 0 ) );
+
+   /* sorted queue binds every texture once */
+   dlRecordReset();
+   for(i = 0; i != OBJECTS; ++i)
+      dlQueueDraw( object[i], 0 );
+   dlFlushQueue();
+   dlEndFrame();
+
+   dlRecordGetStats( &stats );
+   printStats( "queued frame", &stats );
+   check( "queue draws every object", stats.draws == DRAWS );
+   check( "queue binds textures once", countCalls( DL_RECORD_BIND_TEXTURE, 0 ) == 2 );
+
+   /* streamed geometry is written at flush,
+    * ring moving on after queueing doesn't lose it */
+   if(!(streamed = dlNewPlane( 0.1, 0.1, 1 )))
+      return( EXIT_FAILURE );
+   streamed->vbo->hint = GL_STREAM_DRAW;
+
+   dlQueueDraw( streamed, 0 );
+   if(dlStreamMap( 1, &offset )) dlStreamUnmap();
+   if(dlStreamMap( DL_STREAM_SIZE, &offset )) dlStreamUnmap();
+   dlFlushQueue();
+   check( "streamed queue writes at flush", streamed->vbo->streamed &&
+          streamed->vbo->serial == dlStreamSerial() );
+   dlEndFrame();
+   dlFreeObject( streamed );
+
+   /* remap moves every vertex, pending partial range can't stay */
+   dlVBOModifiedVertices( object[0]->vbo, 0, 1 );
+   for(i = 0; i != object[0]->vbo->v_use; ++i)
+      remap[i] = object[0]->vbo->v_use - 1 - i;
+   dlVBORemap( object[0]->vbo, remap );
+
+   dlRecordReset();
+   dlDraw( object[0] );
+   dlEndFrame();
+   dlRecordGetStats( &stats );
+   check( "remap uploads every vertex", stats.uploaded == object[0]->vbo->vbo_size );
+
+   /* cached binds never reach GL twice */
+   check( "no redundant buffer binds", !countCalls( DL_RECORD_BIND_BUFFER, 1 ) );
+
+   /* static batch draws once per texture */
+   dlObjectWorldBounds( object[0], &all );
+   for(i = 1; i != OBJECTS; ++i)
+      kmAABBUnion( &all, &all, dlObjectWorldBounds( object[i], &box ) );
+
+   merged = dlBatchStatic( object, OBJECTS );
+   check( "batch per texture", merged && merged->num_childs == 1 );
+   check( "batch keeps placement", merged && dlObjectWorldBounds( merged, &box ) &&
+          fabs( box.min.x - all.min.x ) < 0.001f && fabs( box.max.x - all.max.x ) < 0.001f );
+
+   dlRecordReset();
+   dlDraw( merged );
+   dlEndFrame();
+
+   dlRecordGetStats( &stats );
+   printStats( "batched frame", &stats );
+   check( "batch draws", stats.objects == 2 && stats.draws == 4 );
+
+   /* hidden object's triangles collapse, draw stays */
+   range = merged ? &merged->batch->range[1] : NULL;
+   check( "hide merged object", range && dlBatchHide( merged, 2, 1 ) == 0 &&
+          batchIndex( merged, range->first ) == batchIndex( merged, range->first + range->count - 1 ) );
+   check( "show merged object", range && dlBatchHide( merged, 2, 0 ) == 0 &&
+          batchIndex( merged, range->first + 1 ) == merged->batch->indices[ range->first + 1 ] );
+
+   /* copies hide their pieces independently */
+   copy = merged ? dlCopyObject( merged ) : NULL;
+   check( "hide on copied batch", copy && dlBatchHide( merged, 2, 1 ) == 0 &&
+          dlBatchHide( copy, 2, 1 ) == 0 &&
+          batchIndex( copy, range->first ) == batchIndex( copy, range->first + range->count - 1 ) );
+   dlFreeObject( copy );
+   dlFreeObject( merged );
+
+   /* fixed function instancing only changes matrix */
+   for(i = 0; i != INSTANCES; ++i)
+      kmMat4Translation( &instance[i], i, 0, 0 );
+
+   dlRecordReset();
+   dlDrawInstanced( object[0], instance, INSTANCES );
+   dlEndFrame();
+
+   dlRecordGetStats( &stats );
+   printStats( "instanced frame", &stats );
+   check( "draw per instance", stats.draws == INSTANCES );
+   check( "pointers set at most once", countCalls( DL_RECORD_VERTEX_POINTER, 0 ) <= 1 );
+
+   /* shader that doesn't read DL_IN_INSTANCE gets matrix per draw */
+   memset( &shader, 0, sizeof(dlShader) );
+   dlSetShader( &shader );
+
+   dlRecordReset();
+   dlDrawInstanced( object[0], instance, INSTANCES );
+   dlEndFrame();
+
+   dlRecordGetStats( &stats );
+   check( "no instance input, draw per instance", stats.draws == INSTANCES &&
+          !countCalls( DL_RECORD_DRAW_ARRAYS_INSTANCED, 0 ) &&
+          !countCalls( DL_RECORD_DRAW_ELEMENTS_INSTANCED, 0 ) );
+
+   /* with instance input matrices are streamed once and drawn in one call */
+   shader.instance = 1;
+
+   dlRecordReset();
+   dlDrawInstanced( object[0], instance, INSTANCES );
+   dlEndFrame();
+
+   dlRecordGetStats( &stats );
+   printStats( "hardware instanced frame", &stats );
+   check( "one instanced draw", stats.draws == 1 &&
+          countCalls( DL_RECORD_DRAW_ARRAYS_INSTANCED, 0 ) +
+          countCalls( DL_RECORD_DRAW_ELEMENTS_INSTANCED, 0 ) == 1 );
+   check( "matrices streamed once", stats.uploaded == INSTANCES * sizeof(kmMat4) );
+
+   /* plain draw after it resets instance input to identity */
+   dlRecordReset();
+   dlDraw( object[0] );
+   dlEndFrame();
+   dlSetShader( NULL );
+   check( "instance input identity", countCalls( DL_RECORD_VERTEX_ATTRIB, 0 ) == 4 );
+
+   if(argc > 1 && !strcmp( argv[1], "-v" ))
+      dlRecordWrite( stdout );
+
+   for(i = 0; i != OBJECTS; ++i)
+      dlFreeObject( object[i] );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "../test.h"
+
+/* PMD sized model, two bones per vertex */
+#define VERTICES 10000
+#define BONES    100
+#define FRAMES   200
+
+/* vertex with more weights than skin keeps */
+#define CROWDED  7
+
+/* skinning before influences, walks weight lists of bones */
+static void referenceSkin( dlAnimator *animator, const kmVec3 *tstance, kmVec3 *out, unsigned int vertices )
+{
+   dlBone         *bone;
+   dlVertexWeight *weight;
+   kmVec3          v;
+   unsigned int    i;
+
+   for(i = 0; i != vertices; ++i)
+      out[i].x = out[i].y = out[i].z = 0;
+
+   for(bone = animator->bone; bone; bone = bone->next)
+      for(weight = bone->weight; weight; weight = weight->next)
+      {
+         kmVec3Transform( &v, &tstance[weight->vertex], &bone->globalMatrix );
+         out[weight->vertex].x += v.x * weight->value;
+         out[weight->vertex].y += v.y * weight->value;
+         out[weight->vertex].z += v.z * weight->value;
+      }
+}
+
+static float maxError( const kmVec3 *a, const kmVec3 *b, unsigned int vertices )
+{
+   float error = 0, d;
+   unsigned int i;
+
+   for(i = 0; i != vertices; ++i)
+   {
+      d = fabsf( a[i].x - b[i].x ); if(d > error) error = d;
+      d = fabsf( a[i].y - b[i].y ); if(d > error) error = d;
+      d = fabsf( a[i].z - b[i].z ); if(d > error) error = d;
+   }
+   return( error );
+}
+
+/* bones posed with rotation, squash and translation */
+static void pose( dlAnimator *animator, float time )
+{
+   dlBone       *bone;
+   kmMat4        rotation, scaling, translation;
+   unsigned int  b = 0;
+
+   for(bone = animator->bone; bone; bone = bone->next, ++b)
+   {
+      kmMat4RotationPitchYawRoll( &rotation, b * 0.05f, time + b * 0.1f, time * 0.5f );
+      kmMat4Scaling( &scaling, 1.0f, 2.0f, 0.5f );
+      kmMat4Translation( &translation, b * 0.01f, time, -(float)b );
+      kmMat4Multiply( &rotation, &rotation, &scaling );
+      kmMat4Multiply( &bone->globalMatrix, &translation, &rotation );
+   }
+}
+
+/* normal of vertex skinned by one bone stays perpendicular to surface */
+static int normalsFollow( dlBone **bone, const kmVec3 *tstance, const kmVec3 *normal,
+                          const kmVec3 *skinned, unsigned int vertices )
+{
+   kmVec3       axis, tangent, a, b;
+   unsigned int i;
+
+   /* every 11th vertex has only its own bone */
+   axis.x = 0; axis.y = 0; axis.z = 1;
+   for(i = 11; i < vertices; i += 11)
+   {
+      kmVec3Cross( &tangent, &normal[i], &axis );
+      kmVec3Add( &tangent, &tangent, &tstance[i] );
+      kmVec3Transform( &a, &tstance[i], &bone[ i % BONES ]->globalMatrix );
+      kmVec3Transform( &b, &tangent,    &bone[ i % BONES ]->globalMatrix );
+      kmVec3Subtract( &tangent, &b, &a );
+      kmVec3Normalize( &tangent, &tangent );
+
+      if(fabsf( kmVec3Dot( &tangent, &skinned[i] ) ) > 0.001f ||
+         fabsf( kmVec3Length( &skinned[i] ) - 1.0f ) > 0.001f)
+         return( 0 );
+   }
+   return( 1 );
+}
+
+int main( int argc, char **argv )
+{
+   static kmVec3 tstance[VERTICES], expected[VERTICES], skinned[VERTICES];
+   static kmVec3 tnormal[VERTICES], normal[VERTICES];
+   static dlBone *bone[BONES];
+   dlAnimator   *animator;
+   dlObject     *object;
+   dlSkin       *skin;
+   kmMat4       *matrix, *normalMatrix;
+   clock_t       start;
+   double        listTime, skinTime, normalTime;
+   float         sum, *w;
+   unsigned int  i, ok;
+
+   dlDEBINIT( argc, argv );
+
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   if(!(animator = dlNewAnimator()))
+      return( EXIT_FAILURE );
+
+   for(i = 0; i != BONES; ++i)
+      if(!(bone[i] = dlAnimatorAddBone( animator )))
+         return( EXIT_FAILURE );
+
+   for(i = 0; i != VERTICES; ++i)
+   {
+      tstance[i].x = (float)(i % 100) * 0.1f;
+      tstance[i].y = (float)(i / 100) * 0.1f;
+      tstance[i].z = (float)(i % 7);
+
+      tnormal[i].x = sinf( (float)i );
+      tnormal[i].y = cosf( (float)i );
+      tnormal[i].z = 0.5f;
+      kmVec3Normalize( &tnormal[i], &tnormal[i] );
+
+      sum = (float)(i % 11) / 10.0f;
+      dlBoneAddWeight( bone[ i % BONES ], i, 1.0f - sum );
+      if(sum > 0) dlBoneAddWeight( bone[ (i * 7 + 1) % BONES ], i, sum );
+   }
+
+   /* extra weights, weakest three fall off */
+   for(i = 0; i != CROWDED; ++i)
+      dlBoneAddWeight( bone[ 50 + i ], 0, 0.1f * (i + 1) );
+
+   pose( animator, 0.5f );
+
+   if(!(skin = dlNewSkin( animator, VERTICES )))
+      return( EXIT_FAILURE );
+
+   check( "influences limited", skin->influences == DL_SKIN_INFLUENCES && skin->bones == BONES );
+
+   w = &skin->weight[0];
+   check( "strongest kept", skin->bone[0] == 0 && skin->bone[1] == 56 &&
+                            skin->bone[2] == 55 && skin->bone[3] == 54 );
+   check( "weights renormalized", fabsf( w[0] + w[1] + w[2] + w[3] - 1.0f ) < 0.0001f );
+
+   for(i = 1, ok = 1; i != VERTICES; ++i)
+   {
+      w = &skin->weight[ i * DL_SKIN_INFLUENCES ];
+      if(w[0] < w[1] || w[2] != 0 || fabsf( w[0] + w[1] - 1.0f ) > 0.0001f) ok = 0;
+   }
+   check( "untouched weights kept", ok );
+
+   /* same result as weight lists, crowded vertex differs by design */
+   matrix       = skin->matrix;
+   normalMatrix = skin->normal;
+   dlSkinMatrices( skin, animator, matrix, NULL );
+   dlSkinVertices( skin, matrix, tstance, skinned, VERTICES );
+   referenceSkin( animator, tstance, expected, VERTICES );
+   printf( "max error %g\n", maxError( expected + 1, skinned + 1, VERTICES - 1 ) );
+   check( "matches weight lists", maxError( expected + 1, skinned + 1, VERTICES - 1 ) < 0.001f );
+
+   /* normals in same sweep, positions unchanged */
+   dlSkinMatrices( skin, animator, matrix, normalMatrix );
+   dlSkinVerticesNormals( skin, matrix, normalMatrix, tstance, expected,
+                          tnormal, normal, VERTICES );
+   check( "positions with normals", maxError( expected, skinned, VERTICES ) < 0.0001f );
+   check( "normals follow bones", normalsFollow( bone, tstance, tnormal, normal, VERTICES ) );
+
+   /* object builds its skin on first tick */
+   object = dlNewObject();
+   object->vbo = dlNewVBO();
+   dlInsertVertices( object->vbo, tstance, VERTICES );
+   dlInsertNormals( object->vbo, tnormal, VERTICES );
+   dlVBOPrepareTstance( object->vbo );
+   object->animator = dlRefAnimator( animator );
+
+   pose( animator, 1.5f );
+   dlObjectTick( object, 0.0f );
+   dlSkinMatrices( skin, animator, matrix, normalMatrix );
+   dlSkinVerticesNormals( skin, matrix, normalMatrix, tstance, skinned,
+                          tnormal, normal, VERTICES );
+   check( "object skinned", object->skin && object->vbo->v_use == VERTICES &&
+                            maxError( skinned, object->vbo->vertices, VERTICES ) < 0.0001f );
+   check( "object normals skinned", object->vbo->n_use == VERTICES &&
+                                    maxError( normal, object->vbo->normals, VERTICES ) < 0.0001f &&
+                                    maxError( tnormal, object->vbo->tnormal, VERTICES ) == 0 );
+
+   /* skin keeps its matrices, ticking needs no frame end */
+   for(i = 0; i != FRAMES; ++i)
+      dlObjectTick( object, 0.0f );
+   check( "ticks without frame end", maxError( skinned, object->vbo->vertices, VERTICES ) < 0.0001f );
+
+   /* whole pass against weight lists */
+   start = clock();
+   for(i = 0; i != FRAMES; ++i)
+      referenceSkin( animator, tstance, expected, VERTICES );
+   listTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES;
+
+   start = clock();
+   for(i = 0; i != FRAMES; ++i)
+   {
+      dlSkinMatrices( skin, animator, matrix, NULL );
+      dlSkinVertices( skin, matrix, tstance, skinned, VERTICES );
+   }
+   skinTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES;
+
+   start = clock();
+   for(i = 0; i != FRAMES; ++i)
+   {
+      dlSkinMatrices( skin, animator, matrix, normalMatrix );
+      dlSkinVerticesNormals( skin, matrix, normalMatrix, tstance, skinned,
+                             tnormal, normal, VERTICES );
+   }
+   normalTime = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / FRAMES;
+
+   printf( "%u vertices, %u bones: weight lists %.3f ms, influences %.3f ms, with normals %.3f ms\n",
+           VERTICES, BONES, listTime, skinTime, normalTime );
+
+   dlFreeObject( object );
+   dlFreeSkin( skin );
+   dlFreeAnimator( animator );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
@@ -145,6 +145,9 @@ int main( int argc, char **argv )
    if(!obj)
       cleanup(EXIT_FAILURE);
 
+   /* skinned every frame, stream it */
+   obj->vbo->hint = GL_STREAM_DRAW;
+
    obj->material = dlNewMaterialFromImage( "model/npc_1.tga",
                                             SOIL_FLAG_DEFAULTS        |
                                             SOIL_FLAG_TEXTURE_REPEATS );
@@ -247,6 +250,7 @@ int main( int argc, char **argv )
 #endif
 
       dlSwapBuffers();
+      dlEndFrame();
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
       if(fpsDelay < SDL_GetTicks())
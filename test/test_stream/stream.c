@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "DL/dl.h"
+#include "DL/dlRecord.h"
+#include "DL/dlStream.h"
+#include "../test.h"
+
+/* small segments so tests overflow them */
+#define SEGMENT 1024
+
+/* calls of type in log */
+static unsigned int countCalls( dleRecordCall call )
+{
+   const dlRecordCommand *command;
+   unsigned int i, count, found;
+
+   command = dlRecordLog( &count );
+   found   = 0;
+   for(i = 0; i != count; ++i)
+      if(command[i].call == call) ++found;
+
+   return( found );
+}
+
+/* 1 if some call of type had pointer argument inside ring memory */
+static int pointsToRing( dleRecordCall call, unsigned int arg )
+{
+   const dlRecordCommand *command;
+   const unsigned char   *ptr;
+   unsigned int i, count;
+
+   if(!dlStreamData())
+      return( 0 );
+
+   command = dlRecordLog( &count );
+   for(i = 0; i != count; ++i)
+   {
+      if(command[i].call != call)
+         continue;
+
+      ptr = (const unsigned char*)command[i].arg[arg];
+      if(ptr >= dlStreamData() && ptr < dlStreamData() + SEGMENT * DL_STREAM_FRAMES)
+         return( 1 );
+   }
+
+   return( 0 );
+}
+
+static size_t uploaded( void )
+{
+   dlRecordStats stats;
+
+   dlRecordGetStats( &stats );
+   return( stats.uploaded );
+}
+
+/* write size bytes to ring */
+static int fill( size_t size, size_t *offset )
+{
+   unsigned char *data;
+
+   if(!(data = dlStreamMap( size, offset )))
+      return( 0 );
+
+   memset( data, 0xab, size );
+   dlStreamUnmap();
+   return( 1 );
+}
+
+int main( int argc, char **argv )
+{
+   dlObject      *object;
+   dlRecordStats stats;
+   unsigned int  i, serial;
+   size_t        a, b;
+   int           ok;
+
+   dlDEBINIT( argc, argv );
+
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping" );
+      return( EXIT_SUCCESS );
+   }
+
+   /* mapped writes go straight to buffer */
+   ok = dlStreamInit( SEGMENT, DL_STREAM_MAP ) == 0;
+   check( "map method", ok && dlStreamMethod() == DL_STREAM_MAP && dlStreamObject() );
+
+   dlRecordReset();
+   serial = dlStreamSerial();
+   ok = fill( 100, &a ) && fill( 100, &b );
+   check( "writes aligned", ok && a == 0 && b == 128 );
+   check( "map writes through mapping", countCalls( DL_RECORD_MAP_BUFFER_RANGE ) == 2 &&
+          countCalls( DL_RECORD_UNMAP_BUFFER ) == 2 &&
+          !countCalls( DL_RECORD_BUFFER_SUB_DATA ) );
+
+   /* full segment moves on and fences the one it leaves */
+   ok = fill( SEGMENT - 100, &a );
+   check( "overflow advances", ok && a == SEGMENT && dlStreamSerial() == serial + 1 &&
+          countCalls( DL_RECORD_FENCE_SYNC ) == 1 );
+   check( "larger than segment refused", !dlStreamMap( SEGMENT + 1, &a ) );
+
+   /* back at first segment, its fence is waited on */
+   for(i = 1; i != DL_STREAM_FRAMES; ++i)
+   {
+      fill( 1, &a );
+      dlStreamEndFrame();
+   }
+   ok = fill( 1, &a );
+   check( "wrap waits for fence", ok && a == 0 &&
+          countCalls( DL_RECORD_CLIENT_WAIT_SYNC ) == 1 );
+
+   /* orphaning stages writes and uploads them on unmap */
+   ok = dlStreamInit( SEGMENT, DL_STREAM_ORPHAN ) == 0;
+   check( "orphan method", ok && dlStreamMethod() == DL_STREAM_ORPHAN && dlStreamObject() );
+
+   dlRecordReset();
+   ok = fill( 100, &a );
+   check( "orphan uploads on unmap", ok && countCalls( DL_RECORD_BUFFER_SUB_DATA ) == 1 &&
+          !countCalls( DL_RECORD_MAP_BUFFER_RANGE ) && uploaded() == 100 );
+
+   /* fresh storage when ring starts over, no fences needed */
+   for(i = 0; i != DL_STREAM_FRAMES; ++i)
+   {
+      fill( 1, &a );
+      dlStreamEndFrame();
+   }
+   check( "orphan on wrap", countCalls( DL_RECORD_BUFFER_DATA ) == 1 &&
+          !countCalls( DL_RECORD_FENCE_SYNC ) );
+
+   /* CPU ring is plain memory */
+   ok = dlStreamInit( SEGMENT, DL_STREAM_CPU ) == 0;
+   check( "cpu method", ok && dlStreamMethod() == DL_STREAM_CPU &&
+          !dlStreamObject() && dlStreamData() );
+
+   dlRecordReset();
+   ok = dlStreamMap( 100, &a ) == dlStreamData() + a;
+   dlStreamUnmap();
+   dlRecordGetStats( &stats );
+   check( "cpu writes without GL", ok && !stats.calls );
+
+   /* stream hint puts vertices in ring, drawn as client arrays */
+   if(!(object = dlNewPlane( 0.1, 0.1, 1 )))
+      return( EXIT_FAILURE );
+   object->vbo->hint = GL_STREAM_DRAW;
+
+   dlRecordReset();
+   dlDraw( object );
+   check( "cpu ring drawn from memory", object->vbo->streamed &&
+          pointsToRing( DL_RECORD_VERTEX_POINTER, 3 ) );
+   dlEndFrame();
+
+   /* ring started over, old serial must not match */
+   serial = object->vbo->serial;
+   ok = dlStreamInit( SEGMENT, DL_STREAM_MAP ) == 0;
+   check( "new ring expires data", ok && dlStreamSerial() != serial );
+
+   /* written once per segment */
+   dlRecordReset();
+   dlDraw( object );
+   dlDraw( object );
+   check( "streamed once per frame", object->vbo->serial == dlStreamSerial() &&
+          countCalls( DL_RECORD_MAP_BUFFER_RANGE ) == 1 );
+   dlEndFrame();
+
+   /* next segment, dlVBOUpdate writes it again */
+   serial = object->vbo->serial;
+   dlRecordReset();
+   dlDraw( object );
+   check( "expired data streamed again", serial != dlStreamSerial() &&
+          object->vbo->serial == dlStreamSerial() &&
+          countCalls( DL_RECORD_MAP_BUFFER_RANGE ) == 1 );
+   dlEndFrame();
+
+   dlFreeObject( object );
+   dlStreamFree();
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}
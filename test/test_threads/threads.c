@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DL/dl.h"
+#include "DL/dlRecord.h"
+#include "../test.h"
+
+/* roots in grid side, each with childs */
+#define GRID    96
+#define OBJECTS (GRID * GRID)
+#define CHILDS  3
+
+/* frames timed per run */
+#define FRAMES  20
+
+/* largest pool tested */
+#define THREADS 4
+
+/* wall clock, CPU time would add up threads */
+static double now( void )
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return( ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0 );
+}
+
+/* jobs write their own index */
+static void markJob( void *user, unsigned int index )
+{
+   ((unsigned int*)user)[index] = index + 1;
+}
+
+/* move scene and queue it for frames, returns milliseconds spent queuing per frame */
+static double queueFrames( dlJobPool *pool, dlObject **object, dlRenderStats *stats )
+{
+   double queued, start;
+   unsigned int f, i;
+
+   queued = 0;
+   for(f = 0; f != FRAMES; ++f)
+   {
+      /* matrices are rebuilt by the jobs */
+      for(i = 0; i != OBJECTS; ++i)
+         dlRotateObjectf( object[i], 0, 0, 1 );
+
+      start = now();
+      dlQueueDrawList( pool, object, OBJECTS, 0 );
+      queued += now() - start;
+
+      dlFlushQueue();
+      dlEndFrame();
+
+      /* log grows until reset */
+      dlRecordReset();
+   }
+
+   dlGetRenderStats( stats );
+   return( queued / FRAMES );
+}
+
+int main( int argc, char **argv )
+{
+   static dlObject *object[OBJECTS];
+   static unsigned int mark[1000];
+   dlObject      *plane, *child;
+   dlJobPool     *pool;
+   dlRenderStats serial, stats;
+   kmMat4        projection;
+   double        serialTime, time;
+   unsigned int  i, t;
+
+   dlDEBINIT( argc, argv );
+
+   /* pool on its own */
+   if(!(pool = dlNewJobPool( THREADS - 1 )))
+      return( EXIT_FAILURE );
+   dlJobPoolRun( pool, markJob, mark, 1000 );
+   for(i = 0; i != 1000 && mark[i] == i + 1; ++i);
+   check( "every job runs once", i == 1000 );
+   dlFreeJobPool( pool );
+
+   /* recording renderer only runs the CPU side of drawing */
+   if(dlCreateDisplay( 640, 480, DL_RENDER_RECORD ) != 0)
+   {
+      puts( "built without GL recording (make RECORD=1), skipping scene" );
+      return( testResult() );
+   }
+
+   /* projection sees part of grid */
+   kmMat4OrthographicProjection( &projection, -GRID / 3, GRID / 3, -GRID / 3, GRID / 3, -1, 1 );
+   dlSetProjection( projection );
+
+   if(!(plane = dlNewPlane( 0.5, 0.5, 1 )))
+      return( EXIT_FAILURE );
+   dlScaleObjectf( plane, 1, 1, 1 );
+
+   for(i = 0; i != OBJECTS; ++i)
+   {
+      if(!(object[i] = dlCopyObject( plane )))
+         return( EXIT_FAILURE );
+
+      for(t = 0; t != CHILDS; ++t)
+      {
+         if(!(child = dlCopyObject( plane )))
+            return( EXIT_FAILURE );
+         dlObjectAddChild( object[i], child );
+      }
+
+      dlPositionObjectf( object[i], (float)(i % GRID) - GRID / 2,
+                                    (float)(i / GRID) - GRID / 2, 0 );
+   }
+
+   serialTime = queueFrames( NULL, object, &serial );
+   printf( "serial: %u visible, %u culled, %.3f ms per frame\n",
+           serial.visible, serial.culled, serialTime );
+   check( "serial culls", serial.visible && serial.culled );
+
+   for(t = 1; t != THREADS; ++t)
+   {
+      if(!(pool = dlNewJobPool( t )))
+         return( EXIT_FAILURE );
+
+      time = queueFrames( pool, object, &stats );
+      printf( "%u threads: %u visible, %u culled, %.3f ms per frame, %.2fx\n",
+              pool->threads + 1, stats.visible, stats.culled, time,
+              time > 0 ? serialTime / time : 0 );
+      check( "same draws as serial", stats.visible == serial.visible &&
+                                     stats.culled  == serial.culled &&
+                                     stats.draws   == serial.draws );
+
+      dlFreeJobPool( pool );
+   }
+
+   /* child shared by roots of different slices is queued with its parent */
+   if(!(child = dlCopyObject( plane )))
+      return( EXIT_FAILURE );
+   dlObjectAddChild( object[ OBJECTS / 2 + GRID / 2 ], child );
+   dlObjectAddChild( object[ OBJECTS / 2 + GRID / 2 + GRID * 8 ], dlRefObject( child ) );
+
+   if(!(pool = dlNewJobPool( THREADS - 1 )))
+      return( EXIT_FAILURE );
+   queueFrames( pool, object, &stats );
+   check( "shared child queued once", stats.visible == serial.visible + 1 );
+   dlFreeJobPool( pool );
+
+   for(i = 0; i != OBJECTS; ++i)
+      dlFreeObject( object[i] );
+   dlFreeObject( plane );
+
+   dlFreeDisplay();
+   dlMemoryGraph();
+
+   return( testResult() );
+}